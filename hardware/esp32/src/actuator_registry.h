@@ -0,0 +1,167 @@
+#ifndef ACTUATOR_REGISTRY_H
+#define ACTUATOR_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+
+/**
+ * Registro de actuadores generado en compilación a partir de ACTUATOR_LIST
+ * (config.h). Cada entrada asocia topic, pin, nombre y posición en el
+ * arreglo de estados. El despacho de un topic entrante usa una tabla hash
+ * perfecta calculada por el compilador: coste constante sin importar el
+ * número de relays. Añadir un actuador solo requiere una línea en config.h.
+ */
+
+// Identificadores (posición en el arreglo de estados)
+enum ActuatorId : uint8_t {
+#define ACTUATOR_ENUM(id, suffix, pin, name) ACTUATOR_##id,
+  ACTUATOR_LIST(ACTUATOR_ENUM)
+#undef ACTUATOR_ENUM
+  ACTUATOR_COUNT
+};
+
+struct ActuatorInfo {
+  const char* topic;     // Topic completo de comandos
+  const char* suffix;    // Parte posterior a TOPIC_ACTUADORES_PREFIX
+  uint8_t suffixLength;
+  uint8_t pin;
+  const char* name;
+};
+
+constexpr size_t constLength(const char* s) {
+  return *s ? 1 + constLength(s + 1) : 0;
+}
+
+constexpr ActuatorInfo ACTUATORS[ACTUATOR_COUNT] = {
+#define ACTUATOR_INFO(id, suffix, pin, name) \
+  { TOPIC_ACTUADORES_PREFIX suffix, suffix, (uint8_t)constLength(suffix), pin, name },
+  ACTUATOR_LIST(ACTUATOR_INFO)
+#undef ACTUATOR_INFO
+};
+
+constexpr size_t ACTUATOR_PREFIX_LENGTH = constLength(TOPIC_ACTUADORES_PREFIX);
+
+// ============================================
+// HASH PERFECTO
+// ============================================
+
+// FNV-1a con semilla
+constexpr uint32_t actuatorHash(const char* s, size_t length, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (size_t i = 0; i < length; i++) {
+    h = (h ^ (uint8_t)s[i]) * 16777619u;
+  }
+  return h;
+}
+
+// Tabla con al menos el doble de huecos que actuadores (potencia de 2)
+constexpr size_t dispatchTableSize(size_t n) {
+  size_t size = 4;
+  while (size < 2 * n) {
+    size <<= 1;
+  }
+  return size;
+}
+
+constexpr uint8_t ACTUATOR_EMPTY_SLOT = 0xFF;
+constexpr uint32_t ACTUATOR_NO_SEED = 0xFFFFFFFFu;
+
+/**
+ * Tabla de despacho de un registro de N actuadores: semilla sin colisiones
+ * y, por hueco, la posición del actuador (ACTUATOR_EMPTY_SLOT si libre).
+ * Se construye igual en compilación (ACTUATORS) que en ejecución (registros
+ * generados por los benchmarks del host).
+ */
+template <size_t N>
+struct ActuatorDispatchTable {
+  static constexpr size_t SIZE = dispatchTableSize(N);
+  uint32_t seed;
+  uint8_t slots[SIZE];
+};
+
+template <size_t N>
+constexpr bool seedIsPerfect(const ActuatorInfo (&actuators)[N], uint32_t seed) {
+  bool used[ActuatorDispatchTable<N>::SIZE] = {};
+  for (size_t i = 0; i < N; i++) {
+    size_t slot = actuatorHash(actuators[i].suffix, actuators[i].suffixLength, seed) &
+                  (ActuatorDispatchTable<N>::SIZE - 1);
+    if (used[slot]) {
+      return false;
+    }
+    used[slot] = true;
+  }
+  return true;
+}
+
+template <size_t N>
+constexpr uint32_t findPerfectSeed(const ActuatorInfo (&actuators)[N]) {
+  for (uint32_t seed = 0; seed < 100000; seed++) {
+    if (seedIsPerfect(actuators, seed)) {
+      return seed;
+    }
+  }
+  return ACTUATOR_NO_SEED;
+}
+
+template <size_t N>
+constexpr ActuatorDispatchTable<N> buildDispatchTable(const ActuatorInfo (&actuators)[N]) {
+  static_assert(N < ACTUATOR_EMPTY_SLOT, "Demasiados actuadores");
+
+  ActuatorDispatchTable<N> table = {};
+  table.seed = findPerfectSeed(actuators);
+  for (size_t i = 0; i < ActuatorDispatchTable<N>::SIZE; i++) {
+    table.slots[i] = ACTUATOR_EMPTY_SLOT;
+  }
+  for (size_t i = 0; i < N && table.seed != ACTUATOR_NO_SEED; i++) {
+    size_t slot = actuatorHash(actuators[i].suffix, actuators[i].suffixLength, table.seed) &
+                  (ActuatorDispatchTable<N>::SIZE - 1);
+    table.slots[slot] = i;
+  }
+  return table;
+}
+
+/**
+ * Posición del actuador de un topic de comandos en actuators; N si el
+ * topic no corresponde a ninguno
+ */
+template <size_t N>
+inline size_t dispatchTopic(const ActuatorInfo (&actuators)[N],
+                            const ActuatorDispatchTable<N>& table,
+                            const char* topic, size_t length) {
+  if (length <= ACTUATOR_PREFIX_LENGTH ||
+      memcmp(topic, TOPIC_ACTUADORES_PREFIX, ACTUATOR_PREFIX_LENGTH) != 0) {
+    return N;
+  }
+
+  const char* suffix = topic + ACTUATOR_PREFIX_LENGTH;
+  size_t suffixLength = length - ACTUATOR_PREFIX_LENGTH;
+  size_t slot = actuatorHash(suffix, suffixLength, table.seed) &
+                (ActuatorDispatchTable<N>::SIZE - 1);
+  uint8_t index = table.slots[slot];
+
+  // Confirmar: un topic desconocido puede caer en un hueco ocupado
+  if (index == ACTUATOR_EMPTY_SLOT ||
+      actuators[index].suffixLength != suffixLength ||
+      memcmp(actuators[index].suffix, suffix, suffixLength) != 0) {
+    return N;
+  }
+
+  return index;
+}
+
+constexpr ActuatorDispatchTable<ACTUATOR_COUNT> ACTUATOR_DISPATCH = buildDispatchTable(ACTUATORS);
+
+static_assert(ACTUATOR_DISPATCH.seed != ACTUATOR_NO_SEED,
+              "No se encontró una semilla sin colisiones para ACTUATOR_LIST");
+
+/**
+ * Busca el actuador de un topic de comandos. Retorna ACTUATOR_COUNT si el
+ * topic no corresponde a ningún actuador registrado.
+ */
+inline ActuatorId findActuatorByTopic(const char* topic, size_t length) {
+  return (ActuatorId)dispatchTopic(ACTUATORS, ACTUATOR_DISPATCH, topic, length);
+}
+
+#endif // ACTUATOR_REGISTRY_H
@@ -0,0 +1,80 @@
+#ifndef ADC_DOUBLE_BUFFER_H
+#define ADC_DOUBLE_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Doble buffer de bloques de muestras del ADC, entrelazadas por canal
+ * ([bloque][muestra][canal]).
+ *
+ * El productor (temporizador) llena un bloque mientras el consumidor lee
+ * el otro; al completarse se intercambian y se publica un número de
+ * secuencia. El consumidor toma siempre el bloque completo más reciente y
+ * cuenta como perdidos los que el productor reutilizó antes de leerlos.
+ * Sin memoria dinámica; solo depende de std::atomic. write() solo debe
+ * llamarse desde el productor y take() solo desde el consumidor.
+ */
+template <size_t SAMPLES, size_t CHANNELS>
+class AdcDoubleBuffer {
+public:
+  AdcDoubleBuffer() : fillBlock(0), fillPos(0), readySeq(0), consumedSeq(0) {}
+
+  /**
+   * Anota una muestra de cada canal. Retorna true si completa un bloque.
+   */
+  bool write(const uint16_t* values) {
+    for (size_t ch = 0; ch < CHANNELS; ch++) {
+      blocks[fillBlock][fillPos][ch] = values[ch];
+    }
+
+    if (++fillPos < SAMPLES) {
+      return false;
+    }
+
+    // Publicar el bloque lleno y pasar al otro
+    fillPos = 0;
+    fillBlock ^= 1;
+    readySeq.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Bloque completo más reciente sin leer (SAMPLES x CHANNELS muestras) o
+   * nullptr si no hay ninguno nuevo. lost recibe los bloques que se
+   * completaron y no llegaron a leerse.
+   */
+  const uint16_t* take(uint32_t& lost) {
+    uint32_t ready = readySeq.load(std::memory_order_acquire);
+    lost = 0;
+
+    if (ready == consumedSeq) {
+      return nullptr;
+    }
+
+    // Con más de un bloque pendiente el productor ya reutilizó el anterior
+    lost = ready - consumedSeq - 1;
+    consumedSeq = ready;
+
+    // El bloque completo más reciente es el que no se está llenando
+    return &blocks[(ready - 1) & 1][0][0];
+  }
+
+  static constexpr size_t samples() {
+    return SAMPLES;
+  }
+
+  static constexpr size_t channels() {
+    return CHANNELS;
+  }
+
+private:
+  uint16_t blocks[2][SAMPLES][CHANNELS];
+  uint8_t fillBlock;                  // Productor
+  uint16_t fillPos;                   // Productor
+  std::atomic<uint32_t> readySeq;     // Bloques completos producidos
+  uint32_t consumedSeq;               // Bloques procesados (consumidor)
+};
+
+#endif // ADC_DOUBLE_BUFFER_H
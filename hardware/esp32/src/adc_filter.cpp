@@ -0,0 +1,83 @@
+#include "adc_filter.h"
+
+AdcDecimator::AdcDecimator()
+  : decimation(1), window(1), accumulator(0), accumulated(0), blockMin(0),
+    blockMax(0), head(0), filled(0), historySum(0), lastOutput(0), outputCount(0) {}
+
+void AdcDecimator::begin(uint16_t decimationFactor, uint8_t windowSize) {
+  decimation = decimationFactor > 0 ? decimationFactor : 1;
+  window = windowSize == 0 ? 1 :
+           windowSize > ADC_FILTER_MAX_WINDOW ? ADC_FILTER_MAX_WINDOW : windowSize;
+  accumulator = 0;
+  accumulated = 0;
+  head = 0;
+  filled = 0;
+  historySum = 0;
+  lastOutput = 0;
+  outputCount = 0;
+}
+
+/**
+ * Incorpora un valor diezmado al promedio móvil
+ */
+void AdcDecimator::emit(float output) {
+  if (filled == window) {
+    historySum -= history[head];
+  } else {
+    filled++;
+  }
+
+  history[head] = output;
+  historySum += output;
+  head = (head + 1) % window;
+
+  lastOutput = output;
+  outputCount++;
+
+  // Recalcular la suma de vez en cuando para acotar el error de redondeo
+  if ((outputCount & 0xFF) == 0) {
+    historySum = 0;
+    for (uint8_t i = 0; i < filled; i++) {
+      historySum += history[i];
+    }
+  }
+}
+
+void AdcDecimator::push(uint16_t sample) {
+  if (accumulated == 0 || sample < blockMin) {
+    blockMin = sample;
+  }
+  if (accumulated == 0 || sample > blockMax) {
+    blockMax = sample;
+  }
+  accumulator += sample;
+  accumulated++;
+
+  if (accumulated >= decimation) {
+    // Media recortada: sin la muestra mínima ni la máxima del bloque
+    if (accumulated >= ADC_FILTER_TRIM_MIN) {
+      emit((float)(accumulator - blockMin - blockMax) / (accumulated - 2));
+    } else {
+      emit((float)accumulator / accumulated);
+    }
+    accumulator = 0;
+    accumulated = 0;
+  }
+}
+
+/**
+ * Procesa un bloque de muestras; stride permite leer un canal de un
+ * buffer entrelazado sin copiarlo
+ */
+void AdcDecimator::pushBlock(const uint16_t* samples, size_t count, size_t stride) {
+  for (size_t i = 0; i < count; i++) {
+    push(samples[i * stride]);
+  }
+}
+
+/**
+ * Promedio móvil de los últimos valores diezmados (cuentas crudas del ADC)
+ */
+float AdcDecimator::value() const {
+  return filled > 0 ? historySum / filled : 0;
+}
@@ -0,0 +1,51 @@
+#ifndef ADC_FILTER_H
+#define ADC_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADC_FILTER_MAX_WINDOW 32
+#define ADC_FILTER_TRIM_MIN 4          // Diezmado mínimo para descartar extremos
+
+/**
+ * Etapa de sobremuestreo y diezmado para un canal del ADC.
+ *
+ * Acumula `decimation` muestras crudas y produce su promedio (ganando
+ * resolución y rechazando ruido). Con ADC_FILTER_TRIM_MIN muestras o más
+ * se descartan la mínima y la máxima de cada bloque, de modo que un pico
+ * o una caída aislados del ADC no desplazan el valor. Los últimos
+ * `window` valores diezmados forman un promedio móvil que se consulta en
+ * O(1) en cualquier momento.
+ * Sin memoria dinámica ni dependencias de Arduino.
+ */
+class AdcDecimator {
+public:
+  AdcDecimator();
+
+  void begin(uint16_t decimation, uint8_t window);
+  void push(uint16_t sample);
+  void pushBlock(const uint16_t* samples, size_t count, size_t stride);
+
+  bool ready() const { return filled > 0; }
+  float value() const;
+  float latest() const { return lastOutput; }
+  uint32_t outputs() const { return outputCount; }
+
+private:
+  void emit(float output);
+
+  uint16_t decimation;
+  uint8_t window;
+  uint32_t accumulator;
+  uint16_t accumulated;
+  uint16_t blockMin;
+  uint16_t blockMax;
+  float history[ADC_FILTER_MAX_WINDOW];
+  uint8_t head;
+  uint8_t filled;
+  float historySum;
+  float lastOutput;
+  uint32_t outputCount;
+};
+
+#endif // ADC_FILTER_H
@@ -0,0 +1,191 @@
+#include "adc_sampler.h"
+#include "adc_double_buffer.h"
+#include "adc_filter.h"
+#include "config.h"
+#include "logger.h"
+#include <atomic>
+#include <esp_idf_version.h>
+
+/**
+ * Muestreo continuo del ADC1 para los sensores analógicos.
+ *
+ * Con ESP-IDF 5 se usa el modo continuo con DMA (adc_continuous): el
+ * hardware recorre CH6/CH7 a ADC_SAMPLE_RATE_HZ y el driver deja las
+ * tramas en su buffer circular. Con ESP-IDF 4 (Arduino 2.x), cuyo driver
+ * continuo no soporta el ESP32 original, un temporizador esp_timer muestrea
+ * ambos canales a ADC_TIMER_RATE_HZ sobre un doble buffer.
+ * En ambos casos adcSamplerPoll() solo procesa lo ya capturado: nunca espera.
+ */
+
+AdcDecimator adcFilters[ADC_CHANNEL_COUNT];
+std::atomic<uint32_t> adcOverruns(0);
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+// ============================================
+// MODO CONTINUO CON DMA (ESP-IDF 5)
+// ============================================
+#include <esp_adc/adc_continuous.h>
+
+#define ADC_FRAME_BYTES 256
+
+adc_continuous_handle_t adcHandle = nullptr;
+
+// Se llama desde ISR cuando el buffer del driver se llena antes de leerlo
+static bool IRAM_ATTR onAdcPoolOverflow(adc_continuous_handle_t handle,
+                                        const adc_continuous_evt_data_t* edata,
+                                        void* userData) {
+  adcOverruns++;
+  return false;
+}
+
+bool initAdcSampler() {
+  uint32_t perChannelRate = ADC_SAMPLE_RATE_HZ / ADC_CHANNEL_COUNT;
+  for (int i = 0; i < ADC_CHANNEL_COUNT; i++) {
+    adcFilters[i].begin(perChannelRate / ADC_OUTPUT_RATE_HZ, ADC_FILTER_WINDOW);
+  }
+
+  adc_continuous_handle_cfg_t handleConfig = {};
+  handleConfig.max_store_buf_size = ADC_FRAME_BYTES * 4;
+  handleConfig.conv_frame_size = ADC_FRAME_BYTES;
+  if (adc_continuous_new_handle(&handleConfig, &adcHandle) != ESP_OK) {
+    LOG_E(LOG_SENSORS, "No se pudo crear el driver ADC continuo");
+    return false;
+  }
+
+  adc_digi_pattern_config_t pattern[ADC_CHANNEL_COUNT] = {};
+  const uint8_t channels[ADC_CHANNEL_COUNT] = { ADC_CHANNEL_SOIL, ADC_CHANNEL_LDR };
+  for (int i = 0; i < ADC_CHANNEL_COUNT; i++) {
+    pattern[i].atten = ADC_ATTEN_DB_11; // Rango completo 0-3.3V
+    pattern[i].channel = channels[i];
+    pattern[i].unit = ADC_UNIT_1;
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_continuous_config_t config = {};
+  config.pattern_num = ADC_CHANNEL_COUNT;
+  config.adc_pattern = pattern;
+  config.sample_freq_hz = ADC_SAMPLE_RATE_HZ;
+  config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+  adc_continuous_evt_cbs_t callbacks = {};
+  callbacks.on_pool_ovf = onAdcPoolOverflow;
+
+  if (adc_continuous_config(adcHandle, &config) != ESP_OK ||
+      adc_continuous_register_event_callbacks(adcHandle, &callbacks, nullptr) != ESP_OK ||
+      adc_continuous_start(adcHandle) != ESP_OK) {
+    LOG_E(LOG_SENSORS, "No se pudo iniciar el ADC continuo");
+    return false;
+  }
+
+  LOG_I(LOG_SENSORS, "ADC continuo (DMA) a %u Hz", (unsigned)ADC_SAMPLE_RATE_HZ);
+  return true;
+}
+
+/**
+ * Procesa las tramas DMA disponibles sin esperar
+ */
+void adcSamplerPoll() {
+  if (adcHandle == nullptr) {
+    return;
+  }
+
+  uint8_t frame[ADC_FRAME_BYTES];
+  uint32_t length = 0;
+
+  while (adc_continuous_read(adcHandle, frame, sizeof(frame), &length, 0) == ESP_OK) {
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t* result = (const adc_digi_output_data_t*)&frame[i];
+
+      if (result->type1.channel == ADC_CHANNEL_SOIL) {
+        adcFilters[ADC_SOIL].push(result->type1.data);
+      } else if (result->type1.channel == ADC_CHANNEL_LDR) {
+        adcFilters[ADC_LIGHT].push(result->type1.data);
+      }
+    }
+  }
+}
+
+#else
+// ============================================
+// MUESTREO POR TEMPORIZADOR CON DOBLE BUFFER (ESP-IDF 4)
+// ============================================
+#include <driver/adc.h>
+#include <esp_timer.h>
+
+#define ADC_BLOCK_SAMPLES 32
+
+AdcDoubleBuffer<ADC_BLOCK_SAMPLES, ADC_CHANNEL_COUNT> adcBlocks;
+esp_timer_handle_t adcTimer = nullptr;
+
+/**
+ * Productor: corre en la tarea de esp_timer a ADC_TIMER_RATE_HZ
+ */
+static void adcTimerCallback(void* arg) {
+  uint16_t values[ADC_CHANNEL_COUNT];
+  values[ADC_SOIL] = adc1_get_raw((adc1_channel_t)ADC_CHANNEL_SOIL);
+  values[ADC_LIGHT] = adc1_get_raw((adc1_channel_t)ADC_CHANNEL_LDR);
+  adcBlocks.write(values);
+}
+
+bool initAdcSampler() {
+  for (int i = 0; i < ADC_CHANNEL_COUNT; i++) {
+    adcFilters[i].begin(ADC_TIMER_RATE_HZ / ADC_OUTPUT_RATE_HZ, ADC_FILTER_WINDOW);
+  }
+
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  adc1_config_channel_atten((adc1_channel_t)ADC_CHANNEL_SOIL, ADC_ATTEN_DB_11);
+  adc1_config_channel_atten((adc1_channel_t)ADC_CHANNEL_LDR, ADC_ATTEN_DB_11);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = adcTimerCallback;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = "adc";
+
+  if (esp_timer_create(&timerArgs, &adcTimer) != ESP_OK ||
+      esp_timer_start_periodic(adcTimer, 1000000 / ADC_TIMER_RATE_HZ) != ESP_OK) {
+    LOG_E(LOG_SENSORS, "No se pudo iniciar el muestreo del ADC");
+    return false;
+  }
+
+  LOG_I(LOG_SENSORS, "ADC muestreado por temporizador a %u Hz", (unsigned)ADC_TIMER_RATE_HZ);
+  return true;
+}
+
+/**
+ * Consumidor: procesa el último bloque completo, si hay uno nuevo
+ */
+void adcSamplerPoll() {
+  uint32_t lost;
+  const uint16_t* block = adcBlocks.take(lost);
+
+  if (block == nullptr) {
+    return;
+  }
+
+  adcOverruns += lost;
+  for (int ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+    adcFilters[ch].pushBlock(block + ch, ADC_BLOCK_SAMPLES, ADC_CHANNEL_COUNT);
+  }
+}
+#endif
+
+/**
+ * Valor filtrado más reciente de un canal (cuentas crudas 0-4095).
+ * Retorna false si todavía no hay suficientes muestras.
+ */
+bool readAdcChannel(AdcChannelId channel, float& raw) {
+  if (channel >= ADC_CHANNEL_COUNT || !adcFilters[channel].ready()) {
+    return false;
+  }
+
+  raw = adcFilters[channel].value();
+  return true;
+}
+
+/**
+ * Bloques o tramas perdidos porque el consumidor no los leyó a tiempo
+ */
+uint32_t adcSamplerOverruns() {
+  return adcOverruns;
+}
@@ -0,0 +1,13 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+#include "hal.h"
+
+// Funciones públicas
+bool initAdcSampler();
+void adcSamplerPoll();
+bool readAdcChannel(AdcChannelId channel, float& raw);
+uint32_t adcSamplerOverruns();
+
+#endif // ADC_SAMPLER_H
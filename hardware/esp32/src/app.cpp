@@ -0,0 +1,940 @@
+#include "app.h"
+#include <ArduinoJson.h>
+#include <atomic>
+#include <string.h>
+#include "config.h"
+#include "hal.h"
+#include "sensors.h"
+#include "mqtt_client.h"
+#include "connectivity.h"
+#include "spsc_ring.h"
+#include "actuator_registry.h"
+#include "storage_backend.h"
+#include "telemetry_log.h"
+#include "telemetry_batcher.h"
+#include "payload_codec.h"
+#include "trace.h"
+#include "boot_timings.h"
+#include "diagnostics.h"
+#include "logger.h"
+#include "rule_engine.h"
+#include "climate_control.h"
+#include "report_filter.h"
+#include "sampling_scheduler.h"
+
+/**
+ * Lógica del firmware, independiente de la plataforma.
+ * main.cpp la ejecuta en dos tareas FreeRTOS; en el host la ejecuta
+ * native/native_main.cpp sobre la HAL nativa.
+ */
+
+// Comando de actuador (tarea de red -> tarea de adquisición)
+struct ActuatorCommand {
+  ActuatorId actuator;
+  bool state;
+};
+
+// Alertas de las reglas para una lectura (tarea de adquisición -> tarea de red)
+struct AlertMessage {
+  unsigned long timestamp;
+  size_t count;
+  Alert alerts[4];
+};
+
+// Colas entre núcleos
+SpscRing<SensorData, TELEMETRY_QUEUE_LEN> telemetryQueue;   // adquisición -> red
+SpscRing<ActuatorCommand, COMMAND_QUEUE_LEN> commandQueue;  // red -> adquisición
+SpscRing<AlertMessage, ALERT_QUEUE_LEN> alertQueue;         // adquisición -> red
+
+// Registro persistente para cortes de MQTT (propiedad de la tarea de red)
+TelemetryLog telemetryStore;
+bool storeReady = false;
+unsigned long lastDrainRefill = 0;
+uint32_t drainTokens = 0;
+
+// Publicación por lotes (propiedad de la tarea de red). El payload debe
+// caber en una ranura de la cola MQTT junto con la cabecera y el topic.
+uint8_t telemetryBuffer[MQTT_BUFFER_SIZE - 64];
+TelemetryBatcher telemetryBatcher(telemetryBuffer, sizeof(telemetryBuffer));
+
+// Etapas del arranque que completa la tarea de red (ver networkBootStep)
+enum NetworkBootStage : uint8_t {
+  NET_BOOT_STORAGE,
+  NET_BOOT_MQTT,
+  NET_BOOT_DONE
+};
+
+// Variables globales
+unsigned long ledOffAt = 0;
+bool ledBlinking = false;
+uint8_t bootBlinkToggles = 0;
+unsigned long nextBootBlinkAt = 0;
+NetworkBootStage networkBootStage = NET_BOOT_STORAGE;
+bool systemInitialized = false;
+std::atomic<bool> publishBlinkRequest(false);
+std::atomic<uint32_t> droppedReadings(0);
+std::atomic<uint32_t> droppedCommands(0);
+std::atomic<uint32_t> droppedAlerts(0);
+std::atomic<bool> telemetryFlushRequest(false);   // Lectura urgente en la cola
+
+// Reporte por excepción (propiedad de la tarea de adquisición)
+ReportFilter reportFilter;
+
+// Calendario de lectura de cada sensor (propiedad de la tarea de adquisición)
+#if ADAPTIVE_SAMPLING
+const SamplingPolicy SAMPLING_POLICY = {
+  { { SAMPLING_DHT_MIN_MS, SAMPLING_DHT_MAX_MS }, { SAMPLING_SOIL_MIN_MS, SAMPLING_SOIL_MAX_MS },
+    { SAMPLING_LIGHT_MIN_MS, SAMPLING_LIGHT_MAX_MS } },
+  { SAMPLING_TEMP_STEP, SAMPLING_HUM_STEP, SAMPLING_SOIL_STEP, SAMPLING_LUX_STEP },
+  SAMPLING_LEAD, SAMPLING_RELEASE, SAMPLING_COALESCE
+};
+#else
+// Intervalo fijo: todos los sensores juntos
+const SamplingPolicy SAMPLING_POLICY = {
+  { { SENSOR_READ_INTERVAL_MS, SENSOR_READ_INTERVAL_MS },
+    { SENSOR_READ_INTERVAL_MS, SENSOR_READ_INTERVAL_MS },
+    { SENSOR_READ_INTERVAL_MS, SENSOR_READ_INTERVAL_MS } },
+  { 1, 1, 1, 1 }, 1, 1, 1
+};
+#endif
+SamplingScheduler samplingScheduler;
+
+// Fuente de lecturas de la tarea de adquisición (ver appSetReadingSource)
+static uint8_t acquireFromSensors(uint8_t sensors, SensorData& data);
+ReadingSource readingSource = acquireFromSensors;
+
+// Estados de actuadores, indexados por ActuatorId
+// (propiedad de la tarea de adquisición)
+bool actuatorStates[ACTUATOR_COUNT] = {};
+
+// Reglas de control y alerta (propiedad de la tarea de adquisición)
+#define RULE_ENTRY(metric, comparator, threshold, hysteresis, dwellMs, actuator, severity) \
+  { ALERT_##metric, RULE_##comparator, ACTUATOR_##actuator, SEVERITY_##severity, \
+    threshold, hysteresis, dwellMs },
+const Rule DEFAULT_RULES[] = {
+  RULE_LIST(RULE_ENTRY)
+};
+#undef RULE_ENTRY
+
+RuleSlot ruleSlots[RULE_CAPACITY];
+RuleEngine ruleEngine(ruleSlots, RULE_CAPACITY);
+uint32_t ruleDemand = 0;   // Actuadores pedidos por las reglas en la última lectura
+
+// Reglas recibidas en TOPIC_REGLAS (tarea de red -> tarea de adquisición):
+// la tarea de red solo escribe la tabla con rulesPending a false
+Rule pendingRules[RULE_CAPACITY];
+size_t pendingRuleCount = 0;
+std::atomic<bool> rulesPending(false);
+StaticJsonDocument<RULES_JSON_SIZE> rulesDocument;   // Propiedad de la tarea de red
+
+// Control en lazo cerrado (propiedad de la tarea de adquisición)
+struct ClimateLoop {
+  ActuatorId actuator;
+  ControlLoopConfig config;
+  ControlLoop loop;
+  float measurement;           // Última medida y su instante
+  unsigned long measuredAt;
+  bool measured;
+  bool manual;                 // Suspendido por un comando hasta manualUntil
+  unsigned long manualUntil;
+};
+
+enum ClimateLoopId : uint8_t {
+  CLIMATE_FAN,
+  CLIMATE_PUMP,
+  CLIMATE_LOOP_COUNT
+};
+
+#if CLIMATE_CONTROL
+ClimateLoop climateLoops[CLIMATE_LOOP_COUNT] = {
+  { ACTUATOR_VENTILADOR,
+    { FAN_SETPOINT, { FAN_KP, FAN_KI, FAN_KD, true },
+      { FAN_WINDOW_MS, FAN_MIN_ON_MS, FAN_MIN_OFF_MS } } },
+  { ACTUATOR_BOMBA,
+    { PUMP_SETPOINT, { PUMP_KP, PUMP_KI, PUMP_KD, false },
+      { PUMP_WINDOW_MS, PUMP_MIN_ON_MS, PUMP_MIN_OFF_MS } } }
+};
+const uint32_t CLIMATE_ACTUATORS = (1u << ACTUATOR_VENTILADOR) | (1u << ACTUATOR_BOMBA);
+#else
+const uint32_t CLIMATE_ACTUATORS = 0;
+#endif
+uint32_t controlTicks = 0;
+
+/**
+ * Inicializa los pines de actuadores
+ */
+void initActuators() {
+  LOG_I(LOG_APP, "Inicializando actuadores...");
+  
+  // Apagar todos los relays al inicio (relays activos en LOW)
+  for (size_t i = 0; i < ACTUATOR_COUNT; i++) {
+    halPinOutput(ACTUATORS[i].pin);
+    halPinWrite(ACTUATORS[i].pin, true);
+  }
+  
+  halPinOutput(PIN_LED_STATUS);
+  halPinWrite(PIN_LED_STATUS, false);
+  
+  LOG_I(LOG_APP, "Actuadores inicializados (todos apagados)");
+}
+
+/**
+ * Controla un actuador
+ */
+void controlActuator(ActuatorId id, bool state) {
+  actuatorStates[id] = state;
+  
+  // Los relays suelen ser activos en LOW
+  halPinWrite(ACTUATORS[id].pin, !state);
+  
+  LOG_I(LOG_APP, "%s %s", ACTUATORS[id].name, state ? "ENCENDIDO" : "APAGADO");
+}
+
+/**
+ * Indica si algún actuador está encendido
+ */
+bool anyActuatorOn() {
+  for (size_t i = 0; i < ACTUATOR_COUNT; i++) {
+    if (actuatorStates[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Callback para comandos de actuadores recibidos por MQTT
+ */
+void handleActuatorCommand(const char* topic, const uint8_t* payload, size_t length) {
+  LOG_D(LOG_APP, "Comando de actuador recibido en %s", topic);
+  
+  // Parsear JSON (documento en pila, sin memoria dinámica)
+  StaticJsonDocument<128> doc;
+  DeserializationError error = deserializeJson(doc, payload, length);
+  
+  if (error) {
+    LOG_W(LOG_APP, "Error al parsear JSON: %s", error.c_str());
+    return;
+  }
+  
+  // Obtener estado (on/off o true/false)
+  bool state = false;
+  if (doc.containsKey("state")) {
+    JsonVariant stateValue = doc["state"];
+    
+    if (stateValue.is<const char*>()) {
+      const char* stateStr = stateValue.as<const char*>();
+      state = (strcmp(stateStr, "on") == 0 || strcmp(stateStr, "ON") == 0 ||
+               strcmp(stateStr, "true") == 0 || strcmp(stateStr, "1") == 0);
+    } else if (stateValue.is<bool>()) {
+      state = stateValue.as<bool>();
+    } else {
+      state = stateValue.as<long>() == 1;
+    }
+  } else if (doc.containsKey("value")) {
+    state = doc["value"].as<bool>();
+  }
+  
+  // Identificar actuador según topic (tabla hash perfecta)
+  ActuatorCommand cmd;
+  cmd.actuator = findActuatorByTopic(topic, strlen(topic));
+  cmd.state = state;
+  
+  if (cmd.actuator == ACTUATOR_COUNT) {
+    LOG_W(LOG_APP, "Topic de actuador desconocido: %s", topic);
+    return;
+  }
+  
+  // La tarea de adquisición aplica el comando en su siguiente iteración
+  if (!commandQueue.push(cmd)) {
+    droppedCommands++;
+    LOG_E(LOG_APP, "Cola de comandos llena, comando descartado");
+  }
+}
+
+/**
+ * Convierte una fila de TOPIC_REGLAS:
+ *   ["métrica", ">" o "<", umbral, histéresis, permanencia s, "actuador", "severidad"]
+ * El actuador es el sufijo de su topic; actuador y severidad son
+ * opcionales ("" o ausentes = ninguno).
+ */
+static bool parseRule(JsonArrayConst row, Rule& rule) {
+  if (row.size() < 5 || !row[2].is<float>() || !row[3].is<float>() ||
+      !row[4].is<unsigned long>()) {
+    return false;
+  }
+  
+  const char* metric = row[0] | "";
+  const char* comparator = row[1] | "";
+  const char* actuator = row[5] | "";
+  const char* severity = row[6] | "";
+  
+  rule.metric = (AlertMetric)RULE_METRIC_COUNT;
+  for (uint8_t m = 0; m < RULE_METRIC_COUNT; m++) {
+    if (strcmp(metric, alertMetricName((AlertMetric)m)) == 0) {
+      rule.metric = (AlertMetric)m;
+    }
+  }
+  
+  if (strcmp(comparator, ">") != 0 && strcmp(comparator, "<") != 0) {
+    return false;
+  }
+  rule.comparator = comparator[0] == '<' ? RULE_BELOW : RULE_ABOVE;
+  rule.threshold = row[2].as<float>();
+  rule.hysteresis = row[3].as<float>();
+  rule.dwellMs = row[4].as<unsigned long>() * 1000UL;
+  
+  rule.actuator = ACTUATOR_NONE;
+  for (size_t i = 0; i < ACTUATOR_COUNT; i++) {
+    if (strcmp(actuator, ACTUATORS[i].suffix) == 0) {
+      rule.actuator = (uint8_t)i;
+    }
+  }
+  if (actuator[0] != '\0' && rule.actuator == ACTUATOR_NONE) {
+    return false;
+  }
+  
+  rule.severity = SEVERITY_NONE;
+  for (uint8_t v = SEVERITY_INFO; v <= SEVERITY_CRITICAL; v++) {
+    if (strcmp(severity, alertSeverityName((AlertSeverity)v)) == 0) {
+      rule.severity = v;
+    }
+  }
+  if (severity[0] != '\0' && rule.severity == SEVERITY_NONE) {
+    return false;
+  }
+  
+  return RuleEngine::validate(rule);
+}
+
+/**
+ * Sustitución de las reglas recibida por MQTT:
+ *   {"offset":0,"more":false,"rules":[fila, ...]}
+ * Una tabla que no cabe en un mensaje se envía en varios con "more":true,
+ * cada uno con el offset de su primera regla; la tarea de adquisición la
+ * aplica completa al recibir el último. Una fila no válida descarta la
+ * tabla entera.
+ */
+void handleRulesMessage(const uint8_t* payload, size_t length) {
+  if (rulesPending.load(std::memory_order_acquire)) {
+    LOG_W(LOG_APP, "Reglas anteriores aún sin aplicar, mensaje descartado");
+    return;
+  }
+  
+  DeserializationError error = deserializeJson(rulesDocument, payload, length);
+  if (error) {
+    LOG_W(LOG_APP, "Error al parsear reglas: %s", error.c_str());
+    return;
+  }
+  
+  size_t offset = rulesDocument["offset"] | 0U;
+  bool more = rulesDocument["more"] | false;
+  JsonArrayConst rows = rulesDocument["rules"];
+  
+  if (rows.isNull() || (offset != 0 && offset != pendingRuleCount)) {
+    LOG_W(LOG_APP, "Mensaje de reglas fuera de secuencia (offset %u)", (unsigned)offset);
+    pendingRuleCount = 0;
+    return;
+  }
+  
+  pendingRuleCount = offset;
+  for (JsonVariantConst row : rows) {
+    if (pendingRuleCount >= RULE_CAPACITY ||
+        !parseRule(row.as<JsonArrayConst>(), pendingRules[pendingRuleCount])) {
+      LOG_W(LOG_APP, "Regla %u no válida, tabla descartada", (unsigned)pendingRuleCount);
+      pendingRuleCount = 0;
+      return;
+    }
+    pendingRuleCount++;
+  }
+  
+  if (!more) {
+    rulesPending.store(true, std::memory_order_release);
+  }
+}
+
+/**
+ * Callback de mensajes MQTT: reglas o comandos de actuadores
+ */
+void handleInboundMessage(const char* topic, const uint8_t* payload, size_t length) {
+  if (strcmp(topic, TOPIC_REGLAS) == 0) {
+    handleRulesMessage(payload, length);
+  } else {
+    handleActuatorCommand(topic, payload, length);
+  }
+}
+
+/**
+ * Aplica un comando de actuador. Solo se llama desde la tarea de adquisición.
+ */
+void applyActuatorCommand(const ActuatorCommand& cmd) {
+  if (cmd.actuator >= ACTUATOR_COUNT) {
+    return;
+  }
+  
+  controlActuator(cmd.actuator, cmd.state);
+  
+#if CLIMATE_CONTROL
+  // El comando manual prevalece sobre el lazo durante CONTROL_MANUAL_HOLD_MS
+  for (size_t i = 0; i < CLIMATE_LOOP_COUNT; i++) {
+    if (climateLoops[i].actuator == cmd.actuator) {
+      climateLoops[i].manual = true;
+      climateLoops[i].manualUntil = halMillis() + CONTROL_MANUAL_HOLD_MS;
+    }
+  }
+#endif
+  
+  // Confirmar estado con LED
+  halPinWrite(PIN_LED_STATUS, anyActuatorOn());
+}
+
+/**
+ * Evalúa las reglas con una lectura válida: conmuta los actuadores cuya
+ * demanda cambió y entrega las alertas a la tarea de red. Un comando
+ * manual prevalece hasta que cambie la demanda de ese actuador. Los
+ * actuadores de un lazo de control solo reciben la demanda como forzado
+ * (ver stepClimateLoop). Solo se llama desde la tarea de adquisición.
+ */
+void applyRules(const SensorData& data) {
+  AlertMessage message;
+  message.timestamp = data.timestamp;
+  message.count = ruleEngine.evaluate(data, data.timestamp, message.alerts, 4);
+  
+  uint32_t demand = ruleEngine.demand();
+  uint32_t changed = (demand ^ ruleDemand) & ~CLIMATE_ACTUATORS;
+  for (size_t i = 0; changed != 0 && i < ACTUATOR_COUNT; i++) {
+    if (changed & (1u << i)) {
+      controlActuator((ActuatorId)i, (demand & (1u << i)) != 0);
+    }
+  }
+  ruleDemand = demand;
+  
+  if (message.count > 0 && !alertQueue.push(message)) {
+    droppedAlerts++;
+    LOG_W(LOG_APP, "Cola de alertas llena, %u alertas descartadas", (unsigned)message.count);
+  }
+}
+
+#if CLIMATE_CONTROL
+/**
+ * Guarda la medida de un lazo para el siguiente periodo de control
+ */
+static void recordClimateInput(ClimateLoopId id, float value, unsigned long now) {
+  climateLoops[id].measurement = value;
+  climateLoops[id].measuredAt = now;
+  climateLoops[id].measured = true;
+}
+
+/**
+ * Un periodo de un lazo: PID y relay con la última medida (la demanda de
+ * las reglas fuerza el encendido). Con la medida caducada el relay se
+ * apaga; durante una suspensión manual el lazo no toca el actuador.
+ */
+static void stepClimateLoop(ClimateLoop& climate, unsigned long now) {
+  if (climate.manual) {
+    if ((long)(now - climate.manualUntil) < 0) {
+      return;
+    }
+    climate.manual = false;
+    climate.loop.begin(climate.config, now);
+    LOG_I(LOG_APP, "%s vuelve al control automático", ACTUATORS[climate.actuator].name);
+  }
+  
+  bool forceOn = (ruleDemand & (1u << climate.actuator)) != 0;
+  bool on;
+  if (climate.measured && now - climate.measuredAt <= CONTROL_MAX_AGE_MS) {
+    on = climate.loop.step(climate.measurement, forceOn, now);
+  } else {
+    on = climate.loop.idle(forceOn, now);
+  }
+  
+  if (on != actuatorStates[climate.actuator]) {
+    controlActuator(climate.actuator, on);
+  }
+}
+
+/**
+ * Control en lazo cerrado: con los sensores reales toma cada muestra
+ * intermedia del DHT22 (DHT_SAMPLE_INTERVAL_MS) y la humedad del suelo del
+ * ADC en cada periodo; con otra fuente de lecturas (p. ej. una traza) los lazos usan
+ * las lecturas de su sensor. Los lazos avanzan con cada periodo del
+ * temporizador de control, independiente del calendario de lecturas.
+ */
+static void stepClimateControl() {
+  unsigned long now = halMillis();
+  bool liveSensors = readingSource == acquireFromSensors;
+  float value;
+  
+  if (liveSensors && takeTemperature(value)) {
+    recordClimateInput(CLIMATE_FAN, value, now);
+  }
+  
+  uint32_t ticks = halControlTicks();
+  if (ticks == controlTicks) {
+    return;
+  }
+  controlTicks = ticks;
+  
+  if (liveSensors && readSoilMoisture(value)) {
+    recordClimateInput(CLIMATE_PUMP, value, now);
+  }
+  
+  for (size_t i = 0; i < CLIMATE_LOOP_COUNT; i++) {
+    stepClimateLoop(climateLoops[i], now);
+  }
+}
+#endif
+
+/**
+ * Programa la siguiente lectura de los sensores leídos según la velocidad
+ * de cambio de sus métricas y su distancia a los umbrales de las reglas
+ */
+static void scheduleSensors(uint8_t sensors, const SensorData& data) {
+  const float values[SENSOR_METRIC_COUNT] = {
+    data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+  };
+  float distances[SENSOR_METRIC_COUNT];
+  for (size_t i = 0; i < SENSOR_METRIC_COUNT; i++) {
+    distances[i] = ruleEngine.limitDistance((AlertMetric)i, values[i]);
+  }
+  
+  samplingScheduler.update(sensors, data, distances, halMillis());
+  
+  LOG_D(LOG_APP, "Próximas lecturas: DHT22 %lu s, suelo %lu s, luz %lu s",
+        (unsigned long)samplingScheduler.interval(SENSOR_DHT22) / 1000,
+        (unsigned long)samplingScheduler.interval(SENSOR_SUELO) / 1000,
+        (unsigned long)samplingScheduler.interval(SENSOR_LUZ) / 1000);
+}
+
+/**
+ * Reporte por excepción: indica si una lectura válida debe publicarse.
+ * urgent pide publicar el lote sin esperar a su edad máxima (la lectura
+ * cruza un umbral de las reglas respecto de la última publicada). Solo se
+ * llama desde la tarea de adquisición.
+ */
+static bool reportReading(const SensorData& data, bool& urgent) {
+  urgent = false;
+#if REPORT_BY_EXCEPTION
+  bool crossing = reportFilter.hasReported() &&
+                  ruleEngine.crosses(reportFilter.lastReported(), data);
+  ReportReason reason = reportFilter.offer(data, crossing, data.timestamp);
+  if (reason == REPORT_SUPPRESSED) {
+    return false;
+  }
+  
+  LOG_D(LOG_APP, "Lectura publicada (%s)", reportReasonName(reason));
+  urgent = reason == REPORT_CROSSING;
+#endif
+  return true;
+}
+
+/**
+ * Contadores del reporte por excepción
+ */
+const ReportStats& getReportStats() {
+  return reportFilter.stats();
+}
+
+/**
+ * Contadores de la publicación de telemetría
+ */
+const BatchStats& getBatchStats() {
+  return telemetryBatcher.stats();
+}
+
+/**
+ * Lecturas de cada sensor
+ */
+const SamplingStats& getSamplingStats() {
+  return samplingScheduler.stats();
+}
+
+/**
+ * Reglas cargadas (solo lectura, desde la tarea de adquisición o el host)
+ */
+const RuleEngine& getRuleEngine() {
+  return ruleEngine;
+}
+
+/**
+ * Publica las alertas de una lectura. Se ejecuta en la tarea de red; sin
+ * conexión esperan en la cola MQTT.
+ */
+void publishAlerts(const AlertMessage& message) {
+  uint8_t payload[384];
+  size_t length;
+  {
+    DIAG_SCOPE(DIAG_SERIALIZE);
+    length = encodeAlerts(ALERTS_CODEC, message.timestamp, message.alerts, message.count,
+                          payload, sizeof(payload));
+  }
+  if (length > 0) {
+    publishPayload(TOPIC_ALERTAS, payload, length);
+  }
+}
+
+/**
+ * Fuente de lecturas por defecto: inicia la lectura de los sensores que
+ * tocan y avanza la adquisición un paso. La primera lectura llega en
+ * cuanto el DHT22 termina de calentarse.
+ */
+static uint8_t acquireFromSensors(uint8_t sensors, SensorData& data) {
+  if (sensors != 0 && !isSensorAcquisitionBusy()) {
+    startSensorAcquisition(sensors);
+  }
+  
+  return pollSensors(data);
+}
+
+/**
+ * Sustituye la fuente de lecturas (p. ej. por una traza en el host).
+ * nullptr restaura los sensores. Llamar antes de iniciar las tareas.
+ */
+void appSetReadingSource(ReadingSource source) {
+  readingSource = source != nullptr ? source : acquireFromSensors;
+}
+
+/**
+ * Una iteración de la tarea de adquisición y control (núcleo ACQ_TASK_CORE).
+ * Nunca toca la red: un socket TLS lento no retrasa muestreo ni relays.
+ */
+void appAcquisitionStep() {
+  // Aplicar comandos recibidos por la tarea de red
+  ActuatorCommand cmd;
+  while (commandQueue.pop(cmd)) {
+    applyActuatorCommand(cmd);
+  }
+  
+  // Sustituir las reglas si llegó una tabla nueva (todas empiezan
+  // inactivas; los actuadores se reajustan con la siguiente lectura)
+  if (rulesPending.load(std::memory_order_acquire)) {
+    if (ruleEngine.load(pendingRules, pendingRuleCount)) {
+      LOG_I(LOG_APP, "%u reglas cargadas", (unsigned)pendingRuleCount);
+    } else {
+      LOG_W(LOG_APP, "Tabla de reglas rechazada");
+    }
+    rulesPending.store(false, std::memory_order_release);
+  }
+  
+  // Avanzar la adquisición un paso (no bloqueante)
+  SensorData data;
+  uint8_t sensors;
+  {
+    DIAG_SCOPE(DIAG_SENSORS);
+    sensors = readingSource(samplingScheduler.due(halMillis()), data);
+  }
+  
+  if (sensors != 0) {
+    traceReading(data);
+    scheduleSensors(sensors, data);
+    
+    if (data.valid) {
+      bootMark(BOOT_FIRST_READING);
+      applyRules(data);
+      
+#if CLIMATE_CONTROL
+      if (sensors & (1u << SENSOR_DHT22)) {
+        recordClimateInput(CLIMATE_FAN, data.temperatura, data.timestamp);
+      }
+      if (sensors & (1u << SENSOR_SUELO)) {
+        recordClimateInput(CLIMATE_PUMP, data.humedadSuelo, data.timestamp);
+      }
+#endif
+      
+      bool urgent;
+      if (reportReading(data, urgent)) {
+        if (!telemetryQueue.push(data)) {
+          droppedReadings++;
+          LOG_W(LOG_APP, "Cola de telemetría llena, lectura descartada");
+        } else if (urgent) {
+          telemetryFlushRequest = true;
+        }
+      }
+    } else {
+      LOG_W(LOG_APP, "Datos de sensores no válidos, no se publicarán");
+    }
+  }
+  
+#if CLIMATE_CONTROL
+  stepClimateControl();
+#endif
+  
+  // Encender LED de transmisión a petición de la tarea de red
+  if (publishBlinkRequest.exchange(false)) {
+    halPinWrite(PIN_LED_STATUS, true);
+    ledOffAt = halMillis() + LED_BLINK_MS;
+    ledBlinking = true;
+  }
+  
+  // Apagar LED de transmisión sin bloquear
+  if (ledBlinking && (long)(halMillis() - ledOffAt) >= 0) {
+    halPinWrite(PIN_LED_STATUS, false);
+    ledBlinking = false;
+  }
+  
+  // Parpadeo de arranque (impares: encendido)
+  if (bootBlinkToggles > 0 && (long)(halMillis() - nextBootBlinkAt) >= 0) {
+    bootBlinkToggles--;
+    halPinWrite(PIN_LED_STATUS, (bootBlinkToggles & 1) != 0);
+    nextBootBlinkAt += BOOT_BLINK_MS;
+  }
+}
+
+/**
+ * Guarda una lectura en el registro local para reenviarla más tarde
+ */
+void storeReading(const SensorData& data) {
+  if (storeReady && telemetryStore.append(data)) {
+    LOG_D(LOG_STORAGE, "MQTT no conectado, lectura guardada (%u pendientes)",
+          (unsigned)telemetryStore.pending());
+  } else {
+    LOG_W(LOG_STORAGE, "MQTT no conectado, no se publicarán datos");
+  }
+}
+
+/**
+ * Entrega una lectura al publicador por lotes. Retorna false si no
+ * pudo aceptarse por falta de conexión.
+ */
+bool publishReading(const SensorData& data) {
+  if (!telemetryBatcher.add(data, halMillis())) {
+    return false;
+  }
+  
+  publishBlinkRequest = true;
+  return true;
+}
+
+/**
+ * Mueve al registro local las lecturas de un lote que no pudo publicarse
+ */
+void storePendingBatch() {
+  SensorData pending[TELEMETRY_BATCH_CAPACITY];
+  size_t count = telemetryBatcher.takePending(pending, TELEMETRY_BATCH_CAPACITY);
+  
+  for (size_t i = 0; i < count; i++) {
+    storeReading(pending[i]);
+  }
+}
+
+/**
+ * Reenvía lecturas almacenadas durante un corte, limitado a
+ * STORE_DRAIN_RATE por segundo para no competir con las lecturas en vivo
+ */
+void drainTelemetryStore() {
+  if (!storeReady || telemetryStore.pending() == 0) {
+    return;
+  }
+  
+  // Rellenar el cubo de tokens
+  unsigned long now = halMillis();
+  uint32_t refill = (now - lastDrainRefill) * STORE_DRAIN_RATE / 1000;
+  
+  if (refill > 0) {
+    drainTokens += refill;
+    if (drainTokens > STORE_DRAIN_BURST) {
+      drainTokens = STORE_DRAIN_BURST;
+    }
+    lastDrainRefill = now;
+  }
+  
+  if (drainTokens == 0) {
+    return;
+  }
+  
+  SensorData batch[STORE_DRAIN_BURST];
+  size_t count = telemetryStore.peek(batch, drainTokens);
+  size_t sent = 0;
+  
+  while (sent < count && isMQTTConnected() && publishReading(batch[sent])) {
+    sent++;
+  }
+  
+  telemetryStore.consume(sent);
+  drainTokens -= sent;
+  
+  if (telemetryStore.pending() == 0) {
+    LOG_I(LOG_STORAGE, "Registro local reenviado por completo");
+  }
+}
+
+/**
+ * Campos del primer estado "online": los hitos del arranque
+ */
+static size_t bootStatusFields(char* out, size_t capacity) {
+  static bool reported = false;
+  if (reported) {
+    return 0;
+  }
+  
+  bootMark(BOOT_MQTT_ONLINE);
+  size_t length = bootTimingsJson(out, capacity);
+  reported = length > 0;
+  return length;
+}
+
+/**
+ * Completa una etapa del arranque en la tarea de red. Retorna true cuando
+ * ya no queda ninguna. Cada etapa corre en una iteración distinta para que
+ * la asociación WiFi avance entre medias.
+ */
+static bool networkBootStep() {
+  switch (networkBootStage) {
+    case NET_BOOT_STORAGE: {
+      // Montar registro persistente de telemetría
+      StorageBackend* storage = halTelemetryStorage();
+      storeReady = storage != nullptr && telemetryStore.begin(storage);
+      if (storeReady) {
+        LOG_I(LOG_STORAGE, "Registro local: %u lecturas pendientes de reenvío",
+              (unsigned)telemetryStore.pending());
+      } else {
+        LOG_E(LOG_STORAGE, "Registro local no disponible");
+      }
+      
+      // Registrar la traza desde el arranque (usa LittleFS, ya montado)
+      if (ENABLE_TRACE) {
+        traceBegin();
+      }
+      
+      bootMark(BOOT_STORAGE_READY);
+      networkBootStage = NET_BOOT_MQTT;
+      return false;
+    }
+    
+    case NET_BOOT_MQTT: {
+      // Inicializar MQTT: conecta en cuanto haya WiFi
+      initMQTT();
+      setMessageCallback(handleInboundMessage);
+      setStatusFields(bootStatusFields);
+      
+      BatchPolicy batchPolicy = { TELEMETRY_MODE, TELEMETRY_BATCH_SIZE,
+                                  TELEMETRY_BATCH_MAX_AGE_MS, TELEMETRY_CODEC };
+      telemetryBatcher.begin(batchPolicy, publishPayload, publishRoom);
+      
+      bootMark(BOOT_MQTT_READY);
+      networkBootStage = NET_BOOT_DONE;
+      systemInitialized = true;
+      LOG_I(LOG_APP, "¡Sistema inicializado correctamente!");
+      return true;
+    }
+    
+    default:
+      return true;
+  }
+}
+
+/**
+ * Una iteración de la tarea de red (núcleo NET_TASK_CORE): WiFi, TLS y MQTT.
+ */
+void appNetworkStep() {
+  // Mantener conexión WiFi (reintentos con backoff, sin bloquear)
+  {
+    DIAG_SCOPE(DIAG_WIFI);
+    connectivityStep();
+  }
+  
+  // Las lecturas esperan en la cola hasta que MQTT esté inicializado
+  if (!systemInitialized && !networkBootStep()) {
+    return;
+  }
+  
+  if (halNetworkConnected()) {
+    bootMark(BOOT_WIFI_UP);
+  }
+  
+  // Mantener conexión MQTT (recibe comandos de actuadores)
+  {
+    DIAG_SCOPE(DIAG_MQTT_LOOP);
+    mqttLoop();
+  }
+  
+  // Publicar lecturas producidas por la tarea de adquisición. La petición
+  // de publicar el lote se toma antes de vaciar la cola: su lectura ya
+  // está en ella.
+  SensorData data;
+  bool flushRequested = telemetryFlushRequest.exchange(false);
+  
+  while (telemetryQueue.pop(data)) {
+    if (!isMQTTConnected() || !publishReading(data)) {
+      storeReading(data);
+    }
+  }
+  
+  // Publicar las alertas de las reglas
+  AlertMessage alerts;
+  while (alertQueue.pop(alerts)) {
+    publishAlerts(alerts);
+  }
+  
+  if (isMQTTConnected()) {
+    // Publicar el lote si cruzó un umbral o la lectura más antigua
+    // alcanzó su edad máxima
+    if (flushRequested) {
+      telemetryBatcher.flush(halMillis());
+    }
+    telemetryBatcher.poll(halMillis());
+    
+    // Con la cola en vivo vacía, reenviar lo acumulado durante el corte
+    drainTelemetryStore();
+  } else if (telemetryBatcher.pending() > 0) {
+    storePendingBatch();
+  }
+  
+#if ENABLE_DIAGNOSTICS
+  // Resumen periódico de la instrumentación
+  if (isMQTTConnected() && diagReportDue(halMillis())) {
+    char report[DIAG_REPORT_SIZE];
+    size_t length = diagReportJson(report, sizeof(report));
+    if (length > 0) {
+      publishPayload(TOPIC_DIAGNOSTICO, (const uint8_t*)report, length);
+    }
+  }
+#endif
+  
+  // Volcar la traza de registro si está activa
+  traceFlush(false);
+}
+
+/**
+ * Arranque por etapas. Aquí solo lo inmediato: relays en estado seguro,
+ * sensores y asociación WiFi en segundo plano. La primera lectura llega
+ * tras el calentamiento del DHT22, mientras la tarea de red monta el
+ * registro local e inicializa MQTT (ver networkBootStep). Los tiempos de
+ * cada etapa se publican en el primer estado "online".
+ */
+void appSetup() {
+  // Apagar los relays antes que nada
+  initActuators();
+  ruleEngine.load(DEFAULT_RULES, sizeof(DEFAULT_RULES) / sizeof(DEFAULT_RULES[0]));
+  
+#if REPORT_BY_EXCEPTION
+  ReportPolicy reportPolicy = {
+    { { REPORT_TEMP_DEADBAND, 0.0f }, { REPORT_HUM_DEADBAND, 0.0f },
+      { REPORT_SOIL_DEADBAND, 0.0f }, { REPORT_LUX_DEADBAND, REPORT_LUX_RELATIVE } },
+    REPORT_HEARTBEAT_MS
+  };
+  reportFilter.begin(reportPolicy);
+#endif
+  
+#if CLIMATE_CONTROL
+  // Lazos de ventilador y bomba a cadencia fija
+  for (size_t i = 0; i < CLIMATE_LOOP_COUNT; i++) {
+    climateLoops[i].loop.begin(climateLoops[i].config, halMillis());
+  }
+  halControlTimerBegin(CONTROL_PERIOD_MS);
+#endif
+  bootMark(BOOT_OUTPUTS_SAFE);
+  
+  // Inicializar sensores: el DHT22 se calienta en paralelo con la red
+  initSensors();
+  samplingScheduler.begin(SAMPLING_POLICY, halMillis() + DHT_WARMUP_MS);
+  bootMark(BOOT_SENSORS_STARTED);
+  
+  // Inicializar WiFi: la asociación avanza en segundo plano
+  connectivityBegin();
+  bootMark(BOOT_WIFI_STARTED);
+  
+  // Parpadear LED 3 veces desde la tarea de adquisición, sin bloquear
+  bootBlinkToggles = 6;
+  nextBootBlinkAt = halMillis();
+}
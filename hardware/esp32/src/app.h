@@ -0,0 +1,30 @@
+#ifndef APP_H
+#define APP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+#include "report_filter.h"
+#include "rule_engine.h"
+#include "sampling_scheduler.h"
+#include "telemetry_batcher.h"
+
+// Una llamada por iteración con los sensores que toca leer (máscara de
+// SensorId, puede ser 0). Cuando hay una lectura retorna los sensores
+// leídos; el resto de data conserva los últimos valores leídos.
+typedef uint8_t (*ReadingSource)(uint8_t sensors, SensorData& data);
+
+// Funciones públicas
+void appSetup();
+void appAcquisitionStep();
+void appNetworkStep();
+void appSetReadingSource(ReadingSource source);
+void handleActuatorCommand(const char* topic, const uint8_t* payload, size_t length);
+void handleRulesMessage(const uint8_t* payload, size_t length);
+void handleInboundMessage(const char* topic, const uint8_t* payload, size_t length);
+const ReportStats& getReportStats();
+const BatchStats& getBatchStats();
+const SamplingStats& getSamplingStats();
+const RuleEngine& getRuleEngine();
+
+#endif // APP_H
@@ -0,0 +1,44 @@
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <stdint.h>
+
+/**
+ * Espera exponencial con jitter entre reintentos de red.
+ *
+ * Tras el n-ésimo fallo consecutivo la espera es un valor uniforme en
+ * [d/2, d], con d = mínimo · 2^(n-1) acotado al máximo. El jitter evita
+ * que los invernaderos que perdieron el mismo AP vuelvan todos a la vez.
+ * Sin estado global ni memoria dinámica; portable (compila en el host).
+ */
+class Backoff {
+public:
+  Backoff(uint32_t minimumMs, uint32_t maximumMs)
+    : minimumMs(minimumMs), maximumMs(maximumMs), failures(0) {}
+
+  // Registra un fallo y retorna la espera; random es uniforme de 32 bits
+  uint32_t next(uint32_t random) {
+    uint32_t delay = minimumMs;
+    for (uint8_t i = 0; i < failures && delay < maximumMs; i++) {
+      delay = delay > maximumMs / 2 ? maximumMs : delay * 2;
+    }
+    if (failures < 0xFF) {
+      failures++;
+    }
+
+    uint32_t half = delay / 2;
+    return delay - half + random % (half + 1);
+  }
+
+  // Intento con éxito: el siguiente fallo vuelve a la espera mínima
+  void reset() { failures = 0; }
+
+  uint8_t consecutiveFailures() const { return failures; }
+
+private:
+  uint32_t minimumMs;
+  uint32_t maximumMs;
+  uint8_t failures;
+};
+
+#endif // BACKOFF_H
@@ -0,0 +1,60 @@
+#include "boot_timings.h"
+#include "config.h"
+#include "hal.h"
+#include <atomic>
+#include <stdio.h>
+
+static const char* const BOOT_STAGE_NAMES[BOOT_STAGE_COUNT] = {
+  "outputs", "sensors", "wifi_start", "storage", "mqtt_init",
+  "first_reading", "wifi_up", "mqtt_online"
+};
+
+// El instante se escribe antes de publicar el bit (orden release/acquire)
+uint32_t bootStageMs[BOOT_STAGE_COUNT];
+std::atomic<uint32_t> bootReached(0);
+
+/**
+ * Registra el hito si es la primera vez
+ */
+void bootMark(BootStage stage) {
+  uint32_t bit = 1u << stage;
+  if (stage >= BOOT_STAGE_COUNT || (bootReached.load(std::memory_order_acquire) & bit) != 0) {
+    return;
+  }
+
+  bootStageMs[stage] = (uint32_t)halMillis();
+  bootReached.fetch_or(bit, std::memory_order_release);
+}
+
+bool bootStageReached(BootStage stage, uint32_t& ms) {
+  if (stage >= BOOT_STAGE_COUNT ||
+      (bootReached.load(std::memory_order_acquire) & (1u << stage)) == 0) {
+    return false;
+  }
+
+  ms = bootStageMs[stage];
+  return true;
+}
+
+const char* bootStageName(BootStage stage) {
+  return stage < BOOT_STAGE_COUNT ? BOOT_STAGE_NAMES[stage] : "?";
+}
+
+size_t bootTimingsJson(char* out, size_t capacity) {
+  int length = snprintf(out, capacity, ",\"boot\":{\"fw\":\"%s\"", FIRMWARE_VERSION);
+
+  for (uint8_t i = 0; i < BOOT_STAGE_COUNT && length > 0 && (size_t)length < capacity; i++) {
+    uint32_t ms;
+    if (bootStageReached((BootStage)i, ms)) {
+      length += snprintf(out + length, capacity - length, ",\"%s\":%lu",
+                         BOOT_STAGE_NAMES[i], (unsigned long)ms);
+    }
+  }
+
+  if (length <= 0 || (size_t)length + 1 >= capacity) {
+    return 0;
+  }
+  out[length++] = '}';
+  out[length] = '\0';
+  return length;
+}
@@ -0,0 +1,36 @@
+#ifndef BOOT_TIMINGS_H
+#define BOOT_TIMINGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Hitos del arranque por etapas (ver appSetup()).
+ *
+ * Cada hito guarda el halMillis() de la primera vez que se alcanza; se
+ * publican en el primer estado "online" para seguir el tiempo hasta la
+ * primera lectura y hasta la sesión MQTT entre versiones del firmware.
+ * Se pueden marcar desde cualquier tarea. Portable (compila en el host).
+ */
+enum BootStage : uint8_t {
+  BOOT_OUTPUTS_SAFE,       // Relays apagados (lo primero del arranque)
+  BOOT_SENSORS_STARTED,    // DHT22 calentando y ADC muestreando
+  BOOT_WIFI_STARTED,       // Asociación en curso (tarea de red)
+  BOOT_STORAGE_READY,      // Registro local montado
+  BOOT_MQTT_READY,         // Cliente MQTT inicializado, esperando WiFi
+  BOOT_FIRST_READING,      // Primera lectura válida (tarea de adquisición)
+  BOOT_WIFI_UP,            // Primera IP
+  BOOT_MQTT_ONLINE,        // Primera sesión MQTT
+  BOOT_STAGE_COUNT
+};
+
+// Funciones públicas
+void bootMark(BootStage stage);
+bool bootStageReached(BootStage stage, uint32_t& ms);
+const char* bootStageName(BootStage stage);
+
+// Escribe ,"boot":{"fw":...,"etapa":ms,...} con los hitos alcanzados.
+// Retorna la longitud, o 0 si no cabe.
+size_t bootTimingsJson(char* out, size_t capacity);
+
+#endif // BOOT_TIMINGS_H
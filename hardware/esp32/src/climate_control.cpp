@@ -0,0 +1,120 @@
+#include "climate_control.h"
+
+static float clampUnit(float value) {
+  return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+// ============================================
+// PID
+// ============================================
+PidController::PidController()
+  : config(), integralTerm(0), lastMeasurement(0), lastOutput(0), primed(false) {}
+
+void PidController::begin(const PidConfig& pidConfig) {
+  config = pidConfig;
+  reset();
+}
+
+void PidController::reset() {
+  integralTerm = 0;
+  lastMeasurement = 0;
+  lastOutput = 0;
+  primed = false;
+}
+
+float PidController::step(float setpoint, float measurement, float dtS) {
+  float sign = config.reverse ? -1.0f : 1.0f;
+  float error = sign * (setpoint - measurement);
+
+  // Derivada de la medida (sin salto al cambiar la consigna)
+  float derivative = 0;
+  if (primed && dtS > 0) {
+    derivative = -sign * (measurement - lastMeasurement) / dtS;
+  }
+  lastMeasurement = measurement;
+  primed = true;
+
+  float proportional = config.kp * error;
+  float candidate = integralTerm + config.ki * error * dtS;
+  float unsaturated = proportional + candidate + config.kd * derivative;
+
+  // Integración condicional: no acumular si empuja más allá del límite
+  bool saturatedHigh = unsaturated > 1.0f && error > 0;
+  bool saturatedLow = unsaturated < 0.0f && error < 0;
+  if (!saturatedHigh && !saturatedLow) {
+    integralTerm = clampUnit(candidate);
+  }
+
+  lastOutput = clampUnit(proportional + integralTerm + config.kd * derivative);
+  return lastOutput;
+}
+
+// ============================================
+// RELAY PROPORCIONAL EN EL TIEMPO
+// ============================================
+TimeProportionalRelay::TimeProportionalRelay()
+  : timing(), windowStart(0), changedAt(0), switchCount(0), relayOn(false) {}
+
+void TimeProportionalRelay::begin(const RelayTiming& relayTiming, unsigned long now) {
+  timing = relayTiming;
+  windowStart = now;
+  changedAt = now - timing.minOffMs;   // Puede encender de inmediato
+  switchCount = 0;
+  relayOn = false;
+}
+
+bool TimeProportionalRelay::step(float duty, bool forceOn, unsigned long now) {
+  unsigned long elapsed = now - windowStart;
+  if (elapsed >= timing.windowMs) {
+    elapsed %= timing.windowMs;
+    windowStart = now - elapsed;
+  }
+
+  // Tiempo encendido de la ventana, sin pulsos ni pausas demasiado cortos
+  uint32_t onMs = (uint32_t)(clampUnit(duty) * timing.windowMs);
+  if (onMs < timing.minOnMs) {
+    onMs = 0;
+  } else if (timing.windowMs - onMs < timing.minOffMs) {
+    onMs = timing.windowMs;
+  }
+
+  bool want = forceOn || elapsed < onMs;
+  if (want != relayOn) {
+    unsigned long held = now - changedAt;
+    if (held >= (relayOn ? timing.minOnMs : timing.minOffMs)) {
+      relayOn = want;
+      changedAt = now;
+      switchCount++;
+    }
+  }
+  return relayOn;
+}
+
+// ============================================
+// LAZO
+// ============================================
+ControlLoop::ControlLoop() : config(), lastStepAt(0), stepped(false) {}
+
+void ControlLoop::begin(const ControlLoopConfig& loopConfig, unsigned long now) {
+  config = loopConfig;
+  pid.begin(config.pid);
+  relay.begin(config.relay, now);
+  lastStepAt = now;
+  stepped = false;
+}
+
+bool ControlLoop::step(float measurement, bool forceOn, unsigned long now) {
+  // Paso real desde la última medida (el temporizador puede saltarse ticks)
+  float dtS = stepped ? (now - lastStepAt) / 1000.0f : 0.0f;
+  lastStepAt = now;
+  stepped = true;
+
+  float duty = pid.step(config.setpoint, measurement, dtS);
+  return relay.step(duty, forceOn, now);
+}
+
+bool ControlLoop::idle(bool forceOn, unsigned long now) {
+  pid.reset();
+  stepped = false;
+  return relay.step(0.0f, forceOn, now);
+}
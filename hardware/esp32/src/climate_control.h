@@ -0,0 +1,113 @@
+#ifndef CLIMATE_CONTROL_H
+#define CLIMATE_CONTROL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Control en lazo cerrado de un relay: PID con anti-windup cuya salida
+ * (0-1) se convierte en ciclo de trabajo de una ventana de tiempo fija
+ * (control proporcional en el tiempo), respetando tiempos mínimos de
+ * encendido y apagado del relay. Solo cálculo: no lee sensores ni escribe
+ * pines, así que se simula en el host contra un modelo de planta (ver
+ * native/control_sim.cpp). Portable (compila en el host).
+ */
+
+struct PidConfig {
+  float kp;             // Salida por unidad de error
+  float ki;             // Salida por unidad de error y segundo
+  float kd;             // Salida por unidad de error / segundo
+  bool reverse;         // true: la salida sube con la medida por encima de la consigna (enfriar)
+};
+
+struct RelayTiming {
+  uint32_t windowMs;    // Periodo del ciclo de trabajo
+  uint32_t minOnMs;     // Pulso más corto permitido
+  uint32_t minOffMs;    // Pausa más corta permitida
+};
+
+struct ControlLoopConfig {
+  float setpoint;
+  PidConfig pid;
+  RelayTiming relay;
+};
+
+/**
+ * PID en forma posicional con la salida limitada a [0, 1]. El integrador
+ * se congela mientras la salida está saturada en el sentido del error y
+ * se limita al mismo rango (anti-windup). La derivada se calcula sobre la
+ * medida para no dar saltos al cambiar la consigna.
+ */
+class PidController {
+public:
+  PidController();
+
+  void begin(const PidConfig& config);
+  void reset();
+  float step(float setpoint, float measurement, float dtS);
+
+  float output() const { return lastOutput; }
+  float integral() const { return integralTerm; }
+
+private:
+  PidConfig config;
+  float integralTerm;
+  float lastMeasurement;
+  float lastOutput;
+  bool primed;
+};
+
+/**
+ * Convierte un ciclo de trabajo en el estado del relay dentro de una
+ * ventana fija. Un pulso más corto que minOnMs se omite y una pausa más
+ * corta que minOffMs se suprime; además el relay nunca cambia antes de
+ * cumplir el tiempo mínimo en su estado actual.
+ */
+class TimeProportionalRelay {
+public:
+  TimeProportionalRelay();
+
+  void begin(const RelayTiming& timing, unsigned long now);
+  bool step(float duty, bool forceOn, unsigned long now);
+
+  bool on() const { return relayOn; }
+  uint32_t switches() const { return switchCount; }
+
+private:
+  RelayTiming timing;
+  unsigned long windowStart;
+  unsigned long changedAt;
+  uint32_t switchCount;
+  bool relayOn;
+};
+
+/**
+ * Un lazo completo: consigna, PID y relay
+ */
+class ControlLoop {
+public:
+  ControlLoop();
+
+  void begin(const ControlLoopConfig& config, unsigned long now);
+
+  // Retorna el estado que debe tener el relay. forceOn (p. ej. una regla
+  // de seguridad) lo enciende respetando los tiempos mínimos.
+  bool step(float measurement, bool forceOn, unsigned long now);
+
+  // Sin medida válida: el relay se apaga (respetando el mínimo encendido)
+  bool idle(bool forceOn, unsigned long now);
+
+  float setpoint() const { return config.setpoint; }
+  float duty() const { return pid.output(); }
+  bool relayOn() const { return relay.on(); }
+  uint32_t switches() const { return relay.switches(); }
+
+private:
+  ControlLoopConfig config;
+  PidController pid;
+  TimeProportionalRelay relay;
+  unsigned long lastStepAt;
+  bool stepped;
+};
+
+#endif // CLIMATE_CONTROL_H
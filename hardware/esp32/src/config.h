@@ -1,13 +1,24 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// Permite incluir esta configuración desde módulos que compilan en el host
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
 // ============================================
 // CONFIGURACIÓN WIFI
 // ============================================
 #define WIFI_SSID "TU_WIFI_SSID"
 #define WIFI_PASSWORD "TU_WIFI_PASSWORD"
-#define WIFI_TIMEOUT_MS 20000
-#define WIFI_RETRY_DELAY_MS 5000
+
+// Reconexión sin bloqueo (ver connectivity.h): primero directa al BSSID y
+// canal de la última asociación, después con búsqueda completa, y entre
+// intentos fallidos una espera exponencial con jitter. Nunca se reinicia.
+#define WIFI_TIMEOUT_MS 20000          // Búsqueda completa + asociación + DHCP
+#define WIFI_FAST_TIMEOUT_MS 5000      // Asociación directa (BSSID y canal conocidos)
+#define WIFI_BACKOFF_MIN_MS 1000
+#define WIFI_BACKOFF_MAX_MS 60000
 
 // ============================================
 // CONFIGURACIÓN AWS IOT CORE
@@ -16,22 +27,39 @@
 #define AWS_IOT_PORT 8883
 #define THING_NAME "invernadero-01"
 
+// TLS (ver tls_link.cpp): la sesión se guarda en memoria RTC y cada
+// reconexión, también tras el sueño profundo, la reanuda sin repetir el
+// intercambio de claves ni la firma con la clave del dispositivo
+#define TLS_SESSION_RESUMPTION true
+#define TLS_SESSION_CACHE_SIZE 2048    // Sesión serializada (incluye el certificado del servidor)
+
 // Topics MQTT
 #define TOPIC_TEMPERATURA "invernadero/sensores/temperatura"
 #define TOPIC_HUMEDAD "invernadero/sensores/humedad"
 #define TOPIC_LUMINOSIDAD "invernadero/sensores/luminosidad"
 #define TOPIC_HUMEDAD_SUELO "invernadero/sensores/humedad-suelo"
+#define TOPIC_TELEMETRIA "invernadero/sensores/telemetria"
 #define TOPIC_ESTADO "invernadero/estado"
+#define TOPIC_DIAGNOSTICO "invernadero/diagnostico"
 #define TOPIC_ALERTAS "invernadero/alertas"
-#define TOPIC_ACTUADOR_VENTILADOR "invernadero/actuadores/ventilador"
-#define TOPIC_ACTUADOR_BOMBA "invernadero/actuadores/bomba"
-#define TOPIC_ACTUADOR_LUCES "invernadero/actuadores/luces"
+#define TOPIC_REGLAS "invernadero/reglas"
+#define TOPIC_ACTUADORES_PREFIX "invernadero/actuadores/"
+#define TOPIC_ACTUADOR_VENTILADOR TOPIC_ACTUADORES_PREFIX "ventilador"
+#define TOPIC_ACTUADOR_BOMBA TOPIC_ACTUADORES_PREFIX "bomba"
+#define TOPIC_ACTUADOR_LUCES TOPIC_ACTUADORES_PREFIX "luces"
 
 // ============================================
 // CERTIFICADOS AWS IOT
 // ============================================
 // IMPORTANTE: Reemplazar con tus certificados reales
 // Obtener ejecutando: bash scripts/setup-aws.sh
+//
+// Se admite también un certificado ECDSA P-256 (certificado y firma más
+// cortos que con RSA-2048): generar la clave y el CSR con
+//   openssl ecparam -name prime256v1 -genkey -noout -out device.key
+//   openssl req -new -key device.key -subj "/CN=invernadero-01" -out device.csr
+//   aws iot create-certificate-from-csr --certificate-signing-request file://device.csr
+// y pegar aquí el certificado y la clave ("BEGIN EC PRIVATE KEY")
 
 const char AWS_CERT_CA[] PROGMEM = R"EOF(
 -----BEGIN CERTIFICATE-----
@@ -67,16 +95,73 @@ const char AWS_CERT_PRIVATE[] PROGMEM = R"EOF(
 #define PIN_RELAY_BOMBA 26             // GPIO26 - Relay bomba de riego
 #define PIN_RELAY_LUCES 27             // GPIO27 - Relay luces
 
+// Registro de actuadores: X(id, sufijo del topic, pin, nombre)
+// El topic de comandos es TOPIC_ACTUADORES_PREFIX + sufijo; las
+// suscripciones y el despacho se generan a partir de esta lista
+// (ver actuator_registry.h)
+#define ACTUATOR_LIST(X) \
+  X(VENTILADOR, "ventilador", PIN_RELAY_VENTILADOR, "Ventilador") \
+  X(BOMBA, "bomba", PIN_RELAY_BOMBA, "Bomba") \
+  X(LUCES, "luces", PIN_RELAY_LUCES, "Luces")
+
 // LED indicador
 #define PIN_LED_STATUS 2               // GPIO2 - LED integrado
 
 // ============================================
 // CONFIGURACIÓN DE SENSORES
 // ============================================
-#define DHT_TYPE DHT22                 // Tipo de sensor DHT
-#define SENSOR_READ_INTERVAL_MS 30000  // Leer sensores cada 30 segundos
+#define SENSOR_READ_INTERVAL_MS 30000  // Leer sensores cada 30 segundos (sin muestreo adaptativo)
 #define SENSOR_RETRY_COUNT 3           // Reintentos de lectura
-#define SENSOR_RETRY_DELAY_MS 2000     // Delay entre reintentos
+#define SENSOR_RETRY_DELAY_MS 2000     // Espera entre reintentos (no bloqueante)
+#define ANALOG_WAIT_MS 50              // Espera si el ADC aún no tiene muestras
+#define DHT_WARMUP_MS 1100             // Primera lectura tras encender (DHT22: > 1 s)
+#define DHT_MIN_INTERVAL_MS 2000       // Separación mínima entre tramas del DHT22
+
+// Muestreo interno entre lecturas: cada lectura publica mín., máx., media,
+// desviación típica y número de muestras de su ventana (ver window_stats.h)
+#define DHT_SAMPLE_INTERVAL_MS 5000    // Tramas intermedias del DHT22 (mín. DHT_MIN_INTERVAL_MS)
+#define ANALOG_SAMPLE_INTERVAL_MS 100  // Suelo y luz, del valor filtrado (ADC_OUTPUT_RATE_HZ)
+
+// Muestreo adaptativo (ver sampling_scheduler.h): cada sensor se lee con
+// su propio intervalo, más corto cuanto más rápido cambia su métrica y
+// cuanto más cerca está de un umbral de las reglas. Con false todos se
+// leen juntos cada SENSOR_READ_INTERVAL_MS.
+#ifndef ADAPTIVE_SAMPLING
+#define ADAPTIVE_SAMPLING true
+#endif
+#define SAMPLING_DHT_MIN_MS 15000      // Mín. DHT_MIN_INTERVAL_MS
+#define SAMPLING_DHT_MAX_MS 60000      // < CONTROL_MAX_AGE_MS: con una traza los lazos
+#define SAMPLING_SOIL_MIN_MS 5000      // solo ven las lecturas de su sensor
+#define SAMPLING_SOIL_MAX_MS 60000
+#define SAMPLING_LIGHT_MIN_MS 5000
+#define SAMPLING_LIGHT_MAX_MS 300000
+// Cambio de cada métrica que justifica otra lectura (~resolución del sensor)
+#define SAMPLING_TEMP_STEP 0.2         // °C
+#define SAMPLING_HUM_STEP 1.0          // %
+#define SAMPLING_SOIL_STEP 1.0         // %
+#define SAMPLING_LUX_STEP 1.0          // %
+#define SAMPLING_LEAD 0.15             // Fracción del tiempo estimado hasta el umbral
+#define SAMPLING_RELEASE 0.3           // Caída de la velocidad estimada por lectura
+#define SAMPLING_COALESCE 0.5          // Adelanta al sensor que tiene pendiente menos de esta fracción
+
+// DHT22 capturado con el periférico RMT (ver dht22_rmt.cpp)
+#define DHT_RMT_CHANNEL 4              // Canal RMT de recepción (ESP-IDF 4)
+#define DHT_START_LOW_US 1200          // Señal de inicio del host (mín. 1 ms)
+#define DHT_READ_TIMEOUT_MS 25         // Límite para recibir la trama completa
+
+// Muestreo continuo del ADC (ver adc_sampler.cpp)
+#define ADC_CHANNEL_SOIL 6             // ADC1_CH6 (PIN_HUMEDAD_SUELO)
+#define ADC_CHANNEL_LDR 7              // ADC1_CH7 (PIN_LDR)
+#define ADC_SAMPLE_RATE_HZ 20000       // DMA (ESP-IDF 5): total para ambos canales (mín. 20 kHz)
+#define ADC_TIMER_RATE_HZ 500          // Temporizador (ESP-IDF 4): por canal
+#define ADC_OUTPUT_RATE_HZ 10          // Valores diezmados por segundo y canal
+#define ADC_FILTER_WINDOW 16           // Valores diezmados en el promedio móvil
+
+// Calibración analógica (cuentas 0-4095): ajustar según cada sensor
+#define SOIL_ADC_DRY 3500              // Sensor de suelo en aire: ~3000-4095
+#define SOIL_ADC_WET 1200              // Sensor de suelo en agua: ~1000-1500
+#define LDR_ADC_DARK 50                // Oscuridad total: ~10-100
+#define LDR_ADC_BRIGHT 3500            // Luz brillante: ~3000-4095
 
 // ============================================
 // UMBRALES Y ALERTAS
@@ -103,32 +188,196 @@ const char AWS_CERT_PRIVATE[] PROGMEM = R"EOF(
 #define LUX_MIN 20.0
 #define LUX_MAX 100.0
 
+// Reglas de control y alerta por defecto (ver rule_engine.h):
+// X(métrica, comparador, umbral, histéresis, permanencia ms, actuador, severidad)
+// La histéresis lleva cada métrica de vuelta a su rango ideal antes de
+// apagar el actuador o rearmar la alerta. Se sustituyen en tiempo de
+// ejecución publicando en TOPIC_REGLAS (ver handleRulesMessage en app.cpp).
+#define RULE_LIST(X) \
+  X(TEMPERATURA,   ABOVE, TEMP_MAX, TEMP_MAX - TEMP_IDEAL_MAX, 0, VENTILADOR, CRITICAL) \
+  X(TEMPERATURA,   BELOW, TEMP_MIN, TEMP_IDEAL_MIN - TEMP_MIN, 0, NONE, WARNING) \
+  X(HUMEDAD,       ABOVE, HUM_MAX, HUM_MAX - HUM_IDEAL_MAX, 300000, VENTILADOR, WARNING) \
+  X(HUMEDAD,       BELOW, HUM_MIN, HUM_IDEAL_MIN - HUM_MIN, 300000, NONE, WARNING) \
+  X(HUMEDAD_SUELO, BELOW, SOIL_MIN, SOIL_IDEAL_MIN - SOIL_MIN, 0, BOMBA, WARNING) \
+  X(HUMEDAD_SUELO, ABOVE, SOIL_MAX, SOIL_MAX - SOIL_IDEAL_MAX, 0, NONE, WARNING) \
+  X(LUMINOSIDAD,   BELOW, LUX_MIN, 5.0, 600000, NONE, INFO)
+
+#define RULE_CAPACITY 32               // Reglas cargables a la vez
+#define RULES_JSON_SIZE 4096           // Documento para parsear un mensaje de TOPIC_REGLAS
+
+// ============================================
+// CONTROL DE CLIMA (LAZO CERRADO)
+// ============================================
+// Ventilador y bomba con PID y relay proporcional en el tiempo (ver
+// climate_control.h), a la cadencia de un temporizador propio e
+// independiente del calendario de lecturas. Las reglas que piden estos
+// actuadores actúan como forzado de seguridad. Un comando manual suspende
+// el lazo de ese actuador durante CONTROL_MANUAL_HOLD_MS. Sintonía
+// validada con: program --control-sim 48
+#ifndef CLIMATE_CONTROL
+#define CLIMATE_CONTROL true
+#endif
+#define CONTROL_PERIOD_MS 1000         // Periodo del temporizador del lazo
+#define CONTROL_MAX_AGE_MS 90000       // Sin medida más reciente, el lazo apaga su relay
+#define CONTROL_MANUAL_HOLD_MS 1800000 // 30 min
+
+// Ventilador: enfría hacia FAN_SETPOINT (°C)
+#define FAN_SETPOINT (TEMP_IDEAL_MAX - 2.0)
+#define FAN_KP 0.25                    // 100 % con 4 °C por encima
+#define FAN_KI 0.0005
+#define FAN_KD 0.0
+#define FAN_WINDOW_MS 300000
+#define FAN_MIN_ON_MS 30000
+#define FAN_MIN_OFF_MS 30000
+
+// Bomba: riega hacia PUMP_SETPOINT (% de humedad del suelo). El agua
+// tarda en llegar al sensor: ventana larga y poca acción integral.
+#define PUMP_SETPOINT ((SOIL_IDEAL_MIN + SOIL_IDEAL_MAX) / 2)
+#define PUMP_KP 0.1                    // 100 % con 10 puntos por debajo
+#define PUMP_KI 0.000005
+#define PUMP_KD 0.0
+#define PUMP_WINDOW_MS 1200000
+#define PUMP_MIN_ON_MS 60000
+#define PUMP_MIN_OFF_MS 300000
+
 // ============================================
 // CONFIGURACIÓN MQTT
 // ============================================
-#define MQTT_BUFFER_SIZE 512
+#define MQTT_BUFFER_SIZE 1024
 #define MQTT_KEEPALIVE 60
-#define MQTT_RECONNECT_DELAY_MS 5000
-#define MQTT_MAX_RECONNECT_ATTEMPTS 5
+#define MQTT_RECONNECT_DELAY_MS 5000   // Espera mínima tras un intento fallido
+#define MQTT_BACKOFF_MAX_MS 120000     // Se duplica (con jitter) hasta este tope
+#define MQTT_CONNECT_TIMEOUT_MS 15000  // TLS + CONNECT -> CONNACK
+#define MQTT_WRITE_TIMEOUT_MS 10000    // Escritura TLS sin avanzar -> enlace caído
+
+// Cola de salida asíncrona (ver mqtt_outbox.h): los mensajes se copian a
+// una de MQTT_OUTBOX_SLOTS ranuras de MQTT_BUFFER_SIZE y se envían por
+// prioridad (estado > alertas > telemetría). La telemetría no puede ocupar
+// las MQTT_OUTBOX_RESERVED últimas ranuras libres.
+#define MQTT_OUTBOX_SLOTS 8
+#define MQTT_OUTBOX_RESERVED 2
+#define MQTT_INFLIGHT_WINDOW 4         // PUBLISH QoS1 sin PUBACK a la vez
+#define MQTT_RETRANSMIT_MS 10000       // Reenvío (DUP) si no llega el PUBACK
+#define MQTT_QOS_STATUS 1
+#define MQTT_QOS_ALERTS 1
+#define MQTT_QOS_TELEMETRY 1
+#define MQTT_QOS_COMMANDS 1            // Suscripción a los actuadores
+#define MQTT_LINK_BUFFER_SIZE 4096     // Bytes entre la tarea de red y la de E/S TLS (potencia de 2)
+#define MQTT_IO_TASK_STACK 6144
+#define MQTT_IO_TASK_PRIORITY 1
+
+// ============================================
+// PUBLICACIÓN DE TELEMETRÍA
+// ============================================
+// TELEMETRY_BATCHED: un mensaje con varias lecturas en TOPIC_TELEMETRIA
+// TELEMETRY_LEGACY_TOPICS: cada lectura en los 4 topics por métrica
+#define TELEMETRY_MODE TELEMETRY_BATCHED
+#define TELEMETRY_BATCH_SIZE 8         // Lecturas por mensaje (~95 B c/u en JSON, ~17 B en CBOR)
+                                       // Con ventanas ~325 B y ~80 B: un lote que no cabe en
+                                       // MQTT_BUFFER_SIZE se publica antes de llenarse
+#define TELEMETRY_BATCH_MAX_AGE_MS 300000  // Publicar como máximo 5 min después
+
+// Codificación por topic: CODEC_JSON (texto), CODEC_CBOR (binario compacto,
+// claves enteras y valores en centésimas) o CODEC_SERIES (bloque comprimido
+// delta-de-delta, ~4 B por lectura; solo telemetría). Ver payload_codec.h
+#define TELEMETRY_CODEC CODEC_JSON     // TOPIC_TELEMETRIA
+#define ALERTS_CODEC CODEC_JSON        // TOPIC_ALERTAS
+
+// Reporte por excepción (ver report_filter.h): se publican solo las
+// lecturas que se alejan de la última publicada más que la banda muerta
+// de alguna métrica, las que cruzan un umbral de las reglas (publicando el
+// lote al momento) y un latido cada REPORT_HEARTBEAT_MS. El muestreo, las
+// reglas y el control siguen usando todas las lecturas.
+#ifndef REPORT_BY_EXCEPTION
+#define REPORT_BY_EXCEPTION true
+#endif
+#define REPORT_HEARTBEAT_MS 1800000    // Silencio máximo (30 min)
+// Banda muerta por métrica: max(absoluta, relativa * |última publicada|)
+#define REPORT_TEMP_DEADBAND 0.5       // °C
+#define REPORT_HUM_DEADBAND 3.0        // %
+#define REPORT_SOIL_DEADBAND 3.0       // %
+#define REPORT_LUX_DEADBAND 3.0        // %
+#define REPORT_LUX_RELATIVE 0.1        // La luz varía en órdenes de magnitud
+
+// ============================================
+// ALMACENAMIENTO LOCAL (STORE-AND-FORWARD)
+// ============================================
+// Lecturas guardadas en LittleFS mientras MQTT no está disponible
+#define STORE_FILE_PATH "/telemetria.log"
+#define STORE_SECTOR_SIZE 4096         // Bytes por sector lógico (~146 lecturas)
+#define STORE_SECTOR_COUNT 64          // 256 KB => ~9300 lecturas (~3 días a 30 s)
+#define STORE_SYNC_RECORDS 16          // Volcado a LittleFS cada 16 lecturas (~8 min a 30 s)
+#define STORE_DRAIN_RATE 20            // Lecturas reenviadas por segundo (máx.)
+#define STORE_DRAIN_BURST 10           // Lecturas por lote de reenvío
+
+// ============================================
+// TRAZAS (REGISTRO Y REPRODUCCIÓN)
+// ============================================
+// Lecturas, mensajes MQTT y cambios de conexión en TRACE_FILE_PATH para
+// reproducir incidentes en el host (ver trace.h y native/replay.cpp)
+#define ENABLE_TRACE false
+#define TRACE_FILE_PATH "/traza.bin"
+#define TRACE_FILE_MAX_BYTES 262144    // Se deja de registrar al alcanzarlo
+#define TRACE_BUFFER_SIZE 4096         // Buffer en RAM entre volcados
+#define TRACE_FLUSH_INTERVAL_MS 5000   // Volcado periódico al archivo
+
+// ============================================
+// DIAGNÓSTICO DEL CAMINO CALIENTE
+// ============================================
+// Tiempos por fase (ciclos de CPU), heap y contadores de publicación y
+// reconexión, resumidos cada DIAG_REPORT_INTERVAL_MS en TOPIC_DIAGNOSTICO
+// (ver diagnostics.h). Con false no se compila nada de la instrumentación.
+#ifndef ENABLE_DIAGNOSTICS
+#define ENABLE_DIAGNOSTICS true
+#endif
+#define DIAG_REPORT_INTERVAL_MS 300000 // Resumen cada 5 minutos
+#define DIAG_REPORT_SIZE 640           // Payload del resumen (B)
+
+// ============================================
+// CONFIGURACIÓN DE TAREAS (FreeRTOS)
+// ============================================
+// Adquisición y control en el núcleo 1 (APP_CPU); WiFi/TLS/MQTT en el
+// núcleo 0 (PRO_CPU), donde ya corre la pila WiFi del ESP32
+#define ACQ_TASK_CORE 1
+#define ACQ_TASK_PRIORITY 3
+#define ACQ_TASK_STACK 4096
+#define NET_TASK_CORE 0
+#define NET_TASK_PRIORITY 2
+#define NET_TASK_STACK 8192
+#define TELEMETRY_QUEUE_LEN 16         // Lecturas pendientes de publicar (potencia de 2)
+#define COMMAND_QUEUE_LEN 8            // Comandos pendientes de aplicar (potencia de 2)
+#define ALERT_QUEUE_LEN 8              // Alertas pendientes de publicar (potencia de 2)
 
 // ============================================
 // CONFIGURACIÓN GENERAL
 // ============================================
 #define SERIAL_BAUD_RATE 115200
 #define WATCHDOG_TIMEOUT_S 30
-#define ENABLE_SERIAL_DEBUG true
+#define LOOP_IDLE_DELAY_MS 1           // Cesión de CPU por iteración del loop
+#define LED_BLINK_MS 100               // Duración del parpadeo de transmisión
+#define BOOT_BLINK_MS 200              // Parpadeo de arranque (3 veces, sin bloquear)
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "dev"         // Publicada con los tiempos de arranque (-DFIRMWARE_VERSION=...)
+#endif
 
 // ============================================
-// MACROS DE DEBUG
+// REGISTRO (LOG)
 // ============================================
-#if ENABLE_SERIAL_DEBUG
-  #define DEBUG_PRINT(x) Serial.print(x)
-  #define DEBUG_PRINTLN(x) Serial.println(x)
-  #define DEBUG_PRINTF(x, ...) Serial.printf(x, __VA_ARGS__)
-#else
-  #define DEBUG_PRINT(x)
-  #define DEBUG_PRINTLN(x)
-  #define DEBUG_PRINTF(x, ...)
+// Mensajes con nivel y módulo que una tarea de baja prioridad formatea y
+// escribe por el puerto serie, fuera del camino caliente (ver logger.h).
+// LOG_LEVEL: 0 nada, 1 errores, 2 advertencias, 3 información,
+// 4 depuración (cada lectura y publicación); los niveles superiores no
+// se compilan. En el host los mensajes se descartan salvo con --verbose.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 3
 #endif
+#define LOG_RING_SIZE 32               // Mensajes pendientes de escribir (potencia de 2)
+#define LOG_TEXT_SIZE 48               // Copia de los argumentos %s de cada mensaje
+#define LOG_LINE_SIZE 192              // Línea formateada
+#define LOG_DRAIN_BATCH 8              // Mensajes por pasada de la tarea de registro
+#define LOG_IDLE_DELAY_MS 20           // Espera de la tarea de registro sin mensajes
+#define LOG_TASK_CORE 1                // Solo corre cuando la adquisición cede la CPU
+#define LOG_TASK_PRIORITY 0
+#define LOG_TASK_STACK 3072
 
 #endif // CONFIG_H
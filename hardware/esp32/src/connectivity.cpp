@@ -0,0 +1,182 @@
+#include "connectivity.h"
+#include "config.h"
+#include "backoff.h"
+#include "hal.h"
+#include "logger.h"
+#include "mqtt_client.h"
+#include <string.h>
+
+/**
+ * Reconexión WiFi sin bloqueo (ver connectivity.h). Solo la tarea de red
+ * llama a estas funciones; los eventos del controlador llegan por
+ * halNetworkState().
+ */
+
+enum JoinState : uint8_t {
+  JOIN_WAITING,     // Backoff antes del siguiente intento
+  JOIN_FAST,        // Asociación directa al AP guardado
+  JOIN_SCAN,        // Asociación con búsqueda completa
+  JOIN_ONLINE
+};
+
+// Variables de estado
+JoinState joinState = JOIN_WAITING;
+unsigned long joinStartedAt = 0;
+unsigned long joinWaitMs = 0;
+bool fastJoinFailed = false;       // El AP guardado no respondió en esta ronda
+bool wifiLost = false;             // Asociación perdida (se mide la recuperación)
+unsigned long wifiLostAt = 0;
+bool serviceUp = false;
+bool serviceLost = false;
+unsigned long serviceLostAt = 0;
+Backoff joinBackoff(WIFI_BACKOFF_MIN_MS, WIFI_BACKOFF_MAX_MS);
+
+// AP de la última asociación
+HalWifiHint wifiHint;
+bool wifiHintValid = false;
+
+ConnectivityStats connectivityStats;
+
+/**
+ * Inicia un intento: directo si hay AP guardado y no falló en esta ronda
+ */
+static void startJoin(unsigned long now) {
+  joinStartedAt = now;
+
+  if (wifiHintValid && !fastJoinFailed) {
+    joinState = JOIN_FAST;
+    halNetworkJoin(&wifiHint);
+  } else {
+    joinState = JOIN_SCAN;
+    halNetworkJoin(nullptr);
+  }
+}
+
+/**
+ * Intento fallido: tras el directo se busca de inmediato; tras una
+ * búsqueda se espera con backoff y la siguiente ronda vuelve a ser directa
+ */
+static void joinFailed(unsigned long now) {
+  connectivityStats.failedJoins++;
+  halNetworkLeave();
+
+  if (joinState == JOIN_FAST) {
+    fastJoinFailed = true;
+    startJoin(now);
+    return;
+  }
+
+  fastJoinFailed = false;
+  joinWaitMs = joinBackoff.next(halRandom());
+  joinStartedAt = now;
+  joinState = JOIN_WAITING;
+  LOG_W(LOG_NET, "WiFi no disponible; reintento en %lu ms", joinWaitMs);
+}
+
+/**
+ * IP asignada: guardar el AP si cambió y medir la recuperación
+ */
+static void joined(unsigned long now) {
+  if (joinState == JOIN_FAST) {
+    connectivityStats.fastJoins++;
+  } else {
+    connectivityStats.scanJoins++;
+  }
+
+  LOG_I(LOG_NET, "¡WiFi conectado! (%s, %lu ms)",
+        joinState == JOIN_FAST ? "asociación directa" : "búsqueda completa",
+        now - joinStartedAt);
+
+  if (wifiLost) {
+    connectivityStats.wifiRecoveryMs.record((uint32_t)(now - wifiLostAt));
+    wifiLost = false;
+  }
+
+  HalWifiHint current;
+  if (halNetworkCurrentHint(current) &&
+      (!wifiHintValid || memcmp(&current, &wifiHint, sizeof(current)) != 0)) {
+    wifiHint = current;
+    wifiHintValid = true;
+    halNetworkSaveHint(wifiHint);
+  }
+
+  joinBackoff.reset();
+  fastJoinFailed = false;
+  joinState = JOIN_ONLINE;
+}
+
+/**
+ * Inicializa la radio y lanza la primera asociación (no espera)
+ */
+void connectivityBegin() {
+  halNetworkBegin();
+
+  memset(&wifiHint, 0, sizeof(wifiHint));
+  wifiHintValid = halNetworkLoadHint(wifiHint);
+  fastJoinFailed = false;
+  wifiLost = false;
+  serviceUp = false;
+  serviceLost = false;
+  joinBackoff.reset();
+
+  LOG_I(LOG_NET, "Conectando a WiFi: %s", WIFI_SSID);
+  startJoin(halMillis());
+}
+
+/**
+ * Una iteración del gestor. Debe llamarse en cada paso de la tarea de
+ * red, antes de mqttLoop(); nunca bloquea.
+ */
+void connectivityStep() {
+  unsigned long now = halMillis();
+  HalNetState net = halNetworkState();
+
+  switch (joinState) {
+    case JOIN_WAITING:
+      if (now - joinStartedAt >= joinWaitMs) {
+        startJoin(now);
+      }
+      break;
+
+    case JOIN_FAST:
+    case JOIN_SCAN: {
+      unsigned long timeout = joinState == JOIN_FAST ? WIFI_FAST_TIMEOUT_MS : WIFI_TIMEOUT_MS;
+      if (net == NET_UP) {
+        joined(now);
+      } else if (net == NET_DOWN || now - joinStartedAt > timeout) {
+        joinFailed(now);
+      }
+      break;
+    }
+
+    case JOIN_ONLINE:
+      if (net != NET_UP) {
+        LOG_W(LOG_NET, "WiFi desconectado. Reconectando...");
+        connectivityStats.wifiDrops++;
+        wifiLost = true;
+        wifiLostAt = now;
+        halNetworkLeave();
+        startJoin(now);
+      }
+      break;
+  }
+
+  // Disponibilidad del servicio: de sesión perdida a sesión restablecida
+  bool online = isMQTTConnected();
+  if (serviceUp && !online) {
+    connectivityStats.outages++;
+    serviceLost = true;
+    serviceLostAt = now;
+  } else if (!serviceUp && online && serviceLost) {
+    connectivityStats.serviceRecoveryMs.record((uint32_t)(now - serviceLostAt));
+    serviceLost = false;
+  }
+  serviceUp = online;
+}
+
+/**
+ * Contadores de asociaciones y tiempos de recuperación desde el arranque
+ */
+const ConnectivityStats& getConnectivityStats() {
+  return connectivityStats;
+}
@@ -0,0 +1,34 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <stdint.h>
+#include "latency_histogram.h"
+
+/**
+ * Gestor de conectividad WiFi de la tarea de red.
+ *
+ * Máquina de estados sin bloqueo sobre los eventos de la HAL: al perder
+ * el AP reintenta de inmediato con el BSSID y canal guardados (unos cientos
+ * de ms en lugar de una búsqueda completa); si no responde, busca en todos
+ * los canales, y tras cada ronda fallida espera con backoff y jitter
+ * (ver backoff.h). La sesión MQTT se reanuda sola en cuanto hay IP. La
+ * adquisición y el control nunca esperan a la red, y el firmware no se
+ * reinicia por cortes transitorios.
+ */
+
+struct ConnectivityStats {
+  uint32_t wifiDrops;                  // Asociaciones perdidas
+  uint32_t fastJoins;                  // Asociaciones directas (BSSID y canal)
+  uint32_t scanJoins;                  // Asociaciones con búsqueda completa
+  uint32_t failedJoins;
+  uint32_t outages;                    // Sesiones MQTT perdidas
+  LatencyHistogram wifiRecoveryMs;     // Asociación perdida -> IP de nuevo
+  LatencyHistogram serviceRecoveryMs;  // Sesión perdida -> sesión MQTT de nuevo
+};
+
+// Funciones públicas
+void connectivityBegin();
+void connectivityStep();
+const ConnectivityStats& getConnectivityStats();
+
+#endif // CONNECTIVITY_H
@@ -0,0 +1,88 @@
+#include "dht22_decoder.h"
+
+// Tolerancias (us). Preámbulo (~80) y bajo de bit (~50) no se solapan
+// para no confundir un bit con la respuesta al buscar el inicio
+#define DHT_PREAMBLE_MIN 65
+#define DHT_PREAMBLE_MAX 100
+#define DHT_BIT_LOW_MIN 35
+#define DHT_BIT_LOW_MAX 64
+#define DHT_BIT_HIGH_MIN 10
+#define DHT_BIT_HIGH_MAX 100
+#define DHT_BIT_ONE_THRESHOLD 48    // Alto > umbral => bit 1
+
+static bool inRange(uint16_t value, uint16_t min, uint16_t max) {
+  return value >= min && value <= max;
+}
+
+/**
+ * Decodifica una transacción completa del DHT22
+ */
+Dht22Status decodeDht22(const DhtPulse* pulses, size_t count, Dht22Reading& reading) {
+  // Buscar el preámbulo: bajo ~80 us seguido de alto ~80 us
+  size_t i = 0;
+  bool found = false;
+
+  for (; i + 1 < count; i++) {
+    if (pulses[i].level == 0 && pulses[i + 1].level == 1 &&
+        inRange(pulses[i].duration, DHT_PREAMBLE_MIN, DHT_PREAMBLE_MAX) &&
+        inRange(pulses[i + 1].duration, DHT_PREAMBLE_MIN, DHT_PREAMBLE_MAX)) {
+      found = true;
+      i += 2;
+      break;
+    }
+  }
+
+  if (!found) {
+    return DHT_ERR_NO_RESPONSE;
+  }
+
+  uint8_t bytes[5] = { 0, 0, 0, 0, 0 };
+
+  for (int bit = 0; bit < 40; bit++, i += 2) {
+    if (i + 1 >= count) {
+      return DHT_ERR_TRUNCATED;
+    }
+
+    const DhtPulse& low = pulses[i];
+    const DhtPulse& high = pulses[i + 1];
+
+    if (low.level != 0 || high.level != 1 ||
+        !inRange(low.duration, DHT_BIT_LOW_MIN, DHT_BIT_LOW_MAX) ||
+        !inRange(high.duration, DHT_BIT_HIGH_MIN, DHT_BIT_HIGH_MAX)) {
+      return DHT_ERR_TIMING;
+    }
+
+    bytes[bit / 8] <<= 1;
+    if (high.duration > DHT_BIT_ONE_THRESHOLD) {
+      bytes[bit / 8] |= 1;
+    }
+  }
+
+  if ((uint8_t)(bytes[0] + bytes[1] + bytes[2] + bytes[3]) != bytes[4]) {
+    return DHT_ERR_CHECKSUM;
+  }
+
+  uint16_t rawHum = (bytes[0] << 8) | bytes[1];
+  uint16_t rawTemp = ((bytes[2] & 0x7F) << 8) | bytes[3];
+
+  reading.humedad = rawHum / 10.0f;
+  reading.temperatura = rawTemp / 10.0f;
+  if (bytes[2] & 0x80) {
+    reading.temperatura = -reading.temperatura;
+  }
+
+  return DHT_OK;
+}
+
+const char* dht22StatusName(Dht22Status status) {
+  switch (status) {
+    case DHT_OK: return "ok";
+    case DHT_PENDING: return "en curso";
+    case DHT_ERR_TIMEOUT: return "sin captura";
+    case DHT_ERR_NO_RESPONSE: return "sin respuesta";
+    case DHT_ERR_TRUNCATED: return "trama incompleta";
+    case DHT_ERR_TIMING: return "tiempos fuera de rango";
+    case DHT_ERR_CHECKSUM: return "checksum";
+  }
+  return "desconocido";
+}
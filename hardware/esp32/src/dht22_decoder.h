@@ -0,0 +1,40 @@
+#ifndef DHT22_DECODER_H
+#define DHT22_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Decodificación del tren de pulsos del DHT22.
+ *
+ * Función pura (sin hardware ni Arduino): recibe los pulsos capturados
+ * (nivel y duración en microsegundos) y devuelve temperatura y humedad de
+ * una sola transacción. Trama esperada tras la señal de inicio del host:
+ *   respuesta: bajo ~80 us, alto ~80 us
+ *   40 bits:   bajo ~50 us + alto ~26 us (0) o ~70 us (1)
+ *   bytes:     humedad (16 bits), temperatura (16 bits, bit 15 = signo), checksum
+ */
+enum Dht22Status : uint8_t {
+  DHT_OK,
+  DHT_PENDING,            // Transacción en curso (solo driver)
+  DHT_ERR_TIMEOUT,        // No llegó ninguna captura (solo driver)
+  DHT_ERR_NO_RESPONSE,    // No se encontró el preámbulo de respuesta
+  DHT_ERR_TRUNCATED,      // Menos de 40 bits
+  DHT_ERR_TIMING,         // Pulso fuera de tolerancia
+  DHT_ERR_CHECKSUM
+};
+
+struct DhtPulse {
+  uint8_t level;          // 0 = bajo, 1 = alto
+  uint16_t duration;      // Microsegundos
+};
+
+struct Dht22Reading {
+  float temperatura;
+  float humedad;
+};
+
+Dht22Status decodeDht22(const DhtPulse* pulses, size_t count, Dht22Reading& reading);
+const char* dht22StatusName(Dht22Status status);
+
+#endif // DHT22_DECODER_H
@@ -0,0 +1,239 @@
+#include "dht22_rmt.h"
+#include "config.h"
+#include "logger.h"
+#include <atomic>
+#include <driver/gpio.h>
+#include <esp_idf_version.h>
+
+/**
+ * Driver del DHT22 sobre el periférico RMT.
+ *
+ * El host baja la línea DHT_START_LOW_US (pin en drenador abierto) y la
+ * libera; a partir de ahí el RMT captura por hardware el tren de pulsos
+ * del sensor y lo entrega completo al terminar (línea inactiva más de
+ * DHT_RMT_IDLE_US). No se deshabilitan interrupciones ni se espera:
+ * pollDht22() solo avanza la transacción y decodifica fuera de la ISR.
+ */
+
+#define DHT_RMT_RESOLUTION_HZ 1000000   // 1 tick = 1 us
+#define DHT_RMT_IDLE_US 200             // Fin de trama
+#define DHT_RMT_MAX_SYMBOLS 64          // 43 símbolos por trama
+#define DHT_MAX_PULSES (DHT_RMT_MAX_SYMBOLS * 2)
+
+enum DhtTransaction {
+  DHT_TX_IDLE,
+  DHT_TX_START_LOW,    // Señal de inicio en curso
+  DHT_TX_CAPTURING     // RMT recibiendo
+};
+
+DhtTransaction dhtTx = DHT_TX_IDLE;
+unsigned long dhtStartedAt = 0;     // micros() del inicio de la señal
+unsigned long dhtDeadline = 0;      // millis() límite de la captura
+DhtPulse dhtPulses[DHT_MAX_PULSES];
+
+/**
+ * Añade los dos semiperiodos de un símbolo RMT a la lista de pulsos
+ */
+static size_t appendSymbol(size_t count, uint8_t level0, uint16_t duration0,
+                           uint8_t level1, uint16_t duration1) {
+  if (duration0 > 0 && count < DHT_MAX_PULSES) {
+    dhtPulses[count++] = { level0, duration0 };
+  }
+  if (duration1 > 0 && count < DHT_MAX_PULSES) {
+    dhtPulses[count++] = { level1, duration1 };
+  }
+  return count;
+}
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+// ============================================
+// DRIVER RMT RX (ESP-IDF 5)
+// ============================================
+#include <driver/rmt_rx.h>
+
+rmt_channel_handle_t dhtChannel = nullptr;
+rmt_symbol_word_t dhtSymbols[DHT_RMT_MAX_SYMBOLS];
+std::atomic<size_t> dhtReceived(0);
+std::atomic<bool> dhtDone(false);
+
+// Se llama desde ISR al terminar la trama
+static bool IRAM_ATTR onDhtReceiveDone(rmt_channel_handle_t channel,
+                                       const rmt_rx_done_event_data_t* edata,
+                                       void* userData) {
+  dhtReceived.store(edata->num_symbols, std::memory_order_relaxed);
+  dhtDone.store(true, std::memory_order_release);
+  return false;
+}
+
+static bool initRmtReceiver() {
+  rmt_rx_channel_config_t config = {};
+  config.gpio_num = (gpio_num_t)PIN_DHT22;
+  config.clk_src = RMT_CLK_SRC_DEFAULT;
+  config.resolution_hz = DHT_RMT_RESOLUTION_HZ;
+  config.mem_block_symbols = DHT_RMT_MAX_SYMBOLS;
+
+  rmt_rx_event_callbacks_t callbacks = {};
+  callbacks.on_recv_done = onDhtReceiveDone;
+
+  return rmt_new_rx_channel(&config, &dhtChannel) == ESP_OK &&
+         rmt_rx_register_event_callbacks(dhtChannel, &callbacks, nullptr) == ESP_OK &&
+         rmt_enable(dhtChannel) == ESP_OK;
+}
+
+static bool startRmtCapture() {
+  rmt_receive_config_t config = {};
+  config.signal_range_min_ns = 1000;                  // Filtro de glitches
+  config.signal_range_max_ns = DHT_RMT_IDLE_US * 1000;
+
+  dhtDone.store(false, std::memory_order_relaxed);
+  return rmt_receive(dhtChannel, dhtSymbols, sizeof(dhtSymbols), &config) == ESP_OK;
+}
+
+// Retorna el número de pulsos capturados, o -1 si aún no hay trama
+static int takeRmtCapture() {
+  if (!dhtDone.load(std::memory_order_acquire)) {
+    return -1;
+  }
+
+  size_t count = 0;
+  size_t symbols = dhtReceived.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < symbols; i++) {
+    count = appendSymbol(count, dhtSymbols[i].level0, dhtSymbols[i].duration0,
+                         dhtSymbols[i].level1, dhtSymbols[i].duration1);
+  }
+  return (int)count;
+}
+
+static void abortRmtCapture() {
+  // No hay cancelación de rmt_receive(): reiniciar el canal
+  rmt_disable(dhtChannel);
+  rmt_enable(dhtChannel);
+}
+
+#else
+// ============================================
+// DRIVER RMT LEGACY (ESP-IDF 4)
+// ============================================
+#include <driver/rmt.h>
+
+RingbufHandle_t dhtRingbuf = nullptr;
+
+static bool initRmtReceiver() {
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)PIN_DHT22, (rmt_channel_t)DHT_RMT_CHANNEL);
+  config.clk_div = APB_CLK_FREQ / DHT_RMT_RESOLUTION_HZ;
+  config.mem_block_num = 1;
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = 80;          // ~1 us a 80 MHz
+  config.rx_config.idle_threshold = DHT_RMT_IDLE_US;
+
+  return rmt_config(&config) == ESP_OK &&
+         rmt_driver_install(config.channel, 1024, 0) == ESP_OK &&
+         rmt_get_ringbuf_handle(config.channel, &dhtRingbuf) == ESP_OK;
+}
+
+static bool startRmtCapture() {
+  return rmt_rx_start((rmt_channel_t)DHT_RMT_CHANNEL, true) == ESP_OK;
+}
+
+static int takeRmtCapture() {
+  size_t bytes = 0;
+  rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(dhtRingbuf, &bytes, 0);
+  if (items == nullptr) {
+    return -1;
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < bytes / sizeof(rmt_item32_t); i++) {
+    count = appendSymbol(count, items[i].level0, items[i].duration0,
+                         items[i].level1, items[i].duration1);
+  }
+
+  vRingbufferReturnItem(dhtRingbuf, items);
+  rmt_rx_stop((rmt_channel_t)DHT_RMT_CHANNEL);
+  return (int)count;
+}
+
+static void abortRmtCapture() {
+  rmt_rx_stop((rmt_channel_t)DHT_RMT_CHANNEL);
+
+  // Descartar una posible trama tardía
+  size_t bytes = 0;
+  void* item = xRingbufferReceive(dhtRingbuf, &bytes, 0);
+  if (item != nullptr) {
+    vRingbufferReturnItem(dhtRingbuf, item);
+  }
+}
+#endif
+
+/**
+ * Configura el canal RMT y el pin en drenador abierto
+ */
+bool initDht22() {
+  if (!initRmtReceiver()) {
+    LOG_E(LOG_SENSORS, "No se pudo iniciar el RMT del DHT22");
+    return false;
+  }
+
+  // El RMT lee la entrada; el host solo baja la línea en la señal de inicio
+  gpio_set_direction((gpio_num_t)PIN_DHT22, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode((gpio_num_t)PIN_DHT22, GPIO_PULLUP_ONLY);
+  gpio_set_level((gpio_num_t)PIN_DHT22, 1);
+
+  LOG_I(LOG_SENSORS, "DHT22 sobre RMT inicializado");
+  return true;
+}
+
+/**
+ * Inicia una transacción: baja la línea (señal de inicio)
+ */
+void startDht22Read() {
+  if (dhtTx == DHT_TX_CAPTURING) {
+    abortRmtCapture();
+  }
+
+  gpio_set_level((gpio_num_t)PIN_DHT22, 0);
+  dhtStartedAt = micros();
+  dhtTx = DHT_TX_START_LOW;
+}
+
+/**
+ * Avanza la transacción en curso sin esperar. Retorna DHT_PENDING hasta
+ * tener la trama completa; luego el resultado de la decodificación.
+ */
+Dht22Status pollDht22(Dht22Reading& reading) {
+  switch (dhtTx) {
+    case DHT_TX_START_LOW:
+      if (micros() - dhtStartedAt < DHT_START_LOW_US) {
+        return DHT_PENDING;
+      }
+
+      // Liberar la línea y capturar: el sensor responde en 20-40 us
+      gpio_set_level((gpio_num_t)PIN_DHT22, 1);
+      if (!startRmtCapture()) {
+        dhtTx = DHT_TX_IDLE;
+        return DHT_ERR_TIMEOUT;
+      }
+      dhtDeadline = millis() + DHT_READ_TIMEOUT_MS;
+      dhtTx = DHT_TX_CAPTURING;
+      return DHT_PENDING;
+
+    case DHT_TX_CAPTURING: {
+      int count = takeRmtCapture();
+
+      if (count < 0) {
+        if ((long)(millis() - dhtDeadline) < 0) {
+          return DHT_PENDING;
+        }
+        abortRmtCapture();
+        dhtTx = DHT_TX_IDLE;
+        return DHT_ERR_TIMEOUT;
+      }
+
+      dhtTx = DHT_TX_IDLE;
+      return decodeDht22(dhtPulses, count, reading);
+    }
+
+    default:
+      return DHT_ERR_TIMEOUT;
+  }
+}
@@ -0,0 +1,12 @@
+#ifndef DHT22_RMT_H
+#define DHT22_RMT_H
+
+#include <Arduino.h>
+#include "dht22_decoder.h"
+
+// Funciones públicas
+bool initDht22();
+void startDht22Read();
+Dht22Status pollDht22(Dht22Reading& reading);
+
+#endif // DHT22_RMT_H
@@ -0,0 +1,125 @@
+#include "diagnostics.h"
+
+#if ENABLE_DIAGNOSTICS
+
+#include <atomic>
+#include <stdio.h>
+#include "latency_histogram.h"
+#include "mqtt_client.h"
+#include "connectivity.h"
+#include "app.h"
+
+static const char* const DIAG_PHASE_NAMES[DIAG_PHASE_COUNT] = {
+  "sensors", "wifi", "mqtt_loop", "serialize", "publish"
+};
+
+// Resumen de una fase en ciclos
+struct PhaseSummary {
+  uint32_t count;
+  uint32_t min;
+  uint32_t p50;
+  uint32_t p99;
+  uint32_t max;
+};
+
+// Ventana actual, por fase (cada una la escribe solo su tarea)
+LatencyHistogram diagPhases[DIAG_PHASE_COUNT];
+
+// Entrega de la ventana de la tarea de adquisición a la de red
+PhaseSummary diagSensorWindow;
+std::atomic<bool> diagSensorRequested(false);
+std::atomic<bool> diagSensorReady(false);
+
+// Propiedad de la tarea de red
+bool diagWindowClosing = false;
+unsigned long diagWindowStartedAt = 0;
+
+static PhaseSummary summarize(const LatencyHistogram& histogram) {
+  PhaseSummary summary;
+  summary.count = (uint32_t)histogram.count();
+  summary.min = histogram.min();
+  summary.p50 = histogram.percentile(0.50);
+  summary.p99 = histogram.percentile(0.99);
+  summary.max = histogram.max();
+  return summary;
+}
+
+/**
+ * Registra la duración de una fase. La tarea de adquisición entrega aquí
+ * su ventana cuando la tarea de red la pide.
+ */
+void diagRecord(DiagPhase phase, uint32_t cycles) {
+  diagPhases[phase].record(cycles);
+
+  if (phase == DIAG_SENSORS && diagSensorRequested.load(std::memory_order_acquire)) {
+    diagSensorWindow = summarize(diagPhases[DIAG_SENSORS]);
+    diagPhases[DIAG_SENSORS].reset();
+    diagSensorRequested.store(false, std::memory_order_relaxed);
+    diagSensorReady.store(true, std::memory_order_release);
+  }
+}
+
+bool diagReportDue(unsigned long now) {
+  if (!diagWindowClosing) {
+    if (now - diagWindowStartedAt < DIAG_REPORT_INTERVAL_MS) {
+      return false;
+    }
+
+    diagSensorRequested.store(true, std::memory_order_release);
+    diagWindowClosing = true;
+  }
+
+  return diagSensorReady.load(std::memory_order_acquire);
+}
+
+/**
+ * Escribe una fase como "nombre":[n,mín,p50,p99,máx] (us)
+ */
+static int writePhase(char* out, size_t capacity, DiagPhase phase, const PhaseSummary& s) {
+  float perUs = (float)halCyclesPerUs();
+  return snprintf(out, capacity, "%s\"%s\":[%lu,%.1f,%.1f,%.1f,%.1f]",
+                  phase == 0 ? "" : ",", DIAG_PHASE_NAMES[phase], (unsigned long)s.count,
+                  s.min / perUs, s.p50 / perUs, s.p99 / perUs, s.max / perUs);
+}
+
+size_t diagReportJson(char* out, size_t capacity) {
+  unsigned long now = halMillis();
+  int length = snprintf(out, capacity, "{\"thing\":\"%s\",\"timestamp\":%lu,\"window_ms\":%lu,\"us\":{",
+                        THING_NAME, now, now - diagWindowStartedAt);
+
+  for (uint8_t i = 0; i < DIAG_PHASE_COUNT && length > 0 && (size_t)length < capacity; i++) {
+    PhaseSummary summary = i == DIAG_SENSORS ? diagSensorWindow : summarize(diagPhases[i]);
+    length += writePhase(out + length, capacity - length, (DiagPhase)i, summary);
+  }
+
+  const MqttStats& mqtt = getMqttStats();
+  const ConnectivityStats& net = getConnectivityStats();
+  const TlsStats& tls = getTlsStats();
+  const ReportStats& report = getReportStats();
+  if (length > 0 && (size_t)length < capacity) {
+    length += snprintf(out + length, capacity - length,
+                       "},\"heap\":{\"free\":%lu,\"min_free\":%lu},"
+                       "\"mqtt\":{\"pub\":%lu,\"rejected\":%lu,\"retransmits\":%lu},"
+                       "\"drops\":{\"wifi\":%lu,\"mqtt\":%lu},\"tls_handshakes\":%lu,"
+                       "\"report\":{\"sent\":%lu,\"suppressed\":%lu}}",
+                       (unsigned long)halHeapFree(), (unsigned long)halHeapMinFree(),
+                       (unsigned long)mqtt.messages, (unsigned long)mqtt.rejected,
+                       (unsigned long)mqtt.retransmits, (unsigned long)net.wifiDrops,
+                       (unsigned long)net.outages, (unsigned long)tls.handshakes,
+                       (unsigned long)report.sent, (unsigned long)report.suppressed);
+  }
+
+  // Nueva ventana, quepa o no el resumen
+  for (uint8_t i = 0; i < DIAG_PHASE_COUNT; i++) {
+    if (i != DIAG_SENSORS) {
+      diagPhases[i].reset();
+    }
+  }
+  diagSensorReady.store(false, std::memory_order_relaxed);
+  diagWindowClosing = false;
+  diagWindowStartedAt = now;
+
+  return length > 0 && (size_t)length < capacity ? (size_t)length : 0;
+}
+
+#endif // ENABLE_DIAGNOSTICS
@@ -0,0 +1,64 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "hal.h"
+
+/**
+ * Instrumentación del camino caliente.
+ *
+ * Cada fase se mide con el contador de ciclos de la CPU (DIAG_SCOPE) y se
+ * acumula en un LatencyHistogram. Cada DIAG_REPORT_INTERVAL_MS la tarea de
+ * red publica en TOPIC_DIAGNOSTICO un resumen por fase (n, mín., p50, p99
+ * y máx. en us) junto con el heap libre y los contadores de publicación,
+ * caídas y handshakes, y empieza una nueva ventana. Portable (compila en
+ * el host).
+ *
+ * Con ENABLE_DIAGNOSTICS false las macros quedan vacías y el módulo no
+ * compila nada.
+ */
+
+// Fases medidas; cada una la registra siempre la misma tarea
+enum DiagPhase : uint8_t {
+  DIAG_SENSORS,     // Lectura de sensores (tarea de adquisición)
+  DIAG_WIFI,        // connectivityStep()
+  DIAG_MQTT_LOOP,   // mqttLoop(): lectura, escritura y keepalive
+  DIAG_SERIALIZE,   // Codificación de telemetría y alertas
+  DIAG_PUBLISH,     // publishPayload(): copia a la cola y primera escritura
+  DIAG_PHASE_COUNT
+};
+
+#if ENABLE_DIAGNOSTICS
+
+void diagRecord(DiagPhase phase, uint32_t cycles);
+
+// Mide el bloque que la contiene
+class DiagScope {
+public:
+  explicit DiagScope(DiagPhase phase) : phase(phase), start(halCycles()) {}
+  ~DiagScope() { diagRecord(phase, halCycles() - start); }
+
+private:
+  DiagPhase phase;
+  uint32_t start;
+};
+
+#define DIAG_CONCAT_(a, b) a##b
+#define DIAG_CONCAT(a, b) DIAG_CONCAT_(a, b)
+#define DIAG_SCOPE(phase) DiagScope DIAG_CONCAT(diagScope, __LINE__)(phase)
+
+// Tarea de red: true cuando toca publicar el resumen (la tarea de
+// adquisición ya entregó su ventana); diagReportJson() lo escribe y
+// empieza la siguiente. Retorna la longitud, o 0 si no cabe.
+bool diagReportDue(unsigned long now);
+size_t diagReportJson(char* out, size_t capacity);
+
+#else
+
+#define DIAG_SCOPE(phase)
+
+#endif // ENABLE_DIAGNOSTICS
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,207 @@
+#include "load_generator.h"
+#include "local_broker.h"
+#include "../config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <thread>
+
+/**
+ * Generador de carga de la flota (env:fleet)
+ *
+ *   program [opciones]
+ *     --host IP --port N        Broker (por defecto 127.0.0.1:1883, p. ej. Mosquitto)
+ *     --local-broker            Arranca el broker sustituto en el proceso (en --port
+ *                               si se indica, p. ej. para conectar la ingesta)
+ *     --nodes N --threads T     Nodos simulados y hilos que los atienden
+ *     --duration S              Duración de la prueba
+ *     --interval-ms MS          Cadencia por nodo (SENSOR_READ_INTERVAL_MS)
+ *     --jitter F                ± fracción de la cadencia (0.1)
+ *     --ramp-ms MS              Reparto de las conexiones iniciales (0)
+ *     --storm-every S           Tormenta de reconexión cada S segundos (0 = no)
+ *     --storm-fraction F        Fracción de nodos cortados en cada tormenta (1)
+ *     --reconnect-ms MS         Espera antes de reconectar (MQTT_RECONNECT_DELAY_MS)
+ *     --reconnect-jitter F      ± fracción de esa espera (0, como el firmware)
+ *     --commands R              Comandos de actuador por segundo (10)
+ *     --per-node-topics         Topics con prefijo "<thing>/" en lugar de compartidos
+ *     --seed N
+ *
+ * Con los topics compartidos de config.h cada comando llega a todos los
+ * nodos (y cada uno lo confirma): así se comporta hoy la flota.
+ */
+
+static void usage(const char* program) {
+  printf("Uso: %s [--host IP] [--port N] [--local-broker] [--nodes N] [--threads T]\n"
+         "       [--duration S] [--interval-ms MS] [--jitter F] [--ramp-ms MS]\n"
+         "       [--storm-every S] [--storm-fraction F] [--reconnect-ms MS]\n"
+         "       [--reconnect-jitter F] [--commands R] [--per-node-topics] [--seed N]\n",
+         program);
+}
+
+/**
+ * Cada nodo usa un socket (dos con el broker local): subir el límite
+ */
+static bool raiseFileLimit(uint32_t needed) {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+    return false;
+  }
+  if (limit.rlim_cur >= needed) {
+    return true;
+  }
+
+  limit.rlim_cur = limit.rlim_max < needed ? limit.rlim_max : needed;
+  return setrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur >= needed;
+}
+
+static void printLatency(const char* label, const LatencyHistogram& h, double scale, const char* unit) {
+  printf("  %-22s n=%-8llu p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f %s\n", label,
+         (unsigned long long)h.count(), h.percentile(0.50) / scale, h.percentile(0.90) / scale,
+         h.percentile(0.99) / scale, h.percentile(0.999) / scale, h.max() / scale, unit);
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = std::thread::hardware_concurrency();
+  FleetConfig config;
+  config.host = "127.0.0.1";
+  config.port = 1883;
+  config.nodes = 500;
+  config.threads = threads > 0 ? threads : 1;
+  config.durationS = 60;
+  config.intervalMs = SENSOR_READ_INTERVAL_MS;
+  config.jitter = 0.1f;
+  config.rampMs = 0;
+  config.stormEveryS = 0;
+  config.stormFraction = 1.0f;
+  config.reconnectMs = MQTT_RECONNECT_DELAY_MS;
+  config.reconnectJitter = 0.0f;
+  config.commandsPerS = 10.0f;
+  config.perNodeTopics = false;
+  config.seed = 1;
+  bool localBroker = false;
+  bool portGiven = false;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (strcmp(arg, "--local-broker") == 0) {
+      localBroker = true;
+    } else if (strcmp(arg, "--per-node-topics") == 0) {
+      config.perNodeTopics = true;
+    } else if (strcmp(arg, "--host") == 0 && hasValue) {
+      config.host = argv[++i];
+    } else if (strcmp(arg, "--port") == 0 && hasValue) {
+      config.port = (uint16_t)atoi(argv[++i]);
+      portGiven = true;
+    } else if (strcmp(arg, "--nodes") == 0 && hasValue) {
+      config.nodes = (uint32_t)atol(argv[++i]);
+    } else if (strcmp(arg, "--threads") == 0 && hasValue) {
+      config.threads = (uint32_t)atol(argv[++i]);
+    } else if (strcmp(arg, "--duration") == 0 && hasValue) {
+      config.durationS = (uint32_t)atol(argv[++i]);
+    } else if (strcmp(arg, "--interval-ms") == 0 && hasValue) {
+      config.intervalMs = (uint32_t)atol(argv[++i]);
+    } else if (strcmp(arg, "--jitter") == 0 && hasValue) {
+      config.jitter = (float)atof(argv[++i]);
+    } else if (strcmp(arg, "--ramp-ms") == 0 && hasValue) {
+      config.rampMs = (uint32_t)atol(argv[++i]);
+    } else if (strcmp(arg, "--storm-every") == 0 && hasValue) {
+      config.stormEveryS = (uint32_t)atol(argv[++i]);
+    } else if (strcmp(arg, "--storm-fraction") == 0 && hasValue) {
+      config.stormFraction = (float)atof(argv[++i]);
+    } else if (strcmp(arg, "--reconnect-ms") == 0 && hasValue) {
+      config.reconnectMs = (uint32_t)atol(argv[++i]);
+    } else if (strcmp(arg, "--reconnect-jitter") == 0 && hasValue) {
+      config.reconnectJitter = (float)atof(argv[++i]);
+    } else if (strcmp(arg, "--commands") == 0 && hasValue) {
+      config.commandsPerS = (float)atof(argv[++i]);
+    } else if (strcmp(arg, "--seed") == 0 && hasValue) {
+      config.seed = (uint32_t)atol(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (config.nodes == 0 || config.threads == 0 || config.durationS == 0 ||
+      config.intervalMs == 0 || config.jitter < 0 || config.jitter >= 1 ||
+      config.reconnectJitter < 0 || config.reconnectJitter >= 1 || config.commandsPerS < 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (config.threads > config.nodes) {
+    config.threads = config.nodes;
+  }
+
+  uint32_t sockets = config.nodes * (localBroker ? 2 : 1) + 64;
+  if (!raiseFileLimit(sockets)) {
+    printf("Aviso: el límite de descriptores no alcanza para %u sockets (ulimit -n)\n",
+           (unsigned)sockets);
+  }
+
+  LocalBroker broker;
+  if (localBroker) {
+    if (!broker.start(portGiven ? config.port : 0)) {
+      printf("No se pudo arrancar el broker local\n");
+      return 1;
+    }
+    config.host = "127.0.0.1";
+    config.port = broker.port();
+  }
+
+  printf("Flota: %u nodos en %u hilos contra %s:%u%s, %u s, cadencia %u ms ±%.0f%%\n",
+         (unsigned)config.nodes, (unsigned)config.threads, config.host, (unsigned)config.port,
+         localBroker ? " (broker local)" : "", (unsigned)config.durationS,
+         (unsigned)config.intervalMs, config.jitter * 100);
+
+  FleetReport report;
+  if (!runLoadGenerator(config, report)) {
+    return 1;
+  }
+
+  double s = report.elapsedS;
+  printf("\n== Publicación ==\n");
+  printf("  %llu lecturas (%.0f msg/s), %.2f MB/s de payload, %.2f MB/s en el cable (con estados)\n",
+         (unsigned long long)report.published, report.published / s,
+         report.payloadBytes / s / 1e6, report.wireBytes / s / 1e6);
+  printf("  reenviadas tras reconectar %llu, omitidas por contrapresión %llu\n",
+         (unsigned long long)report.drained, (unsigned long long)report.skipped);
+
+  printf("\n== Conexiones ==\n");
+  printf("  %llu sesiones, %llu fallos\n",
+         (unsigned long long)report.connects, (unsigned long long)report.connectFailures);
+  printLatency("connect -> SUBACK", report.connectUs, 1000.0, "ms");
+  if (report.initialConnectMs > 0) {
+    printf("  flota conectada en %u ms\n", (unsigned)report.initialConnectMs);
+  } else {
+    printf("  la flota no llegó a conectarse completa\n");
+  }
+  if (report.storms > 0) {
+    printf("  %u tormentas, peor recuperación %u ms\n",
+           (unsigned)report.storms, (unsigned)report.worstRecoveryMs);
+    if (report.unrecovered > 0) {
+      printf("  %u nodos sin reconectar al terminar\n", (unsigned)report.unrecovered);
+    }
+  }
+
+  printf("\n== Comandos de actuador ==\n");
+  printf("  %llu enviados, %llu entregas a nodos, %llu confirmaciones (%.1f por comando)\n",
+         (unsigned long long)report.commandsSent, (unsigned long long)report.commandsReceived,
+         (unsigned long long)report.acks,
+         report.commandsSent > 0 ? (double)report.acks / report.commandsSent : 0.0);
+  printLatency("ida y vuelta", report.roundTripUs, 1000.0, "ms");
+
+  if (localBroker) {
+    BrokerCounters c = broker.counters();
+    printf("\n== Broker local ==\n");
+    printf("  %llu CONNECT, %llu PUBLISH recibidos, %llu entregados, %llu descartados\n",
+           (unsigned long long)c.connections, (unsigned long long)c.received,
+           (unsigned long long)c.delivered, (unsigned long long)c.dropped);
+    printf("  %.2f MB/s de entrada, %.2f MB/s de salida\n", c.bytesIn / s / 1e6, c.bytesOut / s / 1e6);
+    broker.stop();
+  }
+
+  return 0;
+}
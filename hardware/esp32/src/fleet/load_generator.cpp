@@ -0,0 +1,752 @@
+#include "load_generator.h"
+#include "../config.h"
+#include "../actuator_registry.h"
+#include "../mqtt_packet.h"
+#include "../payload_codec.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define FLEET_RX_BUFFER_SIZE 2048
+#define FLEET_MAX_TX_BACKLOG 65536       // Bytes pendientes por nodo antes de omitir
+#define FLEET_POLL_TIMEOUT_MS 1
+#define FLEET_CONNECT_TIMEOUT_US 10000000ULL
+#define FLEET_SEQ_WINDOW 65536           // Comandos en vuelo que se pueden emparejar
+#define FLEET_CONTROLLER_ID "invernadero-controlador"
+
+static uint64_t nowUs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+/**
+ * Topic con el prefijo del thing cuando cada nodo tiene sus propios topics
+ */
+static size_t buildTopic(char* out, size_t capacity, const char* prefix, const char* topic) {
+  int length = snprintf(out, capacity, "%s%s", prefix, topic);
+  return length > 0 && (size_t)length < capacity ? (size_t)length : 0;
+}
+
+/**
+ * Extrae el número de secuencia ("seq":N) de un comando o confirmación
+ */
+static bool findSequence(const uint8_t* payload, size_t length, uint32_t& seq) {
+  static const char key[] = "\"seq\":";
+  const uint8_t* at = (const uint8_t*)memmem(payload, length, key, sizeof(key) - 1);
+  if (at == nullptr) {
+    return false;
+  }
+
+  size_t i = (at - payload) + sizeof(key) - 1;
+  if (i >= length || payload[i] < '0' || payload[i] > '9') {
+    return false;
+  }
+
+  seq = 0;
+  while (i < length && payload[i] >= '0' && payload[i] <= '9') {
+    seq = seq * 10 + (payload[i++] - '0');
+  }
+  return true;
+}
+
+// ============================================
+// ESTADO COMPARTIDO
+// ============================================
+
+struct FleetShared {
+  const FleetConfig* config;
+  sockaddr_in address;
+  uint64_t startUs;
+  uint64_t endUs;
+
+  // Se incrementa en cada tormenta de reconexión
+  std::atomic<uint32_t> stormEpoch;
+
+  // Primera conexión de toda la flota
+  std::atomic<uint32_t> firstOnline;
+  std::atomic<uint64_t> initialDoneUs;
+};
+
+// ============================================
+// SOCKETS
+// ============================================
+
+struct Connection {
+  int fd;
+  uint8_t rx[FLEET_RX_BUFFER_SIZE];
+  MqttFrameReader reader;
+  std::vector<uint8_t> tx;
+  size_t txStart;
+
+  Connection() : fd(-1), reader(rx, sizeof(rx)), txStart(0) {}
+
+  size_t pending() const { return tx.size() - txStart; }
+
+  bool open(const sockaddr_in& address) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+      return false;
+    }
+
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    setNonBlocking(fd);
+    reader.reset();
+    tx.clear();
+    txStart = 0;
+
+    if (connect(fd, (const sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+      shut();
+      return false;
+    }
+    return true;
+  }
+
+  void shut() {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  // Envía lo pendiente. Retorna false si la conexión falló.
+  bool flush() {
+    while (txStart < tx.size()) {
+      ssize_t n = send(fd, tx.data() + txStart, tx.size() - txStart, MSG_NOSIGNAL);
+      if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+      txStart += n;
+    }
+
+    tx.clear();
+    txStart = 0;
+    return true;
+  }
+
+  // Encola un paquete y trata de enviarlo. false si no cabe en la cola.
+  bool write(const uint8_t* data, size_t length) {
+    if (pending() + length > FLEET_MAX_TX_BACKLOG) {
+      return false;
+    }
+    tx.insert(tx.end(), data, data + length);
+    return true;
+  }
+
+  // Lee lo disponible. Retorna false si la conexión se cerró.
+  bool receive() {
+    for (;;) {
+      uint8_t* space = reader.space();
+      if (reader.room() == 0) {
+        return true;
+      }
+
+      ssize_t n = recv(fd, space, reader.room(), 0);
+      if (n == 0) {
+        return false;
+      }
+      if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+      reader.commit(n);
+    }
+  }
+};
+
+// ============================================
+// NODOS
+// ============================================
+
+enum NodeState : uint8_t {
+  NODE_WAITING,       // Esperando el siguiente intento de conexión
+  NODE_CONNECTING,    // connect() en curso
+  NODE_HANDSHAKE,     // CONNECT y SUBSCRIBE enviados, esperando SUBACK
+  NODE_ONLINE
+};
+
+struct FleetNode {
+  Connection link;
+  NodeState state;
+  bool everOnline;
+  char thing[40];
+  char prefix[48];           // "" o "<thing>/"
+  uint64_t stormCutUs;         // Cortado por una tormenta (0 = no)
+  uint64_t connectStartUs;
+  uint64_t reconnectAtUs;
+  uint64_t nextPublishUs;
+  uint64_t nextDrainUs;
+  uint32_t backlog;          // Lecturas pendientes de reenviar
+  SensorData data;
+};
+
+class FleetWorker {
+public:
+  FleetWorker(FleetShared& shared, uint32_t first, uint32_t count, uint32_t seed);
+  ~FleetWorker();
+
+  void run();
+  const FleetReport& result() const { return report; }
+
+private:
+  double uniform(double low, double high);
+  uint64_t jittered(uint64_t us, float fraction);
+
+  void startConnect(FleetNode& node, uint64_t now);
+  void drop(FleetNode& node, uint64_t now, bool failure);
+  void sendHandshake(FleetNode& node);
+  void onOnline(FleetNode& node, uint64_t now);
+  bool handlePacket(FleetNode& node, const MqttPacket& packet, uint64_t now);
+  void handleCommand(FleetNode& node, const MqttPublish& publish);
+  bool publish(FleetNode& node, const char* topic, const char* payload, size_t length);
+  void publishReading(FleetNode& node, uint64_t now, bool drained);
+  void stepTimers(FleetNode& node, uint64_t now);
+  void stormCut(uint64_t now);
+
+  FleetShared& shared;
+  const FleetConfig& config;
+  std::vector<FleetNode*> nodes;
+  std::mt19937 random;
+  uint32_t stormEpoch;
+  FleetReport report;
+};
+
+FleetWorker::FleetWorker(FleetShared& shared, uint32_t first, uint32_t count, uint32_t seed)
+  : shared(shared), config(*shared.config), random(seed), stormEpoch(0), report() {
+  uint64_t interval = (uint64_t)config.intervalMs * 1000;
+
+  for (uint32_t i = 0; i < count; i++) {
+    FleetNode* node = new FleetNode();
+    snprintf(node->thing, sizeof(node->thing), "%s-%05u", THING_NAME, (unsigned)(first + i));
+    snprintf(node->prefix, sizeof(node->prefix), "%s%s",
+             config.perNodeTopics ? node->thing : "", config.perNodeTopics ? "/" : "");
+
+    // Conexión inicial repartida en la rampa; fase de publicación aleatoria
+    node->state = NODE_WAITING;
+    node->everOnline = false;
+    node->stormCutUs = 0;
+    node->reconnectAtUs = shared.startUs + (uint64_t)uniform(0, config.rampMs * 1000.0);
+    node->nextPublishUs = shared.startUs + (uint64_t)uniform(0, (double)interval);
+    node->nextDrainUs = 0;
+    node->backlog = 0;
+    node->data.temperatura = (float)uniform(18, 30);
+    node->data.humedad = (float)uniform(50, 80);
+    node->data.humedadSuelo = (float)uniform(30, 70);
+    node->data.luminosidad = (float)uniform(0, 100);
+    node->data.valid = true;
+    node->data.timestamp = 0;
+    nodes.push_back(node);
+  }
+}
+
+FleetWorker::~FleetWorker() {
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodes[i]->link.shut();
+    delete nodes[i];
+  }
+}
+
+double FleetWorker::uniform(double low, double high) {
+  return std::uniform_real_distribution<double>(low, high)(random);
+}
+
+uint64_t FleetWorker::jittered(uint64_t us, float fraction) {
+  return (uint64_t)(us * uniform(1.0 - fraction, 1.0 + fraction));
+}
+
+void FleetWorker::startConnect(FleetNode& node, uint64_t now) {
+  node.connectStartUs = now;
+  if (!node.link.open(shared.address)) {
+    drop(node, now, true);
+    return;
+  }
+  node.state = NODE_CONNECTING;
+}
+
+/**
+ * Cierra la conexión y programa el reintento (fallo o corte de tormenta)
+ */
+void FleetWorker::drop(FleetNode& node, uint64_t now, bool failure) {
+  if (failure) {
+    report.connectFailures++;
+  }
+
+  node.link.shut();
+  node.state = NODE_WAITING;
+  node.reconnectAtUs = now + jittered((uint64_t)config.reconnectMs * 1000, config.reconnectJitter);
+}
+
+void FleetWorker::sendHandshake(FleetNode& node) {
+  uint8_t packet[512];
+  char filters[ACTUATOR_COUNT][96];
+  const char* filterList[ACTUATOR_COUNT];
+
+  for (size_t i = 0; i < ACTUATOR_COUNT; i++) {
+    buildTopic(filters[i], sizeof(filters[i]), node.prefix, ACTUATORS[i].topic);
+    filterList[i] = filters[i];
+  }
+
+  // CONNECT y SUBSCRIBE van juntos: el broker los procesa en orden
+  size_t length = mqttEncodeConnect(packet, sizeof(packet), node.thing, MQTT_KEEPALIVE, true);
+  node.link.write(packet, length);
+  length = mqttEncodeSubscribe(packet, sizeof(packet), 1, filterList, ACTUATOR_COUNT, 0);
+  node.link.write(packet, length);
+  node.state = NODE_HANDSHAKE;
+}
+
+void FleetWorker::onOnline(FleetNode& node, uint64_t now) {
+  node.state = NODE_ONLINE;
+  report.connects++;
+  report.connectUs.record((uint32_t)(now - node.connectStartUs));
+
+  char status[128];
+  int length = snprintf(status, sizeof(status),
+                        "{\"thing\":\"%s\",\"status\":\"online\",\"timestamp\":%lu}",
+                        node.thing, (unsigned long)((now - shared.startUs) / 1000));
+  char topic[96];
+  buildTopic(topic, sizeof(topic), node.prefix, TOPIC_ESTADO);
+  publish(node, topic, status, length);
+
+  if (!node.everOnline) {
+    node.everOnline = true;
+    if (shared.firstOnline.fetch_add(1) + 1 == config.nodes) {
+      shared.initialDoneUs = now;
+    }
+  }
+
+  // Recuperación de la tormenta: desde el corte hasta volver a estar en línea
+  if (node.stormCutUs != 0) {
+    uint32_t recovery = (uint32_t)((now - node.stormCutUs) / 1000);
+    report.worstRecoveryMs = recovery > report.worstRecoveryMs ? recovery : report.worstRecoveryMs;
+    node.stormCutUs = 0;
+  }
+
+  // Reenvío de lo guardado durante el corte, a STORE_DRAIN_RATE
+  node.nextDrainUs = now;
+}
+
+bool FleetWorker::publish(FleetNode& node, const char* topic, const char* payload, size_t length) {
+  uint8_t packet[512];
+  size_t topicLength = strlen(topic);
+  size_t size = mqttEncodePublish(packet, sizeof(packet), topic, topicLength,
+                                  (const uint8_t*)payload, length, 0, 0, false);
+
+  if (size == 0 || !node.link.write(packet, size)) {
+    report.skipped++;
+    return false;
+  }
+
+  report.wireBytes += size;
+  return true;
+}
+
+/**
+ * Publica una lectura con el formato de sensorDataToJson()
+ */
+void FleetWorker::publishReading(FleetNode& node, uint64_t now, bool drained) {
+  // Paseo aleatorio acotado de cada magnitud
+  SensorData& d = node.data;
+  d.temperatura = fminf(fmaxf(d.temperatura + (float)uniform(-0.2, 0.2), 5), 45);
+  d.humedad = fminf(fmaxf(d.humedad + (float)uniform(-0.5, 0.5), 10), 100);
+  d.humedadSuelo = fminf(fmaxf(d.humedadSuelo + (float)uniform(-0.3, 0.3), 0), 100);
+  d.luminosidad = fminf(fmaxf(d.luminosidad + (float)uniform(-1, 1), 0), 100);
+  d.timestamp = (unsigned long)((now - shared.startUs) / 1000);
+
+  char payload[256];
+  size_t length = encodeSensorDataJson(node.thing, d, payload, sizeof(payload));
+  char topic[96];
+  buildTopic(topic, sizeof(topic), node.prefix, TOPIC_TELEMETRIA);
+
+  if (publish(node, topic, payload, length)) {
+    report.published++;
+    report.payloadBytes += length;
+    if (drained) {
+      report.drained++;
+    }
+  }
+}
+
+/**
+ * Aplica un comando de actuador y lo confirma en TOPIC_ESTADO
+ */
+void FleetWorker::handleCommand(FleetNode& node, const MqttPublish& publish) {
+  size_t prefixLength = strlen(node.prefix);
+  if (publish.topicLength < prefixLength) {
+    return;
+  }
+
+  ActuatorId id = findActuatorByTopic(publish.topic + prefixLength,
+                                      publish.topicLength - prefixLength);
+  uint32_t seq;
+  if (id == ACTUATOR_COUNT || !findSequence(publish.payload, publish.payloadLength, seq)) {
+    return;
+  }
+
+  report.commandsReceived++;
+  bool on = memmem(publish.payload, publish.payloadLength, "\"on\"", 4) != nullptr;
+
+  char ack[160];
+  int length = snprintf(ack, sizeof(ack),
+                        "{\"thing\":\"%s\",\"actuador\":\"%s\",\"state\":\"%s\",\"seq\":%u}",
+                        node.thing, ACTUATORS[id].suffix, on ? "on" : "off", (unsigned)seq);
+  char topic[96];
+  buildTopic(topic, sizeof(topic), node.prefix, TOPIC_ESTADO);
+  this->publish(node, topic, ack, length);
+}
+
+bool FleetWorker::handlePacket(FleetNode& node, const MqttPacket& packet, uint64_t now) {
+  switch (packet.type) {
+    case MQTT_CONNACK:
+      // Código de retorno distinto de 0: conexión rechazada
+      return packet.length >= 2 && packet.body[1] == 0;
+
+    case MQTT_SUBACK:
+      if (node.state == NODE_HANDSHAKE) {
+        onOnline(node, now);
+      }
+      return true;
+
+    case MQTT_PUBLISH: {
+      MqttPublish publish;
+      if (mqttParsePublish(packet, publish)) {
+        handleCommand(node, publish);
+      }
+      return true;
+    }
+
+    default:
+      return true;
+  }
+}
+
+void FleetWorker::stepTimers(FleetNode& node, uint64_t now) {
+  uint64_t interval = (uint64_t)config.intervalMs * 1000;
+
+  if (node.state == NODE_WAITING && now >= node.reconnectAtUs) {
+    startConnect(node, now);
+  }
+
+  if ((node.state == NODE_CONNECTING || node.state == NODE_HANDSHAKE) &&
+      now - node.connectStartUs > FLEET_CONNECT_TIMEOUT_US) {
+    drop(node, now, true);
+  }
+
+  // La cadencia de lectura sigue aunque no haya conexión (firmware: al registro)
+  while (now >= node.nextPublishUs) {
+    node.nextPublishUs += jittered(interval, config.jitter);
+    if (node.state == NODE_ONLINE) {
+      publishReading(node, now, false);
+    } else {
+      node.backlog++;
+    }
+  }
+
+  if (node.state == NODE_ONLINE && node.backlog > 0 && now >= node.nextDrainUs) {
+    node.nextDrainUs = now + 1000000 / STORE_DRAIN_RATE;
+    node.backlog--;
+    publishReading(node, now, true);
+  }
+}
+
+/**
+ * Corta a la vez una fracción de los nodos conectados de este hilo
+ */
+void FleetWorker::stormCut(uint64_t now) {
+  for (size_t i = 0; i < nodes.size(); i++) {
+    FleetNode& node = *nodes[i];
+    if (node.state == NODE_ONLINE && uniform(0, 1) < config.stormFraction) {
+      drop(node, now, false);
+      node.stormCutUs = now;
+    }
+  }
+}
+
+void FleetWorker::run() {
+  std::vector<pollfd> fds(nodes.size());
+
+  for (;;) {
+    uint64_t now = nowUs();
+    if (now >= shared.endUs) {
+      for (size_t i = 0; i < nodes.size(); i++) {
+        report.unrecovered += nodes[i]->stormCutUs != 0 ? 1 : 0;
+      }
+      break;
+    }
+
+    uint32_t epoch = shared.stormEpoch.load();
+    if (epoch != stormEpoch) {
+      stormEpoch = epoch;
+      stormCut(now);
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+      FleetNode& node = *nodes[i];
+      stepTimers(node, now);
+
+      if (node.state == NODE_ONLINE || node.state == NODE_HANDSHAKE) {
+        if (!node.link.flush()) {
+          drop(node, now, true);
+        }
+      }
+
+      fds[i].fd = node.state == NODE_WAITING ? -1 : node.link.fd;
+      fds[i].events = POLLIN;
+      if (node.state == NODE_CONNECTING || node.link.pending() > 0) {
+        fds[i].events |= POLLOUT;
+      }
+      fds[i].revents = 0;
+    }
+
+    if (poll(fds.data(), fds.size(), FLEET_POLL_TIMEOUT_MS) <= 0) {
+      continue;
+    }
+
+    now = nowUs();
+    for (size_t i = 0; i < nodes.size(); i++) {
+      FleetNode& node = *nodes[i];
+      short events = fds[i].revents;
+      if (events == 0 || node.state == NODE_WAITING) {
+        continue;
+      }
+
+      if (node.state == NODE_CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(node.link.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0 || (events & (POLLERR | POLLHUP))) {
+          drop(node, now, true);
+          continue;
+        }
+        if (events & POLLOUT) {
+          sendHandshake(node);
+        }
+      }
+
+      if (events & (POLLIN | POLLHUP | POLLERR)) {
+        bool open = node.link.receive();
+
+        MqttPacket packet;
+        MqttFrameStatus status = MQTT_FRAME_NEED_MORE;
+        while (open && (status = node.link.reader.next(packet)) == MQTT_FRAME_OK) {
+          open = handlePacket(node, packet, now);
+        }
+        if (open && status == MQTT_FRAME_ERROR) {
+          open = false;
+        }
+
+        if (!open) {
+          drop(node, now, true);
+          continue;
+        }
+      }
+
+      if (!node.link.flush()) {
+        drop(node, now, true);
+      }
+    }
+  }
+}
+
+// ============================================
+// CONTROLADOR DE COMANDOS
+// ============================================
+
+/**
+ * Envía comandos a nodos aleatorios y empareja las confirmaciones
+ */
+static void runController(FleetShared& shared, FleetReport& report) {
+  const FleetConfig& config = *shared.config;
+  std::mt19937 random(config.seed ^ 0x5EEDu);
+  std::vector<uint64_t> sentAt(FLEET_SEQ_WINDOW, 0);
+  uint8_t packet[512];
+  uint32_t seq = 0;
+  uint64_t period = (uint64_t)(1000000.0 / config.commandsPerS);
+  uint64_t nextCommand = shared.startUs + config.rampMs * 1000ULL;
+  bool online = false;
+
+  Connection link;
+  if (!link.open(shared.address)) {
+    return;
+  }
+
+  const char* filter = config.perNodeTopics ? "+/" TOPIC_ESTADO : TOPIC_ESTADO;
+  size_t length = mqttEncodeConnect(packet, sizeof(packet), FLEET_CONTROLLER_ID, MQTT_KEEPALIVE, true);
+  link.write(packet, length);
+  length = mqttEncodeSubscribe(packet, sizeof(packet), 1, &filter, 1, 0);
+  link.write(packet, length);
+
+  for (;;) {
+    uint64_t now = nowUs();
+    if (now >= shared.endUs) {
+      break;
+    }
+
+    while (online && now >= nextCommand) {
+      nextCommand += period;
+
+      uint32_t node = std::uniform_int_distribution<uint32_t>(0, config.nodes - 1)(random);
+      size_t actuator = std::uniform_int_distribution<size_t>(0, ACTUATOR_COUNT - 1)(random);
+      char topic[128];
+      char thing[40];
+      snprintf(thing, sizeof(thing), "%s-%05u/", THING_NAME, (unsigned)node);
+      buildTopic(topic, sizeof(topic), config.perNodeTopics ? thing : "", ACTUATORS[actuator].topic);
+
+      char payload[64];
+      int payloadLength = snprintf(payload, sizeof(payload), "{\"state\":\"%s\",\"seq\":%u}",
+                                   seq % 2 ? "on" : "off", (unsigned)seq);
+      length = mqttEncodePublish(packet, sizeof(packet), topic, strlen(topic),
+                                 (const uint8_t*)payload, payloadLength, 0, 0, false);
+      sentAt[seq % FLEET_SEQ_WINDOW] = now;
+      if (link.write(packet, length)) {
+        report.commandsSent++;
+      }
+      seq++;
+    }
+
+    if (!link.flush()) {
+      break;
+    }
+
+    pollfd fd = { link.fd, (short)(POLLIN | (link.pending() > 0 ? POLLOUT : 0)), 0 };
+    if (poll(&fd, 1, FLEET_POLL_TIMEOUT_MS) <= 0) {
+      continue;
+    }
+
+    if (!link.receive()) {
+      break;
+    }
+
+    now = nowUs();
+    MqttPacket received;
+    while (link.reader.next(received) == MQTT_FRAME_OK) {
+      if (received.type == MQTT_SUBACK) {
+        online = true;
+        continue;
+      }
+
+      MqttPublish publish;
+      uint32_t ackSeq;
+      if (!mqttParsePublish(received, publish) ||
+          !findSequence(publish.payload, publish.payloadLength, ackSeq)) {
+        continue;
+      }
+
+      // Solo se emparejan confirmaciones dentro de la ventana
+      if (ackSeq < seq && seq - ackSeq <= FLEET_SEQ_WINDOW) {
+        report.acks++;
+        report.roundTripUs.record((uint32_t)(now - sentAt[ackSeq % FLEET_SEQ_WINDOW]));
+      }
+    }
+  }
+
+  link.shut();
+}
+
+// ============================================
+// EJECUCIÓN
+// ============================================
+
+bool runLoadGenerator(const FleetConfig& config, FleetReport& report) {
+  FleetShared shared;
+  shared.config = &config;
+  memset(&shared.address, 0, sizeof(shared.address));
+  shared.address.sin_family = AF_INET;
+  shared.address.sin_port = htons(config.port);
+  if (inet_pton(AF_INET, config.host, &shared.address.sin_addr) != 1) {
+    printf("Dirección de broker no válida: %s\n", config.host);
+    return false;
+  }
+
+  shared.startUs = nowUs();
+  shared.endUs = shared.startUs + config.durationS * 1000000ULL;
+  shared.stormEpoch = 0;
+  shared.firstOnline = 0;
+  shared.initialDoneUs = 0;
+
+  // Reparto de nodos por hilo
+  std::vector<FleetWorker*> workers;
+  uint32_t first = 0;
+  for (uint32_t t = 0; t < config.threads; t++) {
+    uint32_t count = config.nodes / config.threads + (t < config.nodes % config.threads ? 1 : 0);
+    workers.push_back(new FleetWorker(shared, first, count, config.seed + t));
+    first += count;
+  }
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < workers.size(); t++) {
+    threads.push_back(std::thread(&FleetWorker::run, workers[t]));
+  }
+
+  FleetReport controller = FleetReport();
+  std::thread controllerThread;
+  if (config.commandsPerS > 0) {
+    controllerThread = std::thread(runController, std::ref(shared), std::ref(controller));
+  }
+
+  // Tormentas de reconexión periódicas
+  uint32_t storms = 0;
+  if (config.stormEveryS > 0) {
+    uint64_t nextStorm = shared.startUs + config.stormEveryS * 1000000ULL;
+    while (nextStorm < shared.endUs) {
+      uint64_t now = nowUs();
+      if (now < nextStorm) {
+        std::this_thread::sleep_for(std::chrono::microseconds(nextStorm - now));
+        continue;
+      }
+      shared.stormEpoch++;
+      storms++;
+      nextStorm += config.stormEveryS * 1000000ULL;
+    }
+  }
+
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
+  if (controllerThread.joinable()) {
+    controllerThread.join();
+  }
+
+  report = FleetReport();
+  report.elapsedS = (nowUs() - shared.startUs) / 1e6;
+  for (size_t t = 0; t < workers.size(); t++) {
+    const FleetReport& w = workers[t]->result();
+    report.published += w.published;
+    report.payloadBytes += w.payloadBytes;
+    report.wireBytes += w.wireBytes;
+    report.drained += w.drained;
+    report.skipped += w.skipped;
+    report.connects += w.connects;
+    report.connectFailures += w.connectFailures;
+    report.connectUs.merge(w.connectUs);
+    report.worstRecoveryMs = w.worstRecoveryMs > report.worstRecoveryMs
+      ? w.worstRecoveryMs : report.worstRecoveryMs;
+    report.unrecovered += w.unrecovered;
+    report.commandsReceived += w.commandsReceived;
+    delete workers[t];
+  }
+
+  report.commandsSent = controller.commandsSent;
+  report.acks = controller.acks;
+  report.roundTripUs = controller.roundTripUs;
+  report.storms = storms;
+  report.initialConnectMs = shared.initialDoneUs.load() > 0
+    ? (uint32_t)((shared.initialDoneUs - shared.startUs) / 1000) : 0;
+  return true;
+}
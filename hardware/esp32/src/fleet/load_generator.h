@@ -0,0 +1,65 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include "../latency_histogram.h"
+#include <stdint.h>
+
+/**
+ * Generador de carga: simula una flota de nodos del invernadero contra un
+ * broker MQTT, con los topics de config.h y el payload de sensorDataToJson().
+ *
+ * Cada nodo publica lecturas con cadencia SENSOR_READ_INTERVAL_MS (con
+ * jitter), se suscribe a sus actuadores y confirma cada comando en
+ * TOPIC_ESTADO; un controlador envía comandos y mide la ida y vuelta.
+ * Las tormentas de reconexión cortan a la vez una fracción de la flota,
+ * que vuelve con el retardo de MQTT_RECONNECT_DELAY_MS y reenvía las
+ * lecturas perdidas a STORE_DRAIN_RATE, como el registro del firmware.
+ */
+
+struct FleetConfig {
+  const char* host;
+  uint16_t port;
+  uint32_t nodes;
+  uint32_t threads;
+  uint32_t durationS;
+  uint32_t intervalMs;       // Cadencia de publicación por nodo
+  float jitter;              // ± fracción del intervalo
+  uint32_t rampMs;           // Reparto de las conexiones iniciales (0 = todas a la vez)
+  uint32_t stormEveryS;      // 0 = sin tormentas
+  float stormFraction;       // Fracción de nodos que se desconectan
+  uint32_t reconnectMs;      // Espera antes de reconectar
+  float reconnectJitter;     // ± fracción (0 = todos a la vez, como el firmware)
+  float commandsPerS;        // Comandos del controlador por segundo
+  bool perNodeTopics;        // Prefijar los topics con el thing de cada nodo
+  uint32_t seed;
+};
+
+struct FleetReport {
+  double elapsedS;
+
+  // Publicación de telemetría
+  uint64_t published;
+  uint64_t payloadBytes;
+  uint64_t wireBytes;
+  uint64_t drained;          // Lecturas reenviadas tras reconectar
+  uint64_t skipped;          // No publicadas por contrapresión del socket
+
+  // Conexiones (connect() -> SUBACK, en us)
+  uint64_t connects;
+  uint64_t connectFailures;
+  LatencyHistogram connectUs;
+  uint32_t initialConnectMs; // Toda la flota conectada por primera vez
+  uint32_t storms;
+  uint32_t worstRecoveryMs;  // Peor nodo: desde el corte de una tormenta hasta volver
+  uint32_t unrecovered;      // Nodos de una tormenta aún desconectados al terminar
+
+  // Comandos de actuador (publicación del controlador -> confirmación, en us)
+  uint64_t commandsSent;
+  uint64_t commandsReceived; // Entregas a nodos
+  uint64_t acks;
+  LatencyHistogram roundTripUs;
+};
+
+bool runLoadGenerator(const FleetConfig& config, FleetReport& report);
+
+#endif // LOAD_GENERATOR_H
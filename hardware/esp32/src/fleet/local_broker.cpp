@@ -0,0 +1,390 @@
+#include "local_broker.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/ssl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BROKER_POLL_TIMEOUT_MS 20
+
+struct LocalBroker::Client {
+  int fd;
+  SSL* ssl;                           // nullptr sin TLS
+  bool connected;                     // CONNECT recibido
+  bool closing;
+  std::string clientId;
+  std::vector<std::string> filters;
+  uint8_t rx[BROKER_RX_BUFFER_SIZE];
+  MqttFrameReader reader;
+  std::vector<uint8_t> out;           // Cola de salida
+  size_t outStart;
+
+  explicit Client(int fd)
+    : fd(fd), ssl(nullptr), connected(false), closing(false),
+      reader(rx, sizeof(rx)), outStart(0) {}
+};
+
+static void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+LocalBroker::LocalBroker()
+  : tlsContext(nullptr), listenFd(-1), listenPort(0), running(false),
+    connections(0), received(0), delivered(0), dropped(0), bytesIn(0), bytesOut(0) {
+}
+
+LocalBroker::~LocalBroker() {
+  stop();
+}
+
+bool LocalBroker::start(uint16_t port) {
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    return false;
+  }
+
+  int yes = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+
+  socklen_t addrLength = sizeof(addr);
+  if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+      listen(listenFd, SOMAXCONN) < 0 ||
+      getsockname(listenFd, (sockaddr*)&addr, &addrLength) < 0) {
+    close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+
+  setNonBlocking(listenFd);
+  listenPort = ntohs(addr.sin_port);
+  running = true;
+  worker = std::thread(&LocalBroker::run, this);
+  return true;
+}
+
+void LocalBroker::stop() {
+  if (running.exchange(false)) {
+    worker.join();
+  }
+
+  for (size_t i = 0; i < clients.size(); i++) {
+    closeClient(clients[i]);
+  }
+  clients.clear();
+
+  if (listenFd >= 0) {
+    close(listenFd);
+    listenFd = -1;
+  }
+}
+
+BrokerCounters LocalBroker::counters() const {
+  BrokerCounters c = { connections.load(), received.load(), delivered.load(),
+                       dropped.load(), bytesIn.load(), bytesOut.load() };
+  return c;
+}
+
+void LocalBroker::acceptClients() {
+  for (;;) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+      return;
+    }
+
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    setNonBlocking(fd);
+
+    Client* client = new Client(fd);
+    if (tlsContext != nullptr) {
+      client->ssl = SSL_new(tlsContext);
+      SSL_set_fd(client->ssl, fd);
+      SSL_set_accept_state(client->ssl);
+    }
+    clients.push_back(client);
+  }
+}
+
+void LocalBroker::closeClient(Client* client) {
+  if (client->ssl != nullptr) {
+    SSL_free(client->ssl);
+  }
+  close(client->fd);
+  delete client;
+}
+
+/**
+ * Resultado de una operación de OpenSSL sin bloqueo: true si solo hay que
+ * esperar al socket
+ */
+static bool tlsWouldBlock(SSL* ssl, int result) {
+  int error = SSL_get_error(ssl, result);
+  return error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE;
+}
+
+void LocalBroker::queue(Client& client, const uint8_t* data, size_t length) {
+  if (client.out.size() - client.outStart + length > BROKER_MAX_QUEUED_BYTES) {
+    dropped++;
+    return;
+  }
+  client.out.insert(client.out.end(), data, data + length);
+}
+
+/**
+ * Entrega un PUBLISH a todos los clientes con un filtro que coincida
+ * (una vez por cliente, en QoS0)
+ */
+void LocalBroker::route(const MqttPublish& publish) {
+  size_t wireSize = mqttPublishSize(publish.topicLength, publish.payloadLength, 0);
+  uint8_t stackPacket[1024];
+  std::vector<uint8_t> bigPacket;
+  uint8_t* packet = stackPacket;
+
+  if (wireSize > sizeof(stackPacket)) {
+    bigPacket.resize(wireSize);
+    packet = bigPacket.data();
+  }
+
+  size_t length = mqttEncodePublish(packet, wireSize, publish.topic, publish.topicLength,
+                                    publish.payload, publish.payloadLength, 0, 0, false);
+
+  for (size_t i = 0; i < clients.size(); i++) {
+    Client& to = *clients[i];
+    if (!to.connected || to.closing) {
+      continue;
+    }
+
+    for (size_t f = 0; f < to.filters.size(); f++) {
+      if (mqttTopicMatches(to.filters[f].data(), to.filters[f].size(),
+                           publish.topic, publish.topicLength)) {
+        queue(to, packet, length);
+        delivered++;
+        break;
+      }
+    }
+  }
+}
+
+bool LocalBroker::handlePacket(Client& client, const MqttPacket& packet) {
+  uint8_t reply[256];
+  size_t length;
+
+  if (!client.connected && packet.type != MQTT_CONNECT) {
+    return false;
+  }
+
+  switch (packet.type) {
+    case MQTT_CONNECT: {
+      const char* id;
+      size_t idLength;
+      uint16_t keepAlive;
+      if (client.connected || !mqttParseConnect(packet, id, idLength, keepAlive)) {
+        return false;
+      }
+
+      // Un client ID solo puede tener una sesión: se cierra la anterior
+      client.clientId.assign(id, idLength);
+      for (size_t i = 0; i < clients.size(); i++) {
+        if (clients[i] != &client && clients[i]->connected &&
+            clients[i]->clientId == client.clientId) {
+          clients[i]->closing = true;
+        }
+      }
+
+      client.connected = true;
+      connections++;
+      length = mqttEncodeConnack(reply, sizeof(reply), 0);
+      queue(client, reply, length);
+      return true;
+    }
+
+    case MQTT_PUBLISH: {
+      MqttPublish publish;
+      if (!mqttParsePublish(packet, publish) || publish.qos > 1) {
+        return false;
+      }
+
+      received++;
+      if (publish.qos == 1) {
+        length = mqttEncodeAck(reply, sizeof(reply), MQTT_PUBACK, publish.packetId);
+        queue(client, reply, length);
+      }
+      route(publish);
+      return true;
+    }
+
+    case MQTT_SUBSCRIBE: {
+      uint16_t packetId;
+      uint8_t granted[64];
+      size_t count = 0;
+      size_t offset = 0;
+      const char* filter;
+      size_t filterLength;
+      uint8_t qos;
+
+      if (!mqttParsePacketId(packet, packetId)) {
+        return false;
+      }
+
+      while (count < sizeof(granted) &&
+             mqttNextFilter(packet, offset, filter, filterLength, qos)) {
+        client.filters.push_back(std::string(filter, filterLength));
+        granted[count++] = 0;   // Solo entrega QoS0
+      }
+
+      length = mqttEncodeSuback(reply, sizeof(reply), packetId, granted, count);
+      queue(client, reply, length);
+      return true;
+    }
+
+    case MQTT_PINGREQ:
+      length = mqttEncodeEmpty(reply, sizeof(reply), MQTT_PINGRESP);
+      queue(client, reply, length);
+      return true;
+
+    case MQTT_PUBACK:
+      return true;
+
+    default:
+      // DISCONNECT o paquetes no soportados
+      return false;
+  }
+}
+
+/**
+ * Lee y procesa todo lo disponible. Retorna false si hay que cerrar.
+ */
+bool LocalBroker::readClient(Client& client) {
+  // Handshake TLS en curso: avanzar con lo recibido
+  if (client.ssl != nullptr && !SSL_is_init_finished(client.ssl)) {
+    int result = SSL_accept(client.ssl);
+    if (result != 1) {
+      return tlsWouldBlock(client.ssl, result);
+    }
+  }
+
+  for (;;) {
+    uint8_t* space = client.reader.space();
+    ssize_t n;
+
+    if (client.ssl != nullptr) {
+      int result = SSL_read(client.ssl, space, (int)client.reader.room());
+      if (result <= 0) {
+        return tlsWouldBlock(client.ssl, result);
+      }
+      n = result;
+    } else {
+      n = recv(client.fd, space, client.reader.room(), 0);
+      if (n == 0) {
+        return false;
+      }
+      if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+    }
+
+    bytesIn += n;
+    client.reader.commit(n);
+
+    MqttPacket packet;
+    MqttFrameStatus status;
+    while ((status = client.reader.next(packet)) == MQTT_FRAME_OK) {
+      if (!handlePacket(client, packet)) {
+        return false;
+      }
+    }
+    if (status == MQTT_FRAME_ERROR) {
+      return false;
+    }
+  }
+}
+
+/**
+ * Envía la cola de salida. Retorna false si la conexión falló.
+ */
+bool LocalBroker::flushClient(Client& client) {
+  while (client.outStart < client.out.size()) {
+    const uint8_t* data = client.out.data() + client.outStart;
+    size_t length = client.out.size() - client.outStart;
+    ssize_t n;
+
+    if (client.ssl != nullptr) {
+      int result = SSL_write(client.ssl, data, (int)length);
+      if (result <= 0) {
+        return tlsWouldBlock(client.ssl, result);
+      }
+      n = result;
+    } else {
+      n = send(client.fd, data, length, MSG_NOSIGNAL);
+      if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+    }
+    client.outStart += n;
+    bytesOut += n;
+  }
+
+  client.out.clear();
+  client.outStart = 0;
+  return true;
+}
+
+void LocalBroker::run() {
+  std::vector<pollfd> fds;
+
+  while (running) {
+    fds.resize(clients.size() + 1);
+    fds[0].fd = listenFd;
+    fds[0].events = POLLIN;
+    for (size_t i = 0; i < clients.size(); i++) {
+      fds[i + 1].fd = clients[i]->fd;
+      fds[i + 1].events = POLLIN | (clients[i]->out.empty() ? 0 : POLLOUT);
+      fds[i + 1].revents = 0;
+    }
+
+    if (poll(fds.data(), fds.size(), BROKER_POLL_TIMEOUT_MS) <= 0) {
+      continue;
+    }
+
+    size_t polled = clients.size();
+    for (size_t i = 0; i < polled; i++) {
+      Client& client = *clients[i];
+      if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+        if (!readClient(client)) {
+          client.closing = true;
+        }
+      }
+    }
+
+    // Enviar lo encolado en esta vuelta y retirar las conexiones cerradas
+    size_t kept = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+      Client* client = clients[i];
+      if (!client->closing && !flushClient(*client)) {
+        client->closing = true;
+      }
+
+      if (client->closing) {
+        closeClient(client);
+      } else {
+        clients[kept++] = client;
+      }
+    }
+    clients.resize(kept);
+
+    if (fds[0].revents & POLLIN) {
+      acceptClients();
+    }
+  }
+}
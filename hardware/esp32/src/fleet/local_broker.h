@@ -0,0 +1,78 @@
+#ifndef LOCAL_BROKER_H
+#define LOCAL_BROKER_H
+
+#include "../mqtt_packet.h"
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Broker MQTT 3.1.1 mínimo en un hilo (sustituto local de Mosquitto).
+ *
+ * Suficiente para medir clientes en el host: CONNECT con reemplazo de
+ * sesiones por client ID, SUBSCRIBE con comodines, PUBLISH QoS0/QoS1
+ * (PUBACK al emisor, entrega en QoS0), PINGREQ y DISCONNECT. Sin mensajes
+ * retenidos ni sesiones persistentes. Si la cola de salida de un cliente
+ * supera BROKER_MAX_QUEUED_BYTES los mensajes se descartan y se cuentan,
+ * como max_queued_bytes en Mosquitto. Con useTls() las conexiones se
+ * cifran (OpenSSL, sin bloquear el hilo) como el puerto 8883 de AWS IoT.
+ */
+#define BROKER_MAX_QUEUED_BYTES (1024 * 1024)
+#define BROKER_RX_BUFFER_SIZE 4096
+
+struct ssl_ctx_st;
+
+struct BrokerCounters {
+  uint64_t connections;   // CONNECT aceptados
+  uint64_t received;      // PUBLISH recibidos
+  uint64_t delivered;     // PUBLISH entregados a suscriptores
+  uint64_t dropped;       // Descartados por cola llena
+  uint64_t bytesIn;
+  uint64_t bytesOut;
+};
+
+class LocalBroker {
+public:
+  LocalBroker();
+  ~LocalBroker();
+
+  // TLS en todas las conexiones (llamar antes de start; el contexto no se libera)
+  void useTls(ssl_ctx_st* context) { tlsContext = context; }
+
+  // Escucha en 127.0.0.1:port (0 = puerto libre) y arranca el hilo
+  bool start(uint16_t port);
+  void stop();
+
+  uint16_t port() const { return listenPort; }
+  BrokerCounters counters() const;
+
+private:
+  struct Client;
+
+  void run();
+  void acceptClients();
+  bool readClient(Client& client);
+  bool handlePacket(Client& client, const MqttPacket& packet);
+  void route(const MqttPublish& publish);
+  bool flushClient(Client& client);
+  void queue(Client& client, const uint8_t* data, size_t length);
+  void closeClient(Client* client);
+
+  ssl_ctx_st* tlsContext;
+  int listenFd;
+  uint16_t listenPort;
+  std::thread worker;
+  std::atomic<bool> running;
+  std::vector<Client*> clients;
+
+  std::atomic<uint64_t> connections;
+  std::atomic<uint64_t> received;
+  std::atomic<uint64_t> delivered;
+  std::atomic<uint64_t> dropped;
+  std::atomic<uint64_t> bytesIn;
+  std::atomic<uint64_t> bytesOut;
+};
+
+#endif // LOCAL_BROKER_H
@@ -0,0 +1,111 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dht22_decoder.h"
+#include "storage_backend.h"
+
+/**
+ * Capa de abstracción de hardware.
+ *
+ * La lógica del firmware (app.cpp, sensors.cpp, mqtt_client.cpp) solo
+ * accede al hardware a través de estas funciones. hal_esp32.cpp las
+ * implementa sobre Arduino/ESP-IDF y native/hal_native.cpp sobre Linux,
+ * de modo que la misma lógica se ejecuta y se mide en el host (env:native).
+ */
+
+// Canales analógicos muestreados en segundo plano
+enum AdcChannelId : uint8_t {
+  ADC_SOIL,     // PIN_HUMEDAD_SUELO (ADC1_CH6)
+  ADC_LIGHT,    // PIN_LDR (ADC1_CH7)
+  ADC_CHANNEL_COUNT
+};
+
+// Estado del flujo de bytes hacia el broker
+enum HalLinkState : uint8_t {
+  LINK_CLOSED,
+  LINK_OPENING,     // TCP + TLS en curso
+  LINK_OPEN,
+  LINK_FAILED       // No se pudo abrir o se cortó; halLinkClose() antes de reabrir
+};
+
+// Estado de la asociación WiFi, actualizado por los eventos del controlador
+enum HalNetState : uint8_t {
+  NET_IDLE,
+  NET_JOINING,      // Asociación + DHCP en curso
+  NET_UP,           // IP asignada
+  NET_DOWN          // Intento fallido o asociación perdida; halNetworkLeave() antes de reintentar
+};
+
+// AP de la última asociación: reconectar sin recorrer todos los canales
+struct HalWifiHint {
+  uint8_t bssid[6];
+  uint8_t channel;
+};
+
+// Último handshake del enlace TLS
+struct HalHandshake {
+  uint32_t durationMs;       // TCP + handshake
+  uint32_t peakHeapBytes;    // Heap ocupado en el pico del handshake (0 = no medido)
+  bool resumed;              // Sesión anterior reanudada (sin intercambio de claves)
+};
+
+// Reloj
+unsigned long halMillis();
+unsigned long halMicros();
+void halDelay(unsigned long ms);
+void halRestart();
+uint32_t halRandom();
+
+// Instrumentación: contador de ciclos de la CPU (da la vuelta) y heap libre
+// actual y mínimo desde el arranque (0 = no medido)
+uint32_t halCycles();
+uint32_t halCyclesPerUs();
+uint32_t halHeapFree();
+uint32_t halHeapMinFree();
+
+// Temporizador periódico del control en lazo cerrado: halControlTicks()
+// cuenta los periodos transcurridos desde halControlTimerBegin()
+void halControlTimerBegin(uint32_t periodMs);
+uint32_t halControlTicks();
+
+// GPIO (relays y LED)
+void halPinOutput(uint8_t pin);
+void halPinWrite(uint8_t pin, bool high);
+
+// Sensores
+void halSensorsBegin();
+void halDhtStart();
+Dht22Status halDhtPoll(Dht22Reading& reading);
+void halAdcPoll();
+bool halAdcRead(AdcChannelId channel, float& raw);
+
+// Consola (puerto serie); solo la usa la tarea de registro (logger.h)
+void halConsoleWrite(const char* text, size_t length);
+
+// Almacenamiento del registro de telemetría y de trazas
+StorageBackend* halTelemetryStorage();
+bool halTraceWrite(const uint8_t* data, size_t length);
+
+// Red: enlace WiFi y flujo de bytes (TLS) hacia AWS_IOT_ENDPOINT. La
+// política de reconexión vive en connectivity.cpp y el protocolo MQTT en
+// mqtt_client.cpp. Ninguna función bloquea: la asociación y la conexión
+// avanzan en segundo plano, halLinkWrite() acepta lo que cabe en el buffer
+// de salida y halLinkRead() entrega lo ya recibido.
+void halNetworkBegin();
+void halNetworkJoin(const HalWifiHint* hint);   // nullptr = búsqueda completa
+void halNetworkLeave();
+HalNetState halNetworkState();
+bool halNetworkConnected();
+bool halNetworkCurrentHint(HalWifiHint& hint);  // AP actual (con NET_UP)
+bool halNetworkLoadHint(HalWifiHint& hint);     // Guardado entre arranques
+void halNetworkSaveHint(const HalWifiHint& hint);
+void halLinkOpen();
+HalLinkState halLinkState();
+size_t halLinkWrite(const uint8_t* data, size_t length);
+size_t halLinkRead(uint8_t* out, size_t capacity);
+void halLinkClose();
+bool halLinkTakeHandshake(HalHandshake& handshake);  // Una vez por enlace abierto
+
+#endif // HAL_H
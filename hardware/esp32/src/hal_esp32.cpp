@@ -0,0 +1,383 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <atomic>
+#include "hal.h"
+#include "config.h"
+#include "logger.h"
+#include "dht22_rmt.h"
+#include "adc_sampler.h"
+#include "tls_link.h"
+#include "spsc_ring.h"
+
+/**
+ * Implementación de la HAL sobre Arduino/ESP-IDF (env:esp32dev)
+ */
+
+// Registro persistente de telemetría
+LittleFsStorageBackend storeBackend(STORE_FILE_PATH, STORE_SECTOR_SIZE, STORE_SECTOR_COUNT);
+
+// ============================================
+// RELOJ
+// ============================================
+unsigned long halMillis() {
+  return millis();
+}
+
+unsigned long halMicros() {
+  return micros();
+}
+
+void halDelay(unsigned long ms) {
+  delay(ms);
+}
+
+void halRestart() {
+  ESP.restart();
+}
+
+uint32_t halRandom() {
+  return esp_random();
+}
+
+uint32_t halCycles() {
+  return ESP.getCycleCount();
+}
+
+uint32_t halCyclesPerUs() {
+  return ESP.getCpuFreqMHz();
+}
+
+uint32_t halHeapFree() {
+  return ESP.getFreeHeap();
+}
+
+uint32_t halHeapMinFree() {
+  return ESP.getMinFreeHeap();
+}
+
+// ============================================
+// TEMPORIZADOR DE CONTROL
+// ============================================
+std::atomic<uint32_t> controlTicks(0);
+esp_timer_handle_t controlTimer = nullptr;
+
+/**
+ * Corre en la tarea de esp_timer: solo cuenta el periodo; el lazo lo
+ * ejecuta la tarea de adquisición, dueña de los relays
+ */
+static void controlTimerCallback(void* arg) {
+  controlTicks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void halControlTimerBegin(uint32_t periodMs) {
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = controlTimerCallback;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = "control";
+
+  if (esp_timer_create(&timerArgs, &controlTimer) != ESP_OK ||
+      esp_timer_start_periodic(controlTimer, (uint64_t)periodMs * 1000) != ESP_OK) {
+    LOG_E(LOG_APP, "No se pudo iniciar el temporizador de control");
+  }
+}
+
+uint32_t halControlTicks() {
+  return controlTicks.load(std::memory_order_relaxed);
+}
+
+// ============================================
+// CONSOLA
+// ============================================
+void halConsoleWrite(const char* text, size_t length) {
+  Serial.write((const uint8_t*)text, length);
+}
+
+// ============================================
+// GPIO
+// ============================================
+void halPinOutput(uint8_t pin) {
+  pinMode(pin, OUTPUT);
+}
+
+void halPinWrite(uint8_t pin, bool high) {
+  digitalWrite(pin, high ? HIGH : LOW);
+}
+
+// ============================================
+// SENSORES
+// ============================================
+void halSensorsBegin() {
+  // DHT22 capturado por RMT
+  initDht22();
+
+  // Muestreo continuo de humedad de suelo y LDR en segundo plano
+  initAdcSampler();
+}
+
+void halDhtStart() {
+  startDht22Read();
+}
+
+Dht22Status halDhtPoll(Dht22Reading& reading) {
+  return pollDht22(reading);
+}
+
+void halAdcPoll() {
+  adcSamplerPoll();
+}
+
+bool halAdcRead(AdcChannelId channel, float& raw) {
+  return readAdcChannel(channel, raw);
+}
+
+// ============================================
+// ALMACENAMIENTO
+// ============================================
+StorageBackend* halTelemetryStorage() {
+  return storeBackend.begin() ? &storeBackend : nullptr;
+}
+
+/**
+ * Añade un bloque de la traza al archivo (LittleFS ya montado por el
+ * registro de telemetría). Deja de escribir al llegar a TRACE_FILE_MAX_BYTES.
+ */
+bool halTraceWrite(const uint8_t* data, size_t length) {
+  fs::File file = LittleFS.open(TRACE_FILE_PATH, FILE_APPEND);
+  if (!file) {
+    return false;
+  }
+
+  bool written = file.size() + length <= TRACE_FILE_MAX_BYTES &&
+                 file.write(data, length) == length;
+  file.close();
+  return written;
+}
+
+// ============================================
+// RED
+// ============================================
+
+// La asociación la dirige connectivity.cpp; aquí solo se traducen los
+// eventos del controlador WiFi (otra tarea) a un estado atómico. La
+// reconexión automática del controlador queda desactivada para que la
+// política de reintentos sea una sola.
+
+std::atomic<uint8_t> netState(NET_IDLE);
+Preferences wifiPreferences;
+
+static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      netState = NET_UP;
+      LOG_I(LOG_NET, "Dirección IP: %s, intensidad de señal: %d dBm",
+            WiFi.localIP().toString().c_str(), (int)WiFi.RSSI());
+      break;
+
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      if (netState != NET_IDLE) {
+        netState = NET_DOWN;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * Modo estación y eventos del controlador (no conecta)
+ */
+void halNetworkBegin() {
+  LOG_I(LOG_APP, "Sistema de Monitoreo Invernadero");
+
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+  WiFi.onEvent(onWifiEvent);
+}
+
+/**
+ * Inicia la asociación. Con hint se omite la búsqueda de canales y se
+ * asocia directamente a ese BSSID.
+ */
+void halNetworkJoin(const HalWifiHint* hint) {
+  netState = NET_JOINING;
+
+  if (hint != nullptr) {
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, hint->channel, hint->bssid, true);
+  } else {
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  }
+}
+
+void halNetworkLeave() {
+  netState = NET_IDLE;
+  WiFi.disconnect(false);
+}
+
+HalNetState halNetworkState() {
+  return (HalNetState)netState.load();
+}
+
+bool halNetworkConnected() {
+  return netState == NET_UP;
+}
+
+bool halNetworkCurrentHint(HalWifiHint& hint) {
+  const uint8_t* bssid = WiFi.BSSID();
+  if (netState != NET_UP || bssid == nullptr) {
+    return false;
+  }
+
+  memcpy(hint.bssid, bssid, sizeof(hint.bssid));
+  hint.channel = (uint8_t)WiFi.channel();
+  return true;
+}
+
+/**
+ * AP guardado en NVS: solo se escribe cuando cambia, no en cada asociación
+ */
+bool halNetworkLoadHint(HalWifiHint& hint) {
+  wifiPreferences.begin("red", true);
+  bool found = wifiPreferences.getBytes("ap", &hint, sizeof(hint)) == sizeof(hint);
+  wifiPreferences.end();
+  return found && hint.channel != 0;
+}
+
+void halNetworkSaveHint(const HalWifiHint& hint) {
+  wifiPreferences.begin("red", false);
+  wifiPreferences.putBytes("ap", &hint, sizeof(hint));
+  wifiPreferences.end();
+}
+
+// ============================================
+// ENLACE TLS
+// ============================================
+// Una tarea propia (núcleo NET_TASK_CORE) hace el handshake y las
+// escrituras TLS, que bloquean (ver tls_link.cpp); la tarea de red solo
+// copia bytes a y desde las colas, de modo que un socket lento no la detiene.
+
+std::atomic<uint8_t> linkState(LINK_CLOSED);
+std::atomic<bool> linkOpenRequest(false);
+std::atomic<bool> linkCloseRequest(false);
+std::atomic<uint32_t> linkEpoch(0);     // Conexiones abiertas por la tarea de E/S
+uint32_t linkEpochSeen = 0;             // Última que vio la tarea de red
+SpscRing<uint8_t, MQTT_LINK_BUFFER_SIZE> linkTx;   // red -> E/S
+SpscRing<uint8_t, MQTT_LINK_BUFFER_SIZE> linkRx;   // E/S -> red
+TaskHandle_t linkTask = nullptr;
+HalHandshake lastHandshake;             // Escrito por la tarea de E/S antes de LINK_OPEN
+std::atomic<bool> handshakeFresh(false);
+
+/**
+ * La tarea de red pidió cerrar o reabrir: abandonar una escritura detenida
+ */
+static bool linkAbortRequested() {
+  return linkCloseRequest.load() || linkOpenRequest.load();
+}
+
+/**
+ * Tarea de E/S del enlace: conexión, cifrado y copia entre socket y colas
+ */
+static void linkIoTask(void* param) {
+  uint8_t chunk[512];
+
+  for (;;) {
+    if (linkCloseRequest.exchange(false)) {
+      tlsLinkClose();
+      if (!linkOpenRequest.load()) {
+        linkState = LINK_CLOSED;
+      }
+    }
+
+    if (linkOpenRequest.exchange(false)) {
+      tlsLinkClose();
+
+      // Descartar lo que quedó de la conexión anterior
+      while (linkTx.read(chunk, sizeof(chunk)) > 0) {
+      }
+
+      bool ok = tlsLinkConnect(AWS_IOT_ENDPOINT, AWS_IOT_PORT, lastHandshake);
+      handshakeFresh = ok;
+      linkEpoch++;
+      linkState = ok ? LINK_OPEN : LINK_FAILED;
+    }
+
+    if (linkState == LINK_OPEN) {
+      // Salida: la escritura bloquea aquí, no en la tarea de red
+      size_t n = linkTx.read(chunk, sizeof(chunk));
+      if (n > 0 && tlsLinkWrite(chunk, n, linkAbortRequested) != (int)n) {
+        linkState = LINK_FAILED;
+      }
+
+      // Entrada: solo lo que cabe en la cola (el resto espera en el socket)
+      size_t room = MQTT_LINK_BUFFER_SIZE - linkRx.size();
+      int read = 0;
+      if (room > 0) {
+        read = tlsLinkRead(chunk, room < sizeof(chunk) ? room : sizeof(chunk));
+        if (read < 0) {
+          linkState = LINK_FAILED;
+        } else if (read > 0) {
+          linkRx.write(chunk, read);
+        }
+      }
+
+      if (n > 0 || read > 0) {
+        continue;
+      }
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(LOOP_IDLE_DELAY_MS));
+  }
+}
+
+void halLinkOpen() {
+  if (linkTask == nullptr) {
+    // Los certificados del dispositivo se cargan en la tarea de E/S
+    xTaskCreatePinnedToCore(linkIoTask, "enlace", MQTT_IO_TASK_STACK, nullptr,
+                            MQTT_IO_TASK_PRIORITY, &linkTask, NET_TASK_CORE);
+  }
+
+  linkState = LINK_OPENING;
+  linkOpenRequest = true;
+}
+
+HalLinkState halLinkState() {
+  HalLinkState state = (HalLinkState)linkState.load();
+
+  // Nueva conexión: descartar lo recibido por la anterior
+  if (state == LINK_OPEN && linkEpochSeen != linkEpoch.load()) {
+    uint8_t chunk[64];
+    while (linkRx.read(chunk, sizeof(chunk)) > 0) {
+    }
+    linkEpochSeen = linkEpoch.load();
+  }
+  return state;
+}
+
+size_t halLinkWrite(const uint8_t* data, size_t length) {
+  return halLinkState() == LINK_OPEN ? linkTx.write(data, length) : 0;
+}
+
+size_t halLinkRead(uint8_t* out, size_t capacity) {
+  return halLinkState() == LINK_OPEN ? linkRx.read(out, capacity) : 0;
+}
+
+void halLinkClose() {
+  linkCloseRequest = true;
+  if (!linkOpenRequest.load()) {
+    linkState = LINK_CLOSED;
+  }
+}
+
+bool halLinkTakeHandshake(HalHandshake& handshake) {
+  if (halLinkState() != LINK_OPEN || !handshakeFresh.exchange(false)) {
+    return false;
+  }
+
+  handshake = lastHandshake;
+  return true;
+}
@@ -0,0 +1,454 @@
+#include "column_store.h"
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STORE_MAX_THING_LENGTH 64
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t metric;
+  uint8_t hasTags;
+  uint32_t capacity;
+  uint32_t count;            // Publicado después de escribir cada muestra
+  int64_t firstTimestamp;
+  int64_t lastTimestamp;
+  uint8_t reserved[32];
+};
+
+static_assert(sizeof(SegmentHeader) == 64, "La cabecera del segmento ocupa 64 B");
+
+struct ColumnStore::Segment {
+  uint8_t* base;
+  size_t bytes;
+  SegmentHeader* header;
+  int64_t* timestamps;
+  float* values;
+  uint8_t* tags;
+};
+
+struct ColumnStore::Series {
+  StoreMetric metric;
+  std::vector<Segment> segments;
+};
+
+struct ColumnStore::Thing {
+  std::string name;
+  std::string directory;
+  Series* series[METRIC_COUNT];
+};
+
+static const char* const METRIC_NAMES[METRIC_COUNT] = {
+  "temperatura", "humedad", "humedadSuelo", "luminosidad", "alertas"
+};
+
+const char* storeMetricName(StoreMetric metric) {
+  return metric < METRIC_COUNT ? METRIC_NAMES[metric] : "desconocida";
+}
+
+bool storeMetricFromName(const char* name, StoreMetric& metric) {
+  for (size_t i = 0; i < METRIC_COUNT; i++) {
+    if (strcmp(name, METRIC_NAMES[i]) == 0) {
+      metric = (StoreMetric)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * El thing se usa como nombre de directorio: solo [A-Za-z0-9._-],
+ * sin empezar por '.' (evita rutas fuera del almacén)
+ */
+static bool validThing(const char* thing, size_t length) {
+  if (length == 0 || length > STORE_MAX_THING_LENGTH || thing[0] == '.') {
+    return false;
+  }
+
+  for (size_t i = 0; i < length; i++) {
+    char c = thing[i];
+    bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t segmentBytes(bool hasTags) {
+  size_t n = STORE_SEGMENT_CAPACITY;
+  return sizeof(SegmentHeader) + n * sizeof(int64_t) + n * sizeof(float) + (hasTags ? n : 0);
+}
+
+ColumnStore::ColumnStore(const char* directory)
+  : root(directory), lastThing(nullptr) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+ColumnStore::~ColumnStore() {
+  close();
+}
+
+/**
+ * Mapea el segmento index de una serie (creándolo si create)
+ */
+bool ColumnStore::mapSegment(const Thing& owner, Series& series, uint32_t index, bool create) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s.%06u.seg", owner.directory.c_str(),
+           storeMetricName(series.metric), (unsigned)index);
+
+  bool hasTags = series.metric == METRIC_ALERTAS;
+  size_t bytes = segmentBytes(hasTags);
+  int fd = ::open(path, O_RDWR | (create ? O_CREAT | O_EXCL : 0), 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  // Archivo disperso: el disco solo se ocupa a medida que se escribe
+  struct stat info;
+  if ((create && ftruncate(fd, bytes) != 0) ||
+      fstat(fd, &info) != 0 || (size_t)info.st_size != bytes) {
+    ::close(fd);
+    return false;
+  }
+
+  // El mapeo sigue vigente sin el descriptor: miles de series no agotan ulimit -n
+  uint8_t* base = (uint8_t*)mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+
+  Segment segment;
+  segment.base = base;
+  segment.bytes = bytes;
+  segment.header = (SegmentHeader*)base;
+  segment.timestamps = (int64_t*)(base + sizeof(SegmentHeader));
+  segment.values = (float*)(segment.timestamps + STORE_SEGMENT_CAPACITY);
+  segment.tags = hasTags ? (uint8_t*)(segment.values + STORE_SEGMENT_CAPACITY) : nullptr;
+
+  SegmentHeader* header = segment.header;
+  if (create) {
+    header->magic = STORE_SEGMENT_MAGIC;
+    header->version = STORE_SEGMENT_VERSION;
+    header->metric = series.metric;
+    header->hasTags = hasTags ? 1 : 0;
+    header->capacity = STORE_SEGMENT_CAPACITY;
+    header->count = 0;
+    header->firstTimestamp = 0;
+    header->lastTimestamp = 0;
+  } else if (header->magic != STORE_SEGMENT_MAGIC || header->version != STORE_SEGMENT_VERSION ||
+             header->metric != series.metric || header->capacity != STORE_SEGMENT_CAPACITY ||
+             header->count > STORE_SEGMENT_CAPACITY) {
+    munmap(base, bytes);
+    return false;
+  }
+
+  series.segments.push_back(segment);
+  counters.segments++;
+  counters.samples += header->count;
+  return true;
+}
+
+/**
+ * Mapea los segmentos existentes de un thing, en orden de índice
+ */
+bool ColumnStore::loadThing(const std::string& name) {
+  Thing* thing = findThing(name.data(), name.size(), true);
+  if (thing == nullptr) {
+    return false;
+  }
+
+  DIR* dir = opendir(thing->directory.c_str());
+  if (dir == nullptr) {
+    return false;
+  }
+
+  std::vector<std::pair<uint32_t, StoreMetric> > found;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    char metricName[32];
+    unsigned index;
+    if (sscanf(entry->d_name, "%31[A-Za-z].%u.seg", metricName, &index) != 2) {
+      continue;
+    }
+
+    StoreMetric metric;
+    if (storeMetricFromName(metricName, metric)) {
+      found.push_back(std::make_pair((uint32_t)index, metric));
+    }
+  }
+  closedir(dir);
+
+  std::sort(found.begin(), found.end());
+  bool ok = true;
+
+  for (size_t i = 0; i < found.size(); i++) {
+    StoreMetric metric = found[i].second;
+    if (thing->series[metric] == nullptr) {
+      thing->series[metric] = new Series();
+      thing->series[metric]->metric = metric;
+      counters.series++;
+    }
+
+    Series& series = *thing->series[metric];
+    // Los índices deben ser consecutivos: un hueco deja fuera el resto
+    if (found[i].first != series.segments.size() || !mapSegment(*thing, series, found[i].first, false)) {
+      fprintf(stderr, "Segmento %s/%s.%06u.seg ignorado\n", name.c_str(),
+              storeMetricName(metric), (unsigned)found[i].first);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool ColumnStore::open() {
+  if (mkdir(root.c_str(), 0755) != 0 && errno != EEXIST) {
+    return false;
+  }
+
+  DIR* dir = opendir(root.c_str());
+  if (dir == nullptr) {
+    return false;
+  }
+
+  std::vector<std::string> names;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (validThing(entry->d_name, strlen(entry->d_name))) {
+      names.push_back(entry->d_name);
+    }
+  }
+  closedir(dir);
+
+  for (size_t i = 0; i < names.size(); i++) {
+    loadThing(names[i]);
+  }
+  return true;
+}
+
+void ColumnStore::close() {
+  for (std::unordered_map<std::string, Thing*>::iterator it = things.begin();
+       it != things.end(); ++it) {
+    Thing* thing = it->second;
+    for (size_t m = 0; m < METRIC_COUNT; m++) {
+      Series* series = thing->series[m];
+      if (series == nullptr) {
+        continue;
+      }
+      for (size_t s = 0; s < series->segments.size(); s++) {
+        munmap(series->segments[s].base, series->segments[s].bytes);
+      }
+      delete series;
+    }
+    delete thing;
+  }
+
+  things.clear();
+  lastThing = nullptr;
+}
+
+ColumnStore::Thing* ColumnStore::findThing(const char* name, size_t length, bool create) {
+  if (lastThing != nullptr && lastThing->name.size() == length &&
+      memcmp(lastThing->name.data(), name, length) == 0) {
+    return lastThing;
+  }
+
+  lookupKey.assign(name, length);
+  std::unordered_map<std::string, Thing*>::iterator it = things.find(lookupKey);
+  if (it != things.end()) {
+    lastThing = it->second;
+    return lastThing;
+  }
+
+  if (!create || !validThing(name, length)) {
+    return nullptr;
+  }
+
+  std::string directory = root + "/" + lookupKey;
+  if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    return nullptr;
+  }
+
+  Thing* thing = new Thing();
+  thing->name = lookupKey;
+  thing->directory = directory;
+  for (size_t m = 0; m < METRIC_COUNT; m++) {
+    thing->series[m] = nullptr;
+  }
+
+  things[lookupKey] = thing;
+  counters.things++;
+  lastThing = thing;
+  return thing;
+}
+
+bool ColumnStore::append(const char* name, size_t nameLength, StoreMetric metric,
+                         int64_t timestampMs, float value, uint8_t tag) {
+  Thing* thing = metric < METRIC_COUNT ? findThing(name, nameLength, true) : nullptr;
+  if (thing == nullptr) {
+    counters.rejected++;
+    return false;
+  }
+
+  Series* series = thing->series[metric];
+  if (series == nullptr) {
+    series = new Series();
+    series->metric = metric;
+    thing->series[metric] = series;
+    counters.series++;
+  }
+
+  if ((series->segments.empty() ||
+       series->segments.back().header->count == STORE_SEGMENT_CAPACITY) &&
+      !mapSegment(*thing, *series, (uint32_t)series->segments.size(), true)) {
+    counters.rejected++;
+    return false;
+  }
+
+  Segment& segment = series->segments.back();
+  SegmentHeader* header = segment.header;
+  uint32_t count = header->count;
+
+  // Los timestamps no decrecen dentro de una serie
+  const Segment* previous = count > 0 ? &segment
+                          : series->segments.size() > 1 ? &series->segments[series->segments.size() - 2]
+                          : nullptr;
+  if (previous != nullptr && timestampMs < previous->header->lastTimestamp) {
+    timestampMs = previous->header->lastTimestamp;
+    counters.reordered++;
+  }
+
+  segment.timestamps[count] = timestampMs;
+  segment.values[count] = value;
+  if (segment.tags != nullptr) {
+    segment.tags[count] = tag;
+  }
+  if (count == 0) {
+    header->firstTimestamp = timestampMs;
+  }
+  header->lastTimestamp = timestampMs;
+  __atomic_store_n(&header->count, count + 1, __ATOMIC_RELEASE);
+
+  counters.samples++;
+  return true;
+}
+
+size_t ColumnStore::scan(const char* name, StoreMetric metric, int64_t fromMs, int64_t toMs,
+                         std::vector<SeriesSpan>& spans) const {
+  spans.clear();
+  std::unordered_map<std::string, Thing*>::const_iterator it = things.find(name);
+  if (it == things.end() || metric >= METRIC_COUNT || it->second->series[metric] == nullptr) {
+    return 0;
+  }
+
+  const Series& series = *it->second->series[metric];
+  size_t total = 0;
+
+  for (size_t s = 0; s < series.segments.size(); s++) {
+    const Segment& segment = series.segments[s];
+    uint32_t count = __atomic_load_n(&segment.header->count, __ATOMIC_ACQUIRE);
+    if (count == 0 || segment.header->firstTimestamp > toMs ||
+        segment.header->lastTimestamp < fromMs) {
+      continue;
+    }
+
+    const int64_t* first = segment.timestamps;
+    const int64_t* last = segment.timestamps + count;
+    const int64_t* begin = std::lower_bound(first, last, fromMs);
+    const int64_t* end = std::upper_bound(begin, last, toMs);
+    if (begin == end) {
+      continue;
+    }
+
+    size_t offset = begin - first;
+    SeriesSpan span;
+    span.timestamps = begin;
+    span.values = segment.values + offset;
+    span.tags = segment.tags != nullptr ? segment.tags + offset : nullptr;
+    span.count = end - begin;
+    spans.push_back(span);
+    total += span.count;
+  }
+
+  return total;
+}
+
+size_t ColumnStore::downsample(const char* name, StoreMetric metric, int64_t fromMs, int64_t toMs,
+                               int64_t bucketMs, std::vector<SeriesAggregate>& out) const {
+  out.clear();
+  if (bucketMs <= 0) {
+    return 0;
+  }
+
+  std::vector<SeriesSpan> spans;
+  scan(name, metric, fromMs, toMs, spans);
+
+  for (size_t s = 0; s < spans.size(); s++) {
+    const SeriesSpan& span = spans[s];
+    size_t i = 0;
+
+    while (i < span.count) {
+      int64_t start = fromMs + (span.timestamps[i] - fromMs) / bucketMs * bucketMs;
+      // Fin del intervalo por búsqueda binaria; el bucle interno solo lee valores
+      size_t end = std::lower_bound(span.timestamps + i, span.timestamps + span.count,
+                                    start + bucketMs) - span.timestamps;
+
+      float minimum = std::numeric_limits<float>::max();
+      float maximum = -std::numeric_limits<float>::max();
+      double sum = 0;
+      for (size_t k = i; k < end; k++) {
+        float v = span.values[k];
+        minimum = v < minimum ? v : minimum;
+        maximum = v > maximum ? v : maximum;
+        sum += v;
+      }
+
+      // Un intervalo puede continuar en el segmento siguiente
+      if (!out.empty() && out.back().start == start) {
+        SeriesAggregate& a = out.back();
+        a.count += (uint32_t)(end - i);
+        a.min = minimum < a.min ? minimum : a.min;
+        a.max = maximum > a.max ? maximum : a.max;
+        a.sum += sum;
+      } else {
+        SeriesAggregate a = { start, (uint32_t)(end - i), minimum, maximum, sum };
+        out.push_back(a);
+      }
+      i = end;
+    }
+  }
+
+  return out.size();
+}
+
+void ColumnStore::sync() {
+  for (std::unordered_map<std::string, Thing*>::iterator it = things.begin();
+       it != things.end(); ++it) {
+    for (size_t m = 0; m < METRIC_COUNT; m++) {
+      Series* series = it->second->series[m];
+      for (size_t s = 0; series != nullptr && s < series->segments.size(); s++) {
+        msync(series->segments[s].base, series->segments[s].bytes, MS_ASYNC);
+      }
+    }
+  }
+}
+
+void ColumnStore::listThings(std::vector<std::string>& names) const {
+  names.clear();
+  for (std::unordered_map<std::string, Thing*>::const_iterator it = things.begin();
+       it != things.end(); ++it) {
+    names.push_back(it->first);
+  }
+  std::sort(names.begin(), names.end());
+}
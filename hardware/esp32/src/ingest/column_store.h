@@ -0,0 +1,109 @@
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Almacén columnar de series temporales sobre archivos mapeados en memoria.
+ *
+ * Una serie por thing y métrica, guardada en segmentos de capacidad fija:
+ *
+ *   <directorio>/<thing>/<métrica>.<índice>.seg
+ *   [cabecera 64 B][timestamps int64 x N][valores float x N][etiquetas u8 x N]
+ *
+ * Las etiquetas solo existen en la serie de alertas (métrica << 4 | severidad).
+ * Los timestamps son milisegundos de época y no decrecen dentro de una serie,
+ * de modo que un rango se localiza con búsqueda binaria y se recorre sin
+ * copiar (punteros al mapeo). El contador de la cabecera se publica después
+ * de escribir la muestra: otro proceso que mapee el archivo solo ve
+ * muestras completas.
+ */
+#define STORE_SEGMENT_CAPACITY 16384   // Muestras por segmento (~5.7 días a 30 s)
+#define STORE_SEGMENT_MAGIC 0x53434E49u  // "INCS"
+#define STORE_SEGMENT_VERSION 1
+
+enum StoreMetric : uint8_t {
+  METRIC_TEMPERATURA,
+  METRIC_HUMEDAD,
+  METRIC_HUMEDAD_SUELO,
+  METRIC_LUMINOSIDAD,
+  METRIC_ALERTAS,
+  METRIC_COUNT
+};
+
+const char* storeMetricName(StoreMetric metric);
+bool storeMetricFromName(const char* name, StoreMetric& metric);
+
+// Tramo contiguo de una serie dentro de un segmento (válido mientras el almacén exista)
+struct SeriesSpan {
+  const int64_t* timestamps;
+  const float* values;
+  const uint8_t* tags;       // nullptr salvo en alertas
+  size_t count;
+};
+
+// Agregado de un intervalo [start, start + bucket)
+struct SeriesAggregate {
+  int64_t start;
+  uint32_t count;
+  float min;
+  float max;
+  double sum;
+};
+
+struct StoreStats {
+  uint32_t things;
+  uint32_t series;
+  uint32_t segments;
+  uint64_t samples;
+  uint64_t reordered;        // Muestras con timestamp anterior al último (ajustadas)
+  uint64_t rejected;         // Thing no válido o error de E/S
+};
+
+class ColumnStore {
+public:
+  explicit ColumnStore(const char* directory);
+  ~ColumnStore();
+
+  // Crea el directorio si hace falta y mapea los segmentos existentes
+  bool open();
+  void close();
+
+  bool append(const char* thing, size_t thingLength, StoreMetric metric,
+              int64_t timestampMs, float value, uint8_t tag);
+
+  // Tramos con timestamps en [fromMs, toMs]; retorna el número de muestras
+  size_t scan(const char* thing, StoreMetric metric, int64_t fromMs, int64_t toMs,
+              std::vector<SeriesSpan>& spans) const;
+
+  // Agregados por intervalos de bucketMs desde fromMs (solo intervalos con datos)
+  size_t downsample(const char* thing, StoreMetric metric, int64_t fromMs, int64_t toMs,
+                    int64_t bucketMs, std::vector<SeriesAggregate>& out) const;
+
+  // Pide al sistema que escriba las páginas modificadas (asíncrono)
+  void sync();
+
+  const StoreStats& stats() const { return counters; }
+  void listThings(std::vector<std::string>& things) const;
+
+private:
+  struct Segment;
+  struct Series;
+  struct Thing;
+
+  Thing* findThing(const char* thing, size_t thingLength, bool create);
+  bool mapSegment(const Thing& owner, Series& series, uint32_t index, bool create);
+  bool loadThing(const std::string& name);
+
+  std::string root;
+  std::unordered_map<std::string, Thing*> things;
+  std::string lookupKey;     // Reutilizado para no reservar memoria por mensaje
+  Thing* lastThing;          // Los lotes llegan seguidos del mismo thing
+  StoreStats counters;
+};
+
+#endif // COLUMN_STORE_H
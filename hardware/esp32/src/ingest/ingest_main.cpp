@@ -0,0 +1,546 @@
+#include "column_store.h"
+#include "telemetry_ingest.h"
+#include "../config.h"
+#include "../latency_histogram.h"
+#include "../mqtt_packet.h"
+#include "../payload_codec.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <errno.h>
+#include <ftw.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <random>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Servicio de ingesta de telemetría (env:ingest)
+ *
+ *   program [--host IP] [--port N] [--dir D]    Suscribirse al broker y guardar
+ *   program --query THING MÉTRICA --last S [--bucket S] [--dir D]
+ *   program --bench [--things N] [--rounds R] [--dir D]
+ *
+ * Las métricas son temperatura, humedad, humedadSuelo, luminosidad y
+ * alertas. Con --bench se generan en memoria los PUBLISH de una flota
+ * (lecturas sueltas y lotes de TELEMETRY_BATCH_SIZE, como el firmware) y se
+ * mide en un núcleo el ritmo de ingesta y la latencia de las consultas.
+ */
+
+#define INGEST_DEFAULT_DIR "invernadero-datos"
+#define INGEST_CLIENT_ID "invernadero-ingesta"
+#define INGEST_RX_BUFFER_SIZE 16384
+#define INGEST_STATS_INTERVAL_MS 10000   // Línea de estado y msync
+#define INGEST_MAX_BACKOFF_MS 60000
+#define INGEST_BENCH_CHUNK 4096          // Bytes por recv() simulado
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+  stopRequested = 1;
+}
+
+static int64_t wallMs() {
+  return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t nowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void usage(const char* program) {
+  printf("Uso: %s [--host IP] [--port N] [--dir D]\n"
+         "       %s --query THING MÉTRICA --last S [--bucket S] [--dir D]\n"
+         "       %s --bench [--things N] [--rounds R] [--dir D]\n",
+         program, program, program);
+}
+
+static void printCounters(const IngestCounters& c, const StoreStats& s) {
+  printf("  %llu mensajes (%llu B), %llu lecturas, %llu alertas, %llu mal formados, %llu ignorados\n",
+         (unsigned long long)c.messages, (unsigned long long)c.bytes,
+         (unsigned long long)c.samples, (unsigned long long)c.alerts,
+         (unsigned long long)c.malformed, (unsigned long long)c.ignored);
+  printf("  almacén: %u things, %u series, %u segmentos, %llu muestras (%llu reordenadas, %llu rechazadas)\n",
+         (unsigned)s.things, (unsigned)s.series, (unsigned)s.segments,
+         (unsigned long long)s.samples, (unsigned long long)s.reordered,
+         (unsigned long long)s.rejected);
+}
+
+static void printLatency(const char* label, const LatencyHistogram& h) {
+  printf("  %-28s n=%-6llu p50 %.1f  p99 %.1f  max %.1f us\n", label,
+         (unsigned long long)h.count(), h.percentile(0.50) / 1000.0,
+         h.percentile(0.99) / 1000.0, h.max() / 1000.0);
+}
+
+// ============================================
+// SUSCRIPCIÓN AL BROKER
+// ============================================
+
+static const char* const FILTERS[] = {
+  "invernadero/sensores/#",
+  TOPIC_ALERTAS,
+  "+/invernadero/sensores/#",       // Topics con prefijo "<thing>/"
+  "+/" TOPIC_ALERTAS
+};
+
+static bool sendAll(int fd, const uint8_t* data, size_t length) {
+  while (length > 0) {
+    ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+static int connectBroker(const char* host, uint16_t port) {
+  char service[8];
+  snprintf(service, sizeof(service), "%u", (unsigned)port);
+
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  addrinfo* result;
+  if (getaddrinfo(host, service, &hints, &result) != 0) {
+    return -1;
+  }
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(result);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  int yes = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+  uint8_t packet[256];
+  size_t length = mqttEncodeConnect(packet, sizeof(packet), INGEST_CLIENT_ID, MQTT_KEEPALIVE, true);
+  size_t subscribe = mqttEncodeSubscribe(packet + length, sizeof(packet) - length, 1, FILTERS,
+                                         sizeof(FILTERS) / sizeof(FILTERS[0]), 0);
+  if (length == 0 || subscribe == 0 || !sendAll(fd, packet, length + subscribe)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * Sesión con el broker hasta que se cierre la conexión o se pida terminar
+ */
+static void serveSession(int fd, ColumnStore& store, TelemetryIngestor& ingestor) {
+  static uint8_t rx[INGEST_RX_BUFFER_SIZE];
+  MqttFrameReader reader(rx, sizeof(rx));
+  uint64_t lastSendNs = nowNs();
+  uint64_t lastStatsNs = lastSendNs;
+  IngestCounters previous = ingestor.counters();
+
+  while (!stopRequested) {
+    pollfd p = { fd, POLLIN, 0 };
+    int ready = poll(&p, 1, 1000);
+    if (ready < 0 && errno != EINTR) {
+      return;
+    }
+
+    if (ready > 0) {
+      uint8_t* space = reader.space();
+      ssize_t n = recv(fd, space, reader.room(), 0);
+      if (n <= 0) {
+        printf("Conexión cerrada por el broker\n");
+        return;
+      }
+      reader.commit(n);
+
+      int64_t receivedMs = wallMs();
+      MqttPacket packet;
+      MqttFrameStatus status;
+      while ((status = reader.next(packet)) == MQTT_FRAME_OK) {
+        if (packet.type == MQTT_CONNACK && (packet.length < 2 || packet.body[1] != 0)) {
+          printf("El broker rechazó la conexión\n");
+          return;
+        }
+        if (packet.type == MQTT_SUBACK) {
+          printf("Suscrito a la telemetría y las alertas\n");
+        }
+
+        MqttPublish publish;
+        if (packet.type == MQTT_PUBLISH && mqttParsePublish(packet, publish)) {
+          ingestor.ingest(publish.topic, publish.topicLength, publish.payload,
+                          publish.payloadLength, receivedMs);
+        }
+      }
+      if (status == MQTT_FRAME_ERROR) {
+        printf("Paquete mal formado o mayor que %u B\n", (unsigned)sizeof(rx));
+        return;
+      }
+    }
+
+    uint64_t now = nowNs();
+    if (now - lastSendNs >= (uint64_t)MQTT_KEEPALIVE * 500000000ULL) {
+      uint8_t ping[2];
+      size_t length = mqttEncodeEmpty(ping, sizeof(ping), MQTT_PINGREQ);
+      if (!sendAll(fd, ping, length)) {
+        return;
+      }
+      lastSendNs = now;
+    }
+
+    if (now - lastStatsNs >= INGEST_STATS_INTERVAL_MS * 1000000ULL) {
+      const IngestCounters& c = ingestor.counters();
+      double s = (now - lastStatsNs) / 1e9;
+      printf("%.0f msg/s, %.0f lecturas/s, %llu mal formados, %u things\n",
+             (c.messages - previous.messages) / s, (c.samples - previous.samples) / s,
+             (unsigned long long)c.malformed, (unsigned)store.stats().things);
+      fflush(stdout);
+      store.sync();
+      previous = c;
+      lastStatsNs = now;
+    }
+  }
+}
+
+static int runDaemon(const char* host, uint16_t port, ColumnStore& store) {
+  TelemetryIngestor* ingestor = new TelemetryIngestor(store);
+  uint32_t backoffMs = MQTT_RECONNECT_DELAY_MS;
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  while (!stopRequested) {
+    printf("Conectando a %s:%u...\n", host, (unsigned)port);
+    fflush(stdout);
+
+    int fd = connectBroker(host, port);
+    if (fd >= 0) {
+      backoffMs = MQTT_RECONNECT_DELAY_MS;
+      serveSession(fd, store, *ingestor);
+      close(fd);
+      store.sync();
+    }
+    if (stopRequested) {
+      break;
+    }
+
+    // Espera creciente entre intentos, interrumpible por la señal
+    printf("Reintentando en %u ms\n", (unsigned)backoffMs);
+    for (uint32_t waited = 0; waited < backoffMs && !stopRequested; waited += 100) {
+      usleep(100000);
+    }
+    backoffMs = backoffMs * 2 < INGEST_MAX_BACKOFF_MS ? backoffMs * 2 : INGEST_MAX_BACKOFF_MS;
+  }
+
+  store.sync();
+  printf("\nIngesta detenida\n");
+  printCounters(ingestor->counters(), store.stats());
+  delete ingestor;
+  return 0;
+}
+
+// ============================================
+// CONSULTA
+// ============================================
+
+static int runQuery(ColumnStore& store, const char* thing, StoreMetric metric,
+                    int64_t lastS, int64_t bucketS) {
+  int64_t toMs = wallMs();
+  int64_t fromMs = toMs - lastS * 1000;
+
+  if (bucketS <= 0) {
+    std::vector<SeriesSpan> spans;
+    size_t total = store.scan(thing, metric, fromMs, toMs, spans);
+    for (size_t s = 0; s < spans.size(); s++) {
+      for (size_t i = 0; i < spans[s].count; i++) {
+        printf("%lld\t%.2f", (long long)spans[s].timestamps[i], spans[s].values[i]);
+        if (spans[s].tags != nullptr) {
+          printf("\t%s/%s", alertMetricName((AlertMetric)(spans[s].tags[i] >> 4)),
+                 alertSeverityName((AlertSeverity)(spans[s].tags[i] & 0x0F)));
+        }
+        printf("\n");
+      }
+    }
+    fprintf(stderr, "%zu muestras\n", total);
+    return 0;
+  }
+
+  std::vector<SeriesAggregate> buckets;
+  store.downsample(thing, metric, fromMs, toMs, bucketS * 1000, buckets);
+  printf("inicio\tmuestras\tmín\tmedia\tmáx\n");
+  for (size_t i = 0; i < buckets.size(); i++) {
+    const SeriesAggregate& a = buckets[i];
+    printf("%lld\t%u\t%.2f\t%.2f\t%.2f\n", (long long)a.start, (unsigned)a.count,
+           a.min, a.sum / a.count, a.max);
+  }
+  return 0;
+}
+
+// ============================================
+// BENCHMARK
+// ============================================
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return remove(path);
+}
+
+static void appendPublish(std::vector<uint8_t>& stream, const char* topic,
+                          const char* payload, size_t length) {
+  size_t offset = stream.size();
+  stream.resize(offset + mqttPublishSize(strlen(topic), length, 0));
+  mqttEncodePublish(stream.data() + offset, stream.size() - offset, topic, strlen(topic),
+                    (const uint8_t*)payload, length, 0, 0, false);
+}
+
+/**
+ * Flujo de PUBLISH de la flota: en cada ronda cada thing envía un lote de
+ * TELEMETRY_BATCH_SIZE lecturas (o una lectura suelta, uno de cada cuatro)
+ */
+static size_t buildStream(std::vector<uint8_t>& stream, std::vector<int64_t>& arrivals,
+                          uint32_t things, uint32_t rounds, int64_t startMs) {
+  std::mt19937 random(1);
+  std::normal_distribution<float> noise(0.0f, 0.3f);
+  char payload[MQTT_BUFFER_SIZE * 2];
+  char sample[160];
+  size_t samples = 0;
+
+  for (uint32_t r = 0; r < rounds; r++) {
+    for (uint32_t t = 0; t < things; t++) {
+      char thing[32];
+      snprintf(thing, sizeof(thing), "invernadero-%04u", (unsigned)t);
+      bool single = t % 4 == 3;
+      uint32_t count = single ? 1 : TELEMETRY_BATCH_SIZE;
+      unsigned long base = (unsigned long)r * TELEMETRY_BATCH_SIZE * SENSOR_READ_INTERVAL_MS;
+
+      SensorData data = SensorData();
+      size_t length = single ? 0
+                    : (size_t)snprintf(payload, sizeof(payload), "{\"thing\":\"%s\",\"samples\":[", thing);
+      for (uint32_t i = 0; i < count; i++) {
+        data.timestamp = base + (TELEMETRY_BATCH_SIZE - count + i) * SENSOR_READ_INTERVAL_MS;
+        float phase = (float)(data.timestamp / 1000 % 86400) / 86400.0f * 6.2832f;
+        data.temperatura = 24.0f + 6.0f * sinf(phase) + noise(random);
+        data.humedad = 60.0f - 15.0f * sinf(phase) + noise(random);
+        data.humedadSuelo = 45.0f + noise(random);
+        data.luminosidad = fmaxf(0.0f, 800.0f * sinf(phase));
+
+        if (single) {
+          length = encodeSensorDataJson(thing, data, payload, sizeof(payload));
+        } else {
+          size_t n = encodeSensorDataJson(nullptr, data, sample, sizeof(sample));
+          length += snprintf(payload + length, sizeof(payload) - length, "%s%.*s",
+                             i > 0 ? "," : "", (int)n, sample);
+        }
+      }
+      if (!single) {
+        length += snprintf(payload + length, sizeof(payload) - length, "]}");
+      }
+
+      appendPublish(stream, TOPIC_TELEMETRIA, payload, length);
+      arrivals.push_back(startMs + (int64_t)data.timestamp);
+      samples += count;
+    }
+
+    // Una alerta por ronda en algunos things
+    for (uint32_t t = 0; t < things; t += 16) {
+      int length = snprintf(payload, sizeof(payload),
+                            "{\"thing\":\"invernadero-%04u\",\"timestamp\":%lu,\"alerts\":["
+                            "{\"type\":\"temperatura\",\"severity\":\"warning\","
+                            "\"message\":\"Temperatura alta\",\"value\":31.5}]}",
+                            (unsigned)t, (unsigned long)r * SENSOR_READ_INTERVAL_MS);
+      appendPublish(stream, TOPIC_ALERTAS, payload, length);
+      arrivals.push_back(startMs + (int64_t)(r + 1) * TELEMETRY_BATCH_SIZE * SENSOR_READ_INTERVAL_MS);
+    }
+  }
+  return samples;
+}
+
+static int runBench(const char* directory, uint32_t things, uint32_t rounds) {
+  char temporary[] = "/tmp/invernadero-ingesta-XXXXXX";
+  bool ownDirectory = directory == nullptr;
+  if (ownDirectory && (directory = mkdtemp(temporary)) == nullptr) {
+    printf("No se pudo crear el directorio temporal\n");
+    return 1;
+  }
+
+  // La última ronda termina ahora: --query --last funciona sobre los datos
+  int64_t spanMs = (int64_t)rounds * TELEMETRY_BATCH_SIZE * SENSOR_READ_INTERVAL_MS;
+  int64_t startMs = wallMs() - spanMs;
+
+  std::vector<uint8_t> stream;
+  std::vector<int64_t> arrivals;
+  size_t samples = buildStream(stream, arrivals, things, rounds, startMs);
+  printf("Flujo: %zu PUBLISH, %zu lecturas, %.1f MB (%u things, %.1f h de datos)\n",
+         arrivals.size(), samples, stream.size() / 1e6, (unsigned)things, spanMs / 3.6e6);
+
+  ColumnStore store(directory);
+  if (!store.open()) {
+    printf("No se pudo abrir %s\n", directory);
+    return 1;
+  }
+  TelemetryIngestor* ingestor = new TelemetryIngestor(store);
+
+  // Ingesta: el flujo entra en trozos como desde un socket
+  static uint8_t rx[INGEST_RX_BUFFER_SIZE];
+  MqttFrameReader reader(rx, sizeof(rx));
+  size_t offset = 0;
+  size_t message = 0;
+  uint64_t startNs = nowNs();
+
+  while (offset < stream.size()) {
+    uint8_t* space = reader.space();
+    size_t n = stream.size() - offset;
+    n = n < INGEST_BENCH_CHUNK ? n : INGEST_BENCH_CHUNK;
+    n = n < reader.room() ? n : reader.room();
+    memcpy(space, stream.data() + offset, n);
+    reader.commit(n);
+    offset += n;
+
+    MqttPacket packet;
+    MqttPublish publish;
+    while (reader.next(packet) == MQTT_FRAME_OK) {
+      if (packet.type == MQTT_PUBLISH && mqttParsePublish(packet, publish)) {
+        ingestor->ingest(publish.topic, publish.topicLength, publish.payload,
+                         publish.payloadLength, arrivals[message++]);
+      }
+    }
+  }
+  double ingestS = (nowNs() - startNs) / 1e9;
+
+  const IngestCounters& c = ingestor->counters();
+  printf("\n== Ingesta (un núcleo) ==\n");
+  printf("  %.2f s: %.0f msg/s, %.0f lecturas/s, %.0f muestras/s, %.1f MB/s de payload\n",
+         ingestS, c.messages / ingestS, c.samples / ingestS,
+         store.stats().samples / ingestS, c.bytes / ingestS / 1e6);
+  printCounters(c, store.stats());
+
+  // Consultas sobre things al azar
+  std::mt19937 random(2);
+  LatencyHistogram hour, day, downsampled;
+  std::vector<SeriesSpan> spans;
+  std::vector<SeriesAggregate> buckets;
+  int64_t endMs = startMs + spanMs;
+  size_t read = 0;
+  volatile double checksum = 0;  // El recorrido no se elimina al optimizar
+
+  for (int q = 0; q < 2000; q++) {
+    char thing[32];
+    snprintf(thing, sizeof(thing), "invernadero-%04u", (unsigned)(random() % things));
+
+    uint64_t t0 = nowNs();
+    size_t n = store.scan(thing, METRIC_TEMPERATURA, endMs - 3600000, endMs, spans);
+    double sum = 0;
+    for (size_t s = 0; s < spans.size(); s++) {
+      for (size_t i = 0; i < spans[s].count; i++) {
+        sum += spans[s].values[i];
+      }
+    }
+    uint64_t t2 = nowNs();
+    store.scan(thing, METRIC_TEMPERATURA, endMs - 86400000, endMs, spans);
+    uint64_t t3 = nowNs();
+    store.downsample(thing, METRIC_TEMPERATURA, endMs - 86400000, endMs, 300000, buckets);
+    uint64_t t4 = nowNs();
+
+    hour.record((uint32_t)(t2 - t0));
+    day.record((uint32_t)(t3 - t2));
+    downsampled.record((uint32_t)(t4 - t3));
+    read += n;
+    checksum += sum;
+  }
+
+  printf("\n== Consultas (%zu muestras en la última hora) ==\n", read / 2000);
+  printLatency("última hora (recorrido)", hour);
+  printLatency("últimas 24 h (localizar)", day);
+  printLatency("24 h en intervalos de 5 min", downsampled);
+
+  delete ingestor;
+  store.close();
+  if (ownDirectory) {
+    nftw(directory, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+  } else {
+    printf("\nDatos en %s\n", directory);
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  const char* host = "127.0.0.1";
+  uint16_t port = 1883;
+  const char* directory = nullptr;
+  const char* queryThing = nullptr;
+  const char* queryMetric = nullptr;
+  int64_t lastS = 3600;
+  int64_t bucketS = 0;
+  bool bench = false;
+  uint32_t things = 1000;
+  uint32_t rounds = 36;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (strcmp(arg, "--bench") == 0) {
+      bench = true;
+    } else if (strcmp(arg, "--query") == 0 && i + 2 < argc) {
+      queryThing = argv[++i];
+      queryMetric = argv[++i];
+    } else if (strcmp(arg, "--host") == 0 && hasValue) {
+      host = argv[++i];
+    } else if (strcmp(arg, "--port") == 0 && hasValue) {
+      port = (uint16_t)atoi(argv[++i]);
+    } else if (strcmp(arg, "--dir") == 0 && hasValue) {
+      directory = argv[++i];
+    } else if (strcmp(arg, "--last") == 0 && hasValue) {
+      lastS = atoll(argv[++i]);
+    } else if (strcmp(arg, "--bucket") == 0 && hasValue) {
+      bucketS = atoll(argv[++i]);
+    } else if (strcmp(arg, "--things") == 0 && hasValue) {
+      things = (uint32_t)atol(argv[++i]);
+    } else if (strcmp(arg, "--rounds") == 0 && hasValue) {
+      rounds = (uint32_t)atol(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (bench) {
+    if (things == 0 || rounds == 0) {
+      usage(argv[0]);
+      return 2;
+    }
+    return runBench(directory, things, rounds);
+  }
+
+  ColumnStore store(directory != nullptr ? directory : INGEST_DEFAULT_DIR);
+  if (!store.open()) {
+    printf("No se pudo abrir el almacén\n");
+    return 1;
+  }
+
+  if (queryThing != nullptr) {
+    StoreMetric metric;
+    if (!storeMetricFromName(queryMetric, metric) || lastS <= 0) {
+      usage(argv[0]);
+      return 2;
+    }
+    return runQuery(store, queryThing, metric, lastS, bucketS);
+  }
+
+  return runDaemon(host, port, store);
+}
@@ -0,0 +1,494 @@
+#include "telemetry_ingest.h"
+#include "../config.h"
+#include "../payload_codec.h"
+#include <math.h>
+#include <string.h>
+
+// Métricas de SensorData en el orden de StoreMetric
+#define INGEST_SENSOR_METRICS 4
+#define INGEST_ALL_METRICS -1
+
+enum TopicKind : uint8_t {
+  TOPIC_KIND_TELEMETRY,
+  TOPIC_KIND_LEGACY,         // Un topic por métrica
+  TOPIC_KIND_ALERTS,
+  TOPIC_KIND_UNKNOWN
+};
+
+struct TopicRoute {
+  const char* topic;
+  size_t length;
+  TopicKind kind;
+  int metric;
+};
+
+#define ROUTE(topic, kind, metric) { topic, sizeof(topic) - 1, kind, metric }
+
+static const TopicRoute ROUTES[] = {
+  ROUTE(TOPIC_TELEMETRIA, TOPIC_KIND_TELEMETRY, INGEST_ALL_METRICS),
+  ROUTE(TOPIC_TEMPERATURA, TOPIC_KIND_LEGACY, METRIC_TEMPERATURA),
+  ROUTE(TOPIC_HUMEDAD, TOPIC_KIND_LEGACY, METRIC_HUMEDAD),
+  ROUTE(TOPIC_HUMEDAD_SUELO, TOPIC_KIND_LEGACY, METRIC_HUMEDAD_SUELO),
+  ROUTE(TOPIC_LUMINOSIDAD, TOPIC_KIND_LEGACY, METRIC_LUMINOSIDAD),
+  ROUTE(TOPIC_ALERTAS, TOPIC_KIND_ALERTS, INGEST_ALL_METRICS)
+};
+
+/**
+ * Identifica el topic, con o sin prefijo "<thing>/"
+ */
+static const TopicRoute* routeTopic(const char* topic, size_t length) {
+  for (size_t i = 0; i < sizeof(ROUTES) / sizeof(ROUTES[0]); i++) {
+    const TopicRoute& r = ROUTES[i];
+    if (length < r.length || memcmp(topic + length - r.length, r.topic, r.length) != 0) {
+      continue;
+    }
+    if (length == r.length || topic[length - r.length - 1] == '/') {
+      return &r;
+    }
+  }
+  return nullptr;
+}
+
+// ============================================
+// LECTURA JSON
+// ============================================
+
+/**
+ * Lector mínimo de JSON para los objetos planos del firmware: cadenas sin
+ * decodificar escapes, números y arreglos de objetos. Los valores
+ * desconocidos se saltan sin interpretarlos.
+ */
+struct JsonCursor {
+  const char* p;
+  const char* end;
+
+  void skipSpace() {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+      p++;
+    }
+  }
+
+  bool consume(char c) {
+    skipSpace();
+    if (p < end && *p == c) {
+      p++;
+      return true;
+    }
+    return false;
+  }
+
+  bool peek(char c) {
+    skipSpace();
+    return p < end && *p == c;
+  }
+
+  bool string(const char*& text, size_t& length) {
+    if (!consume('"')) {
+      return false;
+    }
+
+    text = p;
+    while (p < end && *p != '"') {
+      p += *p == '\\' ? 2 : 1;
+    }
+    if (p >= end) {
+      return false;
+    }
+
+    length = p - text;
+    p++;
+    return true;
+  }
+
+  bool literal(const char* text) {
+    size_t length = strlen(text);
+    if ((size_t)(end - p) < length || memcmp(p, text, length) != 0) {
+      return false;
+    }
+    p += length;
+    return true;
+  }
+
+  bool number(double& value) {
+    skipSpace();
+    bool negative = p < end && *p == '-';
+    if (negative) {
+      p++;
+    }
+    // Lectura fallida del sensor: snprintf escribe "nan", ArduinoJson "null"
+    if (literal("nan") || literal("null")) {
+      value = NAN;
+      return true;
+    }
+    if (p >= end || *p < '0' || *p > '9') {
+      return false;
+    }
+
+    double result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      result = result * 10 + (*p++ - '0');
+    }
+
+    if (p < end && *p == '.') {
+      p++;
+      double scale = 0.1;
+      while (p < end && *p >= '0' && *p <= '9') {
+        result += (*p++ - '0') * scale;
+        scale *= 0.1;
+      }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+      p++;
+      bool negativeExp = p < end && *p == '-';
+      if (p < end && (*p == '-' || *p == '+')) {
+        p++;
+      }
+      int exponent = 0;
+      while (p < end && *p >= '0' && *p <= '9') {
+        exponent = exponent * 10 + (*p++ - '0');
+      }
+      while (exponent-- > 0) {
+        result = negativeExp ? result / 10 : result * 10;
+      }
+    }
+
+    value = negative ? -result : result;
+    return true;
+  }
+
+  // Salta un valor de cualquier tipo
+  bool skip() {
+    skipSpace();
+    if (p >= end) {
+      return false;
+    }
+
+    if (*p == '"') {
+      const char* text;
+      size_t length;
+      return string(text, length);
+    }
+
+    if (*p == '{' || *p == '[') {
+      int depth = 0;
+      while (p < end) {
+        char c = *p;
+        if (c == '"') {
+          const char* text;
+          size_t length;
+          if (!string(text, length)) {
+            return false;
+          }
+          continue;
+        }
+        p++;
+        if (c == '{' || c == '[') {
+          depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Número o literal (true, false, null)
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ') {
+      p++;
+    }
+    return p > start;
+  }
+};
+
+static bool keyIs(const char* key, size_t length, const char* expected) {
+  return strlen(expected) == length && memcmp(key, expected, length) == 0;
+}
+
+/**
+ * Recorre los pares clave-valor de un objeto. handler(key, length, cursor)
+ * consume el valor y retorna false si es inválido.
+ */
+template <typename Handler>
+static bool forEachMember(JsonCursor& json, Handler handler) {
+  if (!json.consume('{')) {
+    return false;
+  }
+  if (json.consume('}')) {
+    return true;
+  }
+
+  do {
+    const char* key;
+    size_t length;
+    if (!json.string(key, length) || !json.consume(':') || !handler(key, length, json)) {
+      return false;
+    }
+  } while (json.consume(','));
+
+  return json.consume('}');
+}
+
+template <typename Handler>
+static bool forEachElement(JsonCursor& json, Handler handler) {
+  if (!json.consume('[')) {
+    return false;
+  }
+  if (json.consume(']')) {
+    return true;
+  }
+
+  do {
+    if (!handler(json)) {
+      return false;
+    }
+  } while (json.consume(','));
+
+  return json.consume(']');
+}
+
+/**
+ * Campo de una lectura; retorna false solo si el valor es inválido
+ */
+static bool readSampleField(const char* key, size_t length, JsonCursor& json,
+                            SensorData& data, bool& known) {
+  double value;
+  known = true;
+
+  if (keyIs(key, length, "timestamp")) {
+    if (!json.number(value)) return false;
+    data.timestamp = (unsigned long)value;
+  } else if (keyIs(key, length, "temperatura")) {
+    if (!json.number(value)) return false;
+    data.temperatura = (float)value;
+  } else if (keyIs(key, length, "humedad")) {
+    if (!json.number(value)) return false;
+    data.humedad = (float)value;
+  } else if (keyIs(key, length, "humedadSuelo")) {
+    if (!json.number(value)) return false;
+    data.humedadSuelo = (float)value;
+  } else if (keyIs(key, length, "luminosidad")) {
+    if (!json.number(value)) return false;
+    data.luminosidad = (float)value;
+  } else {
+    known = false;
+  }
+  return true;
+}
+
+static void copyThing(char* out, size_t& outLength, const char* text, size_t length) {
+  outLength = length < INGEST_MAX_THING - 1 ? length : INGEST_MAX_THING - 1;
+  memcpy(out, text, outLength);
+  out[outLength] = '\0';
+}
+
+// ============================================
+// INGESTA
+// ============================================
+
+static void sampleSink(const SensorData& data, void* context) {
+  ((TelemetryIngestor*)context)->collect(data);
+}
+
+static void alertSink(const Alert& alert, unsigned long timestamp, void* context) {
+  ((TelemetryIngestor*)context)->collectAlert(alert.metric, alert.severity, alert.value);
+}
+
+TelemetryIngestor::TelemetryIngestor(ColumnStore& store)
+  : store(store), thingLength(0), batchCount(0), batchOverflow(false), alertCount(0) {
+  memset(&totals, 0, sizeof(totals));
+  thing[0] = '\0';
+}
+
+void TelemetryIngestor::collect(const SensorData& data) {
+  if (batchCount < INGEST_MAX_BATCH) {
+    batch[batchCount++] = data;
+  } else {
+    batchOverflow = true;
+  }
+}
+
+void TelemetryIngestor::collectAlert(uint8_t metric, uint8_t severity, float value) {
+  if (alertCount < INGEST_MAX_BATCH) {
+    alertTags[alertCount] = (uint8_t)((metric << 4) | (severity & 0x0F));
+    alertValues[alertCount] = value;
+    alertCount++;
+  }
+}
+
+/**
+ * Lectura individual ({"thing", "timestamp", ...}) o lote ({"thing", "samples": [...]})
+ */
+bool TelemetryIngestor::decodeJsonTelemetry(const uint8_t* payload, size_t length) {
+  JsonCursor json = { (const char*)payload, (const char*)payload + length };
+  SensorData single = SensorData();
+  bool hasFields = false;
+
+  bool ok = forEachMember(json, [&](const char* key, size_t keyLength, JsonCursor& value) {
+    if (keyIs(key, keyLength, "thing")) {
+      const char* text;
+      size_t textLength;
+      if (!value.string(text, textLength)) return false;
+      copyThing(thing, thingLength, text, textLength);
+      return true;
+    }
+
+    if (keyIs(key, keyLength, "samples")) {
+      return forEachElement(value, [&](JsonCursor& element) {
+        SensorData data = SensorData();
+        bool valid = forEachMember(element, [&](const char* k, size_t kl, JsonCursor& v) {
+          bool known;
+          return readSampleField(k, kl, v, data, known) && (known || v.skip());
+        });
+        if (valid) {
+          collect(data);
+        }
+        return valid;
+      });
+    }
+
+    bool known;
+    if (!readSampleField(key, keyLength, value, single, known)) {
+      return false;
+    }
+    hasFields |= known;
+    return known || value.skip();
+  });
+
+  if (ok && hasFields) {
+    collect(single);
+  }
+  return ok;
+}
+
+bool TelemetryIngestor::decodeJsonAlerts(const uint8_t* payload, size_t length) {
+  JsonCursor json = { (const char*)payload, (const char*)payload + length };
+
+  return forEachMember(json, [&](const char* key, size_t keyLength, JsonCursor& value) {
+    if (keyIs(key, keyLength, "thing")) {
+      const char* text;
+      size_t textLength;
+      if (!value.string(text, textLength)) return false;
+      copyThing(thing, thingLength, text, textLength);
+      return true;
+    }
+
+    if (!keyIs(key, keyLength, "alerts")) {
+      return value.skip();
+    }
+
+    return forEachElement(value, [&](JsonCursor& element) {
+      int metric = -1;
+      int severity = SEVERITY_INFO;
+      double alertValue = 0;
+
+      bool valid = forEachMember(element, [&](const char* k, size_t kl, JsonCursor& v) {
+        const char* text;
+        size_t textLength;
+
+        if (keyIs(k, kl, "type")) {
+          if (!v.string(text, textLength)) return false;
+          for (int m = ALERT_TEMPERATURA; m <= ALERT_LUMINOSIDAD; m++) {
+            if (keyIs(text, textLength, alertMetricName((AlertMetric)m))) metric = m;
+          }
+          return true;
+        }
+        if (keyIs(k, kl, "severity")) {
+          if (!v.string(text, textLength)) return false;
+          for (int s = SEVERITY_INFO; s <= SEVERITY_CRITICAL; s++) {
+            if (keyIs(text, textLength, alertSeverityName((AlertSeverity)s))) severity = s;
+          }
+          return true;
+        }
+        if (keyIs(k, kl, "value")) {
+          return v.number(alertValue);
+        }
+        return v.skip();
+      });
+
+      if (valid && metric >= 0) {
+        collectAlert((uint8_t)metric, (uint8_t)severity, (float)alertValue);
+      }
+      return valid;
+    });
+  });
+}
+
+/**
+ * Guarda las lecturas del mensaje: la más reciente en la hora de llegada
+ * y el resto según su diferencia de millis() con ella
+ */
+void TelemetryIngestor::storeSamples(int64_t receivedMs, int onlyMetric) {
+  unsigned long newest = 0;
+  for (size_t i = 0; i < batchCount; i++) {
+    newest = batch[i].timestamp > newest ? batch[i].timestamp : newest;
+  }
+
+  for (size_t i = 0; i < batchCount; i++) {
+    const SensorData& d = batch[i];
+    int64_t ts = receivedMs - (int64_t)(newest - d.timestamp);
+    const float values[INGEST_SENSOR_METRICS] = {
+      d.temperatura, d.humedad, d.humedadSuelo, d.luminosidad
+    };
+
+    for (int m = 0; m < INGEST_SENSOR_METRICS; m++) {
+      if ((onlyMetric == INGEST_ALL_METRICS || onlyMetric == m) && !isnan(values[m])) {
+        store.append(thing, thingLength, (StoreMetric)m, ts, values[m], 0);
+      }
+    }
+  }
+  totals.samples += batchCount;
+}
+
+void TelemetryIngestor::storeAlerts(int64_t receivedMs) {
+  for (size_t i = 0; i < alertCount; i++) {
+    store.append(thing, thingLength, METRIC_ALERTAS, receivedMs, alertValues[i], alertTags[i]);
+  }
+  totals.alerts += alertCount;
+}
+
+bool TelemetryIngestor::ingest(const char* topic, size_t topicLength,
+                               const uint8_t* payload, size_t length, int64_t receivedMs) {
+  totals.messages++;
+  totals.bytes += length;
+
+  const TopicRoute* route = routeTopic(topic, topicLength);
+  if (route == nullptr || length == 0) {
+    totals.ignored++;
+    return false;
+  }
+
+  thingLength = 0;
+  thing[0] = '\0';
+  batchCount = 0;
+  batchOverflow = false;
+  alertCount = 0;
+
+  bool ok;
+  if (route->kind == TOPIC_KIND_ALERTS) {
+    ok = payload[0] == '{' ? decodeJsonAlerts(payload, length)
+                           : decodeAlertsCbor(payload, length, alertSink, this);
+  } else if (payload[0] == '{') {
+    ok = decodeJsonTelemetry(payload, length);
+  } else if ((payload[0] & 0xE0) == 0xA0) {
+    // Mapa CBOR
+    ok = decodeTelemetryCbor(payload, length, thing, sizeof(thing), sampleSink, this);
+    thingLength = strlen(thing);
+  } else {
+    ok = decodeTelemetrySeries(payload, length, thing, sizeof(thing), sampleSink, this);
+    thingLength = strlen(thing);
+  }
+
+  // El firmware siempre identifica el thing; sin él no hay serie donde guardar
+  if (!ok || batchOverflow || thingLength == 0) {
+    totals.malformed++;
+    return false;
+  }
+
+  if (route->kind == TOPIC_KIND_ALERTS) {
+    storeAlerts(receivedMs);
+  } else {
+    storeSamples(receivedMs, route->metric);
+  }
+  return true;
+}
@@ -0,0 +1,64 @@
+#ifndef TELEMETRY_INGEST_H
+#define TELEMETRY_INGEST_H
+
+#include "column_store.h"
+#include "../sensor_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Decodificación de los mensajes del firmware hacia el almacén columnar.
+ *
+ *   TOPIC_TELEMETRIA        lectura de sensorDataToJson() o lote JSON/CBOR/SERIES
+ *   TOPIC_TEMPERATURA, ...  modo compatible: misma lectura, solo esa métrica
+ *   TOPIC_ALERTAS           alertas JSON o CBOR (etiqueta = métrica << 4 | severidad)
+ *
+ * Los topics también se reconocen con prefijo "<thing>/". El timestamp del
+ * firmware es millis() desde el arranque: cada muestra se sitúa en la hora
+ * de llegada menos su antigüedad dentro del mensaje.
+ */
+#define INGEST_MAX_BATCH 256           // Lecturas por mensaje
+#define INGEST_MAX_THING 64
+
+struct IngestCounters {
+  uint64_t messages;
+  uint64_t bytes;
+  uint64_t samples;
+  uint64_t alerts;
+  uint64_t malformed;        // Payload que no se pudo decodificar
+  uint64_t ignored;          // Topic no reconocido
+};
+
+class TelemetryIngestor {
+public:
+  explicit TelemetryIngestor(ColumnStore& store);
+
+  bool ingest(const char* topic, size_t topicLength,
+              const uint8_t* payload, size_t length, int64_t receivedMs);
+
+  const IngestCounters& counters() const { return totals; }
+
+  // Añade una lectura al lote en curso (sumideros de los decodificadores CBOR)
+  void collect(const SensorData& data);
+  void collectAlert(uint8_t metric, uint8_t severity, float value);
+
+private:
+  bool decodeJsonTelemetry(const uint8_t* payload, size_t length);
+  bool decodeJsonAlerts(const uint8_t* payload, size_t length);
+  void storeSamples(int64_t receivedMs, int onlyMetric);
+  void storeAlerts(int64_t receivedMs);
+
+  ColumnStore& store;
+  IngestCounters totals;
+
+  char thing[INGEST_MAX_THING];
+  size_t thingLength;
+  SensorData batch[INGEST_MAX_BATCH];
+  size_t batchCount;
+  bool batchOverflow;
+  uint8_t alertTags[INGEST_MAX_BATCH];
+  float alertValues[INGEST_MAX_BATCH];
+  size_t alertCount;
+};
+
+#endif // TELEMETRY_INGEST_H
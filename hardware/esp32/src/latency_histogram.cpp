@@ -0,0 +1,79 @@
+#include "latency_histogram.h"
+#include <string.h>
+
+#define LATENCY_SUB_COUNT (1u << LATENCY_SUB_BITS)
+
+/**
+ * Índice del cubo: los valores menores que 2^SUB_BITS van a cubos
+ * exactos; el resto se agrupa por su bit más alto y los SUB_BITS siguientes
+ */
+static size_t bucketIndex(uint32_t value) {
+  if (value < LATENCY_SUB_COUNT) {
+    return value;
+  }
+
+  unsigned top = 31 - __builtin_clz(value);
+  unsigned shift = top - LATENCY_SUB_BITS;
+  size_t sub = (value >> shift) & (LATENCY_SUB_COUNT - 1);
+  return ((size_t)(shift + 1) << LATENCY_SUB_BITS) + sub;
+}
+
+// Mayor valor que cae en el cubo
+static uint32_t bucketUpperBound(size_t index) {
+  if (index < LATENCY_SUB_COUNT) {
+    return (uint32_t)index;
+  }
+
+  unsigned shift = (unsigned)(index >> LATENCY_SUB_BITS) - 1;
+  uint64_t sub = (index & (LATENCY_SUB_COUNT - 1)) | LATENCY_SUB_COUNT;
+  uint64_t upper = ((sub + 1) << shift) - 1;
+  return upper > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)upper;
+}
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  samples = 0;
+  sum = 0;
+  minimum = 0xFFFFFFFFu;
+  maximum = 0;
+}
+
+void LatencyHistogram::record(uint32_t value) {
+  buckets[bucketIndex(value)]++;
+  samples++;
+  sum += value;
+  minimum = value < minimum ? value : minimum;
+  maximum = value > maximum ? value : maximum;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+    buckets[i] += other.buckets[i];
+  }
+  samples += other.samples;
+  sum += other.sum;
+  minimum = other.minimum < minimum ? other.minimum : minimum;
+  maximum = other.maximum > maximum ? other.maximum : maximum;
+}
+
+uint32_t LatencyHistogram::percentile(double p) const {
+  if (samples == 0) {
+    return 0;
+  }
+
+  uint64_t target = (uint64_t)(p * samples);
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen > target) {
+      uint32_t upper = bucketUpperBound(i);
+      return upper < maximum ? upper : maximum;
+    }
+  }
+  return maximum;
+}
@@ -0,0 +1,41 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Histograma de latencias en escala logarítmica con cubos fijos.
+ *
+ * Cada potencia de 2 se divide en 8 sub-cubos (error relativo < 12.5 %),
+ * cubriendo todo el rango de uint32_t en 256 contadores (1 KB) sin
+ * memoria dinámica. La unidad (ns, us, ciclos) la decide el llamador.
+ */
+#define LATENCY_SUB_BITS 3
+#define LATENCY_BUCKETS ((32 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+class LatencyHistogram {
+public:
+  LatencyHistogram();
+
+  void record(uint32_t value);
+  void merge(const LatencyHistogram& other);
+  void reset();
+
+  uint64_t count() const { return samples; }
+  uint32_t min() const { return samples > 0 ? minimum : 0; }
+  uint32_t max() const { return maximum; }
+  double mean() const { return samples > 0 ? (double)sum / samples : 0.0; }
+
+  // Límite superior del cubo que contiene el percentil p (0..1)
+  uint32_t percentile(double p) const;
+
+private:
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint64_t samples;
+  uint64_t sum;
+  uint32_t minimum;
+  uint32_t maximum;
+};
+
+#endif // LATENCY_HISTOGRAM_H
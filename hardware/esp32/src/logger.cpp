@@ -0,0 +1,87 @@
+#include "logger.h"
+#include "mpsc_ring.h"
+
+static const char LEVEL_LETTERS[] = "-EWID";
+static const char* const MODULE_NAMES[LOG_MODULE_COUNT] = {
+  "app", "sensores", "mqtt", "wifi", "tls", "registro"
+};
+
+std::atomic<uint8_t> logLevels[LOG_MODULE_COUNT] = {
+  {LOG_LEVEL}, {LOG_LEVEL}, {LOG_LEVEL}, {LOG_LEVEL}, {LOG_LEVEL}, {LOG_LEVEL}
+};
+static_assert(LOG_MODULE_COUNT == 6, "actualizar logLevels y MODULE_NAMES");
+
+// Mensajes pendientes de formatear (cualquier tarea -> tarea de registro)
+MpscRing<LogRecord, LOG_RING_SIZE> logRing;
+std::atomic<uint32_t> logDropCount(0);
+uint32_t logDropReported = 0;   // Propiedad de la tarea de registro
+
+/**
+ * Cambia el nivel de un módulo en tiempo de ejecución. Los niveles por
+ * encima de LOG_LEVEL no están compilados y no se pueden activar.
+ */
+void logSetLevel(LogModule module, LogLevel level) {
+  if (module < LOG_MODULE_COUNT) {
+    logLevels[module].store(level, std::memory_order_relaxed);
+  }
+}
+
+bool logPush(const LogRecord& record) {
+  if (!logRing.push(record)) {
+    logDropCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+uint32_t logDropped() {
+  return logDropCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * Escribe una línea "[segundos] N módulo: mensaje"
+ */
+static void writeLine(uint32_t ms, LogLevel level, LogModule module, const LogRecord* record,
+                      const char* message) {
+  char line[LOG_LINE_SIZE];
+  int length = snprintf(line, sizeof(line), "[%5lu.%03u] %c %s: ", (unsigned long)(ms / 1000),
+                        (unsigned)(ms % 1000), LEVEL_LETTERS[level < LOG_DEBUG ? level : LOG_DEBUG],
+                        MODULE_NAMES[module]);
+  if (length < 0 || (size_t)length >= sizeof(line)) {
+    return;
+  }
+
+  int body = record != nullptr
+    ? record->formatter(*record, line + length, sizeof(line) - length)
+    : snprintf(line + length, sizeof(line) - length, "%s", message);
+  if (body < 0) {
+    return;
+  }
+
+  // Mensaje truncado: se conserva el salto de línea
+  length = (size_t)(length + body) < sizeof(line) - 1 ? length + body : sizeof(line) - 2;
+  line[length++] = '\n';
+  halConsoleWrite(line, length);
+}
+
+/**
+ * Formatea y escribe hasta maxRecords mensajes. Retorna cuántos escribió.
+ */
+size_t logDrain(size_t maxRecords) {
+  uint32_t dropped = logDropCount.load(std::memory_order_relaxed);
+  if (dropped != logDropReported) {
+    char message[48];
+    snprintf(message, sizeof(message), "%lu mensajes descartados (anillo lleno)",
+             (unsigned long)(dropped - logDropReported));
+    writeLine((uint32_t)halMillis(), LOG_WARN, LOG_APP, nullptr, message);
+    logDropReported = dropped;
+  }
+
+  LogRecord record;
+  size_t written = 0;
+  while (written < maxRecords && logRing.pop(record)) {
+    writeLine(record.ms, record.level, record.module, &record, nullptr);
+    written++;
+  }
+  return written;
+}
@@ -0,0 +1,233 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+#include "config.h"
+#include "hal.h"
+
+/**
+ * Registro asíncrono con niveles y filtro por módulo.
+ *
+ * LOG_E/W/I/D no formatean: guardan el instante, el puntero al formato y
+ * los argumentos en una ranura de un anillo lock-free (las cadenas se
+ * copian, hasta LOG_TEXT_SIZE entre todas). logDrain(), desde una tarea de
+ * baja prioridad, formatea y escribe con halConsoleWrite(). Con el anillo
+ * lleno el mensaje se descarta y se cuenta. Un nivel por encima de
+ * LOG_LEVEL no genera código. Portable (compila en el host).
+ */
+
+enum LogLevel : uint8_t {
+  LOG_NONE,
+  LOG_ERROR,
+  LOG_WARN,
+  LOG_INFO,
+  LOG_DEBUG
+};
+
+enum LogModule : uint8_t {
+  LOG_APP,       // app.cpp, main.cpp
+  LOG_SENSORS,   // Sensores, DHT22 y ADC
+  LOG_MQTT,      // Sesión y cola MQTT
+  LOG_NET,       // WiFi
+  LOG_TLS,       // Enlace TLS
+  LOG_STORAGE,   // Registro local (LittleFS)
+  LOG_MODULE_COUNT
+};
+
+#define LOG_MAX_ARGS 6
+
+// Argumento guardado; las cadenas como desplazamiento en LogRecord::text
+union LogArg {
+  long long i;
+  unsigned long long u;
+  double f;
+  const void* p;
+  size_t text;
+};
+
+struct LogRecord;
+typedef int (*LogFormatFn)(const LogRecord& record, char* out, size_t capacity);
+
+struct LogRecord {
+  uint32_t ms;
+  LogLevel level;
+  LogModule module;
+  const char* format;
+  LogFormatFn formatter;   // Sabe los tipos de los argumentos
+  LogArg args[LOG_MAX_ARGS];
+  char text[LOG_TEXT_SIZE];
+};
+
+// Funciones públicas
+void logSetLevel(LogModule module, LogLevel level);
+bool logPush(const LogRecord& record);
+size_t logDrain(size_t maxRecords);   // Solo desde la tarea de registro
+uint32_t logDropped();
+
+extern std::atomic<uint8_t> logLevels[LOG_MODULE_COUNT];
+
+inline bool logEnabled(LogModule module, LogLevel level) {
+  return logLevels[module].load(std::memory_order_relaxed) >= level;
+}
+
+// ============================================
+// ARGUMENTOS DIFERIDOS
+// ============================================
+// Tipo con el que se guarda y se vuelve a pasar a snprintf cada argumento
+template <typename T, typename = void>
+struct LogStored {
+  typedef const void* type;
+};
+template <typename T>
+struct LogStored<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+  typedef T type;
+};
+template <typename T>
+struct LogStored<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  typedef double type;
+};
+template <>
+struct LogStored<const char*> {
+  typedef const char* type;
+};
+template <>
+struct LogStored<char*> {
+  typedef const char* type;
+};
+
+// Guardar
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+logStore(LogRecord&, LogArg& arg, size_t&, T value) {
+  if (std::is_signed<T>::value) {
+    arg.i = (long long)value;
+  } else {
+    arg.u = (unsigned long long)value;
+  }
+}
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type
+logStore(LogRecord&, LogArg& arg, size_t&, T value) {
+  arg.f = value;
+}
+
+inline void logStore(LogRecord& record, LogArg& arg, size_t& used, const char* value) {
+  if (value == nullptr) {
+    value = "(null)";
+  }
+
+  // Copia truncada; sin espacio queda la cadena vacía del final
+  size_t room = used < LOG_TEXT_SIZE ? LOG_TEXT_SIZE - 1 - used : 0;
+  size_t length = 0;
+  while (length < room && value[length] != '\0') {
+    length++;
+  }
+  arg.text = used < LOG_TEXT_SIZE ? used : LOG_TEXT_SIZE - 1;
+  memcpy(record.text + arg.text, value, length);
+  record.text[arg.text + length] = '\0';
+  used = arg.text + length + 1;
+}
+
+inline void logStore(LogRecord& record, LogArg& arg, size_t& used, char* value) {
+  logStore(record, arg, used, (const char*)value);
+}
+
+template <typename T>
+typename std::enable_if<std::is_pointer<T>::value>::type
+logStore(LogRecord&, LogArg& arg, size_t&, T value) {
+  arg.p = (const void*)value;
+}
+
+// Recuperar
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, T>::type
+logLoad(const LogRecord&, const LogArg& arg) {
+  return std::is_signed<T>::value ? (T)arg.i : (T)arg.u;
+}
+
+template <typename T>
+typename std::enable_if<std::is_same<T, double>::value, T>::type
+logLoad(const LogRecord&, const LogArg& arg) {
+  return arg.f;
+}
+
+template <typename T>
+typename std::enable_if<std::is_same<T, const char*>::value, T>::type
+logLoad(const LogRecord& record, const LogArg& arg) {
+  return record.text + arg.text;
+}
+
+template <typename T>
+typename std::enable_if<std::is_same<T, const void*>::value, T>::type
+logLoad(const LogRecord&, const LogArg& arg) {
+  return arg.p;
+}
+
+template <typename... Stored, size_t... I>
+int logFormatArgs(const LogRecord& record, char* out, size_t capacity, std::index_sequence<I...>) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+  return snprintf(out, capacity, record.format, logLoad<Stored>(record, record.args[I])...);
+#pragma GCC diagnostic pop
+}
+
+template <typename... Stored>
+int logFormat(const LogRecord& record, char* out, size_t capacity) {
+  return logFormatArgs<Stored...>(record, out, capacity, std::index_sequence_for<Stored...>());
+}
+
+/**
+ * Guarda el mensaje para formatearlo más tarde. Usar las macros LOG_*.
+ */
+template <typename... Args>
+void logWrite(LogLevel level, LogModule module, const char* format, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "demasiados argumentos para LOG_MAX_ARGS");
+
+  LogRecord record;
+  record.ms = (uint32_t)halMillis();
+  record.level = level;
+  record.module = module;
+  record.format = format;
+  record.formatter = logFormat<typename LogStored<typename std::decay<Args>::type>::type...>;
+
+  size_t used = 0;
+  size_t index = 0;
+  (void)used;
+  (void)index;
+  (logStore(record, record.args[index++], used, args), ...);
+
+  logPush(record);
+}
+
+// Solo para que el compilador compruebe formato y argumentos
+inline void logCheckFormat(const char* format, ...) __attribute__((format(printf, 1, 2)));
+inline void logCheckFormat(const char* format, ...) {}
+
+// ============================================
+// MACROS
+// ============================================
+// El formato debe ser un literal (se guarda su puntero), sin '\n' final
+#define LOG_AT(level, module, ...) \
+  do { \
+    if (LOG_LEVEL >= (level) && logEnabled((module), (level))) { \
+      if (false) { \
+        logCheckFormat(__VA_ARGS__); \
+      } \
+      logWrite((level), (module), __VA_ARGS__); \
+    } \
+  } while (0)
+
+#define LOG_E(module, ...) LOG_AT(LOG_ERROR, module, __VA_ARGS__)
+#define LOG_W(module, ...) LOG_AT(LOG_WARN, module, __VA_ARGS__)
+#define LOG_I(module, ...) LOG_AT(LOG_INFO, module, __VA_ARGS__)
+#define LOG_D(module, ...) LOG_AT(LOG_DEBUG, module, __VA_ARGS__)
+
+#endif // LOGGER_H
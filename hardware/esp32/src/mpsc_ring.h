@@ -0,0 +1,90 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Cola circular lock-free de varios productores y un consumidor (MPSC).
+ *
+ * Capacidad fija N (potencia de 2), sin memoria dinámica. Cada ranura
+ * lleva un número de secuencia: un productor reserva la ranura con un
+ * compare-and-swap sobre head y la publica al actualizar su secuencia, de
+ * modo que un productor interrumpido no corrompe a los demás (solo retrasa
+ * al consumidor hasta que termine). push() puede llamarse desde cualquier
+ * tarea; pop() solo desde la consumidora.
+ */
+template <typename T, size_t N>
+class MpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+public:
+  MpscRing() : head(0), tail(0) {
+    for (size_t i = 0; i < N; i++) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Encola un elemento. Retorna false si la cola está llena.
+   */
+  bool push(const T& item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    for (;;) {
+      slot = &slots[h & (N - 1)];
+      intptr_t diff = (intptr_t)slot->sequence.load(std::memory_order_acquire) - (intptr_t)h;
+
+      if (diff == 0) {
+        if (head.compare_exchange_weak(h, h + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        h = head.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->item = item;
+    slot->sequence.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Extrae el elemento más antiguo. Retorna false si la cola está vacía
+   * (o si su productor aún no terminó de escribirlo).
+   */
+  bool pop(T& item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    Slot& slot = slots[t & (N - 1)];
+
+    if (slot.sequence.load(std::memory_order_acquire) != t + 1) {
+      return false;
+    }
+
+    item = slot.item;
+    slot.sequence.store(t + N, std::memory_order_release);
+    tail.store(t + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  static constexpr size_t capacity() {
+    return N;
+  }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  // Índices en líneas de caché separadas para evitar falso compartido
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+  Slot slots[N];
+};
+
+#endif // MPSC_RING_H
@@ -1,38 +1,149 @@
 #include "mqtt_client.h"
 #include "config.h"
-#include <WiFiClientSecure.h>
-#include <PubSubClient.h>
+#include "actuator_registry.h"
+#include "backoff.h"
+#include "hal.h"
+#include "mqtt_packet.h"
+#include "trace.h"
+#include "diagnostics.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
 
-// Clientes WiFi y MQTT
-WiFiClientSecure wifiClient;
-PubSubClient mqttClient(wifiClient);
+/**
+ * Sesión MQTT con AWS IoT Core. La HAL aporta el flujo de bytes (TLS);
+ * aquí quedan el protocolo, la cola de salida, la reconexión, las
+ * suscripciones y los contadores. Nada bloquea la tarea de red; el
+ * firmware nunca se reinicia por fallos de conexión.
+ */
+
+#define MQTT_CONTROL_BUFFER_SIZE 256   // CONNECT, SUBSCRIBE, PUBACK y PINGREQ
+#define MQTT_MAX_TOPIC_LENGTH 128
+
+enum SessionState : uint8_t {
+  SESSION_IDLE,          // Sin enlace; se reintenta con WiFi y tras el backoff
+  SESSION_LINKING,       // Esperando el enlace TLS
+  SESSION_CONNECTING,    // CONNECT enviado, esperando CONNACK
+  SESSION_ONLINE
+};
 
 // Callback para actuadores
-void (*actuatorCallbackFunction)(String topic, String payload) = nullptr;
+MqttMessageCallback messageCallbackFunction = nullptr;
+StatusFieldsFn statusFieldsFunction = nullptr;
 
 // Variables de estado
+SessionState sessionState = SESSION_IDLE;
+unsigned long sessionStartedAt = 0;
 unsigned long lastReconnectAttempt = 0;
-int reconnectAttempts = 0;
+unsigned long reconnectWaitMs = 0;      // 0 = en cuanto haya WiFi
+unsigned long lastSendAt = 0;
+unsigned long lastReceiveAt = 0;
+Backoff reconnectBackoff(MQTT_RECONNECT_DELAY_MS, MQTT_BACKOFF_MAX_MS);
+bool sessionUp = false;         // Último estado registrado en la traza
+TlsStats tlsStats;
+bool sessionHandshakeValid = false;   // tlsStats.last es del enlace actual
+
+// Cola de salida y buffers del protocolo (propiedad de la tarea de red)
+MqttOutbox outbox;
+uint8_t controlBuffer[MQTT_CONTROL_BUFFER_SIZE];
+size_t controlLength = 0;
+size_t controlSent = 0;
+uint8_t receiveBuffer[MQTT_BUFFER_SIZE];
+MqttFrameReader receiveReader(receiveBuffer, sizeof(receiveBuffer));
+char inboundTopic[MQTT_MAX_TOPIC_LENGTH];
+
+// Filtros de cada sesión: topics de los actuadores registrados y de reglas
+const char* const REGISTRY_FILTERS[] = {
+#define ACTUATOR_FILTER(id, suffix, pin, name) TOPIC_ACTUADORES_PREFIX suffix,
+  ACTUATOR_LIST(ACTUATOR_FILTER)
+#undef ACTUATOR_FILTER
+  TOPIC_REGLAS
+};
+const char* const* subscribeFilters = REGISTRY_FILTERS;
+size_t subscribeCount = ACTUATOR_COUNT + 1;
+size_t subscribeNext = 0;               // Primer filtro sin enviar
+bool subscribeAwaiting = false;         // SUBACK de subscribePacketId pendiente
+uint16_t subscribePacketId = 0;
+
+/**
+ * Carril de un topic: estado y alertas adelantan a la telemetría
+ */
+static MqttLane laneForTopic(const char* topic) {
+  if (strcmp(topic, TOPIC_ESTADO) == 0) {
+    return LANE_STATUS;
+  }
+  if (strcmp(topic, TOPIC_ALERTAS) == 0) {
+    return LANE_ALERTS;
+  }
+  return LANE_TELEMETRY;
+}
+
+static uint8_t qosForLane(MqttLane lane) {
+  switch (lane) {
+    case LANE_STATUS: return MQTT_QOS_STATUS;
+    case LANE_ALERTS: return MQTT_QOS_ALERTS;
+    default: return MQTT_QOS_TELEMETRY;
+  }
+}
+
+/**
+ * Añade un paquete de control a los pendientes de escribir
+ */
+static bool queueControl(size_t length) {
+  if (length == 0) {
+    return false;
+  }
+  controlLength += length;
+  return true;
+}
+
+static uint8_t* controlSpace(size_t& capacity) {
+  capacity = sizeof(controlBuffer) - controlLength;
+  return controlBuffer + controlLength;
+}
 
 /**
  * Callback interno de MQTT para mensajes recibidos
  */
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  DEBUG_PRINT("Mensaje recibido en topic: ");
-  DEBUG_PRINTLN(topic);
-  
-  // Convertir payload a String
-  String message = "";
-  for (unsigned int i = 0; i < length; i++) {
-    message += (char)payload[i];
+void mqttCallback(const char* topic, const uint8_t* payload, size_t length) {
+  // El payload se entrega sin copiar (buffer de recepción)
+  LOG_D(LOG_MQTT, "Mensaje recibido en %s (%u B)", topic, (unsigned)length);
+
+  traceInbound(topic, payload, length);
+
+  // Llamar al callback de la aplicación si está definido
+  if (messageCallbackFunction != nullptr) {
+    messageCallbackFunction(topic, payload, length);
   }
-  
-  DEBUG_PRINT("Payload: ");
-  DEBUG_PRINTLN(message);
-  
-  // Llamar al callback de actuadores si está definido
-  if (actuatorCallbackFunction != nullptr) {
-    actuatorCallbackFunction(String(topic), message);
+}
+
+/**
+ * Publica el estado de conexión en TOPIC_ESTADO (sin memoria dinámica).
+ * Con handshake añade su duración, pico de heap y si se reanudó; el
+ * estado "online" lleva además los campos de setStatusFields().
+ */
+static void publishStatus(const char* status, const HalHandshake* handshake = nullptr,
+                          bool online = false) {
+  char extra[320] = "";
+  int length = 0;
+  if (handshake != nullptr) {
+    length = snprintf(extra, sizeof(extra), ",\"tls\":{\"ms\":%lu,\"heap\":%lu,\"resumed\":%s}",
+                      (unsigned long)handshake->durationMs, (unsigned long)handshake->peakHeapBytes,
+                      handshake->resumed ? "true" : "false");
+  }
+  if (online && statusFieldsFunction != nullptr && length >= 0 && (size_t)length < sizeof(extra)) {
+    // 0 si no caben: se publica el estado sin ellos
+    size_t fields = statusFieldsFunction(extra + length, sizeof(extra) - length);
+    extra[length + fields] = '\0';
+  }
+
+  char statusMsg[448];
+  length = snprintf(statusMsg, sizeof(statusMsg),
+                    "{\"thing\":\"%s\",\"status\":\"%s\",\"timestamp\":%lu%s}",
+                    THING_NAME, status, halMillis(), extra);
+
+  if (length > 0 && (size_t)length < sizeof(statusMsg)) {
+    publishPayload(TOPIC_ESTADO, (const uint8_t*)statusMsg, length);
   }
 }
 
@@ -40,126 +151,449 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
  * Inicializa el cliente MQTT
  */
 void initMQTT() {
-  DEBUG_PRINTLN("Inicializando cliente MQTT...");
-  
-  // Configurar certificados SSL/TLS
-  wifiClient.setCACert(AWS_CERT_CA);
-  wifiClient.setCertificate(AWS_CERT_CRT);
-  wifiClient.setPrivateKey(AWS_CERT_PRIVATE);
-  
-  // Configurar servidor MQTT
-  mqttClient.setServer(AWS_IOT_ENDPOINT, AWS_IOT_PORT);
-  mqttClient.setCallback(mqttCallback);
-  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
-  mqttClient.setKeepAlive(MQTT_KEEPALIVE);
-  
-  DEBUG_PRINTLN("Cliente MQTT inicializado");
-}
-
-/**
- * Conecta al broker MQTT de AWS IoT Core
- */
-bool connectMQTT() {
-  if (mqttClient.connected()) {
+  LOG_I(LOG_MQTT, "Inicializando cliente MQTT...");
+
+  // Certificados y servidor los configura la HAL al abrir el enlace
+  sessionState = SESSION_IDLE;
+  controlLength = 0;
+  controlSent = 0;
+  receiveReader.reset();
+
+  LOG_I(LOG_MQTT, "Cliente MQTT inicializado");
+}
+
+/**
+ * Registra el handshake del enlace recién abierto
+ */
+static void recordHandshake(const HalHandshake& handshake) {
+  tlsStats.handshakes++;
+  if (handshake.resumed) {
+    tlsStats.resumed++;
+    tlsStats.resumedMs.record(handshake.durationMs);
+  } else {
+    tlsStats.fullMs.record(handshake.durationMs);
+  }
+  if (handshake.peakHeapBytes > tlsStats.peakHeapBytes) {
+    tlsStats.peakHeapBytes = handshake.peakHeapBytes;
+  }
+
+  tlsStats.last = handshake;
+  sessionHandshakeValid = true;
+}
+
+/**
+ * Abre el enlace para una nueva sesión
+ */
+static void startSession() {
+  lastReconnectAttempt = halMillis();
+  sessionStartedAt = lastReconnectAttempt;
+  sessionState = SESSION_LINKING;
+  sessionHandshakeValid = false;
+  halLinkOpen();
+}
+
+/**
+ * Cierra el enlace. Lo que quede en vuelo se reenvía en la siguiente sesión,
+ * que se intenta de inmediato (una sesión caída no es un intento fallido).
+ */
+static void endSession() {
+  if (sessionUp) {
+    sessionUp = false;
+    traceLink(false);
+  }
+
+  halLinkClose();
+  sessionState = SESSION_IDLE;
+  reconnectWaitMs = 0;
+  controlLength = 0;
+  controlSent = 0;
+  receiveReader.reset();
+  subscribeNext = 0;
+  subscribeAwaiting = false;
+}
+
+/**
+ * Intento de conexión fallido (enlace, CONNACK o tiempo agotado)
+ */
+static void sessionFailed(const char* reason) {
+  endSession();
+  lastReconnectAttempt = halMillis();
+  reconnectWaitMs = reconnectBackoff.next(halRandom());
+  LOG_W(LOG_MQTT, "Error de conexión: %s; reintento en %lu ms", reason, reconnectWaitMs);
+}
+
+/**
+ * Encola el siguiente SUBSCRIBE: tantos filtros como quepan en el buffer
+ * de control, con su propio identificador. Los demás salen tras su SUBACK.
+ * Retorna false si ni un filtro cabe en un paquete; con el buffer de
+ * control ocupado lo deja para el siguiente loop.
+ */
+static bool queueSubscribe() {
+  if (subscribeAwaiting || subscribeNext >= subscribeCount) {
     return true;
   }
-  
-  DEBUG_PRINT("Conectando a AWS IoT Core...");
-  
-  // Intentar conexión
-  if (mqttClient.connect(THING_NAME)) {
-    DEBUG_PRINTLN(" ¡Conectado!");
-    
-    // Suscribirse a topics de actuadores
-    mqttClient.subscribe(TOPIC_ACTUADOR_VENTILADOR);
-    mqttClient.subscribe(TOPIC_ACTUADOR_BOMBA);
-    mqttClient.subscribe(TOPIC_ACTUADOR_LUCES);
-    
-    DEBUG_PRINTLN("Suscrito a topics de actuadores");
-    
-    // Publicar mensaje de estado
-    String statusMsg = "{\"thing\":\"" + String(THING_NAME) + "\",\"status\":\"online\",\"timestamp\":" + String(millis()) + "}";
-    mqttClient.publish(TOPIC_ESTADO, statusMsg.c_str());
-    
-    reconnectAttempts = 0;
+
+  const char* const* filters = subscribeFilters + subscribeNext;
+  size_t count = 0;
+  while (subscribeNext + count < subscribeCount &&
+         mqttSubscribeSize(filters, count + 1) <= MQTT_CONTROL_BUFFER_SIZE) {
+    count++;
+  }
+  if (count == 0) {
+    LOG_E(LOG_MQTT, "Filtro %s mayor que el buffer de control", filters[0]);
+    return false;
+  }
+
+  size_t capacity;
+  uint8_t* space = controlSpace(capacity);
+  if (mqttSubscribeSize(filters, count) > capacity) {
     return true;
-  } else {
-    DEBUG_PRINT(" Error de conexión, rc=");
-    DEBUG_PRINTLN(mqttClient.state());
-    
-    reconnectAttempts++;
-    
-    if (reconnectAttempts >= MQTT_MAX_RECONNECT_ATTEMPTS) {
-      DEBUG_PRINTLN("Máximo de reintentos alcanzado. Reiniciando ESP32...");
-      delay(1000);
-      ESP.restart();
-    }
-    
+  }
+
+  subscribePacketId = subscribePacketId == 0xFFFF ? 1 : subscribePacketId + 1;
+  if (!queueControl(mqttEncodeSubscribe(space, capacity, subscribePacketId, filters, count,
+                                        MQTT_QOS_COMMANDS))) {
+    LOG_E(LOG_MQTT, "No se pudo codificar el SUBSCRIBE");
     return false;
   }
+
+  subscribeNext += count;
+  subscribeAwaiting = true;
+  return true;
+}
+
+/**
+ * CONNACK aceptado: suscripciones, estado y reenvío de lo pendiente
+ */
+static void onSessionOnline() {
+  LOG_I(LOG_MQTT, "¡Conectado!");
+  sessionState = SESSION_ONLINE;
+  sessionUp = true;
+  traceLink(true);
+  reconnectBackoff.reset();
+
+  // Suscribirse a los topics de todos los actuadores registrados y al de
+  // reglas de control, en tantos SUBSCRIBE como haga falta
+  subscribeNext = 0;
+  subscribeAwaiting = false;
+  if (!queueSubscribe()) {
+    sessionFailed("suscripciones sin enviar");
+    return;
+  }
+
+  outbox.resumeSession();
+  publishStatus("online", sessionHandshakeValid ? &tlsStats.last : nullptr, true);
+}
+
+/**
+ * Procesa un paquete recibido del broker
+ */
+static void handlePacket(const MqttPacket& packet) {
+  uint16_t packetId;
+  MqttPublish publish;
+
+  switch (packet.type) {
+    case MQTT_CONNACK:
+      if (sessionState != SESSION_CONNECTING) {
+        break;
+      }
+      if (packet.length >= 2 && packet.body[1] == 0) {
+        onSessionOnline();
+      } else {
+        sessionFailed("CONNACK rechazado");
+      }
+      break;
+
+    case MQTT_PUBACK:
+      if (mqttParsePacketId(packet, packetId)) {
+        outbox.acknowledge(packetId, halMicros());
+      }
+      break;
+
+    case MQTT_PUBLISH:
+      if (!mqttParsePublish(packet, publish)) {
+        break;
+      }
+
+      // Confirmar antes de entregar: el comando ya está en manos del firmware
+      if (publish.qos > 0) {
+        size_t capacity;
+        uint8_t* space = controlSpace(capacity);
+        queueControl(mqttEncodeAck(space, capacity, MQTT_PUBACK, publish.packetId));
+      }
+
+      if (publish.topicLength < sizeof(inboundTopic)) {
+        memcpy(inboundTopic, publish.topic, publish.topicLength);
+        inboundTopic[publish.topicLength] = '\0';
+        mqttCallback(inboundTopic, publish.payload, publish.payloadLength);
+      }
+      break;
+
+    case MQTT_SUBACK:
+      if (!subscribeAwaiting || !mqttParsePacketId(packet, packetId) ||
+          packetId != subscribePacketId) {
+        break;
+      }
+
+      // Códigos 0x80: el broker rechazó el filtro
+      if (packet.length > 2 && memchr(packet.body + 2, 0x80, packet.length - 2) != nullptr) {
+        LOG_E(LOG_MQTT, "Suscripción rechazada por el broker");
+      }
+
+      subscribeAwaiting = false;
+      if (subscribeNext >= subscribeCount) {
+        LOG_I(LOG_MQTT, "Suscrito a %u topics", (unsigned)subscribeCount);
+      } else if (!queueSubscribe()) {
+        sessionFailed("suscripciones sin enviar");
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * Lee lo recibido por el enlace y procesa los paquetes completos
+ */
+static void receivePackets(unsigned long now) {
+  for (;;) {
+    uint8_t* space = receiveReader.space();
+    size_t room = receiveReader.room();
+    size_t received = room > 0 ? halLinkRead(space, room) : 0;
+    if (received == 0) {
+      break;
+    }
+
+    receiveReader.commit(received);
+    lastReceiveAt = now;
+  }
+
+  MqttPacket packet;
+  MqttFrameStatus status = MQTT_FRAME_NEED_MORE;
+  while (sessionState >= SESSION_CONNECTING &&
+         (status = receiveReader.next(packet)) == MQTT_FRAME_OK) {
+    handlePacket(packet);
+  }
+
+  if (sessionState >= SESSION_CONNECTING && status == MQTT_FRAME_ERROR) {
+    LOG_E(LOG_MQTT, "Paquete MQTT mayor que el buffer");
+    endSession();
+  }
 }
 
 /**
- * Desconecta del broker MQTT
+ * Escribe en el enlace lo que acepte: paquetes de control entre PUBLISH
+ * y, en sesión, la cola de salida por prioridad
+ */
+static void transmitPackets(unsigned long now) {
+  for (;;) {
+    if (!outbox.transmitting() && controlSent < controlLength) {
+      size_t written = halLinkWrite(controlBuffer + controlSent, controlLength - controlSent);
+      controlSent += written;
+      if (written > 0) {
+        lastSendAt = now;
+      }
+      if (controlSent < controlLength) {
+        return;
+      }
+      controlLength = 0;
+      controlSent = 0;
+    }
+
+    if (sessionState != SESSION_ONLINE) {
+      return;
+    }
+
+    size_t length;
+    const uint8_t* data = outbox.peek(now, length);
+    if (data == nullptr) {
+      return;
+    }
+
+    size_t written = halLinkWrite(data, length);
+    if (written == 0) {
+      return;
+    }
+
+    outbox.consume(written, now, halMicros());
+    lastSendAt = now;
+    if (written < length) {
+      return;
+    }
+  }
+}
+
+/**
+ * Desconecta del broker MQTT tras intentar entregar el estado "offline"
  */
 void disconnectMQTT() {
-  if (mqttClient.connected()) {
+  if (sessionState == SESSION_ONLINE) {
     // Publicar mensaje de desconexión
-    String statusMsg = "{\"thing\":\"" + String(THING_NAME) + "\",\"status\":\"offline\",\"timestamp\":" + String(millis()) + "}";
-    mqttClient.publish(TOPIC_ESTADO, statusMsg.c_str());
-    
-    mqttClient.disconnect();
-    DEBUG_PRINTLN("Desconectado de MQTT");
+    publishStatus("offline");
+
+    unsigned long start = halMillis();
+    while (outbox.queued() > 0 && halLinkState() == LINK_OPEN &&
+           halMillis() - start < MQTT_CONNECT_TIMEOUT_MS) {
+      mqttLoop();
+      halDelay(LOOP_IDLE_DELAY_MS);
+    }
+
+    size_t capacity;
+    uint8_t* space = controlSpace(capacity);
+    queueControl(mqttEncodeEmpty(space, capacity, MQTT_DISCONNECT));
+    transmitPackets(halMillis());
+
+    endSession();
+    LOG_I(LOG_MQTT, "Desconectado de MQTT");
   }
 }
 
 /**
  * Publica datos de sensores a un topic
  */
-bool publishSensorData(const String& topic, const String& payload) {
-  if (!mqttClient.connected()) {
-    DEBUG_PRINTLN("Error: MQTT no conectado");
+bool publishSensorData(const char* topic, const char* payload) {
+  return publishPayload(topic, (const uint8_t*)payload, strlen(payload));
+}
+
+/**
+ * Publica un mensaje genérico
+ */
+bool publishMessage(const char* topic, const char* message) {
+  return publishPayload(topic, (const uint8_t*)message, strlen(message));
+}
+
+/**
+ * Encola un payload binario o de texto (se copia: el buffer del llamador
+ * queda libre al retornar). false si la cola de su carril está llena.
+ */
+bool publishPayload(const char* topic, const uint8_t* payload, size_t length) {
+  DIAG_SCOPE(DIAG_PUBLISH);
+  MqttLane lane = laneForTopic(topic);
+
+  if (!outbox.enqueue(lane, topic, payload, length, qosForLane(lane), halMicros())) {
+    LOG_W(LOG_MQTT, "Cola MQTT llena para %s", topic);
     return false;
   }
-  
-  bool success = mqttClient.publish(topic.c_str(), payload.c_str());
-  
-  if (success) {
-    DEBUG_PRINT("Publicado en ");
-    DEBUG_PRINT(topic);
-    DEBUG_PRINT(": ");
-    DEBUG_PRINTLN(payload);
-  } else {
-    DEBUG_PRINT("Error al publicar en ");
-    DEBUG_PRINTLN(topic);
+
+  tracePublish(topic, payload, length);
+  LOG_D(LOG_MQTT, "Encolado en %s (%u B)", topic, (unsigned)length);
+
+  // Empezar a escribir ya: con el enlace libre no espera al siguiente loop
+  if (sessionState == SESSION_ONLINE) {
+    transmitPackets(halMillis());
   }
-  
-  return success;
+  return true;
 }
 
 /**
- * Publica un mensaje genérico
+ * Mensajes que aún se pueden encolar en el carril de ese topic
+ */
+size_t publishRoom(const char* topic) {
+  return outbox.room(laneForTopic(topic));
+}
+
+/**
+ * Contadores de mensajes, bytes y latencias desde el arranque
+ */
+const MqttStats& getMqttStats() {
+  return outbox.stats();
+}
+
+/**
+ * Duración y memoria de los handshakes TLS desde el arranque
  */
-bool publishMessage(const String& topic, const String& message) {
-  return publishSensorData(topic, message);
+const TlsStats& getTlsStats() {
+  return tlsStats;
 }
 
 /**
- * Mantiene la conexión MQTT activa
- * Debe llamarse en el loop principal
+ * Mantiene la sesión MQTT: reconexión, lectura, escritura y keepalive.
+ * Debe llamarse en el loop principal; nunca bloquea.
  */
 void mqttLoop() {
-  if (!mqttClient.connected()) {
-    unsigned long now = millis();
-    
-    if (now - lastReconnectAttempt > MQTT_RECONNECT_DELAY_MS) {
-      lastReconnectAttempt = now;
-      
-      DEBUG_PRINTLN("Intentando reconectar MQTT...");
-      connectMQTT();
+  unsigned long now = halMillis();
+  HalLinkState link = halLinkState();
+
+  // Sin IP no hay enlace posible: esperar al gestor de conectividad
+  if (!halNetworkConnected()) {
+    if (sessionState != SESSION_IDLE) {
+      LOG_W(LOG_MQTT, "Conexión MQTT perdida (sin WiFi)");
+      endSession();
     }
-  } else {
-    mqttClient.loop();
+    return;
+  }
+
+  switch (sessionState) {
+    case SESSION_IDLE:
+      if (now - lastReconnectAttempt >= reconnectWaitMs) {
+        LOG_I(LOG_MQTT, "Conectando a AWS IoT Core...");
+        startSession();
+      }
+      return;
+
+    case SESSION_LINKING:
+      if (link == LINK_OPEN) {
+        HalHandshake handshake;
+        if (halLinkTakeHandshake(handshake)) {
+          recordHandshake(handshake);
+        }
+
+        size_t capacity;
+        uint8_t* space = controlSpace(capacity);
+        queueControl(mqttEncodeConnect(space, capacity, THING_NAME, MQTT_KEEPALIVE, true));
+        sessionState = SESSION_CONNECTING;
+        lastReceiveAt = now;
+      } else if (link == LINK_FAILED || now - sessionStartedAt > MQTT_CONNECT_TIMEOUT_MS) {
+        sessionFailed("enlace TLS no disponible");
+        return;
+      }
+      break;
+
+    case SESSION_CONNECTING:
+    case SESSION_ONLINE:
+      if (link != LINK_OPEN) {
+        LOG_W(LOG_MQTT, "Conexión MQTT perdida");
+        endSession();
+        return;
+      }
+      break;
+  }
+
+  if (sessionState == SESSION_LINKING) {
+    return;
+  }
+
+  receivePackets(now);
+
+  if (sessionState == SESSION_CONNECTING && now - sessionStartedAt > MQTT_CONNECT_TIMEOUT_MS) {
+    sessionFailed("sin CONNACK");
+    return;
+  }
+
+  if (sessionState == SESSION_ONLINE) {
+    // Sin nada recibido en 1.5 keepalive el broker ya cerró la sesión
+    if (now - lastReceiveAt > MQTT_KEEPALIVE * 1500UL) {
+      LOG_W(LOG_MQTT, "Keepalive MQTT vencido");
+      endSession();
+      return;
+    }
+
+    // SUBSCRIBE aplazado por el buffer de control ocupado
+    if (!queueSubscribe()) {
+      sessionFailed("suscripciones sin enviar");
+      return;
+    }
+
+    if (now - lastSendAt > MQTT_KEEPALIVE * 500UL && controlLength == 0) {
+      size_t capacity;
+      uint8_t* space = controlSpace(capacity);
+      queueControl(mqttEncodeEmpty(space, capacity, MQTT_PINGREQ));
+    }
+  }
+
+  if (sessionState != SESSION_IDLE) {
+    transmitPackets(now);
   }
 }
 
@@ -167,12 +601,29 @@ void mqttLoop() {
  * Verifica si MQTT está conectado
  */
 bool isMQTTConnected() {
-  return mqttClient.connected();
+  return sessionState == SESSION_ONLINE;
+}
+
+/**
+ * Establece el callback para los mensajes recibidos (actuadores y reglas)
+ */
+void setMessageCallback(MqttMessageCallback callback) {
+  messageCallbackFunction = callback;
+}
+
+/**
+ * Filtros a suscribir en cada sesión (se copia el puntero, no los
+ * filtros). nullptr = actuadores registrados y reglas. Se aplica en la
+ * siguiente sesión.
+ */
+void setSubscriptions(const char* const* filters, size_t count) {
+  subscribeFilters = filters != nullptr ? filters : REGISTRY_FILTERS;
+  subscribeCount = filters != nullptr ? count : ACTUATOR_COUNT + 1;
 }
 
 /**
- * Establece el callback para comandos de actuadores
+ * Establece los campos adicionales del estado "online"
  */
-void setActuatorCallback(void (*callback)(String topic, String payload)) {
-  actuatorCallbackFunction = callback;
+void setStatusFields(StatusFieldsFn fields) {
+  statusFieldsFunction = fields;
 }
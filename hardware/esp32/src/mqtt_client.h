@@ -1,17 +1,55 @@
 #ifndef MQTT_CLIENT_H
 #define MQTT_CLIENT_H
 
-#include <Arduino.h>
-#include <PubSubClient.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hal.h"
+#include "latency_histogram.h"
+#include "mqtt_outbox.h"
+
+/**
+ * Cliente MQTT 3.1.1 asíncrono sobre el flujo de bytes de la HAL.
+ *
+ * Las funciones de publicación solo encolan (ver mqtt_outbox.h) y
+ * retornan de inmediato; mqttLoop() escribe lo que el enlace acepte, lee
+ * las respuestas y mantiene la sesión. El carril se deduce del topic:
+ * TOPIC_ESTADO y TOPIC_ALERTAS adelantan a la telemetría. La sesión se
+ * abre sola en cuanto hay WiFi y se reintenta con backoff y jitter.
+ */
+
+// Contadores de publicación y latencia de entrega por carril
+typedef OutboxStats MqttStats;
+
+// Handshakes TLS del enlace desde el arranque
+struct TlsStats {
+  uint32_t handshakes;
+  uint32_t resumed;               // Sesión reanudada (sin intercambio de claves)
+  uint32_t peakHeapBytes;         // Mayor pico de heap de un handshake
+  LatencyHistogram fullMs;        // Duración de los handshakes completos
+  LatencyHistogram resumedMs;     // Duración de los reanudados
+  HalHandshake last;              // Handshake del último enlace abierto
+};
+
+// Callback de mensajes recibidos: punteros válidos solo durante la llamada
+typedef void (*MqttMessageCallback)(const char* topic, const uint8_t* payload, size_t length);
+
+// Campos adicionales del estado "online" (p. ej. tiempos de arranque):
+// escribe ,"clave":valor... en out y retorna la longitud (0 = ninguno)
+typedef size_t (*StatusFieldsFn)(char* out, size_t capacity);
 
 // Funciones públicas
 void initMQTT();
-bool connectMQTT();
 void disconnectMQTT();
-bool publishSensorData(const String& topic, const String& payload);
-bool publishMessage(const String& topic, const String& message);
+bool publishSensorData(const char* topic, const char* payload);
+bool publishMessage(const char* topic, const char* message);
+bool publishPayload(const char* topic, const uint8_t* payload, size_t length);
+size_t publishRoom(const char* topic);
+const MqttStats& getMqttStats();
+const TlsStats& getTlsStats();
 void mqttLoop();
 bool isMQTTConnected();
-void setActuatorCallback(void (*callback)(String topic, String payload));
+void setMessageCallback(MqttMessageCallback callback);
+void setSubscriptions(const char* const* filters, size_t count);
+void setStatusFields(StatusFieldsFn fields);
 
 #endif // MQTT_CLIENT_H
@@ -0,0 +1,228 @@
+#include "mqtt_outbox.h"
+#include "mqtt_packet.h"
+#include <string.h>
+
+MqttOutbox::MqttOutbox()
+  : freeCount(MQTT_OUTBOX_SLOTS), inflightCount(0), current(-1), offset(0),
+    currentIsResend(false), nextPacketId(1), nextSequence(0) {
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    slots[i].state = SLOT_FREE;
+  }
+  for (size_t l = 0; l < LANE_COUNT; l++) {
+    laneHead[l] = 0;
+    laneCount[l] = 0;
+  }
+
+  counters.messages = 0;
+  counters.payloadBytes = 0;
+  counters.wireBytes = 0;
+  counters.acked = 0;
+  counters.retransmits = 0;
+  counters.rejected = 0;
+}
+
+/**
+ * Identificador de paquete no usado por ninguna ranura ocupada (1..65535)
+ */
+uint16_t MqttOutbox::allocatePacketId() {
+  for (;;) {
+    uint16_t id = nextPacketId;
+    nextPacketId = nextPacketId == 0xFFFF ? 1 : nextPacketId + 1;
+
+    bool used = false;
+    for (size_t i = 0; i < MQTT_OUTBOX_SLOTS && !used; i++) {
+      used = slots[i].state != SLOT_FREE && slots[i].qos > 0 && slots[i].packetId == id;
+    }
+    if (!used) {
+      return id;
+    }
+  }
+}
+
+bool MqttOutbox::enqueue(MqttLane lane, const char* topic, const uint8_t* payload,
+                         size_t length, uint8_t qos, unsigned long nowUs) {
+  // La telemetría deja libres las últimas ranuras para estado y alertas
+  size_t reserve = lane == LANE_TELEMETRY ? MQTT_OUTBOX_RESERVED : 0;
+  if (lane >= LANE_COUNT || freeCount <= reserve) {
+    counters.rejected++;
+    return false;
+  }
+
+  int index = 0;
+  while (slots[index].state != SLOT_FREE) {
+    index++;
+  }
+
+  Slot& slot = slots[index];
+  uint16_t packetId = qos > 0 ? allocatePacketId() : 0;
+  size_t encoded = mqttEncodePublish(slot.packet, sizeof(slot.packet), topic, strlen(topic),
+                                     payload, length, qos, packetId, false);
+  if (encoded == 0) {
+    counters.rejected++;
+    return false;
+  }
+
+  slot.length = (uint16_t)encoded;
+  slot.payloadLength = (uint16_t)length;
+  slot.packetId = packetId;
+  slot.qos = qos;
+  slot.lane = lane;
+  slot.state = SLOT_QUEUED;
+  slot.resend = false;
+  slot.sequence = nextSequence++;
+  slot.enqueuedUs = nowUs;
+  slot.sentMs = 0;
+
+  lanes[lane][(laneHead[lane] + laneCount[lane]) % MQTT_OUTBOX_SLOTS] = (uint8_t)index;
+  laneCount[lane]++;
+  freeCount--;
+  return true;
+}
+
+/**
+ * Elige la siguiente ranura a escribir (ver cabecera). -1 si no hay ninguna.
+ */
+int MqttOutbox::selectNext(unsigned long nowMs) {
+  // Reenvíos pendientes, el más antiguo primero
+  int resend = -1;
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    const Slot& slot = slots[i];
+    if (slot.state != SLOT_INFLIGHT ||
+        (!slot.resend && nowMs - slot.sentMs < MQTT_RETRANSMIT_MS)) {
+      continue;
+    }
+    if (resend < 0 || slot.sequence < slots[resend].sequence) {
+      resend = (int)i;
+    }
+  }
+  if (resend >= 0) {
+    currentIsResend = true;
+    return resend;
+  }
+
+  for (size_t l = 0; l < LANE_COUNT; l++) {
+    if (laneCount[l] == 0) {
+      continue;
+    }
+
+    uint8_t index = lanes[l][laneHead[l]];
+    if (slots[index].qos > 0 && inflightCount >= MQTT_INFLIGHT_WINDOW) {
+      continue;
+    }
+
+    laneHead[l] = (laneHead[l] + 1) % MQTT_OUTBOX_SLOTS;
+    laneCount[l]--;
+    currentIsResend = false;
+    return index;
+  }
+  return -1;
+}
+
+const uint8_t* MqttOutbox::peek(unsigned long nowMs, size_t& length) {
+  if (current < 0) {
+    current = selectNext(nowMs);
+    offset = 0;
+    if (current < 0) {
+      length = 0;
+      return nullptr;
+    }
+
+    if (currentIsResend) {
+      slots[current].packet[0] |= 0x08;   // DUP
+    }
+  }
+
+  length = slots[current].length - offset;
+  return slots[current].packet + offset;
+}
+
+void MqttOutbox::consume(size_t written, unsigned long nowMs, unsigned long nowUs) {
+  if (current < 0) {
+    return;
+  }
+
+  offset += written;
+  Slot& slot = slots[current];
+  if (offset < slot.length) {
+    return;
+  }
+
+  counters.wireBytes += slot.length;
+  if (currentIsResend) {
+    counters.retransmits++;
+  } else {
+    counters.messages++;
+    counters.payloadBytes += slot.payloadLength;
+  }
+
+  if (slot.qos == 0) {
+    counters.deliveryUs[slot.lane].record((uint32_t)(nowUs - slot.enqueuedUs));
+    release(current);
+  } else {
+    if (slot.state != SLOT_INFLIGHT) {
+      slot.state = SLOT_INFLIGHT;
+      inflightCount++;
+    }
+    slot.resend = false;
+    slot.sentMs = nowMs;
+  }
+
+  current = -1;
+  offset = 0;
+}
+
+bool MqttOutbox::acknowledge(uint16_t packetId, unsigned long nowUs) {
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    Slot& slot = slots[i];
+    if (slot.state != SLOT_INFLIGHT || slot.packetId != packetId) {
+      continue;
+    }
+
+    // Un PUBACK puede llegar mientras se reenvía: el reenvío se completa igual
+    if ((int)i == current) {
+      return false;
+    }
+
+    counters.acked++;
+    counters.deliveryUs[slot.lane].record((uint32_t)(nowUs - slot.enqueuedUs));
+    inflightCount--;
+    release((int)i);
+    return true;
+  }
+  return false;
+}
+
+void MqttOutbox::release(int index) {
+  slots[index].state = SLOT_FREE;
+  freeCount++;
+}
+
+void MqttOutbox::resumeSession() {
+  // Un paquete a medio escribir se pierde con la conexión: vuelve a empezar
+  if (current >= 0) {
+    Slot& slot = slots[current];
+    if (slot.state == SLOT_QUEUED) {
+      MqttLane lane = slot.lane;
+      laneHead[lane] = (laneHead[lane] + MQTT_OUTBOX_SLOTS - 1) % MQTT_OUTBOX_SLOTS;
+      lanes[lane][laneHead[lane]] = (uint8_t)current;
+      laneCount[lane]++;
+    }
+    current = -1;
+    offset = 0;
+  }
+
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state == SLOT_INFLIGHT) {
+      slots[i].resend = true;
+    }
+  }
+}
+
+size_t MqttOutbox::queued() const {
+  return MQTT_OUTBOX_SLOTS - freeCount;
+}
+
+size_t MqttOutbox::room(MqttLane lane) const {
+  size_t reserve = lane == LANE_TELEMETRY ? MQTT_OUTBOX_RESERVED : 0;
+  return freeCount > reserve ? freeCount - reserve : 0;
+}
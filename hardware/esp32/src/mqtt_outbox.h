@@ -0,0 +1,109 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "latency_histogram.h"
+
+/**
+ * Cola de salida MQTT con carriles de prioridad y ventana QoS1.
+ *
+ * Cada mensaje se codifica como PUBLISH completo en una ranura fija al
+ * encolarlo (el llamador puede reutilizar su buffer). El transporte pide
+ * los bytes con peek()/consume(), que admiten escrituras parciales:
+ *
+ *   1. PUBLISH QoS1 sin PUBACK tras MQTT_RETRANSMIT_MS (o tras reconectar),
+ *      reenviados con DUP en su orden original
+ *   2. el primero del carril de mayor prioridad con mensajes, siempre que
+ *      haya hueco en la ventana si es QoS1
+ *
+ * Un PUBLISH QoS0 libera su ranura al escribirse; uno QoS1 la mantiene
+ * hasta su PUBACK. Sin memoria dinámica; portable (compila en el host).
+ */
+
+// Carriles, de mayor a menor prioridad
+enum MqttLane : uint8_t {
+  LANE_STATUS,       // TOPIC_ESTADO
+  LANE_ALERTS,       // TOPIC_ALERTAS
+  LANE_TELEMETRY,    // Lecturas y lotes
+  LANE_COUNT
+};
+
+struct OutboxStats {
+  uint32_t messages;          // PUBLISH escritos por primera vez
+  uint32_t payloadBytes;
+  uint32_t wireBytes;         // Bytes de PUBLISH escritos, reenvíos incluidos
+  uint32_t acked;             // PUBACK recibidos
+  uint32_t retransmits;
+  uint32_t rejected;          // Sin ranura libre (el llamador conserva el mensaje)
+  // Encolado -> PUBACK (QoS1) o -> escrito en el enlace (QoS0), en us
+  LatencyHistogram deliveryUs[LANE_COUNT];
+};
+
+class MqttOutbox {
+public:
+  MqttOutbox();
+
+  // Copia el mensaje. false si no hay ranura o no cabe en MQTT_BUFFER_SIZE.
+  bool enqueue(MqttLane lane, const char* topic, const uint8_t* payload, size_t length,
+               uint8_t qos, unsigned long nowUs);
+
+  // Bytes pendientes del paquete en curso; elige el siguiente si no hay
+  const uint8_t* peek(unsigned long nowMs, size_t& length);
+  void consume(size_t written, unsigned long nowMs, unsigned long nowUs);
+
+  // Libera el PUBLISH con ese identificador. false si no estaba en vuelo.
+  bool acknowledge(uint16_t packetId, unsigned long nowUs);
+
+  // Nueva sesión: reenviar todo lo que esté en vuelo antes que lo nuevo
+  void resumeSession();
+
+  // Hay un paquete a medio escribir (no intercalar paquetes de control)
+  bool transmitting() const { return current >= 0 && offset > 0; }
+  size_t queued() const;
+  // Mensajes que el carril aún puede encolar
+  size_t room(MqttLane lane) const;
+  size_t inFlight() const { return inflightCount; }
+  const OutboxStats& stats() const { return counters; }
+
+private:
+  enum SlotState : uint8_t {
+    SLOT_FREE,
+    SLOT_QUEUED,       // En su carril, sin enviar
+    SLOT_INFLIGHT      // QoS1 escrito, esperando PUBACK
+  };
+
+  struct Slot {
+    uint8_t packet[MQTT_BUFFER_SIZE];
+    uint16_t length;
+    uint16_t payloadLength;
+    uint16_t packetId;
+    uint8_t qos;
+    MqttLane lane;
+    SlotState state;
+    bool resend;                 // Reenviar en cuanto sea posible
+    uint32_t sequence;           // Orden de encolado
+    unsigned long enqueuedUs;
+    unsigned long sentMs;
+  };
+
+  int selectNext(unsigned long nowMs);
+  uint16_t allocatePacketId();
+  void release(int index);
+
+  Slot slots[MQTT_OUTBOX_SLOTS];
+  uint8_t lanes[LANE_COUNT][MQTT_OUTBOX_SLOTS];   // FIFO de índices de ranura
+  uint8_t laneHead[LANE_COUNT];
+  uint8_t laneCount[LANE_COUNT];
+  size_t freeCount;
+  size_t inflightCount;
+  int current;                   // Ranura en transmisión (-1 = ninguna)
+  size_t offset;                 // Bytes ya escritos de la ranura en curso
+  bool currentIsResend;
+  uint16_t nextPacketId;
+  uint32_t nextSequence;
+  OutboxStats counters;
+};
+
+#endif // MQTT_OUTBOX_H
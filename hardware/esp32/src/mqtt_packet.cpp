@@ -0,0 +1,353 @@
+#include "mqtt_packet.h"
+#include <string.h>
+
+#define MQTT_PROTOCOL_LEVEL 4          // MQTT 3.1.1
+#define MQTT_MAX_REMAINING 268435455u  // 4 bytes de longitud variable
+
+// ============================================
+// ESCRITURA
+// ============================================
+
+static size_t remainingLengthBytes(size_t remaining) {
+  return remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4;
+}
+
+/**
+ * Escribe la cabecera fija. Retorna su longitud, o 0 si el paquete
+ * completo (cabecera + remaining) no cabe.
+ */
+static size_t writeFixedHeader(uint8_t* out, size_t capacity, uint8_t first, size_t remaining) {
+  if (remaining > MQTT_MAX_REMAINING) {
+    return 0;
+  }
+
+  size_t header = 1 + remainingLengthBytes(remaining);
+  if (header + remaining > capacity) {
+    return 0;
+  }
+
+  out[0] = first;
+  size_t i = 1;
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    out[i++] = remaining > 0 ? (digit | 0x80) : digit;
+  } while (remaining > 0);
+
+  return header;
+}
+
+static size_t writeU16(uint8_t* out, uint16_t value) {
+  out[0] = value >> 8;
+  out[1] = value & 0xFF;
+  return 2;
+}
+
+static size_t writeString(uint8_t* out, const char* text, size_t length) {
+  writeU16(out, (uint16_t)length);
+  memcpy(out + 2, text, length);
+  return 2 + length;
+}
+
+size_t mqttPublishSize(size_t topicLength, size_t payloadLength, uint8_t qos) {
+  size_t remaining = 2 + topicLength + (qos > 0 ? 2 : 0) + payloadLength;
+  return 1 + remainingLengthBytes(remaining) + remaining;
+}
+
+static size_t subscribeRemaining(const char* const* filters, size_t count) {
+  size_t remaining = 2;
+  for (size_t f = 0; f < count; f++) {
+    remaining += 2 + strlen(filters[f]) + 1;
+  }
+  return remaining;
+}
+
+size_t mqttSubscribeSize(const char* const* filters, size_t count) {
+  size_t remaining = subscribeRemaining(filters, count);
+  return 1 + remainingLengthBytes(remaining) + remaining;
+}
+
+size_t mqttEncodeConnect(uint8_t* out, size_t capacity, const char* clientId,
+                         uint16_t keepAliveS, bool cleanSession) {
+  size_t idLength = strlen(clientId);
+  if (idLength > 0xFFFF) {
+    return 0;
+  }
+
+  size_t remaining = 10 + 2 + idLength;
+  size_t i = writeFixedHeader(out, capacity, MQTT_CONNECT << 4, remaining);
+  if (i == 0) {
+    return 0;
+  }
+
+  i += writeString(out + i, "MQTT", 4);
+  out[i++] = MQTT_PROTOCOL_LEVEL;
+  out[i++] = cleanSession ? 0x02 : 0x00;
+  i += writeU16(out + i, keepAliveS);
+  i += writeString(out + i, clientId, idLength);
+  return i;
+}
+
+size_t mqttEncodeConnack(uint8_t* out, size_t capacity, uint8_t returnCode) {
+  size_t i = writeFixedHeader(out, capacity, MQTT_CONNACK << 4, 2);
+  if (i == 0) {
+    return 0;
+  }
+
+  out[i++] = 0;            // Sin sesión previa
+  out[i++] = returnCode;
+  return i;
+}
+
+size_t mqttEncodePublish(uint8_t* out, size_t capacity,
+                         const char* topic, size_t topicLength,
+                         const uint8_t* payload, size_t payloadLength,
+                         uint8_t qos, uint16_t packetId, bool dup) {
+  if (topicLength > 0xFFFF || qos > 1) {
+    return 0;
+  }
+
+  uint8_t first = (MQTT_PUBLISH << 4) | (dup ? 0x08 : 0) | (qos << 1);
+  size_t remaining = 2 + topicLength + (qos > 0 ? 2 : 0) + payloadLength;
+  size_t i = writeFixedHeader(out, capacity, first, remaining);
+  if (i == 0) {
+    return 0;
+  }
+
+  i += writeString(out + i, topic, topicLength);
+  if (qos > 0) {
+    i += writeU16(out + i, packetId);
+  }
+  memcpy(out + i, payload, payloadLength);
+  return i + payloadLength;
+}
+
+size_t mqttEncodeSubscribe(uint8_t* out, size_t capacity, uint16_t packetId,
+                           const char* const* filters, size_t count, uint8_t qos) {
+  size_t remaining = subscribeRemaining(filters, count);
+
+  // SUBSCRIBE lleva los bits reservados 0010
+  size_t i = writeFixedHeader(out, capacity, (MQTT_SUBSCRIBE << 4) | 0x02, remaining);
+  if (i == 0) {
+    return 0;
+  }
+
+  i += writeU16(out + i, packetId);
+  for (size_t f = 0; f < count; f++) {
+    i += writeString(out + i, filters[f], strlen(filters[f]));
+    out[i++] = qos;
+  }
+  return i;
+}
+
+size_t mqttEncodeSuback(uint8_t* out, size_t capacity, uint16_t packetId,
+                        const uint8_t* granted, size_t count) {
+  size_t i = writeFixedHeader(out, capacity, MQTT_SUBACK << 4, 2 + count);
+  if (i == 0) {
+    return 0;
+  }
+
+  i += writeU16(out + i, packetId);
+  memcpy(out + i, granted, count);
+  return i + count;
+}
+
+size_t mqttEncodeAck(uint8_t* out, size_t capacity, MqttPacketType type, uint16_t packetId) {
+  size_t i = writeFixedHeader(out, capacity, type << 4, 2);
+  if (i == 0) {
+    return 0;
+  }
+  return i + writeU16(out + i, packetId);
+}
+
+size_t mqttEncodeEmpty(uint8_t* out, size_t capacity, MqttPacketType type) {
+  return writeFixedHeader(out, capacity, type << 4, 0);
+}
+
+// ============================================
+// LECTURA
+// ============================================
+
+static bool readString(const MqttPacket& packet, size_t& offset,
+                       const char*& text, size_t& length) {
+  if (offset + 2 > packet.length) {
+    return false;
+  }
+
+  length = ((size_t)packet.body[offset] << 8) | packet.body[offset + 1];
+  if (offset + 2 + length > packet.length) {
+    return false;
+  }
+
+  text = (const char*)packet.body + offset + 2;
+  offset += 2 + length;
+  return true;
+}
+
+bool mqttParseConnect(const MqttPacket& packet, const char*& clientId,
+                      size_t& clientIdLength, uint16_t& keepAliveS) {
+  size_t offset = 0;
+  const char* protocol;
+  size_t protocolLength;
+
+  if (packet.type != MQTT_CONNECT ||
+      !readString(packet, offset, protocol, protocolLength) ||
+      offset + 4 > packet.length) {
+    return false;
+  }
+
+  // Nivel de protocolo (1 B) y flags (1 B)
+  offset += 2;
+  keepAliveS = ((uint16_t)packet.body[offset] << 8) | packet.body[offset + 1];
+  offset += 2;
+
+  return readString(packet, offset, clientId, clientIdLength);
+}
+
+bool mqttParsePublish(const MqttPacket& packet, MqttPublish& publish) {
+  if (packet.type != MQTT_PUBLISH) {
+    return false;
+  }
+
+  size_t offset = 0;
+  publish.qos = (packet.flags >> 1) & 0x03;
+  publish.retain = (packet.flags & 0x01) != 0;
+  publish.dup = (packet.flags & 0x08) != 0;
+  publish.packetId = 0;
+
+  if (publish.qos > 2 || !readString(packet, offset, publish.topic, publish.topicLength)) {
+    return false;
+  }
+
+  if (publish.qos > 0) {
+    if (offset + 2 > packet.length) {
+      return false;
+    }
+    publish.packetId = ((uint16_t)packet.body[offset] << 8) | packet.body[offset + 1];
+    offset += 2;
+  }
+
+  publish.payload = packet.body + offset;
+  publish.payloadLength = packet.length - offset;
+  return true;
+}
+
+bool mqttParsePacketId(const MqttPacket& packet, uint16_t& packetId) {
+  if (packet.length < 2) {
+    return false;
+  }
+
+  packetId = ((uint16_t)packet.body[0] << 8) | packet.body[1];
+  return true;
+}
+
+bool mqttNextFilter(const MqttPacket& packet, size_t& offset, const char*& filter,
+                    size_t& filterLength, uint8_t& qos) {
+  if (packet.type != MQTT_SUBSCRIBE && packet.type != MQTT_UNSUBSCRIBE) {
+    return false;
+  }
+
+  if (offset == 0) {
+    offset = 2;   // Packet ID
+  }
+
+  if (offset >= packet.length || !readString(packet, offset, filter, filterLength)) {
+    return false;
+  }
+
+  qos = 0;
+  if (packet.type == MQTT_SUBSCRIBE) {
+    if (offset >= packet.length) {
+      return false;
+    }
+    qos = packet.body[offset++] & 0x03;
+  }
+  return true;
+}
+
+bool mqttTopicMatches(const char* filter, size_t filterLength,
+                      const char* topic, size_t topicLength) {
+  size_t f = 0;
+  size_t t = 0;
+
+  while (f < filterLength) {
+    if (filter[f] == '#') {
+      return true;
+    }
+
+    if (filter[f] == '+') {
+      while (t < topicLength && topic[t] != '/') {
+        t++;
+      }
+      f++;
+    } else {
+      if (t >= topicLength || filter[f] != topic[t]) {
+        // "a/#" también coincide con "a"
+        return t == topicLength && f + 2 == filterLength &&
+               filter[f] == '/' && filter[f + 1] == '#';
+      }
+      f++;
+      t++;
+    }
+  }
+
+  return t == topicLength;
+}
+
+// ============================================
+// SEPARACIÓN DE PAQUETES
+// ============================================
+
+MqttFrameReader::MqttFrameReader(uint8_t* buffer, size_t capacity)
+  : buffer(buffer), capacity(capacity), start(0), end(0) {
+}
+
+uint8_t* MqttFrameReader::space() {
+  if (start > 0) {
+    memmove(buffer, buffer + start, end - start);
+    end -= start;
+    start = 0;
+  }
+  return buffer + end;
+}
+
+MqttFrameStatus MqttFrameReader::next(MqttPacket& packet) {
+  size_t available = end - start;
+  if (available < 2) {
+    return MQTT_FRAME_NEED_MORE;
+  }
+
+  const uint8_t* p = buffer + start;
+  size_t remaining = 0;
+  size_t multiplier = 1;
+  size_t i = 1;
+
+  for (;;) {
+    if (i >= available) {
+      return MQTT_FRAME_NEED_MORE;
+    }
+    if (i > 4) {
+      return MQTT_FRAME_ERROR;
+    }
+
+    remaining += (p[i] & 0x7F) * multiplier;
+    multiplier *= 128;
+    if ((p[i++] & 0x80) == 0) {
+      break;
+    }
+  }
+
+  if (i + remaining > capacity) {
+    return MQTT_FRAME_ERROR;
+  }
+  if (i + remaining > available) {
+    return MQTT_FRAME_NEED_MORE;
+  }
+
+  packet.type = p[0] >> 4;
+  packet.flags = p[0] & 0x0F;
+  packet.body = p + i;
+  packet.length = remaining;
+  start += i + remaining;
+  return MQTT_FRAME_OK;
+}
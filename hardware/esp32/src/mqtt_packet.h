@@ -0,0 +1,118 @@
+#ifndef MQTT_PACKET_H
+#define MQTT_PACKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Codificación y decodificación de paquetes MQTT 3.1.1 sobre buffers fijos.
+ *
+ * Sin memoria dinámica ni dependencias de Arduino: lo usan las herramientas
+ * del host (generador de carga, broker local, ingesta) y puede usarlo el
+ * firmware. Las funciones de codificación retornan la longitud escrita, o 0
+ * si el paquete no cabe en el buffer.
+ */
+
+enum MqttPacketType : uint8_t {
+  MQTT_CONNECT = 1,
+  MQTT_CONNACK = 2,
+  MQTT_PUBLISH = 3,
+  MQTT_PUBACK = 4,
+  MQTT_SUBSCRIBE = 8,
+  MQTT_SUBACK = 9,
+  MQTT_UNSUBSCRIBE = 10,
+  MQTT_UNSUBACK = 11,
+  MQTT_PINGREQ = 12,
+  MQTT_PINGRESP = 13,
+  MQTT_DISCONNECT = 14
+};
+
+// Paquete completo: el cuerpo apunta al buffer del lector
+struct MqttPacket {
+  uint8_t type;
+  uint8_t flags;          // 4 bits bajos de la cabecera fija
+  const uint8_t* body;    // Cabecera variable + payload
+  size_t length;          // Longitud restante
+};
+
+struct MqttPublish {
+  const char* topic;      // Sin terminador
+  size_t topicLength;
+  const uint8_t* payload;
+  size_t payloadLength;
+  uint16_t packetId;      // 0 en QoS0
+  uint8_t qos;
+  bool retain;
+  bool dup;
+};
+
+// Tamaño en el cable de un PUBLISH (cabecera fija incluida)
+size_t mqttPublishSize(size_t topicLength, size_t payloadLength, uint8_t qos);
+
+// Tamaño en el cable de un SUBSCRIBE con esos filtros
+size_t mqttSubscribeSize(const char* const* filters, size_t count);
+
+size_t mqttEncodeConnect(uint8_t* out, size_t capacity, const char* clientId,
+                         uint16_t keepAliveS, bool cleanSession);
+size_t mqttEncodeConnack(uint8_t* out, size_t capacity, uint8_t returnCode);
+size_t mqttEncodePublish(uint8_t* out, size_t capacity,
+                         const char* topic, size_t topicLength,
+                         const uint8_t* payload, size_t payloadLength,
+                         uint8_t qos, uint16_t packetId, bool dup);
+size_t mqttEncodeSubscribe(uint8_t* out, size_t capacity, uint16_t packetId,
+                           const char* const* filters, size_t count, uint8_t qos);
+size_t mqttEncodeSuback(uint8_t* out, size_t capacity, uint16_t packetId,
+                        const uint8_t* granted, size_t count);
+size_t mqttEncodeAck(uint8_t* out, size_t capacity, MqttPacketType type, uint16_t packetId);
+size_t mqttEncodeEmpty(uint8_t* out, size_t capacity, MqttPacketType type);
+
+bool mqttParseConnect(const MqttPacket& packet, const char*& clientId,
+                      size_t& clientIdLength, uint16_t& keepAliveS);
+bool mqttParsePublish(const MqttPacket& packet, MqttPublish& publish);
+bool mqttParsePacketId(const MqttPacket& packet, uint16_t& packetId);
+
+/**
+ * Recorre los filtros de un SUBSCRIBE. offset empieza en 0 y avanza con
+ * cada filtro; retorna false al terminar o si el paquete está mal formado.
+ */
+bool mqttNextFilter(const MqttPacket& packet, size_t& offset, const char*& filter,
+                    size_t& filterLength, uint8_t& qos);
+
+// Coincidencia de un topic con un filtro con comodines '+' y '#'
+bool mqttTopicMatches(const char* filter, size_t filterLength,
+                      const char* topic, size_t topicLength);
+
+enum MqttFrameStatus : uint8_t {
+  MQTT_FRAME_OK,
+  MQTT_FRAME_NEED_MORE,
+  MQTT_FRAME_ERROR        // Longitud mal formada o paquete mayor que el buffer
+};
+
+/**
+ * Separa paquetes de un flujo TCP sobre un buffer del llamador.
+ *
+ *   recv(fd, reader.space(), reader.room(), 0) -> reader.commit(n)
+ *   while (reader.next(packet) == MQTT_FRAME_OK) { ... }
+ *
+ * Los paquetes apuntan al buffer y son válidos hasta la siguiente llamada
+ * a space(), que compacta los bytes pendientes al inicio.
+ */
+class MqttFrameReader {
+public:
+  MqttFrameReader(uint8_t* buffer, size_t capacity);
+
+  uint8_t* space();
+  size_t room() const { return capacity - end; }
+  void commit(size_t length) { end += length; }
+  void reset() { start = 0; end = 0; }
+
+  MqttFrameStatus next(MqttPacket& packet);
+
+private:
+  uint8_t* buffer;
+  size_t capacity;
+  size_t start;
+  size_t end;
+};
+
+#endif // MQTT_PACKET_H
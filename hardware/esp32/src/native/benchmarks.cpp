@@ -0,0 +1,1215 @@
+#include "benchmarks.h"
+#include "hal_native.h"
+#include "tls_host.h"
+#include "../config.h"
+#include "../app.h"
+#include "../actuator_registry.h"
+#include "../adc_filter.h"
+#include "../mqtt_client.h"
+#include "../connectivity.h"
+#include "../payload_codec.h"
+#include "../rule_engine.h"
+#include "../storage_backend.h"
+#include "../telemetry_log.h"
+#include "../window_stats.h"
+#include "../sampling_scheduler.h"
+#include "../diagnostics.h"
+#include "../logger.h"
+#include "../fleet/local_broker.h"
+#include <algorithm>
+#include <math.h>
+#include <chrono>
+#include <new>
+#include <openssl/ssl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/**
+ * Suite de benchmarks sobre la lógica real del firmware (env:native).
+ *
+ * Mide serialización, despacho de comandos, duración de cada iteración
+ * del loop y uso de memoria dinámica. Los tiempos son de reloj real; la
+ * lógica corre con el reloj virtual de la HAL nativa para simular horas
+ * de funcionamiento en segundos. Una asignación dinámica en régimen
+ * permanente se considera regresión (el firmware no debe fragmentar el heap).
+ */
+
+// ============================================
+// CONTADORES DE HEAP
+// ============================================
+#define HEAP_HEADER 16   // Mantiene la alineación de malloc
+
+HeapCounters heap = { 0, 0, 0, 0, 0 };
+
+const HeapCounters& heapCounters() {
+  return heap;
+}
+
+void* operator new(size_t size) {
+  uint8_t* block = (uint8_t*)malloc(size + HEAP_HEADER);
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  memcpy(block, &size, sizeof(size));
+  heap.allocations++;
+  heap.bytes += size;
+  heap.liveBytes += size;
+  if (heap.liveBytes > heap.peakBytes) {
+    heap.peakBytes = heap.liveBytes;
+  }
+  return block + HEAP_HEADER;
+}
+
+void operator delete(void* ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  uint8_t* block = (uint8_t*)ptr - HEAP_HEADER;
+  size_t size;
+  memcpy(&size, block, sizeof(size));
+  heap.frees++;
+  heap.liveBytes -= size;
+  free(block);
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+  operator delete(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  operator delete(ptr);
+}
+
+// ============================================
+// MEDICIÓN
+// ============================================
+typedef std::chrono::steady_clock BenchClock;
+
+volatile size_t benchSink = 0;   // Evita que el compilador descarte resultados
+bool regression = false;
+
+static double elapsedNs(BenchClock::time_point start) {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    BenchClock::now() - start).count();
+}
+
+static void report(const char* name, double nsPerOp, size_t bytes, uint64_t allocations,
+                   size_t iterations) {
+  printf("%-32s %10.1f ns/op %6u B %8.3f allocs/op\n", name, nsPerOp,
+         (unsigned)bytes, (double)allocations / iterations);
+}
+
+static SensorData sampleReading(size_t i) {
+  SensorData data = SensorData();
+  data.temperatura = 24.5f + (i % 7) * 0.1f;
+  data.humedad = 61.2f + (i % 5) * 0.2f;
+  data.humedadSuelo = 38.0f + (i % 3) * 0.5f;
+  data.luminosidad = 72.4f;
+  data.valid = true;
+  data.timestamp = 30000UL * i;
+  return data;
+}
+
+// La misma lectura con el resumen de la ventana de muestreo de cada métrica
+static SensorData sampleWindowedReading(size_t i) {
+  SensorData data = sampleReading(i);
+  const float values[SENSOR_METRIC_COUNT] = {
+    data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+  };
+  const uint32_t counts[SENSOR_METRIC_COUNT] = { 6, 6, 300, 300 };
+  for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+    data.window[m].min = values[m] - 0.4f;
+    data.window[m].max = values[m] + 0.6f;
+    data.window[m].mean = values[m] + 0.05f;
+    data.window[m].stddev = 0.21f;
+    data.window[m].count = counts[m];
+  }
+  return data;
+}
+
+// ============================================
+// SERIALIZACIÓN
+// ============================================
+static void benchSingleReading(const char* name, PayloadCodec codec, size_t iterations,
+                               bool windowed = false) {
+  uint8_t buffer[512];
+  size_t length = 0;
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    length = encodeSensorData(codec, windowed ? sampleWindowedReading(i) : sampleReading(i),
+                              buffer, sizeof(buffer));
+    benchSink += length;
+  }
+
+  report(name, elapsedNs(start) / iterations, length, heap.allocations - allocations, iterations);
+}
+
+static void benchBatch(const char* name, PayloadCodec codec, size_t iterations) {
+  uint8_t buffer[MQTT_BUFFER_SIZE];
+  BatchEncoder encoder;
+  size_t length = 0;
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    encoder.begin(codec, buffer, sizeof(buffer));
+    for (size_t s = 0; s < TELEMETRY_BATCH_SIZE; s++) {
+      encoder.add(sampleReading(i + s));
+    }
+    length = encoder.finish();
+    benchSink += length;
+  }
+
+  report(name, elapsedNs(start) / iterations, length, heap.allocations - allocations, iterations);
+}
+
+/**
+ * Lecturas que caben en un PUBLISH de MQTT_BUFFER_SIZE con cada códec
+ * (el lote real lo limita TELEMETRY_BATCH_SIZE)
+ */
+static void benchBatchCapacity() {
+  static const PayloadCodec codecs[] = { CODEC_JSON, CODEC_CBOR, CODEC_SERIES };
+  static const char* const names[] = { "JSON", "CBOR", "series" };
+  uint8_t buffer[MQTT_BUFFER_SIZE];
+  BatchEncoder encoder;
+
+  printf("  lecturas por PUBLISH de %u B:", (unsigned)sizeof(buffer));
+  for (size_t c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++) {
+    encoder.begin(codecs[c], buffer, sizeof(buffer));
+    size_t count = 0;
+    while (encoder.add(sampleReading(count))) {
+      count++;
+    }
+    printf(" %s %u", names[c], (unsigned)count);
+  }
+  printf("\n");
+}
+
+static void benchAlerts(const char* name, PayloadCodec codec, size_t iterations) {
+  const Alert alerts[3] = {
+    { ALERT_TEMPERATURA, SEVERITY_CRITICAL, "Temperatura muy alta", 36.4f },
+    { ALERT_HUMEDAD_SUELO, SEVERITY_WARNING, "Suelo muy seco", 18.5f },
+    { ALERT_LUMINOSIDAD, SEVERITY_INFO, "Poca luz detectada", 12.0f }
+  };
+  uint8_t buffer[384];
+  size_t length = 0;
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    length = encodeAlerts(codec, 30000UL * i, alerts, 3, buffer, sizeof(buffer));
+    benchSink += length;
+  }
+
+  report(name, elapsedNs(start) / iterations, length, heap.allocations - allocations, iterations);
+}
+
+// ============================================
+// COMPRESIÓN DE SERIES
+// ============================================
+#define SERIES_BENCH_BLOCK TELEMETRY_BATCH_CAPACITY   // Lecturas por lote
+#define SERIES_BENCH_BUFFER 4096                      // Cabe un lote JSON completo
+#define SERIES_RAW_BYTES 20                           // Timestamp u32 + 4 floats
+#define ESP32_CPU_MHZ 240
+
+struct SeriesCheck {
+  const SensorData* expected;
+  size_t next;
+  size_t count;
+  size_t mismatches;
+};
+
+static bool sameAtHundredths(float a, float b) {
+  return fabsf(a - b) <= 0.0051f;
+}
+
+static void checkSeriesSample(const SensorData& data, void* context) {
+  SeriesCheck* check = (SeriesCheck*)context;
+  if (check->next >= check->count) {
+    check->mismatches++;
+    return;
+  }
+
+  const SensorData& e = check->expected[check->next++];
+  if (data.timestamp != e.timestamp || !sameAtHundredths(data.temperatura, e.temperatura) ||
+      !sameAtHundredths(data.humedad, e.humedad) ||
+      !sameAtHundredths(data.humedadSuelo, e.humedadSuelo) ||
+      !sameAtHundredths(data.luminosidad, e.luminosidad)) {
+    check->mismatches++;
+  }
+}
+
+// Bytes de las lecturas codificadas en lotes de SERIES_BENCH_BLOCK
+static size_t encodedBytes(PayloadCodec codec, const SensorData* readings, size_t count) {
+  static uint8_t buffer[SERIES_BENCH_BUFFER];
+  BatchEncoder encoder;
+  size_t total = 0;
+
+  for (size_t first = 0; first < count; first += SERIES_BENCH_BLOCK) {
+    encoder.begin(codec, buffer, sizeof(buffer));
+    for (size_t i = first; i < count && i < first + SERIES_BENCH_BLOCK; i++) {
+      encoder.add(readings[i]);
+    }
+    total += encoder.finish();
+  }
+  return total;
+}
+
+bool reportSeriesCompression(const char* name, const SensorData* readings, size_t count) {
+  static uint8_t buffer[SERIES_BENCH_BUFFER];
+  BatchEncoder encoder;
+  size_t bytes = 0;
+  size_t mismatches = 0;
+  uint64_t encodeCycles = 0;
+  double encodeNs = 0, decodeNs = 0;
+  uint64_t allocations = heap.allocations;
+
+  for (size_t first = 0; first < count; first += SERIES_BENCH_BLOCK) {
+    size_t block = count - first < SERIES_BENCH_BLOCK ? count - first : SERIES_BENCH_BLOCK;
+
+    BenchClock::time_point start = BenchClock::now();
+    uint32_t cycles = halCycles();
+    encoder.begin(CODEC_SERIES, buffer, sizeof(buffer));
+    for (size_t i = 0; i < block; i++) {
+      encoder.add(readings[first + i]);
+    }
+    size_t length = encoder.finish();
+    encodeCycles += halCycles() - cycles;
+    encodeNs += elapsedNs(start);
+    bytes += length;
+
+    SeriesCheck check = { readings + first, 0, block, 0 };
+    start = BenchClock::now();
+    bool ok = decodeTelemetrySeries(buffer, length, nullptr, 0, checkSeriesSample, &check);
+    decodeNs += elapsedNs(start);
+    mismatches += check.mismatches + (check.next == block && ok ? 0 : block - check.next + 1);
+  }
+
+  char label[48];
+  snprintf(label, sizeof(label), "series/%s", name);
+  report(label, encodeNs / count, bytes, heap.allocations - allocations, count);
+
+  size_t json = encodedBytes(CODEC_JSON, readings, count);
+  size_t cbor = encodedBytes(CODEC_CBOR, readings, count);
+  double cyclesPerSample = (double)encodeCycles / count;
+  printf("  %u lecturas, %.2f B/lectura: x%.1f frente a bruto (%u B/lectura),"
+         " x%.1f frente a JSON, x%.1f frente a CBOR\n", (unsigned)count,
+         (double)bytes / count, (double)SERIES_RAW_BYTES * count / bytes,
+         (unsigned)SERIES_RAW_BYTES, (double)json / bytes, (double)cbor / bytes);
+  printf("  codificación %.0f ciclos/lectura (%.1f us a %u MHz con los mismos ciclos),"
+         " decodificación %.0f ns/lectura\n", cyclesPerSample,
+         cyclesPerSample / ESP32_CPU_MHZ, (unsigned)ESP32_CPU_MHZ, decodeNs / count);
+
+  if (mismatches > 0) {
+    printf("  ERROR: %u lecturas no se decodifican igual\n", (unsigned)mismatches);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Trazas sintéticas: deriva lenta a cadencia fija y un día de invernadero
+ * (ciclo de temperatura, humedad y luz con la resolución del DHT22 y ruido
+ * del ADC en suelo y luz, con una lectura retrasada de vez en cuando)
+ */
+static void benchSeries() {
+  static SensorData readings[2880];
+  const size_t count = sizeof(readings) / sizeof(readings[0]);
+
+  for (size_t i = 0; i < count; i++) {
+    readings[i] = sampleReading(i);
+  }
+  if (!reportSeriesCompression("drift", readings, count)) {
+    regression = true;
+  }
+
+  uint32_t noise = 12345;
+  for (size_t i = 0; i < count; i++) {
+    float phase = 2.0f * (float)M_PI * i / count;
+    float daylight = sinf(phase - (float)M_PI / 2.0f);
+    noise = noise * 1103515245u + 12345u;
+    float jitter = ((int)((noise >> 16) % 61) - 30) / 100.0f;
+
+    SensorData& data = readings[i];
+    data = SensorData();
+    data.timestamp = 30000UL * i + (i % 97 == 0 ? 1800 : 0);
+    data.temperatura = roundf((22.0f + 8.0f * sinf(phase - 9.0f * (float)M_PI / 12.0f)) * 10) / 10;
+    data.humedad = roundf((65.0f - 15.0f * sinf(phase - 9.0f * (float)M_PI / 12.0f)) * 10) / 10;
+    data.humedadSuelo = 60.0f - 48.0f * i / count + jitter;
+    data.luminosidad = (daylight > 0 ? 2.0f + 90.0f * daylight : 2.0f) + jitter;
+    data.valid = true;
+  }
+  if (!reportSeriesCompression("greenhouse-day", readings, count)) {
+    regression = true;
+  }
+}
+
+// ============================================
+// DESPACHO DE COMANDOS
+// ============================================
+#define DISPATCH_BENCH_MAX 32
+#define DISPATCH_BENCH_ORDER 256        // Secuencia de topics sin patrón fijo
+
+/**
+ * Latencia de despacho topic -> actuador con registros generados de N
+ * relays ("rele00".."releNN"), construidos con las mismas funciones que
+ * ACTUATOR_DISPATCH. Como referencia, la búsqueda lineal por strcmp que
+ * el hash perfecto sustituye: el coste de la primera no debe crecer con N.
+ */
+template <size_t N>
+static void benchTopicLookup(size_t iterations) {
+  static char topics[N][48];
+  static ActuatorInfo registry[N];
+  static size_t lengths[N];
+  static uint8_t order[DISPATCH_BENCH_ORDER];
+
+  for (size_t i = 0; i < N; i++) {
+    lengths[i] = snprintf(topics[i], sizeof(topics[i]), TOPIC_ACTUADORES_PREFIX "rele%02u",
+                          (unsigned)i);
+    const char* suffix = topics[i] + ACTUATOR_PREFIX_LENGTH;
+    registry[i] = { topics[i], suffix, (uint8_t)strlen(suffix), (uint8_t)i, suffix };
+  }
+  uint32_t lcg = 12345;
+  for (size_t i = 0; i < DISPATCH_BENCH_ORDER; i++) {
+    lcg = lcg * 1103515245u + 12345u;
+    order[i] = (lcg >> 16) % N;
+  }
+
+  static ActuatorDispatchTable<N> table;
+  table = buildDispatchTable(registry);
+  if (table.seed == ACTUATOR_NO_SEED) {
+    printf("  ERROR: sin semilla perfecta para %u actuadores\n", (unsigned)N);
+    regression = true;
+    return;
+  }
+
+  char label[48];
+  size_t misses = 0;
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    size_t index = order[i % DISPATCH_BENCH_ORDER];
+    size_t found = dispatchTopic(registry, table, topics[index], lengths[index]);
+    misses += found != index;
+  }
+  snprintf(label, sizeof(label), "dispatch/topic-lookup-%u", (unsigned)N);
+  report(label, elapsedNs(start) / iterations, sizeof(table), heap.allocations - allocations,
+         iterations);
+
+  start = BenchClock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    const char* topic = topics[order[i % DISPATCH_BENCH_ORDER]];
+    size_t found = N;
+    for (size_t a = 0; a < N && found == N; a++) {
+      if (strcmp(topic, registry[a].topic) == 0) {
+        found = a;
+      }
+    }
+    benchSink += found;
+  }
+  snprintf(label, sizeof(label), "dispatch/linear-scan-%u", (unsigned)N);
+  report(label, elapsedNs(start) / iterations, 0, 0, iterations);
+
+  if (misses > 0) {
+    printf("  ERROR: %u topics despachados a otro actuador\n", (unsigned)misses);
+    regression = true;
+  }
+}
+
+static void benchCommandParse(size_t iterations) {
+  static const char on[] = "{\"state\":\"on\"}";
+  static const char off[] = "{\"state\":\"off\"}";
+  double totalNs = 0;
+  uint64_t allocations = heap.allocations;
+
+  for (size_t i = 0; i < iterations; i += COMMAND_QUEUE_LEN) {
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t c = 0; c < COMMAND_QUEUE_LEN; c++) {
+      const char* payload = (c & 1) ? off : on;
+      handleActuatorCommand(ACTUATORS[c % ACTUATOR_COUNT].topic,
+                            (const uint8_t*)payload, strlen(payload));
+    }
+    totalNs += elapsedNs(start);
+
+    // Vaciar la cola de comandos y el registro fuera de la medición
+    appAcquisitionStep();
+    logDrain(LOG_RING_SIZE);
+  }
+
+  report("dispatch/parse+enqueue", totalNs / iterations, 0,
+         heap.allocations - allocations, iterations);
+}
+
+/**
+ * Mensaje entrante -> relay conmutado: lectura del enlace, PUBACK, callback
+ * MQTT, parseo, cola SPSC y aplicación en la tarea de adquisición
+ */
+static void benchCommandRoundTrip(size_t iterations) {
+  const ActuatorInfo& info = ACTUATORS[ACTUATOR_LUCES];
+  uint64_t allocations = heap.allocations;
+  size_t missed = 0;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    bool state = (i & 1) == 0;
+    const char* payload = state ? "{\"state\":true}" : "{\"state\":false}";
+    nativeMqttInject(info.topic, (const uint8_t*)payload, strlen(payload));
+    mqttLoop();
+    appAcquisitionStep();
+
+    // Relays activos en LOW
+    if (nativePinLevel(info.pin) == state) {
+      missed++;
+    }
+  }
+
+  report("dispatch/inject-to-relay", elapsedNs(start) / iterations, 0,
+         heap.allocations - allocations, iterations);
+
+  if (missed > 0) {
+    printf("  ERROR: %u comandos no llegaron al relay\n", (unsigned)missed);
+    regression = true;
+  }
+}
+
+// ============================================
+// INSTRUMENTACIÓN
+// ============================================
+#if ENABLE_DIAGNOSTICS
+static void benchDiagScope(size_t iterations) {
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    DIAG_SCOPE(DIAG_SERIALIZE);
+    benchSink += i;
+  }
+
+  report("diag/scope", elapsedNs(start) / iterations, 0,
+         heap.allocations - allocations, iterations);
+}
+
+static void benchDiagReport(size_t iterations) {
+  char json[DIAG_REPORT_SIZE];
+  size_t length = 0;
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    length = diagReportJson(json, sizeof(json));
+    benchSink += length;
+  }
+
+  report("diag/report-json", elapsedNs(start) / iterations, length,
+           heap.allocations - allocations, iterations);
+}
+#endif
+
+// ============================================
+// REGLAS
+// ============================================
+#define RULE_BENCH_MAX 256
+#define RULE_BENCH_READINGS 64
+
+/**
+ * Coste de una pasada por lectura con N reglas. Las lecturas barren cada
+ * métrica de un extremo a otro para que las reglas crucen sus umbrales y
+ * cambien de estado (con y sin permanencia mínima) durante la medición.
+ */
+static void benchRules(size_t ruleCount, size_t iterations) {
+  static Rule rules[RULE_BENCH_MAX];
+  static RuleSlot slots[RULE_BENCH_MAX];
+  static SensorData readings[RULE_BENCH_READINGS];
+  static const float low[RULE_METRIC_COUNT] = { 10.0f, 30.0f, 10.0f, 0.0f };
+  static const float span[RULE_METRIC_COUNT] = { 30.0f, 60.0f, 80.0f, 100.0f };
+
+  for (size_t i = 0; i < RULE_BENCH_READINGS; i++) {
+    // Onda triangular entre low y low + span
+    float phase = (float)(i < RULE_BENCH_READINGS / 2 ? i : RULE_BENCH_READINGS - i) /
+                  (RULE_BENCH_READINGS / 2);
+    readings[i].temperatura = low[0] + span[0] * phase;
+    readings[i].humedad = low[1] + span[1] * phase;
+    readings[i].humedadSuelo = low[2] + span[2] * (1.0f - phase);
+    readings[i].luminosidad = low[3] + span[3] * phase;
+    readings[i].valid = true;
+  }
+
+  for (size_t i = 0; i < ruleCount; i++) {
+    uint8_t metric = i % RULE_METRIC_COUNT;
+    rules[i].metric = (AlertMetric)metric;
+    rules[i].comparator = (i / RULE_METRIC_COUNT) % 2 ? RULE_BELOW : RULE_ABOVE;
+    rules[i].actuator = i % 3 == 0 ? (uint8_t)(i % ACTUATOR_COUNT) : ACTUATOR_NONE;
+    rules[i].severity = i % 2 ? (uint8_t)SEVERITY_WARNING : SEVERITY_NONE;
+    rules[i].threshold = low[metric] + span[metric] * (0.2f + 0.6f * (float)((i * 7) % 11) / 10.0f);
+    rules[i].hysteresis = span[metric] * 0.05f;
+    rules[i].dwellMs = (i % 4) * 30000UL;
+  }
+
+  RuleEngine engine(slots, ruleCount);
+  engine.load(rules, ruleCount);
+
+  Alert alerts[8];
+  size_t alertCount = 0;
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    alertCount += engine.evaluate(readings[i % RULE_BENCH_READINGS], 30000UL * i, alerts, 8);
+    benchSink += engine.demand();
+  }
+
+  double nsPerOp = elapsedNs(start) / iterations;
+  char name[32];
+  snprintf(name, sizeof(name), "rules/evaluate-%u", (unsigned)ruleCount);
+  report(name, nsPerOp, ruleCount * sizeof(RuleSlot), heap.allocations - allocations, iterations);
+  printf("  %.1f ns por regla, %.2f alertas por lectura\n", nsPerOp / ruleCount,
+         (double)alertCount / iterations);
+}
+
+// ============================================
+// REGISTRO LOCAL
+// ============================================
+/**
+ * Capacidad del registro local sobre el backend en RAM con la geometría
+ * del firmware: llenarlo tras un corte y vaciarlo en lotes de
+ * STORE_DRAIN_BURST (peek + consume). En el dispositivo el drenaje queda
+ * limitado a STORE_DRAIN_RATE lecturas/s; esto mide el margen del registro.
+ */
+static void benchTelemetryLog() {
+  RamStorageBackend backend(STORE_SECTOR_SIZE, STORE_SECTOR_COUNT);
+  TelemetryLog log;
+  log.begin(&backend);
+  size_t readings = log.capacity() - log.capacity() / STORE_SECTOR_COUNT;
+
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < readings; i++) {
+    log.append(sampleReading(i));
+  }
+  double appendNs = elapsedNs(start) / readings;
+  report("store/append", appendNs, 28, heap.allocations - allocations, readings);
+
+  SensorData batch[STORE_DRAIN_BURST];
+  size_t drained = 0;
+  allocations = heap.allocations;
+  start = BenchClock::now();
+  while (log.pending() > 0) {
+    size_t count = log.peek(batch, STORE_DRAIN_BURST);
+    log.consume(count);
+    drained += count;
+  }
+  double drainNs = elapsedNs(start) / drained;
+  report("store/drain", drainNs, sizeof(batch), heap.allocations - allocations, drained);
+  printf("  %.0f lecturas/s anexadas, %.0f lecturas/s reenviadas (%u de %u)\n",
+         1e9 / appendNs, 1e9 / drainNs, (unsigned)drained, (unsigned)readings);
+
+  if (drained != readings) {
+    printf("  ERROR: el drenaje no devolvió todas las lecturas\n");
+    regression = true;
+  }
+}
+
+// ============================================
+// VENTANAS DE MUESTREO
+// ============================================
+/**
+ * Coste por muestra de acumular los estadísticos de una ventana (lo que
+ * paga cada lectura del ADC a 10 Hz) y de cerrar la ventana en un resumen.
+ */
+static void benchWindowStats(size_t iterations) {
+  RunningStats stats;
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    stats.add(40.0f + (float)(i % 97) * 0.25f);
+  }
+  benchSink += (uint64_t)stats.mean();
+  report("stats/add", elapsedNs(start) / iterations, sizeof(RunningStats),
+         heap.allocations - allocations, iterations);
+
+  size_t windows = iterations / 300;
+  allocations = heap.allocations;
+  start = BenchClock::now();
+  for (size_t i = 0; i < windows; i++) {
+    stats.add((float)i);
+    MetricSummary summary = stats.summary();
+    benchSink += summary.count;
+    stats.reset();
+  }
+  report("stats/summary", elapsedNs(start) / windows, sizeof(MetricSummary),
+         heap.allocations - allocations, windows);
+}
+
+// ============================================
+// ADC
+// ============================================
+#define ADC_BENCH_SAMPLES 1024          // Muestras por canal de cada bloque
+
+/**
+ * Rendimiento del diezmado: bloques entrelazados de dos canales con ruido,
+ * procesados con pushBlock como en adcSamplerPoll(). Imprime muestras/s y
+ * la fracción de CPU que consumiría el ritmo de muestreo total rateHz.
+ */
+static void benchAdcDecimator(const char* name, uint16_t decimation, uint32_t rateHz,
+                              size_t blocks) {
+  static uint16_t interleaved[ADC_BENCH_SAMPLES][ADC_CHANNEL_COUNT];
+  uint32_t noise = 12345;
+  for (size_t i = 0; i < ADC_BENCH_SAMPLES; i++) {
+    for (size_t ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+      noise = noise * 1103515245u + 12345u;
+      interleaved[i][ch] = (uint16_t)(1500 + ch * 1000 + (noise >> 16) % 64);
+    }
+  }
+
+  AdcDecimator filters[ADC_CHANNEL_COUNT];
+  for (size_t ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+    filters[ch].begin(decimation, ADC_FILTER_WINDOW);
+  }
+
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t b = 0; b < blocks; b++) {
+    for (size_t ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+      filters[ch].pushBlock(&interleaved[0][ch], ADC_BENCH_SAMPLES, ADC_CHANNEL_COUNT);
+    }
+  }
+  double ns = elapsedNs(start);
+  for (size_t ch = 0; ch < ADC_CHANNEL_COUNT; ch++) {
+    benchSink += (uint64_t)filters[ch].value();
+  }
+
+  size_t samples = blocks * ADC_BENCH_SAMPLES * ADC_CHANNEL_COUNT;
+  double nsPerSample = ns / samples;
+  report(name, nsPerSample, sizeof(filters), heap.allocations - allocations, samples);
+  printf("  %.1f M muestras/s; %u Hz ocupan el %.3f %% de la CPU del host\n",
+         1000.0 / nsPerSample, (unsigned)rateHz, rateHz * nsPerSample / 1e7);
+}
+
+// ============================================
+// MUESTREO ADAPTATIVO
+// ============================================
+/**
+ * Coste de programar las lecturas tras cada una: distancia de cada métrica
+ * al umbral más cercano de las reglas cargadas, velocidad de cambio,
+ * siguiente intervalo y sensores que vencen.
+ */
+static void benchSampling(size_t iterations) {
+  static const SamplingPolicy policy = {
+    { { SAMPLING_DHT_MIN_MS, SAMPLING_DHT_MAX_MS },
+      { SAMPLING_SOIL_MIN_MS, SAMPLING_SOIL_MAX_MS },
+      { SAMPLING_LIGHT_MIN_MS, SAMPLING_LIGHT_MAX_MS } },
+    { SAMPLING_TEMP_STEP, SAMPLING_HUM_STEP, SAMPLING_SOIL_STEP, SAMPLING_LUX_STEP },
+    SAMPLING_LEAD, SAMPLING_RELEASE, SAMPLING_COALESCE
+  };
+  const RuleEngine& engine = getRuleEngine();
+  SamplingScheduler scheduler;
+  scheduler.begin(policy, 0);
+
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  unsigned long now = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    SensorData data = sampleReading(i);
+    const float values[SENSOR_METRIC_COUNT] = {
+      data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+    };
+    float distances[SENSOR_METRIC_COUNT];
+    for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+      distances[m] = engine.limitDistance((AlertMetric)m, values[m]);
+    }
+    now += 5000;
+    benchSink += scheduler.due(now);
+    scheduler.update(SENSOR_MASK_ALL, data, distances, now);
+  }
+  benchSink += scheduler.interval(SENSOR_DHT22);
+  report("sampling/schedule", elapsedNs(start) / iterations, sizeof(SamplingScheduler),
+         heap.allocations - allocations, iterations);
+}
+
+// ============================================
+// REGISTRO
+// ============================================
+#define UART_NS_PER_BYTE (10 * 1000000000.0 / SERIAL_BAUD_RATE)   // 8N1
+
+static const char* const LOG_BENCH_TOPIC = TOPIC_TELEMETRIA;
+
+/**
+ * Lo que hacía DEBUG_PRINTF: formatear en la tarea que llama y escribir
+ * (aquí en /dev/null). Con la FIFO de la UART llena, además, la llamada
+ * espera a que salga cada byte: se informa el coste modelado a SERIAL_BAUD_RATE.
+ */
+static void benchLogSync(size_t iterations) {
+  FILE* sink = fopen("/dev/null", "w");
+  char line[LOG_LINE_SIZE];
+  int length = 0;
+  uint64_t allocations = heap.allocations;
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < iterations; i++) {
+    length = snprintf(line, sizeof(line), "Encolado en %s (%u bytes)\n", LOG_BENCH_TOPIC,
+                      (unsigned)(i & 1023));
+    fwrite(line, 1, length, sink);
+  }
+  fflush(sink);
+
+  double ns = elapsedNs(start) / iterations;
+  fclose(sink);
+  report("log/sync-printf", ns, length, heap.allocations - allocations, iterations);
+  printf("%-32s %10.1f ns/op (UART a %u baudios saturada, modelo)\n", "log/sync-serial",
+         ns + length * UART_NS_PER_BYTE, (unsigned)SERIAL_BAUD_RATE);
+}
+
+static void benchLogAsync(size_t iterations) {
+  // Vaciar lo que dejaron los benchmarks anteriores
+  while (logDrain(LOG_RING_SIZE) > 0) {
+  }
+
+  uint64_t allocations = heap.allocations;
+  double enqueueNs = 0;
+  double drainNs = 0;
+  uint32_t droppedBefore = logDropped();
+
+  for (size_t i = 0; i < iterations; i += LOG_RING_SIZE) {
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t n = 0; n < LOG_RING_SIZE; n++) {
+      LOG_I(LOG_MQTT, "Encolado en %s (%u B)", LOG_BENCH_TOPIC, (unsigned)((i + n) & 1023));
+    }
+    enqueueNs += elapsedNs(start);
+
+    start = BenchClock::now();
+    logDrain(LOG_RING_SIZE);
+    drainNs += elapsedNs(start);
+  }
+
+  report("log/async-enqueue", enqueueNs / iterations, sizeof(LogRecord),
+         heap.allocations - allocations, iterations);
+  report("log/async-drain (tarea registro)", drainNs / iterations, 0, 0, iterations);
+
+  if (logDropped() != droppedBefore) {
+    printf("  ERROR: %u mensajes descartados sin llenar el anillo\n",
+           (unsigned)(logDropped() - droppedBefore));
+    regression = true;
+  }
+}
+
+static void benchLogDisabled(size_t iterations) {
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    LOG_D(LOG_MQTT, "Encolado en %s (%u B)", LOG_BENCH_TOPIC, (unsigned)i);
+    benchSink += i;
+  }
+  report("log/level-compiled-out", elapsedNs(start) / iterations, 0, 0, iterations);
+
+  logSetLevel(LOG_MQTT, LOG_WARN);
+  start = BenchClock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    LOG_I(LOG_MQTT, "Encolado en %s (%u B)", LOG_BENCH_TOPIC, (unsigned)i);
+    benchSink += i;
+  }
+  report("log/module-filtered", elapsedNs(start) / iterations, 0, 0, iterations);
+  logSetLevel(LOG_MQTT, (LogLevel)LOG_LEVEL);
+}
+
+/**
+ * Dos tareas escriben a la vez mientras esta vacía el anillo: todo mensaje
+ * se escribe o se cuenta como descartado
+ */
+static void benchLogContended(size_t perProducer) {
+  size_t written = 0;
+  uint32_t droppedBefore = logDropped();
+  std::atomic<int> running(2);
+
+  BenchClock::time_point start = BenchClock::now();
+  auto producer = [&running, perProducer](LogModule module) {
+    for (size_t i = 0; i < perProducer; i++) {
+      LOG_I(module, "Mensaje %u de %s", (unsigned)i, "productor");
+    }
+    running--;
+  };
+  std::thread first(producer, LOG_APP);
+  std::thread second(producer, LOG_NET);
+
+  while (running.load() > 0) {
+    written += logDrain(LOG_RING_SIZE);
+  }
+  first.join();
+  second.join();
+  written += logDrain(LOG_RING_SIZE);
+
+  uint32_t dropped = logDropped() - droppedBefore;
+  printf("%-32s %10.1f ns/op %u escritos, %u descartados\n", "log/2-producers",
+         elapsedNs(start) / (2 * perProducer), (unsigned)written, (unsigned)dropped);
+
+  if (written + dropped != 2 * perProducer) {
+    printf("  ERROR: se perdieron mensajes sin contarlos\n");
+    regression = true;
+  }
+}
+
+// ============================================
+// ITERACIÓN DEL LOOP
+// ============================================
+static void runLoop(unsigned long iterations, std::vector<uint32_t>* durations) {
+  for (unsigned long i = 0; i < iterations; i++) {
+    nativeAdvanceClock(LOOP_IDLE_DELAY_MS * 1000UL);
+
+    BenchClock::time_point start = BenchClock::now();
+    appAcquisitionStep();
+    appNetworkStep();
+
+    if (durations != nullptr) {
+      durations->push_back((uint32_t)elapsedNs(start));
+    }
+    logDrain(LOG_DRAIN_BATCH);
+  }
+}
+
+static void benchLoop(float simulatedHours) {
+  unsigned long iterations = (unsigned long)(simulatedHours * 3600000.0f / LOOP_IDLE_DELAY_MS);
+  std::vector<uint32_t> durations;
+  durations.reserve(iterations);
+
+  MqttStats before = getMqttStats();
+  HeapCounters heapBefore = heap;
+  BenchClock::time_point start = BenchClock::now();
+
+  runLoop(iterations, &durations);
+
+  double wallMs = elapsedNs(start) / 1e6;
+  uint64_t allocations = heap.allocations - heapBefore.allocations;
+  const MqttStats& after = getMqttStats();
+
+  std::sort(durations.begin(), durations.end());
+  double total = 0;
+  for (size_t i = 0; i < durations.size(); i++) {
+    total += durations[i];
+  }
+
+  printf("loop/iteration (%.1f h simuladas, %lu iteraciones, %.0f ms reales)\n",
+         simulatedHours, iterations, wallMs);
+  printf("  media %.0f ns  p50 %u ns  p99 %u ns  p99.9 %u ns  max %u ns\n",
+         total / durations.size(), durations[durations.size() / 2],
+         durations[durations.size() * 99 / 100], durations[durations.size() * 999 / 1000],
+         durations.back());
+  printf("  publicados %u mensajes, %u B de payload, %u B en el cable\n",
+         (unsigned)(after.messages - before.messages),
+         (unsigned)(after.payloadBytes - before.payloadBytes),
+         (unsigned)(after.wireBytes - before.wireBytes));
+  printf("  heap: %llu asignaciones durante el loop\n", (unsigned long long)allocations);
+
+  if (allocations > 0) {
+    printf("  ERROR: el loop asignó memoria dinámica en régimen permanente\n");
+    regression = true;
+  }
+}
+
+/**
+ * Ejecuta la suite completa. appSetup() ya debe haberse llamado.
+ */
+bool runBenchmarks(float simulatedHours) {
+  regression = false;
+
+  printf("== Heap tras appSetup ==\n");
+  printf("  %llu asignaciones, %lld B en uso, pico %lld B\n\n",
+         (unsigned long long)heap.allocations, (long long)heap.liveBytes,
+         (long long)heap.peakBytes);
+
+  // Calentar: filtros del ADC y primera lectura completa
+  runLoop(60000UL / LOOP_IDLE_DELAY_MS, nullptr);
+
+  printf("== Serialización ==\n");
+  benchSingleReading("codec/reading-json", CODEC_JSON, 200000);
+  benchSingleReading("codec/reading-cbor", CODEC_CBOR, 200000);
+  benchSingleReading("codec/reading-json-window", CODEC_JSON, 200000, true);
+  benchSingleReading("codec/reading-cbor-window", CODEC_CBOR, 200000, true);
+  benchBatch("codec/batch-json", CODEC_JSON, 50000);
+  benchBatch("codec/batch-cbor", CODEC_CBOR, 50000);
+  benchBatch("codec/batch-series", CODEC_SERIES, 50000);
+  benchBatchCapacity();
+  benchAlerts("codec/alerts-json", CODEC_JSON, 200000);
+  benchAlerts("codec/alerts-cbor", CODEC_CBOR, 200000);
+
+  printf("\n== Compresión de series ==\n");
+  benchSeries();
+
+  printf("\n== Despacho de comandos ==\n");
+  benchTopicLookup<4>(1000000);
+  benchTopicLookup<8>(1000000);
+  benchTopicLookup<16>(1000000);
+  benchTopicLookup<DISPATCH_BENCH_MAX>(1000000);
+  benchCommandParse(200000);
+  benchCommandRoundTrip(200000);
+
+  printf("\n== Reglas ==\n");
+  for (size_t count = 4; count <= RULE_BENCH_MAX; count *= 2) {
+    benchRules(count, 4000000 / count);
+  }
+
+  printf("\n== Registro local ==\n");
+  benchTelemetryLog();
+
+  printf("\n== Ventanas de muestreo ==\n");
+  benchWindowStats(3000000);
+  benchSampling(1000000);
+
+  printf("\n== ADC ==\n");
+  benchAdcDecimator("adc/decimate-dma", ADC_SAMPLE_RATE_HZ / ADC_CHANNEL_COUNT / ADC_OUTPUT_RATE_HZ,
+                    ADC_SAMPLE_RATE_HZ, 4000);
+  benchAdcDecimator("adc/decimate-timer", ADC_TIMER_RATE_HZ / ADC_OUTPUT_RATE_HZ,
+                    ADC_TIMER_RATE_HZ * ADC_CHANNEL_COUNT, 4000);
+
+  printf("\n== Registro ==\n");
+  benchLogSync(200000);
+  benchLogAsync(200000);
+  benchLogDisabled(1000000);
+  benchLogContended(200000);
+
+#if ENABLE_DIAGNOSTICS
+  printf("\n== Instrumentación ==\n");
+  benchDiagScope(1000000);
+  benchDiagReport(50000);
+#endif
+
+  printf("\n== Loop ==\n");
+  benchLoop(simulatedHours);
+
+  printf("\nHeap: pico %lld B, %llu asignaciones y %llu liberaciones en total\n",
+         (long long)heap.peakBytes, (unsigned long long)heap.allocations,
+         (unsigned long long)heap.frees);
+
+  return !regression;
+}
+
+// ============================================
+// TRANSPORTE MQTT
+// ============================================
+#define MQTT_BENCH_ALERT_INTERVAL_MS 100
+#define MQTT_BENCH_STATUS_INTERVAL_MS 1000
+#define MQTT_BENCH_DRAIN_MS 5000
+
+static const char* const LANE_NAMES[LANE_COUNT] = { "estado", "alertas", "telemetría" };
+
+static void printHistogram(const char* label, const LatencyHistogram& h, double scale,
+                           const char* unit) {
+  printf("  %-28s n=%-8llu p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f %s\n", label,
+         (unsigned long long)h.count(), h.percentile(0.50) / scale, h.percentile(0.99) / scale,
+         h.percentile(0.999) / scale, h.max() / scale, unit);
+}
+
+/**
+ * Cliente MQTT real contra un broker en el host: la telemetría satura la
+ * cola (lotes JSON tan rápido como se aceptan) mientras se publican
+ * alertas y estados a ritmo fijo. Mide rendimiento, latencia de entrega
+ * por carril y duración de cada llamada de la tarea de red.
+ */
+bool runMqttBenchmark(const char* host, uint16_t port, float seconds) {
+  LocalBroker broker;
+  bool localBroker = host == nullptr;
+  if (localBroker) {
+    if (!broker.start(0)) {
+      printf("No se pudo arrancar el broker local\n");
+      return false;
+    }
+    host = "127.0.0.1";
+    port = broker.port();
+  }
+
+  nativeUseBroker(host, port);
+  initMQTT();
+  connectivityBegin();
+
+  unsigned long connectStart = halMillis();
+  while (!isMQTTConnected() && halMillis() - connectStart < MQTT_CONNECT_TIMEOUT_MS) {
+    connectivityStep();
+    mqttLoop();
+    halDelay(LOOP_IDLE_DELAY_MS);
+  }
+  if (!isMQTTConnected()) {
+    printf("No se pudo conectar a %s:%u\n", host, (unsigned)port);
+    return false;
+  }
+
+  // Lote de TELEMETRY_BATCH_SIZE lecturas, como el publicador del firmware
+  uint8_t batch[MQTT_BUFFER_SIZE - 64];
+  BatchEncoder encoder;
+  encoder.begin(CODEC_JSON, batch, sizeof(batch));
+  for (size_t i = 0; i < TELEMETRY_BATCH_SIZE; i++) {
+    encoder.add(sampleReading(i));
+  }
+  size_t batchLength = encoder.finish();
+
+  Alert alert = { ALERT_TEMPERATURA, SEVERITY_CRITICAL, "Temperatura muy alta", 36.5f };
+  uint8_t alertPayload[256];
+  size_t alertLength = encodeAlerts(CODEC_JSON, 0, &alert, 1, alertPayload, sizeof(alertPayload));
+
+  LatencyHistogram stepNs;
+  uint32_t alertsRejected = 0;
+  uint32_t telemetryBackpressure = 0;
+  unsigned long nextAlert = halMillis();
+  unsigned long nextStatus = nextAlert;
+  MqttStats before = getMqttStats();
+  BenchClock::time_point start = BenchClock::now();
+  double durationNs = seconds * 1e9;
+
+  while (elapsedNs(start) < durationNs) {
+    BenchClock::time_point stepStart = BenchClock::now();
+    unsigned long now = halMillis();
+
+    mqttLoop();
+
+    if ((long)(now - nextAlert) >= 0) {
+      nextAlert += MQTT_BENCH_ALERT_INTERVAL_MS;
+      if (!publishPayload(TOPIC_ALERTAS, alertPayload, alertLength)) {
+        alertsRejected++;
+      }
+    }
+    if ((long)(now - nextStatus) >= 0) {
+      nextStatus += MQTT_BENCH_STATUS_INTERVAL_MS;
+      publishMessage(TOPIC_ESTADO, "{\"status\":\"bench\"}");
+    }
+    if (!publishPayload(TOPIC_TELEMETRIA, batch, batchLength)) {
+      telemetryBackpressure++;
+    }
+
+    stepNs.record((uint32_t)elapsedNs(stepStart));
+  }
+  double elapsedS = elapsedNs(start) / 1e9;
+
+  // Esperar los PUBACK pendientes
+  BenchClock::time_point drainStart = BenchClock::now();
+  while (getMqttStats().acked < getMqttStats().messages &&
+         elapsedNs(drainStart) < MQTT_BENCH_DRAIN_MS * 1e6) {
+    mqttLoop();
+  }
+
+  const MqttStats& after = getMqttStats();
+  uint32_t messages = after.messages - before.messages;
+  printf("== Transporte MQTT contra %s:%u (%.1f s) ==\n", host, (unsigned)port, elapsedS);
+  printf("  %u PUBLISH (%.0f msg/s), %.2f MB/s en el cable, %u PUBACK, %u reenvíos\n",
+         (unsigned)messages, messages / elapsedS,
+         (after.wireBytes - before.wireBytes) / elapsedS / 1e6,
+         (unsigned)(after.acked - before.acked),
+         (unsigned)(after.retransmits - before.retransmits));
+  printf("  telemetría frenada por la cola %u veces, alertas rechazadas %u\n",
+         (unsigned)telemetryBackpressure, (unsigned)alertsRejected);
+
+  printf("  entrega (encolado -> PUBACK):\n");
+  for (size_t l = 0; l < LANE_COUNT; l++) {
+    printHistogram(LANE_NAMES[l], after.deliveryUs[l], 1000.0, "ms");
+  }
+  printHistogram("llamada de la tarea de red", stepNs, 1000.0, "us");
+
+  if (localBroker) {
+    BrokerCounters c = broker.counters();
+    printf("  broker local: %llu PUBLISH recibidos\n", (unsigned long long)c.received);
+    broker.stop();
+  }
+
+  if (alertsRejected > 0) {
+    printf("  ERROR: la telemetría dejó sin ranura a las alertas\n");
+    return false;
+  }
+  return true;
+}
+
+// ============================================
+// HANDSHAKE TLS
+// ============================================
+
+/**
+ * Reconexiones contra el broker local con TLS mutuo, primero olvidando la
+ * sesión (handshake completo cada vez) y después reanudándola. Mide del
+ * cierre de la sesión a la sesión MQTT de nuevo (TCP + TLS + CONNACK) y el
+ * pico de memoria de OpenSSL del cliente en cada handshake.
+ */
+bool runTlsBenchmark(bool ecdsa, unsigned reconnects) {
+  SSL_CTX* serverContext;
+  SSL_CTX* clientContext;
+  if (!tlsHostContexts(ecdsa, serverContext, clientContext)) {
+    printf("No se pudieron generar las credenciales TLS\n");
+    return false;
+  }
+
+  LocalBroker broker;
+  broker.useTls(serverContext);
+  if (!broker.start(0)) {
+    printf("No se pudo arrancar el broker local\n");
+    return false;
+  }
+
+  nativeUseBroker("127.0.0.1", broker.port());
+  nativeUseTls(clientContext);
+  initMQTT();
+  connectivityBegin();
+
+  printf("== Handshake TLS contra el broker local (%s, TLS mutuo, %u reconexiones) ==\n",
+         ecdsa ? "ECDSA P-256" : "RSA-2048", reconnects);
+
+  bool ok = true;
+  for (int pass = 0; pass < 2 && ok; pass++) {
+    bool resume = pass == 1;
+    LatencyHistogram connectUs;
+    LatencyHistogram heapBytes;
+    uint32_t resumed = 0;
+
+    for (unsigned i = 0; i < reconnects; i++) {
+      disconnectMQTT();
+      if (!resume) {
+        nativeForgetTlsSession();
+      }
+
+      uint32_t handshakes = getTlsStats().handshakes;
+      BenchClock::time_point start = BenchClock::now();
+      while (!isMQTTConnected() && elapsedNs(start) < MQTT_CONNECT_TIMEOUT_MS * 1e6) {
+        connectivityStep();
+        mqttLoop();
+      }
+
+      if (!isMQTTConnected() || getTlsStats().handshakes == handshakes) {
+        printf("  ERROR: no se pudo reconectar con TLS\n");
+        ok = false;
+        break;
+      }
+
+      const HalHandshake& last = getTlsStats().last;
+      connectUs.record((uint32_t)(elapsedNs(start) / 1000));
+      heapBytes.record(last.peakHeapBytes);
+      resumed += last.resumed ? 1 : 0;
+    }
+
+    const char* label = resume ? "con sesión guardada" : "sin sesión guardada";
+    printf("  %s: %u de %u reanudados\n", label, (unsigned)resumed,
+           (unsigned)connectUs.count());
+    printHistogram("reconexión", connectUs, 1000.0, "ms");
+    printHistogram("pico de heap de OpenSSL", heapBytes, 1024.0, "KB");
+
+    if (resume && resumed < connectUs.count()) {
+      printf("  ERROR: el broker no aceptó la sesión guardada\n");
+      ok = false;
+    }
+  }
+
+  disconnectMQTT();
+  broker.stop();
+  nativeUseTls(nullptr);
+  SSL_CTX_free(clientContext);
+  SSL_CTX_free(serverContext);
+  return ok;
+}
@@ -0,0 +1,36 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Contadores de memoria dinámica (operator new/delete del host)
+struct HeapCounters {
+  uint64_t allocations;
+  uint64_t frees;
+  uint64_t bytes;        // Total asignado
+  int64_t liveBytes;     // En uso ahora
+  int64_t peakBytes;     // Máximo en uso
+};
+
+const HeapCounters& heapCounters();
+
+struct SensorData;
+
+// Comprime las lecturas en lotes CODEC_SERIES, comprueba que se decodifican
+// igual (al redondeo de centésimas) e imprime la razón frente a los datos
+// en bruto, JSON y CBOR y el coste por lectura; false si alguna difiere
+bool reportSeriesCompression(const char* name, const SensorData* readings, size_t count);
+
+// Ejecuta la suite; retorna false si detecta una regresión bloqueante
+bool runBenchmarks(float simulatedHours);
+
+// Cliente MQTT contra un broker real (host nullptr = broker local en el
+// proceso) con reloj real; false si las alertas se quedaron sin ranura
+bool runMqttBenchmark(const char* host, uint16_t port, float seconds);
+
+// Reconexiones con TLS mutuo contra el broker local: handshakes completos y
+// reanudados; false si las sesiones no se reanudan
+bool runTlsBenchmark(bool ecdsa, unsigned reconnects);
+
+#endif // BENCHMARKS_H
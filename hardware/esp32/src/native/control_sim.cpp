@@ -0,0 +1,338 @@
+#include "control_sim.h"
+#include "../config.h"
+#include "../climate_control.h"
+#include "../rule_engine.h"
+#include <math.h>
+#include <stdio.h>
+
+/**
+ * Simulación de los lazos de control contra un modelo de planta (env:native).
+ *
+ * Invernadero: la temperatura interior se acerca a la exterior por las
+ * fugas y, con el ventilador, por la renovación de aire (el caudal sigue
+ * al relay con un retardo de primer orden); el sol la calienta de día.
+ * Suelo: el agua de la bomba se infiltra con un retardo hasta el sensor y
+ * la evaporación seca más de día. Se comparan los lazos PID con un
+ * control todo/nada con histéresis sobre las mismas consignas, evaluado
+ * por el motor de reglas a la cadencia de la telemetría, y se cuentan las
+ * conmutaciones de cada relay.
+ */
+
+#define SIM_STEP_MS 1000UL
+#define SIM_STEP_HOURS 4.0f
+
+// Planta
+#define LEAK_RATE (1.0 / 2400.0)         // Renovación sin ventilador (1/s)
+#define FAN_RATE (8.0 / 2400.0)          // Renovación añadida con caudal máximo (1/s)
+#define FAN_SPINUP_S 20.0                // Retardo del caudal
+#define PUMP_RATE (30.0 / 3600.0)        // Riego (%/s)
+#define INFILTRATION_S 600.0             // Retardo del agua hasta el sensor
+
+// Tolerancias para considerar estabilizado el lazo
+#define FAN_BAND 0.5
+#define PUMP_BAND 2.0
+
+enum Strategy : uint8_t {
+  STRATEGY_PID,
+  STRATEGY_RULES,
+  STRATEGY_COUNT
+};
+
+static const char* const STRATEGY_NAMES[STRATEGY_COUNT] = {
+  "PID", "todo/nada"
+};
+
+struct Weather {
+  double outside;       // °C
+  double solar;         // Calentamiento (°C/s)
+  double evaporation;   // Secado del suelo (%/s)
+};
+
+struct Plant {
+  double temperature;
+  double airflow;
+  double soil;
+  double surfaceWater;
+};
+
+// Resultado de un lazo en un escenario
+struct LoopStats {
+  double setpoint;
+  double band;
+  bool cooling;                 // El actuador baja la medida
+  bool crossed;                 // La medida alcanzó la consigna
+  double overshoot;             // Mayor exceso tras alcanzarla
+  unsigned long lastOutsideMs;  // Último instante fuera de la banda
+  double squaredShortfall;     // Error en el sentido que corrige el actuador
+  unsigned long samples;
+  uint32_t switches;
+  bool relayOn;
+  unsigned long relayChangedAt;
+  unsigned long shortestOnMs;
+  unsigned long shortestOffMs;
+  unsigned long onMs;
+};
+
+static void statsBegin(LoopStats& s, double setpoint, double band, bool cooling) {
+  s = LoopStats();
+  s.setpoint = setpoint;
+  s.band = band;
+  s.cooling = cooling;
+  s.shortestOnMs = ~0UL;
+  s.shortestOffMs = ~0UL;
+}
+
+static void statsSample(LoopStats& s, double value, bool relay, unsigned long now) {
+  double error = value - s.setpoint;
+  double beyond = s.cooling ? -error : error;   // Positivo: pasado de la consigna
+
+  if (beyond >= 0) {
+    s.crossed = true;
+  }
+  if (s.crossed && beyond > s.overshoot) {
+    s.overshoot = beyond;
+  }
+  if (fabs(error) > s.band) {
+    s.lastOutsideMs = now;
+  }
+  double shortfall = beyond < 0 ? -beyond : 0;
+  s.squaredShortfall += shortfall * shortfall;
+  s.samples++;
+
+  if (relay) {
+    s.onMs += SIM_STEP_MS;
+  }
+  if (relay != s.relayOn) {
+    // El primer tramo (desde el inicio) no cuenta para los mínimos
+    unsigned long held = now - s.relayChangedAt;
+    if (s.switches > 0) {
+      unsigned long& shortest = s.relayOn ? s.shortestOnMs : s.shortestOffMs;
+      if (held < shortest) {
+        shortest = held;
+      }
+    }
+    s.relayOn = relay;
+    s.relayChangedAt = now;
+    s.switches++;
+  }
+}
+
+// ============================================
+// PLANTA
+// ============================================
+static Weather dayWeather(unsigned long ms) {
+  const double dayMs = 24.0 * 3600000.0;
+  double phase = 2.0 * M_PI * fmod((double)ms, dayMs) / dayMs;
+  double daylight = sin(phase - M_PI / 2.0);   // 0 a las 6 h, 1 a las 12 h
+  double sun = daylight > 0 ? daylight : 0;
+
+  Weather w;
+  w.outside = 20.0 + 6.0 * sin(phase - 9.0 * M_PI / 12.0);
+  w.solar = 8.0 * LEAK_RATE * sun;              // +8 °C sin ventilar a mediodía
+  w.evaporation = (1.0 + 2.0 * sun) / 3600.0;   // 1-3 %/h
+  return w;
+}
+
+static Weather stepWeather(unsigned long) {
+  Weather w;
+  w.outside = 22.0;
+  w.solar = 12.0 * LEAK_RATE;                   // Equilibrio sin ventilar: 34 °C
+  w.evaporation = 2.0 / 3600.0;
+  return w;
+}
+
+static void plantStep(Plant& p, const Weather& w, bool fan, bool pump, double dtS) {
+  p.airflow += ((fan ? 1.0 : 0.0) - p.airflow) * dtS / FAN_SPINUP_S;
+  p.temperature += ((w.outside - p.temperature) * (LEAK_RATE + FAN_RATE * p.airflow) +
+                    w.solar) * dtS;
+
+  double infiltrated = p.surfaceWater * dtS / INFILTRATION_S;
+  p.surfaceWater += (pump ? PUMP_RATE * dtS : 0.0) - infiltrated;
+  p.soil += infiltrated - w.evaporation * dtS;
+  p.soil = p.soil < 0 ? 0 : (p.soil > 100 ? 100 : p.soil);
+}
+
+// Resolución del DHT22 y del porcentaje de suelo
+static float quantize(double value) {
+  return (float)(round(value * 10.0) / 10.0);
+}
+
+// ============================================
+// ESTRATEGIAS
+// ============================================
+static ControlLoopConfig fanConfig() {
+  return { (float)FAN_SETPOINT, { FAN_KP, FAN_KI, FAN_KD, true },
+           { FAN_WINDOW_MS, FAN_MIN_ON_MS, FAN_MIN_OFF_MS } };
+}
+
+static ControlLoopConfig pumpConfig() {
+  return { (float)PUMP_SETPOINT, { PUMP_KP, PUMP_KI, PUMP_KD, false },
+           { PUMP_WINDOW_MS, PUMP_MIN_ON_MS, PUMP_MIN_OFF_MS } };
+}
+
+// Todo/nada con histéresis alrededor de las mismas consignas, evaluado
+// por el motor de reglas a la cadencia de la telemetría
+static const Rule ON_OFF_RULES[] = {
+  { ALERT_TEMPERATURA, RULE_ABOVE, ACTUATOR_VENTILADOR, SEVERITY_NONE,
+    (float)FAN_SETPOINT + 1.0f, 2.0f, 0 },
+  { ALERT_HUMEDAD_SUELO, RULE_BELOW, ACTUATOR_BOMBA, SEVERITY_NONE,
+    (float)PUMP_SETPOINT - 5.0f, 10.0f, 0 }
+};
+#define ON_OFF_RULE_COUNT (sizeof(ON_OFF_RULES) / sizeof(ON_OFF_RULES[0]))
+
+/**
+ * Ejecuta un escenario con una estrategia y acumula las estadísticas de
+ * ambos lazos
+ */
+static void runScenario(Strategy strategy, Weather (*weather)(unsigned long), Plant plant,
+                        unsigned long durationMs, LoopStats& fan, LoopStats& pump) {
+  ControlLoop fanLoop;
+  ControlLoop pumpLoop;
+  fanLoop.begin(fanConfig(), 0);
+  pumpLoop.begin(pumpConfig(), 0);
+
+  RuleSlot slots[ON_OFF_RULE_COUNT];
+  RuleEngine rules(slots, ON_OFF_RULE_COUNT);
+  rules.load(ON_OFF_RULES, ON_OFF_RULE_COUNT);
+  Alert alerts[8];
+
+  float measuredTemp = quantize(plant.temperature);
+  bool fanOn = false;
+  bool pumpOn = false;
+
+  for (unsigned long now = 0; now < durationMs; now += SIM_STEP_MS) {
+    if (now % DHT_SAMPLE_INTERVAL_MS == 0) {
+      measuredTemp = quantize(plant.temperature);
+    }
+    float measuredSoil = quantize(plant.soil);
+
+    if (strategy == STRATEGY_PID) {
+      if (now % CONTROL_PERIOD_MS == 0) {
+        fanOn = fanLoop.step(measuredTemp, false, now);
+        pumpOn = pumpLoop.step(measuredSoil, false, now);
+      }
+    } else if (now % SENSOR_READ_INTERVAL_MS == 0) {
+      SensorData data = { measuredTemp, 60.0f, measuredSoil, 50.0f, true, now };
+      rules.evaluate(data, now, alerts, 8);
+      fanOn = (rules.demand() & (1u << ACTUATOR_VENTILADOR)) != 0;
+      pumpOn = (rules.demand() & (1u << ACTUATOR_BOMBA)) != 0;
+    }
+
+    statsSample(fan, plant.temperature, fanOn, now);
+    statsSample(pump, plant.soil, pumpOn, now);
+    plantStep(plant, weather(now), fanOn, pumpOn, SIM_STEP_MS / 1000.0);
+  }
+}
+
+// ============================================
+// INFORME
+// ============================================
+static void formatMinutes(char* out, size_t capacity, unsigned long ms) {
+  if (ms == ~0UL) {
+    snprintf(out, capacity, "-");
+  } else {
+    snprintf(out, capacity, "%.1f min", ms / 60000.0);
+  }
+}
+
+static void printStepRow(const char* loop, Strategy strategy, const LoopStats& s,
+                         unsigned long durationMs, const char* unit) {
+  // Estabilizado: dentro de la banda durante la última hora al menos
+  bool settled = s.lastOutsideMs + 3600000UL <= durationMs;
+  char settle[16], shortestOn[16], shortestOff[16];
+  if (settled) {
+    formatMinutes(settle, sizeof(settle), s.lastOutsideMs + SIM_STEP_MS);
+  } else {
+    snprintf(settle, sizeof(settle), "no");
+  }
+  formatMinutes(shortestOn, sizeof(shortestOn), s.shortestOnMs);
+  formatMinutes(shortestOff, sizeof(shortestOff), s.shortestOffMs);
+
+  printf("  %-10s %-9s %10s %7.2f %-2s %6u %12s %12s\n", loop, STRATEGY_NAMES[strategy], settle,
+         s.overshoot, unit, (unsigned)s.switches, shortestOn, shortestOff);
+}
+
+static void printDayRow(const char* loop, Strategy strategy, const LoopStats& s, float days,
+                        const char* unit) {
+  char shortestOn[16], shortestOff[16];
+  formatMinutes(shortestOn, sizeof(shortestOn), s.shortestOnMs);
+  formatMinutes(shortestOff, sizeof(shortestOff), s.shortestOffMs);
+
+  printf("  %-10s %-9s %7.2f %-2s %7.1f %% %9.1f %12s %12s\n", loop, STRATEGY_NAMES[strategy],
+         sqrt(s.squaredShortfall / s.samples), unit, 100.0 * s.onMs / (s.samples * SIM_STEP_MS),
+         s.switches / days, shortestOn, shortestOff);
+}
+
+/**
+ * Comprueba los mínimos del relay y que el lazo se estabilice
+ */
+static bool checkLoop(const char* loop, const LoopStats& s, const RelayTiming& timing,
+                      unsigned long durationMs, bool requireSettled) {
+  bool ok = true;
+  if (requireSettled && s.lastOutsideMs + 3600000UL > durationMs) {
+    printf("  ERROR: %s no se estabiliza\n", loop);
+    ok = false;
+  }
+  if (s.shortestOnMs != ~0UL && s.shortestOnMs < timing.minOnMs) {
+    printf("  ERROR: %s encendido %lu ms (mínimo %lu)\n", loop, s.shortestOnMs,
+           (unsigned long)timing.minOnMs);
+    ok = false;
+  }
+  if (s.shortestOffMs != ~0UL && s.shortestOffMs < timing.minOffMs) {
+    printf("  ERROR: %s apagado %lu ms (mínimo %lu)\n", loop, s.shortestOffMs,
+           (unsigned long)timing.minOffMs);
+    ok = false;
+  }
+  return ok;
+}
+
+bool runControlSimulation(float hours) {
+  bool ok = true;
+  LoopStats fan[STRATEGY_COUNT];
+  LoopStats pump[STRATEGY_COUNT];
+
+  // Escalón: invernadero caliente y suelo seco con tiempo constante
+  unsigned long stepMs = (unsigned long)(SIM_STEP_HOURS * 3600000.0f);
+  Plant hot = { 34.0, 0.0, 25.0, 0.0 };
+
+  printf("== Escalón (%.0f h): %.1f °C -> %.1f °C, suelo %.0f %% -> %.0f %% ==\n",
+         SIM_STEP_HOURS, hot.temperature, (double)FAN_SETPOINT, hot.soil, (double)PUMP_SETPOINT);
+  printf("  %-10s %-9s %10s %10s %6s %12s %12s\n", "lazo", "control", "estable en",
+         "sobrepaso", "conm.", "pulso mín.", "pausa mín.");
+  for (uint8_t s = 0; s < STRATEGY_COUNT; s++) {
+    statsBegin(fan[s], FAN_SETPOINT, FAN_BAND, true);
+    statsBegin(pump[s], PUMP_SETPOINT, PUMP_BAND, false);
+    runScenario((Strategy)s, stepWeather, hot, stepMs, fan[s], pump[s]);
+  }
+  for (uint8_t s = 0; s < STRATEGY_COUNT; s++) {
+    printStepRow("ventilador", (Strategy)s, fan[s], stepMs, "°C");
+  }
+  for (uint8_t s = 0; s < STRATEGY_COUNT; s++) {
+    printStepRow("bomba", (Strategy)s, pump[s], stepMs, "%");
+  }
+  ok &= checkLoop("ventilador", fan[STRATEGY_PID], fanConfig().relay, stepMs, true);
+  ok &= checkLoop("bomba", pump[STRATEGY_PID], pumpConfig().relay, stepMs, true);
+
+  // Ciclo diario: el sol satura el ventilador en las horas centrales
+  unsigned long dayMs = (unsigned long)(hours * 3600000.0f);
+  Plant dawn = { 18.0, 0.0, PUMP_SETPOINT, 0.0 };
+
+  printf("\n== Ciclo diario (%.0f h) ==\n", hours);
+  printf("  %-10s %-9s %10s %9s %9s %12s %12s\n", "lazo", "control", "déficit RMS",
+         "encendido", "conm./día", "pulso mín.", "pausa mín.");
+  for (uint8_t s = 0; s < STRATEGY_COUNT; s++) {
+    statsBegin(fan[s], FAN_SETPOINT, FAN_BAND, true);
+    statsBegin(pump[s], PUMP_SETPOINT, PUMP_BAND, false);
+    runScenario((Strategy)s, dayWeather, dawn, dayMs, fan[s], pump[s]);
+  }
+  for (uint8_t s = 0; s < STRATEGY_COUNT; s++) {
+    printDayRow("ventilador", (Strategy)s, fan[s], hours / 24.0f, "°C");
+  }
+  for (uint8_t s = 0; s < STRATEGY_COUNT; s++) {
+    printDayRow("bomba", (Strategy)s, pump[s], hours / 24.0f, "%");
+  }
+  ok &= checkLoop("ventilador", fan[STRATEGY_PID], fanConfig().relay, dayMs, false);
+  ok &= checkLoop("bomba", pump[STRATEGY_PID], pumpConfig().relay, dayMs, false);
+
+  return ok;
+}
@@ -0,0 +1,11 @@
+#ifndef CONTROL_SIM_H
+#define CONTROL_SIM_H
+
+// Simula los lazos del ventilador y la bomba (climate_control.h, con la
+// sintonía de config.h) contra un modelo térmico y de suelo, junto al
+// control todo/nada de las reglas: escalón y H horas de ciclo diario.
+// Retorna false si un lazo no se estabiliza o el relay incumple sus
+// tiempos mínimos.
+bool runControlSimulation(float hours);
+
+#endif // CONTROL_SIM_H
@@ -0,0 +1,862 @@
+#include "hal_native.h"
+#include "../config.h"
+#include "../adc_filter.h"
+#include "../mqtt_packet.h"
+#include "tls_host.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/ssl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Implementación de la HAL sobre Linux (env:native).
+ *
+ * Sensores simulados a partir de NativeEnvironment: el DHT22 genera su
+ * tren de pulsos y pasa por el decodificador real, y el ADC alimenta los
+ * mismos filtros de diezmado que en el ESP32. La red es un broker MQTT en
+ * memoria que acepta toda publicación mientras el enlace esté activo, o
+ * un broker real en el host (nativeUseBroker), opcionalmente con TLS.
+ */
+
+#define NATIVE_PIN_COUNT 40
+#define NATIVE_DHT_TRANSACTION_US 5000   // Duración de una trama real
+#define NATIVE_ADC_NOISE 8               // Ruido de las muestras (cuentas)
+
+// ============================================
+// RELOJ
+// ============================================
+bool virtualClock = false;
+unsigned long long virtualMicros = 0;
+const std::chrono::steady_clock::time_point clockOrigin = std::chrono::steady_clock::now();
+
+unsigned long halMicros() {
+  if (virtualClock) {
+    return (unsigned long)virtualMicros;
+  }
+
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - clockOrigin).count();
+}
+
+unsigned long halMillis() {
+  if (virtualClock) {
+    return (unsigned long)(virtualMicros / 1000);
+  }
+
+  return halMicros() / 1000;
+}
+
+void halDelay(unsigned long ms) {
+  if (virtualClock) {
+    virtualMicros += (unsigned long long)ms * 1000;
+  } else {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+}
+
+// Ciclos reales, también con el reloj virtual: la instrumentación mide el
+// coste de la lógica en el host. En x86 el TSC (frecuencia estimada contra
+// el reloj monótono); en otras arquitecturas, nanosegundos.
+#if defined(__x86_64__) || defined(__i386__)
+const uint64_t cycleOrigin = __rdtsc();
+
+uint32_t halCycles() {
+  return (uint32_t)__rdtsc();
+}
+
+uint32_t halCyclesPerUs() {
+  uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - clockOrigin).count();
+  return us > 0 ? (uint32_t)((__rdtsc() - cycleOrigin) / us) : 1000;
+}
+#else
+uint32_t halCycles() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - clockOrigin).count();
+}
+
+uint32_t halCyclesPerUs() {
+  return 1000;
+}
+#endif
+
+// El heap del host no es comparable con el del ESP32
+uint32_t halHeapFree() {
+  return 0;
+}
+
+uint32_t halHeapMinFree() {
+  return 0;
+}
+
+// Temporizador de control: periodos del reloj de la HAL (también virtual)
+unsigned long controlTimerStart = 0;
+uint32_t controlTimerPeriodMs = 0;
+
+void halControlTimerBegin(uint32_t periodMs) {
+  controlTimerStart = halMillis();
+  controlTimerPeriodMs = periodMs;
+}
+
+uint32_t halControlTicks() {
+  if (controlTimerPeriodMs == 0) {
+    return 0;
+  }
+
+  return (uint32_t)((halMillis() - controlTimerStart) / controlTimerPeriodMs);
+}
+
+void nativeUseVirtualClock(bool enabled) {
+  virtualMicros = halMicros();
+  virtualClock = enabled;
+}
+
+void nativeAdvanceClock(unsigned long us) {
+  virtualMicros += us;
+}
+
+// ============================================
+// CONSOLA
+// ============================================
+FILE* consoleFile = nullptr;
+
+void halConsoleWrite(const char* text, size_t length) {
+  if (consoleFile != nullptr) {
+    fwrite(text, 1, length, consoleFile);
+  }
+}
+
+void nativeSetConsole(FILE* file) {
+  consoleFile = file;
+}
+
+// ============================================
+// GPIO
+// ============================================
+bool pinLevels[NATIVE_PIN_COUNT] = {};
+NativePinHook pinHook = nullptr;
+
+void halPinOutput(uint8_t pin) {
+}
+
+void halPinWrite(uint8_t pin, bool high) {
+  if (pin < NATIVE_PIN_COUNT) {
+    pinLevels[pin] = high;
+  }
+  if (pinHook != nullptr) {
+    pinHook(pin, high);
+  }
+}
+
+bool nativePinLevel(uint8_t pin) {
+  return pin < NATIVE_PIN_COUNT && pinLevels[pin];
+}
+
+void nativeSetPinHook(NativePinHook hook) {
+  pinHook = hook;
+}
+
+// ============================================
+// ENTORNO SIMULADO
+// ============================================
+NativeEnvironmentFn environmentFn = nativeDefaultEnvironment;
+double simulatedSoil = 45.0;     // double: los pasos de 1 ms se perderían en float
+unsigned long lastSoilUpdate = 0;
+
+/**
+ * Ciclo diario: máxima de temperatura a las 15 h, luz de 6 a 18 h.
+ * El suelo se seca 2 %/h y sube 30 %/h con la bomba encendida; el
+ * ventilador baja la temperatura 4 °C (relays activos en LOW).
+ */
+void nativeDefaultEnvironment(unsigned long ms, NativeEnvironment& env) {
+  const float dayMs = 24.0f * 3600000.0f;
+  float phase = 2.0f * (float)M_PI * fmodf((float)ms, dayMs) / dayMs;
+
+  double hours = (ms - lastSoilUpdate) / 3600000.0;
+  bool pumpOn = !nativePinLevel(PIN_RELAY_BOMBA);
+  simulatedSoil += (pumpOn ? 30.0 : -2.0) * hours;
+  simulatedSoil = simulatedSoil < 5.0 ? 5.0 : (simulatedSoil > 95.0 ? 95.0 : simulatedSoil);
+  lastSoilUpdate = ms;
+
+  float daylight = sinf(phase - (float)M_PI / 2.0f);   // 0 a las 6 h, 1 a las 12 h
+  env.temperatura = 22.0f + 8.0f * sinf(phase - 9.0f * (float)M_PI / 12.0f);
+  if (!nativePinLevel(PIN_RELAY_VENTILADOR)) {
+    env.temperatura -= 4.0f;
+  }
+  env.humedad = 65.0f - 15.0f * sinf(phase - 9.0f * (float)M_PI / 12.0f);
+  env.humedadSuelo = (float)simulatedSoil;
+  env.luminosidad = daylight > 0 ? 2.0f + 90.0f * daylight : 2.0f;
+}
+
+void nativeSetEnvironment(NativeEnvironmentFn fn) {
+  environmentFn = fn != nullptr ? fn : nativeDefaultEnvironment;
+}
+
+// ============================================
+// SENSORES
+// ============================================
+AdcDecimator nativeAdc[ADC_CHANNEL_COUNT];
+unsigned long lastAdcSample = 0;
+uint32_t noiseState = 12345;
+
+bool dhtActive = false;
+unsigned long dhtStartedAt = 0;
+Dht22Status dhtFault = DHT_OK;
+DhtPulse dhtPulses[84];
+
+static uint16_t noisySample(float raw) {
+  noiseState = noiseState * 1103515245u + 12345u;
+  int noise = (int)((noiseState >> 16) % (2 * NATIVE_ADC_NOISE + 1)) - NATIVE_ADC_NOISE;
+  int value = (int)raw + noise;
+  return value < 0 ? 0 : (value > 4095 ? 4095 : value);
+}
+
+/**
+ * Trama del DHT22 para unos valores dados (tiempos nominales del datasheet)
+ */
+static size_t synthesizeDhtFrame(float temperatura, float humedad) {
+  uint16_t rawHum = (uint16_t)lroundf(humedad * 10.0f);
+  uint16_t rawTemp = (uint16_t)lroundf(fabsf(temperatura) * 10.0f);
+  if (temperatura < 0) {
+    rawTemp |= 0x8000;
+  }
+
+  uint8_t bytes[5] = { (uint8_t)(rawHum >> 8), (uint8_t)rawHum,
+                       (uint8_t)(rawTemp >> 8), (uint8_t)rawTemp, 0 };
+  bytes[4] = bytes[0] + bytes[1] + bytes[2] + bytes[3];
+
+  size_t count = 0;
+  dhtPulses[count++] = { 0, 80 };
+  dhtPulses[count++] = { 1, 80 };
+  for (int bit = 0; bit < 40; bit++) {
+    bool one = bytes[bit / 8] & (0x80 >> (bit % 8));
+    dhtPulses[count++] = { 0, 50 };
+    dhtPulses[count++] = { 1, (uint16_t)(one ? 70 : 26) };
+  }
+  return count;
+}
+
+void halSensorsBegin() {
+  for (int i = 0; i < ADC_CHANNEL_COUNT; i++) {
+    nativeAdc[i].begin(ADC_TIMER_RATE_HZ / ADC_OUTPUT_RATE_HZ, ADC_FILTER_WINDOW);
+  }
+  lastAdcSample = halMicros();
+}
+
+void halDhtStart() {
+  dhtActive = true;
+  dhtStartedAt = halMicros();
+}
+
+Dht22Status halDhtPoll(Dht22Reading& reading) {
+  if (!dhtActive) {
+    return DHT_ERR_TIMEOUT;
+  }
+
+  if (halMicros() - dhtStartedAt < NATIVE_DHT_TRANSACTION_US) {
+    return DHT_PENDING;
+  }
+
+  dhtActive = false;
+  if (dhtFault != DHT_OK) {
+    return dhtFault;
+  }
+
+  NativeEnvironment env;
+  environmentFn(halMillis(), env);
+  return decodeDht22(dhtPulses, synthesizeDhtFrame(env.temperatura, env.humedad), reading);
+}
+
+void nativeSetDhtFault(Dht22Status status) {
+  dhtFault = status;
+}
+
+/**
+ * Genera las muestras que el temporizador del ADC habría tomado desde la
+ * última llamada (como máximo lo que cubre el promedio móvil)
+ */
+void halAdcPoll() {
+  const unsigned long periodUs = 1000000UL / ADC_TIMER_RATE_HZ;
+  const unsigned long maxSamples = (unsigned long)(ADC_TIMER_RATE_HZ / ADC_OUTPUT_RATE_HZ) * ADC_FILTER_WINDOW;
+  unsigned long now = halMicros();
+  unsigned long samples = (now - lastAdcSample) / periodUs;
+
+  if (samples == 0) {
+    return;
+  }
+  lastAdcSample += samples * periodUs;
+  if (samples > maxSamples) {
+    samples = maxSamples;
+  }
+
+  NativeEnvironment env;
+  environmentFn(halMillis(), env);
+  float soilRaw = SOIL_ADC_DRY + env.humedadSuelo / 100.0f * (SOIL_ADC_WET - SOIL_ADC_DRY);
+  float lightRaw = LDR_ADC_DARK + env.luminosidad / 100.0f * (LDR_ADC_BRIGHT - LDR_ADC_DARK);
+
+  for (unsigned long i = 0; i < samples; i++) {
+    nativeAdc[ADC_SOIL].push(noisySample(soilRaw));
+    nativeAdc[ADC_LIGHT].push(noisySample(lightRaw));
+  }
+}
+
+bool halAdcRead(AdcChannelId channel, float& raw) {
+  if (channel >= ADC_CHANNEL_COUNT || !nativeAdc[channel].ready()) {
+    return false;
+  }
+
+  raw = nativeAdc[channel].value();
+  return true;
+}
+
+// ============================================
+// ALMACENAMIENTO
+// ============================================
+FILE* traceFile = nullptr;
+
+StorageBackend* halTelemetryStorage() {
+  static RamStorageBackend backend(STORE_SECTOR_SIZE, STORE_SECTOR_COUNT);
+  return &backend;
+}
+
+bool halTraceWrite(const uint8_t* data, size_t length) {
+  if (traceFile == nullptr) {
+    return true;
+  }
+
+  return fwrite(data, 1, length, traceFile) == length;
+}
+
+void nativeSetTraceFile(FILE* file) {
+  traceFile = file;
+}
+
+// ============================================
+// RED
+// ============================================
+// Por defecto el enlace llega a un broker en memoria que habla MQTT sobre
+// los mismos bytes que el ESP32 (CONNACK, SUBACK, PUBACK, PINGRESP) y
+// entrega cada PUBLISH al gancho. Con nativeUseBroker() el enlace es un
+// socket TCP no bloqueante hacia un broker real, cifrado con OpenSSL si
+// se pasó un contexto a nativeUseTls() (handshake sin bloquear, sesión
+// reanudada en cada reconexión como en tls_link.cpp).
+//
+// Con el reloj virtual la asociación WiFi y el handshake TLS tardan lo que
+// en el invernadero (menos si se reanuda la sesión), para medir la
+// recuperación tras un corte; con el reloj real son inmediatos.
+#define NATIVE_LINK_BUFFER_SIZE 8192
+#define NATIVE_FAST_JOIN_MS 300        // Asociación directa + DHCP
+#define NATIVE_SCAN_JOIN_MS 2500       // Búsqueda en todos los canales + DHCP
+#define NATIVE_TLS_HANDSHAKE_MS 1200   // TCP + TLS mutuo con AWS IoT Core
+#define NATIVE_TLS_RESUME_MS 300       // TCP + handshake abreviado (sesión reanudada)
+
+bool linkUp = true;                    // AP y broker alcanzables
+uint8_t apChannel = 6;
+const uint8_t apBssid[6] = { 0x02, 0x00, 0x5E, 0x10, 0x20, 0x30 };
+HalNetState nativeNet = NET_IDLE;
+bool joinReachable = false;            // El intento en curso encontrará el AP
+unsigned long joinDoneAt = 0;
+HalWifiHint savedHint;                 // "NVS" del host
+bool savedHintValid = false;
+uint32_t randomState = 0x9E3779B9;     // Secuencia fija: simulaciones repetibles
+HalLinkState nativeLink = LINK_CLOSED;
+unsigned long linkReadyAt = 0;
+NativePublishHook publishHook = nullptr;
+uint32_t restartCount = 0;
+unsigned long linkOpenedAt = 0;        // halMicros() de halLinkOpen()
+HalHandshake linkHandshake;
+bool linkHandshakeFresh = false;
+bool modelSessionCached = false;       // Sesión TLS del broker en memoria
+
+// Broker en memoria
+#define NATIVE_BROKER_FILTERS 64
+#define NATIVE_BROKER_FILTER_LENGTH 128
+
+bool brokerSession = false;     // CONNECT recibido
+uint16_t brokerPacketId = 0;
+char brokerFilters[NATIVE_BROKER_FILTERS][NATIVE_BROKER_FILTER_LENGTH];
+size_t brokerFilterCount = 0;   // Suscripciones de la sesión
+size_t brokerSubscribePackets = 0;
+uint8_t brokerInBuffer[NATIVE_LINK_BUFFER_SIZE];
+MqttFrameReader brokerIn(brokerInBuffer, sizeof(brokerInBuffer));
+uint8_t brokerOut[NATIVE_LINK_BUFFER_SIZE];
+size_t brokerOutLength = 0;
+size_t brokerOutRead = 0;
+
+// Broker real
+const char* brokerHost = nullptr;
+uint16_t brokerPort = 0;
+int brokerSocket = -1;
+SSL_CTX* tlsContext = nullptr;
+SSL* brokerSsl = nullptr;
+SSL_SESSION* tlsSession = nullptr;     // Última sesión negociada con el broker real
+bool tlsSessionOffered = false;
+
+/**
+ * En el host no se reinicia el proceso: se corta el enlace y la lógica
+ * continúa, de modo que una ejecución larga sobrevive a cortes del broker
+ */
+void halRestart() {
+  restartCount++;
+  if (nativeLink == LINK_OPEN) {
+    nativeLink = LINK_FAILED;
+  }
+}
+
+uint32_t nativeRestartCount() {
+  return restartCount;
+}
+
+uint32_t halRandom() {
+  // xorshift32
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+void halNetworkBegin() {
+}
+
+/**
+ * Asociación simulada: la directa solo llega si el AP sigue en ese canal
+ */
+void halNetworkJoin(const HalWifiHint* hint) {
+  nativeNet = NET_JOINING;
+  joinReachable = hint == nullptr ||
+                  (hint->channel == apChannel && memcmp(hint->bssid, apBssid, sizeof(apBssid)) == 0);
+  joinDoneAt = halMillis();
+  if (virtualClock) {
+    joinDoneAt += hint != nullptr ? NATIVE_FAST_JOIN_MS : NATIVE_SCAN_JOIN_MS;
+  }
+}
+
+void halNetworkLeave() {
+  nativeNet = NET_IDLE;
+}
+
+HalNetState halNetworkState() {
+  if (nativeNet == NET_JOINING && halMillis() >= joinDoneAt) {
+    nativeNet = linkUp && joinReachable ? NET_UP : NET_DOWN;
+  }
+  return nativeNet;
+}
+
+bool halNetworkConnected() {
+  return halNetworkState() == NET_UP;
+}
+
+bool halNetworkCurrentHint(HalWifiHint& hint) {
+  if (halNetworkState() != NET_UP) {
+    return false;
+  }
+  memcpy(hint.bssid, apBssid, sizeof(apBssid));
+  hint.channel = apChannel;
+  return true;
+}
+
+bool halNetworkLoadHint(HalWifiHint& hint) {
+  hint = savedHint;
+  return savedHintValid;
+}
+
+void halNetworkSaveHint(const HalWifiHint& hint) {
+  savedHint = hint;
+  savedHintValid = true;
+}
+
+/**
+ * Corte o vuelta del AP: la asociación y el enlace caen como en el ESP32
+ */
+void nativeSetLinkUp(bool up) {
+  linkUp = up;
+  if (!up) {
+    if (nativeNet == NET_UP) {
+      nativeNet = NET_DOWN;
+    }
+    if (nativeLink != LINK_CLOSED) {
+      nativeLink = LINK_FAILED;
+    }
+  }
+}
+
+void nativeSetAccessPointChannel(uint8_t channel) {
+  if (channel != apChannel) {
+    apChannel = channel;
+    nativeSetLinkUp(false);
+    linkUp = true;
+  }
+}
+
+void nativeUseBroker(const char* host, uint16_t port) {
+  brokerHost = host;
+  brokerPort = port;
+}
+
+void nativeUseTls(ssl_ctx_st* context) {
+  tlsContext = context;
+}
+
+void nativeForgetTlsSession() {
+  modelSessionCached = false;
+  if (tlsSession != nullptr) {
+    SSL_SESSION_free(tlsSession);
+    tlsSession = nullptr;
+  }
+}
+
+void nativeSetPublishHook(NativePublishHook hook) {
+  publishHook = hook;
+}
+
+/**
+ * Respuesta del broker en memoria hacia el firmware
+ */
+static uint8_t* brokerReply(size_t& capacity) {
+  // Compactar lo ya leído por el firmware
+  if (brokerOutRead > 0) {
+    memmove(brokerOut, brokerOut + brokerOutRead, brokerOutLength - brokerOutRead);
+    brokerOutLength -= brokerOutRead;
+    brokerOutRead = 0;
+  }
+
+  capacity = sizeof(brokerOut) - brokerOutLength;
+  return brokerOut + brokerOutLength;
+}
+
+static void brokerHandle(const MqttPacket& packet) {
+  size_t capacity;
+  uint8_t* out = brokerReply(capacity);
+  MqttPublish publish;
+  uint16_t packetId;
+
+  switch (packet.type) {
+    case MQTT_CONNECT:
+      brokerSession = true;
+      brokerFilterCount = 0;
+      brokerSubscribePackets = 0;
+      brokerOutLength += mqttEncodeConnack(out, capacity, 0);
+      break;
+
+    case MQTT_SUBSCRIBE: {
+      uint8_t granted[NATIVE_BROKER_FILTERS];
+      size_t count = 0;
+      size_t offset = 0;
+      const char* filter;
+      size_t filterLength;
+      uint8_t qos;
+      while (count < sizeof(granted) &&
+             mqttNextFilter(packet, offset, filter, filterLength, qos)) {
+        // Sin hueco o demasiado largo: rechazado (0x80) como en AWS IoT
+        granted[count++] = 0x80;
+        if (brokerFilterCount < NATIVE_BROKER_FILTERS && filterLength < NATIVE_BROKER_FILTER_LENGTH) {
+          memcpy(brokerFilters[brokerFilterCount], filter, filterLength);
+          brokerFilters[brokerFilterCount++][filterLength] = '\0';
+          granted[count - 1] = qos;
+        }
+      }
+      if (mqttParsePacketId(packet, packetId)) {
+        brokerSubscribePackets++;
+        brokerOutLength += mqttEncodeSuback(out, capacity, packetId, granted, count);
+      }
+      break;
+    }
+
+    case MQTT_PUBLISH:
+      if (!mqttParsePublish(packet, publish)) {
+        break;
+      }
+      if (publish.qos > 0) {
+        brokerOutLength += mqttEncodeAck(out, capacity, MQTT_PUBACK, publish.packetId);
+      }
+      if (publishHook != nullptr) {
+        char topic[256];
+        size_t length = publish.topicLength < sizeof(topic) - 1 ? publish.topicLength : sizeof(topic) - 1;
+        memcpy(topic, publish.topic, length);
+        topic[length] = '\0';
+        publishHook(topic, publish.payload, publish.payloadLength);
+      }
+      break;
+
+    case MQTT_PINGREQ:
+      brokerOutLength += mqttEncodeEmpty(out, capacity, MQTT_PINGRESP);
+      break;
+
+    case MQTT_DISCONNECT:
+      brokerSession = false;
+      break;
+
+    default:
+      break;
+  }
+}
+
+void halLinkOpen() {
+  halLinkClose();
+
+  if (!linkUp || !halNetworkConnected()) {
+    nativeLink = LINK_FAILED;
+    return;
+  }
+
+  linkOpenedAt = halMicros();
+
+  if (brokerHost == nullptr) {
+    brokerSession = false;
+    brokerIn.reset();
+    brokerOutLength = 0;
+    brokerOutRead = 0;
+    tlsSessionOffered = TLS_SESSION_RESUMPTION && modelSessionCached;
+    if (virtualClock) {
+      linkReadyAt = halMillis() + (tlsSessionOffered ? NATIVE_TLS_RESUME_MS : NATIVE_TLS_HANDSHAKE_MS);
+    } else {
+      linkReadyAt = halMillis();
+    }
+    nativeLink = LINK_OPENING;
+    return;
+  }
+
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(brokerPort);
+  if (inet_pton(AF_INET, brokerHost, &address.sin_addr) != 1) {
+    nativeLink = LINK_FAILED;
+    return;
+  }
+
+  brokerSocket = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(brokerSocket, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+  fcntl(brokerSocket, F_SETFL, fcntl(brokerSocket, F_GETFL, 0) | O_NONBLOCK);
+
+  if (connect(brokerSocket, (const sockaddr*)&address, sizeof(address)) == 0) {
+    nativeLink = LINK_OPEN;
+  } else {
+    nativeLink = errno == EINPROGRESS ? LINK_OPENING : LINK_FAILED;
+  }
+}
+
+/**
+ * Enlace abierto: deja el handshake para halLinkTakeHandshake()
+ */
+static void linkOpened(bool resumed, size_t peakHeapBytes) {
+  linkHandshake.durationMs = (uint32_t)((halMicros() - linkOpenedAt) / 1000);
+  linkHandshake.peakHeapBytes = (uint32_t)peakHeapBytes;
+  linkHandshake.resumed = resumed;
+  linkHandshakeFresh = true;
+  nativeLink = LINK_OPEN;
+}
+
+/**
+ * TCP conectado: empieza el handshake ofreciendo la sesión anterior
+ */
+static void startTls() {
+  tlsHostHeapMark();
+  brokerSsl = SSL_new(tlsContext);
+  SSL_set_fd(brokerSsl, brokerSocket);
+  SSL_set_connect_state(brokerSsl);
+
+  tlsSessionOffered = TLS_SESSION_RESUMPTION && tlsSession != nullptr &&
+                      SSL_set_session(brokerSsl, tlsSession) == 1;
+}
+
+/**
+ * Avanza el handshake con lo que haya llegado (no bloquea)
+ */
+static void continueTls() {
+  int result = SSL_connect(brokerSsl);
+  if (result == 1) {
+    if (tlsSession != nullptr) {
+      SSL_SESSION_free(tlsSession);
+    }
+    tlsSession = SSL_get1_session(brokerSsl);
+    linkOpened(SSL_session_reused(brokerSsl) == 1, tlsHostHeapPeak());
+    return;
+  }
+
+  int error = SSL_get_error(brokerSsl, result);
+  if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+    // Una sesión que acabó en fallo no se vuelve a ofrecer
+    if (tlsSessionOffered) {
+      nativeForgetTlsSession();
+    }
+    nativeLink = LINK_FAILED;
+  }
+}
+
+HalLinkState halLinkState() {
+  if (nativeLink == LINK_OPENING && brokerSocket < 0) {
+    if (halMillis() >= linkReadyAt) {
+      linkOpened(tlsSessionOffered, 0);
+      modelSessionCached = true;
+    }
+  } else if (nativeLink == LINK_OPENING && brokerSsl == nullptr) {
+    pollfd p = { brokerSocket, POLLOUT, 0 };
+    if (poll(&p, 1, 0) > 0) {
+      int error = 0;
+      socklen_t length = sizeof(error);
+      getsockopt(brokerSocket, SOL_SOCKET, SO_ERROR, &error, &length);
+      if (error != 0) {
+        nativeLink = LINK_FAILED;
+      } else if (tlsContext == nullptr) {
+        linkOpened(false, 0);
+      } else {
+        startTls();
+      }
+    }
+  }
+
+  if (nativeLink == LINK_OPENING && brokerSsl != nullptr) {
+    continueTls();
+  }
+  return nativeLink;
+}
+
+bool halLinkTakeHandshake(HalHandshake& handshake) {
+  if (halLinkState() != LINK_OPEN || !linkHandshakeFresh) {
+    return false;
+  }
+
+  linkHandshakeFresh = false;
+  handshake = linkHandshake;
+  return true;
+}
+
+size_t halLinkWrite(const uint8_t* data, size_t length) {
+  if (halLinkState() != LINK_OPEN) {
+    return 0;
+  }
+
+  if (brokerSsl != nullptr) {
+    int sent = SSL_write(brokerSsl, data, (int)length);
+    if (sent <= 0) {
+      int error = SSL_get_error(brokerSsl, sent);
+      if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+        nativeLink = LINK_FAILED;
+      }
+      return 0;
+    }
+    return (size_t)sent;
+  }
+
+  if (brokerSocket >= 0) {
+    ssize_t sent = send(brokerSocket, data, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        nativeLink = LINK_FAILED;
+      }
+      return 0;
+    }
+    return (size_t)sent;
+  }
+
+  // El broker en memoria procesa cada paquete en cuanto está completo
+  uint8_t* space = brokerIn.space();
+  size_t accepted = length < brokerIn.room() ? length : brokerIn.room();
+  memcpy(space, data, accepted);
+  brokerIn.commit(accepted);
+
+  MqttPacket packet;
+  while (brokerIn.next(packet) == MQTT_FRAME_OK) {
+    brokerHandle(packet);
+  }
+  return accepted;
+}
+
+size_t halLinkRead(uint8_t* out, size_t capacity) {
+  if (halLinkState() != LINK_OPEN) {
+    return 0;
+  }
+
+  if (brokerSsl != nullptr) {
+    int received = SSL_read(brokerSsl, out, (int)capacity);
+    if (received <= 0) {
+      int error = SSL_get_error(brokerSsl, received);
+      if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+        nativeLink = LINK_FAILED;
+      }
+      return 0;
+    }
+    return (size_t)received;
+  }
+
+  if (brokerSocket >= 0) {
+    ssize_t received = recv(brokerSocket, out, capacity, MSG_DONTWAIT);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      nativeLink = LINK_FAILED;
+      return 0;
+    }
+    return received > 0 ? (size_t)received : 0;
+  }
+
+  size_t available = brokerOutLength - brokerOutRead;
+  size_t n = capacity < available ? capacity : available;
+  memcpy(out, brokerOut + brokerOutRead, n);
+  brokerOutRead += n;
+  return n;
+}
+
+void halLinkClose() {
+  if (brokerSsl != nullptr) {
+    // Sin close_notify OpenSSL invalida la sesión y no se podría reanudar
+    if (SSL_is_init_finished(brokerSsl)) {
+      SSL_shutdown(brokerSsl);
+    }
+    SSL_free(brokerSsl);
+    brokerSsl = nullptr;
+  }
+  linkHandshakeFresh = false;
+  if (brokerSocket >= 0) {
+    close(brokerSocket);
+    brokerSocket = -1;
+  }
+  brokerSession = false;
+  nativeLink = LINK_CLOSED;
+}
+
+static bool brokerSubscribed(const char* topic) {
+  for (size_t i = 0; i < brokerFilterCount; i++) {
+    if (mqttTopicMatches(brokerFilters[i], strlen(brokerFilters[i]), topic, strlen(topic))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t nativeBrokerSubscriptions(size_t* packets) {
+  if (packets != nullptr) {
+    *packets = brokerSubscribePackets;
+  }
+  return brokerSession ? brokerFilterCount : 0;
+}
+
+/**
+ * Entrega un mensaje entrante como lo haría el broker, a QoS1 si la
+ * suscripción lo pide (solo con el broker en memoria y si la sesión está
+ * suscrita al topic)
+ */
+void nativeMqttInject(const char* topic, const uint8_t* payload, size_t length) {
+  if (nativeLink != LINK_OPEN || !brokerSession || brokerSocket >= 0 ||
+      !brokerSubscribed(topic)) {
+    return;
+  }
+
+  size_t capacity;
+  uint8_t* out = brokerReply(capacity);
+  brokerPacketId = brokerPacketId == 0xFFFF ? 1 : brokerPacketId + 1;
+  brokerOutLength += mqttEncodePublish(out, capacity, topic, strlen(topic), payload, length,
+                                       MQTT_QOS_COMMANDS, brokerPacketId, false);
+}
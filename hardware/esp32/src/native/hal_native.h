@@ -0,0 +1,71 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include "../hal.h"
+#include <stdio.h>
+
+/**
+ * Controles de la HAL nativa (env:native): permiten al ejecutable del
+ * host fijar el entorno simulado, el reloj y el estado de la red.
+ */
+
+// Condiciones del invernadero simulado
+struct NativeEnvironment {
+  float temperatura;     // °C
+  float humedad;         // %
+  float humedadSuelo;    // %
+  float luminosidad;     // %
+};
+
+// Calcula el entorno en el instante ms (reloj de la HAL)
+typedef void (*NativeEnvironmentFn)(unsigned long ms, NativeEnvironment& env);
+
+// Entorno: nullptr = ciclo diario por defecto con suelo que responde a la bomba
+void nativeSetEnvironment(NativeEnvironmentFn fn);
+void nativeDefaultEnvironment(unsigned long ms, NativeEnvironment& env);
+
+// Fallo forzado del DHT22 en las siguientes transacciones (DHT_OK = sin fallo)
+void nativeSetDhtFault(Dht22Status status);
+
+// Reloj virtual: solo avanza con nativeAdvanceClock() y halDelay()
+void nativeUseVirtualClock(bool enabled);
+void nativeAdvanceClock(unsigned long us);
+
+// GPIO: el gancho recibe cada escritura (nivel lógico del pin)
+typedef void (*NativePinHook)(uint8_t pin, bool high);
+bool nativePinLevel(uint8_t pin);
+void nativeSetPinHook(NativePinHook hook);
+
+// Red: AP y broker alcanzables. Al cambiar de canal (p. ej. tras reiniciarse
+// el AP) la asociación cae y el BSSID/canal guardados dejan de servir.
+void nativeSetLinkUp(bool up);
+void nativeSetAccessPointChannel(uint8_t channel);
+void nativeMqttInject(const char* topic, const uint8_t* payload, size_t length);
+uint32_t nativeRestartCount();
+
+// Filtros suscritos en la sesión del broker en memoria y, en packets,
+// cuántos SUBSCRIBE llegaron para ello
+size_t nativeBrokerSubscriptions(size_t* packets);
+
+// Broker real en host:port (IPv4) en lugar del broker en memoria.
+// Llamar antes de initMQTT(); nativeMqttInject() no tiene efecto.
+void nativeUseBroker(const char* host, uint16_t port);
+
+// TLS hacia el broker real con este contexto de cliente (nullptr = sin TLS;
+// ver tls_host.h). Olvidar la sesión fuerza un handshake completo, también
+// en el modelo del broker en memoria.
+struct ssl_ctx_st;
+void nativeUseTls(ssl_ctx_st* context);
+void nativeForgetTlsSession();
+
+// Gancho de publicaciones aceptadas por el broker en memoria
+typedef void (*NativePublishHook)(const char* topic, const uint8_t* payload, size_t length);
+void nativeSetPublishHook(NativePublishHook hook);
+
+// Destino de halConsoleWrite() (nullptr = descartar)
+void nativeSetConsole(FILE* file);
+
+// Destino de halTraceWrite() (nullptr = descartar)
+void nativeSetTraceFile(FILE* file);
+
+#endif // HAL_NATIVE_H
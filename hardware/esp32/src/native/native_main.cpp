@@ -0,0 +1,285 @@
+#include "hal_native.h"
+#include "benchmarks.h"
+#include "replay.h"
+#include "control_sim.h"
+#include "tests.h"
+#include "tls_host.h"
+#include "../config.h"
+#include "../app.h"
+#include "../actuator_registry.h"
+#include "../mqtt_client.h"
+#include "../connectivity.h"
+#include "../trace.h"
+#include "../boot_timings.h"
+#include "../logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Ejecutable del host (env:native)
+ *
+ *   program [--bench] [--hours H]   Suite de benchmarks (por defecto, 1 h de loop)
+ *   program --simulate H            Ejecuta H horas simuladas y resume el resultado
+ *     [--outage-every S] [--outage-s S]
+ *                                   Corta el AP cada S segundos durante S segundos
+ *                                   (uno de cada dos vuelve en otro canal) y mide
+ *                                   la recuperación de WiFi y MQTT
+ *   program --replay traza.bin      Reproduce una traza registrada (ver trace.h)
+ *   --record salida.bin             Registra la ejecución (simulación o reproducción)
+ *   program --mqtt-bench S [--broker IP:PUERTO]
+ *                                   Cliente MQTT durante S segundos reales contra un
+ *                                   broker del host (por defecto, uno local en el proceso)
+ *   program --tls-bench N [--ecdsa] N reconexiones con TLS mutuo contra el broker local,
+ *                                   sin y con reanudación de sesión
+ *   program --control-sim H         Lazos de ventilador y bomba contra un modelo de
+ *                                   planta: escalón y H horas de ciclo diario
+ *   program --test [FILTRO]         Pruebas del host (las que contienen FILTRO)
+ *   --verbose                       Escribe el registro del firmware (logger.h) en stderr
+ *
+ * Código de salida distinto de 0 si los benchmarks detectan una regresión,
+ * falla alguna prueba o las lecturas de una traza no sobreviven a la
+ * compresión.
+ */
+
+static void usage(const char* program) {
+  printf("Uso: %s [--bench] [--hours H] | --simulate H [--outage-every S --outage-s S]"
+         " | --replay traza.bin [--record salida.bin]\n"
+         "       [--verbose]\n"
+         "       %s --mqtt-bench S [--broker IP:PUERTO]\n"
+         "       %s --tls-bench N [--ecdsa]\n"
+         "       %s --control-sim H\n"
+         "       %s --test [FILTRO]\n", program, program, program, program, program);
+}
+
+static void printRecovery(const char* label, const LatencyHistogram& h) {
+  printf("  %-22s n=%-5llu p50 %u ms  p99 %u ms  max %u ms\n", label,
+         (unsigned long long)h.count(), (unsigned)h.percentile(0.50),
+         (unsigned)h.percentile(0.99), (unsigned)h.max());
+}
+
+// Último resumen publicado en TOPIC_DIAGNOSTICO
+char lastDiagnostics[DIAG_REPORT_SIZE + 1] = "";
+
+static void keepDiagnostics(const char* topic, const uint8_t* payload, size_t length) {
+  if (strcmp(topic, TOPIC_DIAGNOSTICO) == 0 && length < sizeof(lastDiagnostics)) {
+    memcpy(lastDiagnostics, payload, length);
+    lastDiagnostics[length] = '\0';
+  }
+}
+
+/**
+ * Ejecuta el firmware con el reloj virtual y resume lo publicado. Con
+ * outageEveryS > 0 el AP desaparece periódicamente durante outageS.
+ */
+static void simulate(float hours, unsigned long outageEveryS, unsigned long outageS) {
+  unsigned long iterations = (unsigned long)(hours * 3600000.0f / LOOP_IDLE_DELAY_MS);
+  unsigned long startMs = halMillis();
+  unsigned long outages = 0;
+  bool apDown = false;
+  bool awaitingSession = false;
+  unsigned long restoredAt = 0;
+  LatencyHistogram afterRestoreMs;    // AP de vuelta -> sesión MQTT
+  nativeSetPublishHook(keepDiagnostics);
+
+  for (unsigned long i = 0; i < iterations; i++) {
+    nativeAdvanceClock(LOOP_IDLE_DELAY_MS * 1000UL);
+
+    if (outageEveryS > 0) {
+      unsigned long phase = (halMillis() - startMs) % (outageEveryS * 1000UL);
+      bool down = phase >= (outageEveryS - outageS) * 1000UL;
+      if (down && !apDown) {
+        nativeSetLinkUp(false);
+        outages++;
+      } else if (!down && apDown) {
+        // Uno de cada dos cortes es un reinicio del AP que cambia de canal
+        if (outages % 2 == 0) {
+          nativeSetAccessPointChannel(outages % 4 == 0 ? 6 : 11);
+        }
+        nativeSetLinkUp(true);
+        awaitingSession = true;
+        restoredAt = halMillis();
+      }
+      apDown = down;
+    }
+
+    appAcquisitionStep();
+    appNetworkStep();
+    logDrain(LOG_DRAIN_BATCH);
+
+    if (awaitingSession && isMQTTConnected()) {
+      afterRestoreMs.record((uint32_t)(halMillis() - restoredAt));
+      awaitingSession = false;
+    }
+  }
+
+  const MqttStats& stats = getMqttStats();
+  printf("%.1f h simuladas\n", hours);
+  printf("  publicados %u mensajes, %u B de payload\n",
+         (unsigned)stats.messages, (unsigned)stats.payloadBytes);
+  printf("  reinicios solicitados: %u\n", (unsigned)nativeRestartCount());
+
+  const ConnectivityStats& net = getConnectivityStats();
+  printf("  cortes del AP %lu; WiFi: %u caídas, %u asociaciones directas,"
+         " %u con búsqueda, %u intentos fallidos\n", outages, (unsigned)net.wifiDrops,
+         (unsigned)net.fastJoins, (unsigned)net.scanJoins, (unsigned)net.failedJoins);
+  printRecovery("recuperación WiFi", net.wifiRecoveryMs);
+  printRecovery("recuperación MQTT", net.serviceRecoveryMs);
+  if (outages > 0) {
+    printRecovery("AP de vuelta -> MQTT", afterRestoreMs);
+  }
+
+  const TlsStats& tls = getTlsStats();
+  printf("  handshakes TLS %u (%u reanudados)\n", (unsigned)tls.handshakes, (unsigned)tls.resumed);
+  printRecovery("TLS completo", tls.fullMs);
+  printRecovery("TLS reanudado", tls.resumedMs);
+
+  printf("  arranque (ms):");
+  for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+    uint32_t ms;
+    if (bootStageReached((BootStage)i, ms)) {
+      printf(" %s %u", bootStageName((BootStage)i), (unsigned)ms);
+    }
+  }
+  printf("\n");
+  if (lastDiagnostics[0] != '\0') {
+    printf("  último diagnóstico: %s\n", lastDiagnostics);
+  }
+
+  for (size_t i = 0; i < ACTUATOR_COUNT; i++) {
+    // Relays activos en LOW
+    printf("  %s: %s\n", ACTUATORS[i].name,
+           nativePinLevel(ACTUATORS[i].pin) ? "apagado" : "encendido");
+  }
+}
+
+int main(int argc, char** argv) {
+  bool bench = true;
+  float hours = 1.0f;
+  const char* replayPath = nullptr;
+  const char* recordPath = nullptr;
+  float mqttBenchS = 0;
+  unsigned long outageEveryS = 0;
+  unsigned long outageS = 0;
+  char brokerHost[64] = "";
+  uint16_t brokerPort = 0;
+  unsigned tlsReconnects = 0;
+  bool ecdsa = false;
+  float controlSimHours = 0;
+  bool test = false;
+  const char* testFilter = nullptr;
+
+  // OpenSSL debe contar su memoria desde la primera asignación
+  tlsHostInit();
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bench") == 0) {
+      bench = true;
+    } else if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+      hours = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--simulate") == 0 && i + 1 < argc) {
+      bench = false;
+      hours = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--outage-every") == 0 && i + 1 < argc) {
+      outageEveryS = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--outage-s") == 0 && i + 1 < argc) {
+      outageS = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      bench = false;
+      replayPath = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordPath = argv[++i];
+    } else if (strcmp(argv[i], "--mqtt-bench") == 0 && i + 1 < argc) {
+      mqttBenchS = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--tls-bench") == 0 && i + 1 < argc) {
+      tlsReconnects = (unsigned)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--control-sim") == 0 && i + 1 < argc) {
+      controlSimHours = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--test") == 0) {
+      bench = false;
+      test = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-') {
+        testFilter = argv[++i];
+      }
+    } else if (strcmp(argv[i], "--ecdsa") == 0) {
+      ecdsa = true;
+    } else if (strcmp(argv[i], "--verbose") == 0) {
+      nativeSetConsole(stderr);
+    } else if (strcmp(argv[i], "--broker") == 0 && i + 1 < argc) {
+      if (sscanf(argv[++i], "%63[^:]:%hu", brokerHost, &brokerPort) != 2) {
+        usage(argv[0]);
+        return 2;
+      }
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (hours <= 0 || (bench && recordPath != nullptr) || (ecdsa && tlsReconnects == 0) ||
+      (test && (recordPath != nullptr || replayPath != nullptr)) ||
+      (outageEveryS > 0 && (bench || test || replayPath != nullptr || outageS == 0 ||
+                            outageS >= outageEveryS))) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // Los lazos de control se simulan sin el resto del firmware
+  if (controlSimHours > 0) {
+    return runControlSimulation(controlSimHours) ? 0 : 1;
+  }
+
+  // El transporte se mide con reloj real y sin el resto del firmware
+  if (tlsReconnects > 0) {
+    return runTlsBenchmark(ecdsa, tlsReconnects) ? 0 : 1;
+  }
+  if (mqttBenchS > 0) {
+    return runMqttBenchmark(brokerPort != 0 ? brokerHost : nullptr, brokerPort, mqttBenchS) ? 0 : 1;
+  }
+  if (brokerPort != 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // Toda la lógica corre sobre el reloj virtual
+  nativeUseVirtualClock(true);
+
+  FILE* record = nullptr;
+  if (recordPath != nullptr) {
+    record = fopen(recordPath, "wb");
+    if (record == nullptr) {
+      printf("No se pudo crear %s\n", recordPath);
+      return 2;
+    }
+    nativeSetTraceFile(record);
+    traceBegin();
+  }
+
+  if (replayPath != nullptr && !replayBegin(replayPath)) {
+    return 2;
+  }
+
+  appSetup();
+
+  if (bench) {
+    return runBenchmarks(hours) ? 0 : 1;
+  }
+  if (test) {
+    return runTests(testFilter) ? 0 : 1;
+  }
+
+  bool ok = true;
+  if (replayPath != nullptr) {
+    ok = replayRun();
+  } else {
+    simulate(hours, outageEveryS, outageS);
+  }
+
+  if (record != nullptr) {
+    traceFlush(true);
+    fclose(record);
+    printf("Traza guardada en %s (%u registros perdidos)\n", recordPath,
+           (unsigned)traceDropped());
+  }
+  return ok ? 0 : 1;
+}
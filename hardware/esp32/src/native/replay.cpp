@@ -0,0 +1,492 @@
+#include "replay.h"
+#include "hal_native.h"
+#include "benchmarks.h"
+#include "../config.h"
+#include "../app.h"
+#include "../actuator_registry.h"
+#include "../mqtt_client.h"
+#include "../trace.h"
+#include "../logger.h"
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+/**
+ * Motor de reproducción de trazas (env:native).
+ *
+ * Entrega los mensajes entrantes y los cambios de conexión de la traza en
+ * su instante original sobre el reloj virtual, mientras la lógica del
+ * firmware corre sin cambios. Las lecturas de la traza forman una señal
+ * continua (interpolación lineal entre lecturas consecutivas) que el
+ * firmware lee cuando su calendario de muestreo lo pide; cada cruce de un
+ * umbral de las reglas en la señal se compara con la primera lectura que
+ * lo ve. Las publicaciones resultantes se comparan con las registradas y
+ * se resumen en un digest FNV-1a que solo depende de las entradas: dos
+ * compilaciones con el mismo digest publican exactamente lo mismo y en los
+ * mismos instantes.
+ */
+
+#define REPLAY_TAIL_MS (TELEMETRY_BATCH_MAX_AGE_MS + 1000)  // Vaciar el último lote
+#define REPLAY_MAX_GAP_MS 600000            // Lecturas más separadas: hueco, se mantiene el valor
+#define REPLAY_MAX_CROSSINGS 4              // Por métrica y tramo de la señal
+#define REPLAY_HISTOGRAM_STEP_NS 10
+#define REPLAY_HISTOGRAM_BUCKETS 2000       // Hasta 20 us; el resto cuenta como máximo
+#define REPLAY_MAX_TRANSITIONS_SHOWN 50
+
+struct TopicCounts {
+  uint32_t recorded;
+  uint32_t replayed;
+  uint64_t recordedBytes;
+  uint64_t replayedBytes;
+};
+
+struct ActuatorTransition {
+  unsigned long ms;
+  size_t actuator;
+  bool on;
+};
+
+struct SignalPoint {
+  unsigned long at;
+  SensorData reading;
+};
+
+// Cruce de un umbral en la señal, pendiente de que el firmware lo lea
+struct SignalCrossing {
+  unsigned long at;
+  float before;         // Valor justo antes del cruce
+};
+
+std::vector<uint8_t> replayData;
+std::map<std::string, TopicCounts> replayTopics;
+std::vector<ActuatorTransition> replayTransitions;
+bool replayActuatorOn[ACTUATOR_COUNT] = {};
+uint64_t replayDigest = 1469598103934665603ULL;
+
+std::vector<SignalPoint> replaySignal;      // Lecturas de la primera sesión
+size_t replaySignalNext = 0;                // Lecturas ya alcanzadas por el reloj virtual
+SensorData replaySampled = SensorData();    // Lo último leído por el firmware
+std::vector<SignalCrossing> replayCrossings[SENSOR_METRIC_COUNT];
+uint32_t replayDetected = 0;
+uint32_t replayMissed = 0;
+uint64_t replayLatencySumMs = 0;
+unsigned long replayLatencyMaxMs = 0;
+
+static void digest(const void* data, size_t length) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < length; i++) {
+    replayDigest = (replayDigest ^ bytes[i]) * 1099511628211ULL;
+  }
+}
+
+static float* metricField(SensorData& data, size_t metric) {
+  float* const fields[SENSOR_METRIC_COUNT] = {
+    &data.temperatura, &data.humedad, &data.humedadSuelo, &data.luminosidad
+  };
+  return fields[metric];
+}
+
+static float metricValue(const SensorData& data, size_t metric) {
+  const float values[SENSOR_METRIC_COUNT] = {
+    data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+  };
+  return values[metric];
+}
+
+/**
+ * Indica si pasar de from a to en una métrica cruza un umbral de las
+ * reglas cargadas en el firmware
+ */
+static bool crossesMetric(size_t metric, float from, float to) {
+  SensorData a = SensorData();
+  SensorData b = SensorData();
+  *metricField(a, metric) = from;
+  *metricField(b, metric) = to;
+  return getRuleEngine().crosses(a, b);
+}
+
+static bool interpolable(const SignalPoint& a, const SignalPoint& b) {
+  return a.reading.valid && b.reading.valid && b.at > a.at && b.at - a.at <= REPLAY_MAX_GAP_MS;
+}
+
+/**
+ * Valor de la señal en el instante now (ya alcanzado por el reloj virtual)
+ */
+static SensorData signalAt(unsigned long now) {
+  const SignalPoint& a = replaySignal[replaySignalNext - 1];
+  if (replaySignalNext == replaySignal.size() || !interpolable(a, replaySignal[replaySignalNext])) {
+    return a.reading;
+  }
+
+  const SignalPoint& b = replaySignal[replaySignalNext];
+  float f = (float)(now - a.at) / (b.at - a.at);
+  SensorData value = a.reading;
+  for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+    float from = metricValue(a.reading, m);
+    *metricField(value, m) = from + (metricValue(b.reading, m) - from) * f;
+  }
+  return value;
+}
+
+/**
+ * Busca los cruces de umbral del tramo que empieza en la última lectura
+ * alcanzada: por bisección si el tramo se interpola, o en el salto al
+ * final del tramo si hay un hueco en la traza
+ */
+static void findCrossings() {
+  if (replaySignalNext == replaySignal.size()) {
+    return;
+  }
+  const SignalPoint& a = replaySignal[replaySignalNext - 1];
+  const SignalPoint& b = replaySignal[replaySignalNext];
+  if (!a.reading.valid || !b.reading.valid) {
+    return;
+  }
+  bool linear = interpolable(a, b);
+
+  for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+    float from = metricValue(a.reading, m);
+    float to = metricValue(b.reading, m);
+    float start = 0;
+
+    for (int n = 0; n < REPLAY_MAX_CROSSINGS && crossesMetric(m, from + (to - from) * start, to); n++) {
+      float lo = start;
+      float hi = 1;
+      for (int i = 0; linear && i < 24; i++) {
+        float mid = (lo + hi) / 2;
+        if (crossesMetric(m, from + (to - from) * start, from + (to - from) * mid)) {
+          hi = mid;
+        } else {
+          lo = mid;
+        }
+      }
+
+      SignalCrossing crossing = { a.at + (unsigned long)((b.at - a.at) * hi), from + (to - from) * lo };
+      replayCrossings[m].push_back(crossing);
+      start = hi;
+    }
+  }
+}
+
+/**
+ * Cierra los cruces ya ocurridos de una métrica que el firmware acaba de
+ * leer: detectado si la lectura queda al otro lado del umbral, perdido si
+ * la señal volvió antes de leerse
+ */
+static void resolveCrossings(size_t metric, float value, unsigned long now) {
+  std::vector<SignalCrossing>& pending = replayCrossings[metric];
+  size_t done = 0;
+
+  while (done < pending.size() && pending[done].at <= now) {
+    if (crossesMetric(metric, pending[done].before, value)) {
+      unsigned long latency = now - pending[done].at;
+      replayDetected++;
+      replayLatencySumMs += latency;
+      replayLatencyMaxMs = latency > replayLatencyMaxMs ? latency : replayLatencyMaxMs;
+    } else {
+      replayMissed++;
+    }
+    done++;
+  }
+  pending.erase(pending.begin(), pending.begin() + done);
+}
+
+/**
+ * Fuente de lecturas de la tarea de adquisición durante la reproducción:
+ * lee la señal de la traza para los sensores que tocan
+ */
+static uint8_t replayReading(uint8_t sensors, SensorData& data) {
+  if (sensors == 0 || replaySignalNext == 0) {
+    return 0;
+  }
+
+  unsigned long now = halMillis();
+  SensorData signal = signalAt(now);
+  if (!signal.valid) {
+    data = replaySampled;
+    data.valid = false;
+    data.timestamp = now;
+    return sensors;
+  }
+
+  for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+    if (sensors & (1u << sensorOfMetric(m))) {
+      *metricField(replaySampled, m) = metricValue(signal, m);
+      resolveCrossings(m, metricValue(signal, m), now);
+    }
+  }
+  replaySampled.valid = true;
+  replaySampled.timestamp = now;
+  data = replaySampled;
+  return sensors;
+}
+
+static void onPublish(const char* topic, const uint8_t* payload, size_t length) {
+  TopicCounts& counts = replayTopics[topic];
+  counts.replayed++;
+  counts.replayedBytes += length;
+
+  unsigned long now = halMillis();
+  digest(&now, sizeof(now));
+  digest(topic, strlen(topic));
+
+  // El diagnóstico lleva tiempos de reloj real: solo cuenta su instante
+  if (strcmp(topic, TOPIC_DIAGNOSTICO) != 0) {
+    digest(payload, length);
+  }
+}
+
+static void onPinWrite(uint8_t pin, bool high) {
+  for (size_t i = 0; i < ACTUATOR_COUNT; i++) {
+    // Relays activos en LOW
+    if (ACTUATORS[i].pin == pin && replayActuatorOn[i] != !high) {
+      replayActuatorOn[i] = !high;
+      ActuatorTransition transition = { halMillis(), i, !high };
+      replayTransitions.push_back(transition);
+      digest(&transition.ms, sizeof(transition.ms));
+      digest(ACTUATORS[i].suffix, ACTUATORS[i].suffixLength);
+      digest(&transition.on, sizeof(transition.on));
+    }
+  }
+}
+
+bool replayBegin(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    printf("No se pudo abrir %s\n", path);
+    return false;
+  }
+
+  uint8_t chunk[4096];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    replayData.insert(replayData.end(), chunk, chunk + read);
+  }
+  fclose(file);
+
+  TraceReader reader(replayData.data(), replayData.size());
+  TraceRecord record;
+  if (!reader.next(record) || record.type != TRACE_START) {
+    printf("%s no es una traza válida (versión %d)\n", path, TRACE_VERSION);
+    return false;
+  }
+
+  printf("Traza %s: %u B, thing %.*s\n", path, (unsigned)replayData.size(),
+         (int)record.topicLength, record.topic);
+
+  // La señal: las lecturas de la primera sesión
+  while (reader.next(record) && record.type != TRACE_START) {
+    if (record.type == TRACE_READING) {
+      SignalPoint point = { record.timestamp, record.reading };
+      replaySignal.push_back(point);
+    }
+  }
+
+  appSetReadingSource(replayReading);
+  nativeSetPublishHook(onPublish);
+  nativeSetPinHook(onPinWrite);
+  return true;
+}
+
+/**
+ * Aplica un registro de la traza en el instante actual
+ */
+static void deliver(const TraceRecord& record, uint32_t& linkChanges) {
+  char topic[256];
+
+  switch (record.type) {
+    case TRACE_READING:
+      // La señal avanza a un tramo nuevo
+      replaySignalNext++;
+      findCrossings();
+      break;
+
+    case TRACE_INBOUND:
+      memcpy(topic, record.topic, record.topicLength);
+      topic[record.topicLength] = '\0';
+      nativeMqttInject(topic, record.payload, record.payloadLength);
+      break;
+
+    case TRACE_PUBLISH: {
+      TopicCounts& counts = replayTopics[std::string(record.topic, record.topicLength)];
+      counts.recorded++;
+      counts.recordedBytes += record.payloadLength;
+      break;
+    }
+
+    case TRACE_LINK:
+      nativeSetLinkUp(record.connected);
+      linkChanges++;
+      break;
+
+    default:
+      break;
+  }
+}
+
+static uint32_t percentile(const std::vector<uint64_t>& histogram, uint64_t total, double p) {
+  uint64_t target = (uint64_t)(total * p);
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < histogram.size(); i++) {
+    seen += histogram[i];
+    if (seen > target) {
+      return (uint32_t)(i * REPLAY_HISTOGRAM_STEP_NS);
+    }
+  }
+  return (uint32_t)(histogram.size() * REPLAY_HISTOGRAM_STEP_NS);
+}
+
+static void printTime(unsigned long ms) {
+  unsigned long s = ms / 1000;
+  printf("%3lud %02lu:%02lu:%02lu", s / 86400, s / 3600 % 24, s / 60 % 60, s % 60);
+}
+
+bool replayRun() {
+  TraceReader reader(replayData.data(), replayData.size());
+  TraceRecord record;
+  reader.next(record);   // TRACE_START de la primera sesión
+
+  bool pending = reader.next(record) && record.type != TRACE_START;
+  uint32_t lastTimestamp = 0;
+  uint32_t linkChanges = 0;
+  uint32_t ignoredSessions = 0;
+
+  std::vector<uint64_t> histogram(REPLAY_HISTOGRAM_BUCKETS + 1, 0);
+  uint64_t iterations = 0;
+  uint64_t totalNs = 0;
+  uint64_t maxNs = 0;
+  unsigned long startMs = halMillis();
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+  for (;;) {
+    unsigned long now = halMillis();
+
+    // Entregar todo lo que ya ocurrió en la traza
+    while (pending && record.timestamp <= now) {
+      deliver(record, linkChanges);
+      lastTimestamp = record.timestamp;
+      pending = reader.next(record);
+
+      if (pending && record.type == TRACE_START) {
+        pending = false;
+        ignoredSessions++;
+        TraceRecord rest;
+        while (reader.next(rest)) {
+          if (rest.type == TRACE_START) {
+            ignoredSessions++;
+          }
+        }
+      }
+    }
+
+    if (!pending && now >= lastTimestamp + REPLAY_TAIL_MS) {
+      break;
+    }
+
+    nativeAdvanceClock(LOOP_IDLE_DELAY_MS * 1000UL);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    appAcquisitionStep();
+    appNetworkStep();
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+
+    size_t bucket = ns / REPLAY_HISTOGRAM_STEP_NS;
+    histogram[bucket < REPLAY_HISTOGRAM_BUCKETS ? bucket : REPLAY_HISTOGRAM_BUCKETS]++;
+    totalNs += ns;
+    maxNs = ns > maxNs ? ns : maxNs;
+    iterations++;
+
+    // La tarea de registro, fuera de la medición
+    logDrain(LOG_DRAIN_BATCH);
+  }
+
+  double wallS = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - wallStart).count() / 1000.0;
+  double simulatedS = (halMillis() - startMs) / 1000.0;
+
+  printf("\n== Reproducción ==\n");
+  printf("  %.1f h simuladas en %.2f s (x%.0f), %llu iteraciones\n", simulatedS / 3600.0,
+         wallS, wallS > 0 ? simulatedS / wallS : 0.0, (unsigned long long)iterations);
+  printf("  cambios de conexión %u, reinicios solicitados %u\n",
+         (unsigned)linkChanges, (unsigned)nativeRestartCount());
+  if (ignoredSessions > 0) {
+    printf("  (se ignoraron %u sesiones posteriores a un reinicio)\n", (unsigned)ignoredSessions);
+  }
+  if (reader.truncated()) {
+    printf("  (la traza termina con un registro incompleto)\n");
+  }
+
+  printf("\n== Loop ==\n");
+  printf("  media %.0f ns  p50 %u ns  p99 %u ns  p99.9 %u ns  max %llu ns\n",
+         iterations > 0 ? (double)totalNs / iterations : 0.0,
+         percentile(histogram, iterations, 0.50), percentile(histogram, iterations, 0.99),
+         percentile(histogram, iterations, 0.999), (unsigned long long)maxNs);
+
+  printf("\n== Publicaciones (registradas / reproducidas) ==\n");
+  for (std::map<std::string, TopicCounts>::const_iterator it = replayTopics.begin();
+       it != replayTopics.end(); ++it) {
+    const TopicCounts& c = it->second;
+    printf("  %-40s %6u / %-6u %8llu / %llu B%s\n", it->first.c_str(),
+           (unsigned)c.recorded, (unsigned)c.replayed,
+           (unsigned long long)c.recordedBytes, (unsigned long long)c.replayedBytes,
+           c.recorded != c.replayed ? "  <- difiere" : "");
+  }
+
+  const SamplingStats& sampling = getSamplingStats();
+  printf("\n== Muestreo ==\n");
+  printf("  traza: %u lecturas; firmware: %u lecturas (DHT22 %u, suelo %u, luz %u)\n",
+         (unsigned)replaySignal.size(), (unsigned)sampling.readings,
+         (unsigned)sampling.reads[SENSOR_DHT22], (unsigned)sampling.reads[SENSOR_SUELO],
+         (unsigned)sampling.reads[SENSOR_LUZ]);
+  printf("  cruces de umbral %u: detectados %u (latencia media %.1f s, máxima %.1f s), perdidos %u\n",
+         (unsigned)(replayDetected + replayMissed), (unsigned)replayDetected,
+         replayDetected > 0 ? replayLatencySumMs / 1000.0 / replayDetected : 0.0,
+         replayLatencyMaxMs / 1000.0, (unsigned)replayMissed);
+
+  // Peor caso para el consumidor: el mayor silencio (cambio dentro de la
+  // banda muerta) más la mayor espera de una lectura en el lote
+  const ReportStats& report = getReportStats();
+  const BatchStats& batch = getBatchStats();
+  uint32_t readings = report.sent + report.suppressed;
+  printf("\n== Reporte por excepción ==\n");
+  printf("  lecturas %u: publicadas %u (cambio %u, umbral %u, latido %u), descartadas %u (%.1f %%)\n",
+         (unsigned)readings, (unsigned)report.sent, (unsigned)report.changes,
+         (unsigned)report.crossings, (unsigned)report.heartbeats, (unsigned)report.suppressed,
+         readings > 0 ? 100.0 * report.suppressed / readings : 0.0);
+  printf("  telemetría: %u mensajes, %u B; silencio máximo %.0f s, espera máxima en lote %.0f s,"
+         " retraso máximo %.0f s\n", (unsigned)batch.messages, (unsigned)batch.bytes,
+         report.maxSilenceMs / 1000.0, batch.maxWaitMs / 1000.0,
+         (report.maxSilenceMs + batch.maxWaitMs) / 1000.0);
+
+  printf("\n== Transiciones de actuadores (%u) ==\n", (unsigned)replayTransitions.size());
+  for (size_t i = 0; i < replayTransitions.size() && i < REPLAY_MAX_TRANSITIONS_SHOWN; i++) {
+    printf("  ");
+    printTime(replayTransitions[i].ms);
+    printf("  %-12s %s\n", ACTUATORS[replayTransitions[i].actuator].name,
+           replayTransitions[i].on ? "ENCENDIDO" : "APAGADO");
+  }
+  if (replayTransitions.size() > REPLAY_MAX_TRANSITIONS_SHOWN) {
+    printf("  ... %u más\n", (unsigned)(replayTransitions.size() - REPLAY_MAX_TRANSITIONS_SHOWN));
+  }
+
+  // Las lecturas válidas de la traza, como las comprimiría CODEC_SERIES
+  std::vector<SensorData> traced;
+  for (size_t i = 0; i < replaySignal.size(); i++) {
+    if (replaySignal[i].reading.valid) {
+      traced.push_back(replaySignal[i].reading);
+    }
+  }
+  bool compressed = true;
+  if (!traced.empty()) {
+    printf("\n== Compresión de series ==\n");
+    compressed = reportSeriesCompression("trace", traced.data(), traced.size());
+  }
+
+  printf("\nDigest: %016llx\n", (unsigned long long)replayDigest);
+  return compressed;
+}
@@ -0,0 +1,13 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Carga la traza e instala la fuente de lecturas y los ganchos de la HAL
+// nativa. Llamar antes de appSetup().
+bool replayBegin(const char* path);
+
+// Reproduce la primera sesión de la traza con el reloj virtual e imprime
+// el informe (tiempos del loop, publicaciones, transiciones de actuadores
+// y compresión de sus lecturas). false si la compresión no las reproduce.
+bool replayRun();
+
+#endif // REPLAY_H
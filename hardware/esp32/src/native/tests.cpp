@@ -0,0 +1,1131 @@
+#include "tests.h"
+#include "hal_native.h"
+#include "benchmarks.h"
+#include "../config.h"
+#include "../app.h"
+#include "../actuator_registry.h"
+#include "../adc_double_buffer.h"
+#include "../adc_filter.h"
+#include "../dht22_decoder.h"
+#include "../mqtt_client.h"
+#include "../sensors.h"
+#include "../storage_backend.h"
+#include "../telemetry_log.h"
+#include "../telemetry_batcher.h"
+#include "../payload_codec.h"
+#include "../series_codec.h"
+#include "../spsc_ring.h"
+#include "../logger.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+/**
+ * Pruebas del host (program --test): propiedades que el firmware debe
+ * cumplir, con el reloj virtual y la HAL nativa. Cada prueba informa sus
+ * fallos con CHECK y la suite termina con código distinto de 0 si alguna
+ * falla. Las que usan el firmware completo corren sobre el estado que deja
+ * appSetup().
+ */
+
+static unsigned checkFailures = 0;
+
+static bool check(bool ok, const char* what, const char* file, int line) {
+  if (!ok) {
+    printf("  FALLO %s:%d: %s\n", file, line, what);
+    checkFailures++;
+  }
+  return ok;
+}
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+/**
+ * Una iteración del firmware como en --simulate: reloj, adquisición, red
+ */
+static void firmwareStep() {
+  nativeAdvanceClock(LOOP_IDLE_DELAY_MS * 1000UL);
+  appAcquisitionStep();
+  appNetworkStep();
+  logDrain(LOG_DRAIN_BATCH);
+}
+
+// ============================================
+// ADQUISICIÓN
+// ============================================
+#define COMMAND_TEST_MINUTES 10
+#define COMMAND_LATENCY_MAX_MS (2 * LOOP_IDLE_DELAY_MS)
+#define COMMAND_LOST_MS 1000
+
+/**
+ * Con el DHT22 fallando en todas las transacciones la adquisición encadena
+ * reintentos (SENSOR_RETRY_DELAY_MS entre ellos). Se envía un comando de
+ * actuador en cuanto se aplica el anterior, así que siempre hay uno en
+ * vuelo cuando la adquisición avanza un paso: cada uno debe llegar al
+ * relay en una o dos iteraciones del loop.
+ */
+static void testCommandLatencyDuringDhtRetries() {
+  const ActuatorInfo& info = ACTUATORS[ACTUATOR_LUCES];
+
+  for (unsigned long waited = 0; !isMQTTConnected() && waited < 120000; waited++) {
+    firmwareStep();
+  }
+  if (!CHECK(isMQTTConnected())) {
+    return;
+  }
+
+  nativeSetDhtFault(DHT_ERR_CHECKSUM);
+
+  unsigned long end = halMillis() + COMMAND_TEST_MINUTES * 60000UL;
+  unsigned long injectedAt = 0;
+  unsigned long maxLatencyMs = 0;
+  unsigned commands = 0, applied = 0, duringAcquisition = 0;
+  bool pending = false;
+  bool state = false;
+
+  while ((long)(halMillis() - end) < 0) {
+    if (!pending) {
+      state = !state;
+      const char* payload = state ? "{\"state\":true}" : "{\"state\":false}";
+      nativeMqttInject(info.topic, (const uint8_t*)payload, strlen(payload));
+      injectedAt = halMillis();
+      pending = true;
+      commands++;
+      if (isSensorAcquisitionBusy()) {
+        duringAcquisition++;
+      }
+    }
+
+    firmwareStep();
+
+    unsigned long latency = halMillis() - injectedAt;
+    // Relays activos en LOW
+    if (nativePinLevel(info.pin) != state) {
+      applied++;
+    } else if (latency < COMMAND_LOST_MS) {
+      continue;
+    }
+    maxLatencyMs = latency > maxLatencyMs ? latency : maxLatencyMs;
+    pending = false;
+  }
+
+  nativeSetDhtFault(DHT_OK);
+
+  printf("  %u comandos (%u con una lectura en curso), latencia máxima %lu ms\n",
+         commands, duringAcquisition, maxLatencyMs);
+  CHECK(applied + (pending ? 1 : 0) == commands);
+  CHECK(duringAcquisition > 0);
+  CHECK(maxLatencyMs <= COMMAND_LATENCY_MAX_MS);
+}
+
+// ============================================
+// DHT22
+// ============================================
+#define DHT_TEST_PULSES (3 + 2 + 2 * 40)
+
+struct DhtTestFrame {
+  DhtPulse pulses[DHT_TEST_PULSES];
+  size_t count;
+};
+
+/**
+ * Captura como la del RMT: fin de la señal de inicio del host, respuesta
+ * del sensor y 40 bits. jitter alterna unos us arriba y abajo del nominal.
+ */
+static DhtTestFrame dhtFrame(const uint8_t bytes[5], int jitter) {
+  DhtTestFrame frame;
+  frame.count = 0;
+  frame.pulses[frame.count++] = { 1, 30 };
+  frame.pulses[frame.count++] = { 0, 80 };
+  frame.pulses[frame.count++] = { 1, 80 };
+  for (int bit = 0; bit < 40; bit++) {
+    int offset = bit % 2 ? jitter : -jitter;
+    bool one = bytes[bit / 8] & (0x80 >> (bit % 8));
+    frame.pulses[frame.count++] = { 0, (uint16_t)(50 + offset) };
+    frame.pulses[frame.count++] = { 1, (uint16_t)((one ? 70 : 26) + offset) };
+  }
+  return frame;
+}
+
+// Ejemplo del datasheet: 65,2 % y 35,1 °C
+static const uint8_t DHT_EXAMPLE[5] = { 0x02, 0x8C, 0x01, 0x5F, 0xEE };
+
+static void testDhtCleanFrame() {
+  Dht22Reading reading = { 0, 0 };
+  DhtTestFrame frame = dhtFrame(DHT_EXAMPLE, 0);
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_OK);
+  CHECK(reading.humedad == 65.2f && reading.temperatura == 35.1f);
+
+  // Tiempos reales de un sensor, dentro de la tolerancia
+  reading = { 0, 0 };
+  frame = dhtFrame(DHT_EXAMPLE, 12);
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_OK);
+  CHECK(reading.humedad == 65.2f && reading.temperatura == 35.1f);
+}
+
+// Bit 15 de la temperatura = signo; la magnitud no es complemento a dos
+static void testDhtNegativeTemperature() {
+  const uint8_t bytes[5] = { 0x01, 0xF4, 0x80, 0x65, 0xDA };   // 50,0 % y -10,1 °C
+  Dht22Reading reading = { 0, 0 };
+  DhtTestFrame frame = dhtFrame(bytes, 0);
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_OK);
+  CHECK(reading.humedad == 50.0f && reading.temperatura == -10.1f);
+}
+
+static void testDhtBadChecksum() {
+  uint8_t bytes[5];
+  memcpy(bytes, DHT_EXAMPLE, sizeof(bytes));
+  bytes[4] ^= 0x01;
+  Dht22Reading reading = { 0, 0 };
+  DhtTestFrame frame = dhtFrame(bytes, 0);
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_ERR_CHECKSUM);
+
+  // Un bit de datos cambiado también
+  memcpy(bytes, DHT_EXAMPLE, sizeof(bytes));
+  bytes[3] ^= 0x10;
+  frame = dhtFrame(bytes, 0);
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_ERR_CHECKSUM);
+}
+
+// Captura cortada en el último bit, a mitad de un bit o tras la respuesta
+static void testDhtTruncatedTrain() {
+  Dht22Reading reading = { 0, 0 };
+  DhtTestFrame frame = dhtFrame(DHT_EXAMPLE, 0);
+  CHECK(decodeDht22(frame.pulses, frame.count - 2, reading) == DHT_ERR_TRUNCATED);
+  CHECK(decodeDht22(frame.pulses, frame.count - 1, reading) == DHT_ERR_TRUNCATED);
+  CHECK(decodeDht22(frame.pulses, 41, reading) == DHT_ERR_TRUNCATED);
+  CHECK(decodeDht22(frame.pulses, 3, reading) == DHT_ERR_TRUNCATED);
+}
+
+// Un alto fuera de tolerancia invalida la trama aunque el checksum cuadre
+static void testDhtMistimedHighPulses() {
+  Dht22Reading reading = { 0, 0 };
+  DhtTestFrame frame = dhtFrame(DHT_EXAMPLE, 0);
+  frame.pulses[3 + 2 + 2 * 20 + 1].duration = 140;
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_ERR_TIMING);
+
+  frame = dhtFrame(DHT_EXAMPLE, 0);
+  frame.pulses[3 + 2 + 2 * 33 + 1].duration = 4;
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_ERR_TIMING);
+
+  // Dos altos seguidos (un bajo perdido en la captura)
+  frame = dhtFrame(DHT_EXAMPLE, 0);
+  frame.pulses[3 + 2 + 2 * 7].level = 1;
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_ERR_TIMING);
+}
+
+static void testDhtMissingStartPulse() {
+  Dht22Reading reading = { 0, 0 };
+  DhtTestFrame frame = dhtFrame(DHT_EXAMPLE, 0);
+
+  // Sin la respuesta del sensor: los bits no se toman por preámbulo
+  CHECK(decodeDht22(frame.pulses + 3, frame.count - 3, reading) == DHT_ERR_NO_RESPONSE);
+
+  // Respuesta demasiado corta
+  frame.pulses[1].duration = 40;
+  CHECK(decodeDht22(frame.pulses, frame.count, reading) == DHT_ERR_NO_RESPONSE);
+
+  CHECK(decodeDht22(frame.pulses, 0, reading) == DHT_ERR_NO_RESPONSE);
+}
+
+// ============================================
+// ADC
+// ============================================
+#define ADC_TEST_DECIMATION 50          // ADC_TIMER_RATE_HZ / ADC_OUTPUT_RATE_HZ
+#define ADC_TEST_WINDOW 4
+#define ADC_TEST_BLOCK 8
+
+static void pushRepeated(AdcDecimator& filter, uint16_t sample, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    filter.push(sample);
+  }
+}
+
+// Un valor diezmado por cada `decimation` muestras, ni antes ni después
+static void testAdcDecimationRatio() {
+  AdcDecimator filter;
+  filter.begin(ADC_TEST_DECIMATION, ADC_TEST_WINDOW);
+
+  pushRepeated(filter, 2000, ADC_TEST_DECIMATION - 1);
+  CHECK(!filter.ready() && filter.outputs() == 0);
+  filter.push(2000);
+  CHECK(filter.ready() && filter.outputs() == 1);
+
+  pushRepeated(filter, 2000, 9 * ADC_TEST_DECIMATION + ADC_TEST_DECIMATION / 2);
+  CHECK(filter.outputs() == 10);
+
+  // pushBlock lee un canal de un buffer entrelazado con el mismo diezmado
+  uint16_t interleaved[ADC_TEST_DECIMATION][2];
+  for (size_t i = 0; i < ADC_TEST_DECIMATION; i++) {
+    interleaved[i][0] = 100;
+    interleaved[i][1] = 3000;
+  }
+  AdcDecimator second;
+  second.begin(ADC_TEST_DECIMATION, ADC_TEST_WINDOW);
+  second.pushBlock(&interleaved[0][1], ADC_TEST_DECIMATION, 2);
+  CHECK(second.outputs() == 1 && second.latest() == 3000.0f);
+}
+
+/**
+ * El sobremuestreo resuelve por debajo de una cuenta y el promedio móvil
+ * sigue a los últimos `window` valores diezmados
+ */
+static void testAdcOversampledMean() {
+  AdcDecimator filter;
+  filter.begin(ADC_TEST_DECIMATION, ADC_TEST_WINDOW);
+
+  // Entre 2000 y 2001 cuentas, el 30 % de las muestras en la superior
+  for (size_t i = 0; i < ADC_TEST_DECIMATION; i++) {
+    filter.push(i % 10 < 3 ? 2001 : 2000);
+  }
+  CHECK(fabsf(filter.latest() - 2000.3f) < 0.03f);
+
+  // Escalón: cuatro valores a 1000 y luego dos a 3000
+  filter.begin(ADC_TEST_DECIMATION, ADC_TEST_WINDOW);
+  pushRepeated(filter, 1000, ADC_TEST_WINDOW * ADC_TEST_DECIMATION);
+  CHECK(filter.value() == 1000.0f);
+  pushRepeated(filter, 3000, 2 * ADC_TEST_DECIMATION);
+  CHECK(filter.latest() == 3000.0f && filter.value() == 2000.0f);
+  pushRepeated(filter, 3000, ADC_TEST_WINDOW * ADC_TEST_DECIMATION);
+  CHECK(filter.value() == 3000.0f);
+}
+
+// Un pico y una caída aislados dentro de un bloque no mueven el valor
+static void testAdcOutlierRejection() {
+  AdcDecimator filter;
+  filter.begin(ADC_TEST_DECIMATION, ADC_TEST_WINDOW);
+
+  for (size_t i = 0; i < ADC_TEST_DECIMATION; i++) {
+    filter.push(i == 7 ? 4095 : i == 31 ? 0 : 1500);
+  }
+  CHECK(filter.latest() == 1500.0f);
+
+  // Sin bastantes muestras para recortar se promedia todo
+  filter.begin(ADC_FILTER_TRIM_MIN - 1, 1);
+  filter.push(1000);
+  filter.push(1000);
+  filter.push(4000);
+  CHECK(filter.latest() == 2000.0f);
+}
+
+static void writeAdcBlock(AdcDoubleBuffer<ADC_TEST_BLOCK, 2>& buffer, uint16_t base) {
+  for (uint16_t i = 0; i < ADC_TEST_BLOCK; i++) {
+    const uint16_t values[2] = { (uint16_t)(base + i), (uint16_t)(base + 100 + i) };
+    CHECK(buffer.write(values) == (i == ADC_TEST_BLOCK - 1));
+  }
+}
+
+/**
+ * Doble buffer: el consumidor recibe el último bloque completo, entero y
+ * entrelazado, mientras el productor llena el otro; los bloques que no
+ * llegó a leer se cuentan como perdidos
+ */
+static void testAdcDoubleBufferSwap() {
+  static AdcDoubleBuffer<ADC_TEST_BLOCK, 2> buffer;
+  uint32_t lost = 0;
+
+  CHECK(buffer.take(lost) == nullptr);
+  writeAdcBlock(buffer, 1000);
+  const uint16_t* block = buffer.take(lost);
+  if (!CHECK(block != nullptr)) {
+    return;
+  }
+  CHECK(lost == 0);
+  CHECK(block[0] == 1000 && block[1] == 1100);
+  CHECK(block[2 * (ADC_TEST_BLOCK - 1)] == 1000 + ADC_TEST_BLOCK - 1);
+  CHECK(buffer.take(lost) == nullptr);
+
+  // Llenar el siguiente no toca el bloque en lectura
+  const uint16_t partial[2] = { 1, 2 };
+  buffer.write(partial);
+  CHECK(block[0] == 1000 && block[1] == 1100);
+  CHECK(buffer.take(lost) == nullptr);
+  for (uint16_t i = 1; i < ADC_TEST_BLOCK; i++) {
+    buffer.write(partial);
+  }
+  const uint16_t* next = buffer.take(lost);
+  CHECK(next != nullptr && next != block && next[0] == 1 && lost == 0);
+
+  // Tres bloques sin leer: llega el último y se pierden dos
+  writeAdcBlock(buffer, 2000);
+  writeAdcBlock(buffer, 3000);
+  writeAdcBlock(buffer, 4000);
+  block = buffer.take(lost);
+  CHECK(block != nullptr && block[0] == 4000 && block[1] == 4100 && lost == 2);
+}
+
+// ============================================
+// COLAS ENTRE TAREAS
+// ============================================
+#define RING_TEST_RECORDS 2000000       // Por cola
+#define RING_TEST_ORIGIN (SIZE_MAX - 1000)  // Los índices se desbordan al empezar
+
+// Comando como el de app.cpp más un número de secuencia
+struct SequencedCommand {
+  ActuatorId actuator;
+  bool state;
+  uint32_t sequence;
+};
+
+static SensorData ringReading(uint32_t sequence) {
+  SensorData data = SensorData();
+  data.temperatura = (float)(sequence % 1000);
+  data.humedad = (float)(sequence % 97);
+  data.timestamp = sequence;
+  data.valid = true;
+  return data;
+}
+
+static SequencedCommand ringCommand(uint32_t sequence) {
+  return { (ActuatorId)(sequence % ACTUATOR_COUNT), (sequence & 1) != 0, sequence };
+}
+
+/**
+ * Un hilo productor y uno consumidor por cola, como adquisición y red:
+ * lecturas de una en una (push/pop) y comandos por ráfagas (write/read)
+ * a través de colas pequeñas, que se llenan y vacían sin parar. El
+ * consumidor recibe cada registro una vez, íntegro y en orden, también
+ * cuando los índices se desbordan.
+ */
+static void testSpscRingThreadedFifo() {
+  static SpscRing<SensorData, 4> readings(RING_TEST_ORIGIN);
+  static SpscRing<SequencedCommand, 8> commands(RING_TEST_ORIGIN);
+  static std::atomic<bool> readingsDone(false), commandsDone(false);
+  uint32_t readingErrors = 0, commandErrors = 0;
+  uint32_t readingsSeen = 0, commandsSeen = 0;
+
+  std::thread readingProducer([] {
+    for (uint32_t seq = 0; seq < RING_TEST_RECORDS; ) {
+      if (readings.push(ringReading(seq))) {
+        seq++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    readingsDone = true;
+  });
+
+  std::thread commandProducer([] {
+    SequencedCommand burst[5];
+    for (uint32_t seq = 0; seq < RING_TEST_RECORDS; ) {
+      size_t count = 1 + seq % 5;
+      if (count > RING_TEST_RECORDS - seq) {
+        count = RING_TEST_RECORDS - seq;
+      }
+      for (size_t i = 0; i < count; i++) {
+        burst[i] = ringCommand(seq + i);
+      }
+      size_t written = commands.write(burst, count);
+      seq += written;
+      if (written == 0) {
+        std::this_thread::yield();
+      }
+    }
+    commandsDone = true;
+  });
+
+  // Cada consumidor sigue hasta que su productor terminó y la cola está
+  // vacía; tras un fallo se resincroniza para contar cada uno una vez
+  std::thread readingConsumer([&] {
+    SensorData data;
+    for (;;) {
+      bool finished = readingsDone.load();
+      if (!readings.pop(data)) {
+        if (finished) {
+          break;
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      SensorData expected = ringReading(readingsSeen);
+      if (data.timestamp != expected.timestamp || data.temperatura != expected.temperatura ||
+          data.humedad != expected.humedad || !data.valid) {
+        readingErrors++;
+        readingsSeen = (uint32_t)data.timestamp;
+      }
+      readingsSeen++;
+    }
+  });
+
+  std::thread commandConsumer([&] {
+    SequencedCommand burst[3];
+    for (;;) {
+      bool finished = commandsDone.load();
+      size_t n = commands.read(burst, 3);
+      if (n == 0) {
+        if (finished) {
+          break;
+        }
+        std::this_thread::yield();
+      }
+      for (size_t i = 0; i < n; i++) {
+        SequencedCommand expected = ringCommand(commandsSeen);
+        if (burst[i].sequence != expected.sequence || burst[i].actuator != expected.actuator ||
+            burst[i].state != expected.state) {
+          commandErrors++;
+          commandsSeen = burst[i].sequence;
+        }
+        commandsSeen++;
+      }
+    }
+  });
+
+  readingProducer.join();
+  commandProducer.join();
+  readingConsumer.join();
+  commandConsumer.join();
+
+  CHECK(readingErrors == 0 && readingsSeen == RING_TEST_RECORDS);
+  CHECK(commandErrors == 0 && commandsSeen == RING_TEST_RECORDS);
+  printf("  %u lecturas y %u comandos, %u fuera de orden\n", (unsigned)readingsSeen,
+         (unsigned)commandsSeen, (unsigned)(readingErrors + commandErrors));
+}
+
+// ============================================
+// MEMORIA
+// ============================================
+#define STEADY_WARMUP_MINUTES 10
+#define STEADY_TEST_MINUTES 60
+#define STEADY_COMMAND_MS 5000UL        // Entre comandos de actuador
+#define STEADY_RULES_MS 600000UL        // Entre tablas de reglas
+
+/**
+ * En régimen permanente ningún ciclo toca el heap: lecturas, lotes
+ * publicados, comandos de actuador y tablas de reglas recibidas. Tras un
+ * arranque con la sesión MQTT abierta y los primeros lotes enviados se
+ * cuentan las asignaciones de todo el proceso (operator new del host).
+ */
+static void testSteadyStateAllocations() {
+  static const char rules[] =
+    "{\"rules\":[[\"temperatura\",\">\",30,1,60,\"ventilador\",\"warning\"],"
+    "[\"humedad_suelo\",\"<\",35,2,0,\"bomba\",\"\"]]}";
+
+  for (unsigned long waited = 0; !isMQTTConnected() && waited < 120000; waited++) {
+    firmwareStep();
+  }
+  if (!CHECK(isMQTTConnected())) {
+    return;
+  }
+  for (unsigned long step = 0; step < STEADY_WARMUP_MINUTES * 60000UL / LOOP_IDLE_DELAY_MS; step++) {
+    firmwareStep();
+  }
+
+  uint64_t allocations = heapCounters().allocations;
+  uint32_t messages = getMqttStats().messages;
+  unsigned commands = 0;
+  unsigned long steps = STEADY_TEST_MINUTES * 60000UL / LOOP_IDLE_DELAY_MS;
+  unsigned long commandEvery = STEADY_COMMAND_MS / LOOP_IDLE_DELAY_MS;
+  unsigned long rulesEvery = STEADY_RULES_MS / LOOP_IDLE_DELAY_MS;
+
+  for (unsigned long step = 0; step < steps; step++) {
+    if (step % commandEvery == 0) {
+      const ActuatorInfo& info = ACTUATORS[commands % ACTUATOR_COUNT];
+      const char* payload = (commands / ACTUATOR_COUNT) % 2 ? "{\"state\":\"off\"}" : "{\"state\":\"on\"}";
+      nativeMqttInject(info.topic, (const uint8_t*)payload, strlen(payload));
+      commands++;
+    }
+    if (step % rulesEvery == rulesEvery / 2) {
+      nativeMqttInject(TOPIC_REGLAS, (const uint8_t*)rules, strlen(rules));
+    }
+    firmwareStep();
+  }
+
+  allocations = heapCounters().allocations - allocations;
+  messages = getMqttStats().messages - messages;
+  printf("  %lu iteraciones, %u comandos, %u mensajes publicados, %llu asignaciones\n",
+         steps, commands, (unsigned)messages, (unsigned long long)allocations);
+  CHECK(messages > 0);
+  CHECK(allocations == 0);
+}
+
+// ============================================
+// ALMACENAMIENTO LOCAL
+// ============================================
+#define LOG_TEST_SECTOR_SIZE 256        // 8 ranuras por sector
+#define LOG_TEST_SECTORS 4
+#define LOG_TEST_READINGS 40            // Más de una vuelta (32 ranuras)
+#define LOG_TEST_MAGIC 0x474F4C54u      // Cabecera de sector (telemetry_log.cpp)
+
+static SensorData logReading(uint32_t i) {
+  SensorData data = SensorData();
+  data.temperatura = 20.0f + i * 0.1f;
+  data.humedad = 50.0f + (i % 7);
+  data.humedadSuelo = 40.0f - (i % 5);
+  data.luminosidad = (float)(i % 100);
+  data.timestamp = 30000UL * i;
+  data.valid = true;
+  return data;
+}
+
+// La lectura recuperada es exactamente la que se anexó con su timestamp
+static bool isLogReading(const SensorData& data) {
+  SensorData expected = logReading(data.timestamp / 30000UL);
+  return data.timestamp % 30000UL == 0 && data.temperatura == expected.temperatura &&
+         data.humedad == expected.humedad && data.humedadSuelo == expected.humedadSuelo &&
+         data.luminosidad == expected.luminosidad;
+}
+
+/**
+ * Anexa lecturas y cada cinco reenvía tres, como el drenaje tras un
+ * corte. Retorna false en la primera escritura que falla.
+ */
+static bool logWorkload(TelemetryLog& log) {
+  SensorData batch[3];
+
+  for (uint32_t i = 0; i < LOG_TEST_READINGS; i++) {
+    if (!log.append(logReading(i))) {
+      return false;
+    }
+    if (i % 5 == 4 && !log.consume(log.peek(batch, 3))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Corte de energía tras cada número posible de bytes escritos (de 0 a
+ * la carga completa). Al volver a montar: el montaje termina, lo que el
+ * registro daba por pendiente sigue ahí (lo ya reenviado puede repetirse
+ * si no llegó a escribirse su marca), cada lectura es íntegra y en orden,
+ * y el registro sigue aceptando lecturas.
+ */
+static void testLogPowerCutSweep() {
+  const size_t slots = (LOG_TEST_SECTOR_SIZE - 8) / 28 * LOG_TEST_SECTORS;
+  SensorData before[64], after[64];
+  long budget;
+  unsigned replayed = 0;
+
+  for (budget = 0; ; budget++) {
+    RamStorageBackend backend(LOG_TEST_SECTOR_SIZE, LOG_TEST_SECTORS);
+    backend.setWriteBudget(budget);
+
+    TelemetryLog log;
+    bool completed = log.begin(&backend) && logWorkload(log);
+    size_t expected = log.peek(before, slots);
+
+    unsigned failures = checkFailures;
+    backend.setWriteBudget(-1);
+    TelemetryLog remounted;
+    CHECK(remounted.begin(&backend));
+    size_t found = remounted.peek(after, slots);
+    CHECK(found <= remounted.pending());
+
+    for (size_t i = 0; i < found; i++) {
+      CHECK(isLogReading(after[i]));
+      CHECK(i == 0 || after[i].timestamp > after[i - 1].timestamp);
+    }
+
+    size_t k = 0;
+    for (size_t i = 0; i < expected; i++) {
+      while (k < found && after[k].timestamp < before[i].timestamp) {
+        k++;
+      }
+      CHECK(k < found && after[k].timestamp == before[i].timestamp);
+    }
+    replayed += found - expected;
+
+    bool appended = true;
+    for (uint32_t i = 0; i < LOG_TEST_READINGS; i++) {
+      appended = remounted.append(logReading(1000 + i)) && appended;
+    }
+    CHECK(appended);
+    CHECK(remounted.pending() <= remounted.capacity());
+
+    if (checkFailures != failures) {
+      printf("  con corte tras %ld bytes\n", budget);
+      return;
+    }
+    if (completed) {
+      break;
+    }
+  }
+
+  printf("  %ld puntos de corte, %u lecturas ya reenviadas reaparecen\n", budget + 1, replayed);
+}
+
+/**
+ * Cabeceras con generaciones imposibles (en blanco, mayores de lo que
+ * cabe en las ranuras o lejos de la rotación) no se toman por el sector
+ * más reciente: el montaje termina y conserva lo pendiente.
+ */
+static void testLogImplausibleHeaders() {
+  static const uint32_t generations[] = { 0xFFFFFFFFu, 0xFFFFFF01u, 0x00100001u };
+  const size_t perSector = (LOG_TEST_SECTOR_SIZE - 8) / 28;
+
+  for (size_t g = 0; g < sizeof(generations) / sizeof(generations[0]); g++) {
+    RamStorageBackend backend(LOG_TEST_SECTOR_SIZE, LOG_TEST_SECTORS);
+    TelemetryLog log;
+    log.begin(&backend);
+    for (uint32_t i = 0; i < perSector; i++) {
+      log.append(logReading(i));
+    }
+
+    size_t sector = generations[g] % LOG_TEST_SECTORS;
+    uint32_t header[2] = { LOG_TEST_MAGIC, generations[g] };
+    backend.eraseSector(sector);
+    backend.write(sector * LOG_TEST_SECTOR_SIZE, header, sizeof(header));
+
+    TelemetryLog remounted;
+    SensorData data[8];
+    CHECK(remounted.begin(&backend));
+    CHECK(remounted.pending() == perSector);
+    CHECK(remounted.peek(data, 8) == perSector && isLogReading(data[0]) && data[0].timestamp == 0);
+    CHECK(remounted.append(logReading(perSector)) && remounted.pending() == perSector + 1);
+  }
+}
+
+/**
+ * Los volcados del backend van por lotes: uno cada STORE_SYNC_RECORDS
+ * lecturas más uno por sector abierto, y uno al consumir un lote
+ */
+static void testLogSyncBatching() {
+  const uint32_t perSector = STORE_SYNC_RECORDS * 5 / 2;
+  const uint32_t readings = perSector * 3;
+  RamStorageBackend backend(8 + perSector * 28, LOG_TEST_SECTORS);
+  TelemetryLog log;
+  CHECK(log.begin(&backend));
+
+  bool appended = true;
+  for (uint32_t i = 0; i < readings; i++) {
+    appended = log.append(logReading(i)) && appended;
+  }
+  CHECK(appended);
+
+  // Sector 0 al montar, los otros dos al llenarse el anterior
+  uint32_t expected = 3 + 3 * (perSector / STORE_SYNC_RECORDS);
+  CHECK(backend.syncCount() == expected);
+
+  SensorData batch[4];
+  uint32_t before = backend.syncCount();
+  CHECK(log.consume(log.peek(batch, 4)) && backend.syncCount() == before + 1);
+
+  printf("  %u lecturas, %u volcados (antes uno por escritura)\n",
+         (unsigned)readings, (unsigned)before);
+}
+
+// ============================================
+// CODIFICACIÓN
+// ============================================
+#define CODEC_TEST_READINGS 12
+#define CODEC_TOLERANCE 0.0051f         // Punto fijo en centésimas
+
+// Lecturas con signo, decimales y, en las impares, ventana de muestreo
+static SensorData codecReading(size_t i) {
+  SensorData data = SensorData();
+  data.temperatura = -8.37f + i * 3.21f;
+  data.humedad = 41.5f + i * 0.77f;
+  data.humedadSuelo = 63.04f - i * 1.5f;
+  data.luminosidad = (float)(i * 9 % 100) + 0.25f;
+  data.timestamp = 1000000UL + 30000UL * i + (i % 3) * 7;
+  data.valid = true;
+  if (i % 2 == 1) {
+    data.window[0] = { data.temperatura - 0.4f, data.temperatura + 0.6f, data.temperatura, 0.21f, 6 };
+    data.window[3] = { 0.0f, 99.99f, data.luminosidad, 12.5f, 300 };
+  }
+  return data;
+}
+
+static bool closeTo(float a, float b) {
+  return fabsf(a - b) <= CODEC_TOLERANCE;
+}
+
+struct DecodedSamples {
+  SensorData samples[CODEC_TEST_READINGS];
+  size_t count;
+};
+
+static void collectSample(const SensorData& data, void* context) {
+  DecodedSamples* decoded = (DecodedSamples*)context;
+  if (decoded->count < CODEC_TEST_READINGS) {
+    decoded->samples[decoded->count] = data;
+  }
+  decoded->count++;
+}
+
+/**
+ * Lote CBOR -> decodificador del host: mismas lecturas, timestamps exactos
+ * y valores y ventanas al redondeo de centésimas
+ */
+static void testCborBatchRoundTrip() {
+  uint8_t buffer[MQTT_BUFFER_SIZE];
+  BatchEncoder encoder;
+  encoder.begin(CODEC_CBOR, buffer, sizeof(buffer));
+  for (size_t i = 0; i < CODEC_TEST_READINGS; i++) {
+    CHECK(encoder.add(codecReading(i)));
+  }
+  size_t length = encoder.finish();
+
+  char thing[32] = "";
+  DecodedSamples decoded;
+  decoded.count = 0;
+  CHECK(decodeTelemetryCbor(buffer, length, thing, sizeof(thing), collectSample, &decoded));
+  CHECK(strcmp(thing, THING_NAME) == 0);
+  if (!CHECK(decoded.count == CODEC_TEST_READINGS)) {
+    return;
+  }
+
+  for (size_t i = 0; i < CODEC_TEST_READINGS; i++) {
+    const SensorData expected = codecReading(i);
+    const SensorData& got = decoded.samples[i];
+    const float want[SENSOR_METRIC_COUNT] = {
+      expected.temperatura, expected.humedad, expected.humedadSuelo, expected.luminosidad
+    };
+    const float have[SENSOR_METRIC_COUNT] = {
+      got.temperatura, got.humedad, got.humedadSuelo, got.luminosidad
+    };
+
+    CHECK(got.timestamp == expected.timestamp);
+    for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+      const MetricSummary& w = expected.window[m];
+      CHECK(closeTo(have[m], w.count > 0 ? w.mean : want[m]));
+      CHECK(got.window[m].count == w.count);
+      if (w.count > 0) {
+        CHECK(closeTo(got.window[m].min, w.min) && closeTo(got.window[m].max, w.max) &&
+              closeTo(got.window[m].stddev, w.stddev));
+      }
+    }
+  }
+
+  // Un lote truncado se rechaza
+  CHECK(!decodeTelemetryCbor(buffer, length / 2, thing, sizeof(thing), nullptr, nullptr));
+}
+
+struct DecodedAlerts {
+  Alert alerts[4];
+  unsigned long timestamp;
+  size_t count;
+};
+
+static void collectAlert(const Alert& alert, unsigned long timestamp, void* context) {
+  DecodedAlerts* decoded = (DecodedAlerts*)context;
+  if (decoded->count < 4) {
+    decoded->alerts[decoded->count] = alert;
+  }
+  decoded->timestamp = timestamp;
+  decoded->count++;
+}
+
+static void testCborAlertsRoundTrip() {
+  const Alert alerts[3] = {
+    { ALERT_TEMPERATURA, SEVERITY_CRITICAL, "Temperatura muy alta", 36.4f },
+    { ALERT_HUMEDAD_SUELO, SEVERITY_WARNING, "Suelo muy seco", 18.5f },
+    { ALERT_TEMPERATURA, SEVERITY_INFO, "Helada", -2.75f }
+  };
+  uint8_t buffer[256];
+  size_t length = encodeAlerts(CODEC_CBOR, 123456UL, alerts, 3, buffer, sizeof(buffer));
+
+  DecodedAlerts decoded;
+  decoded.count = 0;
+  CHECK(length > 0 && decodeAlertsCbor(buffer, length, collectAlert, &decoded));
+  if (!CHECK(decoded.count == 3)) {
+    return;
+  }
+  CHECK(decoded.timestamp == 123456UL);
+  for (size_t i = 0; i < 3; i++) {
+    CHECK(decoded.alerts[i].metric == alerts[i].metric);
+    CHECK(decoded.alerts[i].severity == alerts[i].severity);
+    CHECK(closeTo(decoded.alerts[i].value, alerts[i].value));
+  }
+}
+
+/**
+ * Bloque de series al límite de cada tramo: primera lectura en claro,
+ * cadencia irregular y saltos de horas en los timestamps (incluido el
+ * desbordamiento de millis()), valores negativos y saltos de 32 bits.
+ * Un bloque truncado no entrega lecturas de más.
+ */
+static void testSeriesRoundTripEdgeCases() {
+  static const unsigned long timestamps[CODEC_TEST_READINGS] = {
+    1000UL, 31000UL, 61000UL, 91003UL, 120990UL, 121000UL,
+    7321000UL, 7351000UL, 0xFFFFFF00UL, 0x00000100UL, 0x00007630UL, 0x00007631UL
+  };
+  static const float temperatures[CODEC_TEST_READINGS] = {
+    -40.0f, -39.99f, -39.99f, -12.5f, 0.0f, 0.01f,
+    80.0f, -40.0f, 10000000.0f, -10000000.0f, 0.3f, 0.3f
+  };
+
+  uint8_t buffer[CODEC_TEST_READINGS * SERIES_MAX_SAMPLE_BYTES + SERIES_HEADER_SIZE];
+  SeriesEncoder encoder;
+  encoder.begin(buffer, sizeof(buffer));
+  for (size_t i = 0; i < CODEC_TEST_READINGS; i++) {
+    SensorData data = codecReading(i);
+    data.timestamp = timestamps[i];
+    data.temperatura = temperatures[i];
+    CHECK(encoder.add(data));
+  }
+  size_t length = encoder.finish();
+
+  SeriesDecoder decoder(buffer, length);
+  CHECK(decoder.valid() && decoder.samples() == CODEC_TEST_READINGS);
+  SensorData got;
+  size_t count = 0;
+  while (decoder.next(got)) {
+    if (count < CODEC_TEST_READINGS) {
+      const SensorData expected = codecReading(count);
+      CHECK(got.timestamp == timestamps[count]);
+      CHECK(closeTo(got.temperatura, temperatures[count]));
+      CHECK(closeTo(got.humedad, expected.humedad) &&
+            closeTo(got.humedadSuelo, expected.humedadSuelo) &&
+            closeTo(got.luminosidad, expected.luminosidad));
+    }
+    count++;
+  }
+  CHECK(decoder.valid() && count == CODEC_TEST_READINGS);
+
+  // Una sola lectura: solo la cabecera y los valores en claro
+  encoder.begin(buffer, sizeof(buffer));
+  CHECK(encoder.add(codecReading(3)));
+  length = encoder.finish();
+  CHECK(length == SERIES_HEADER_SIZE + 20);
+  SeriesDecoder single(buffer, length);
+  CHECK(single.next(got) && got.timestamp == codecReading(3).timestamp);
+  CHECK(!single.next(got) && single.valid());
+
+  // Sin hueco para el peor caso de una lectura más, add() lo rechaza
+  encoder.begin(buffer, SERIES_HEADER_SIZE + SERIES_MAX_SAMPLE_BYTES);
+  CHECK(encoder.add(codecReading(0)));
+  CHECK(!encoder.add(codecReading(1)));
+  CHECK(encoder.finish() == SERIES_HEADER_SIZE + 20);
+
+  // Truncado: el decodificador se detiene y lo marca como inválido
+  encoder.begin(buffer, sizeof(buffer));
+  for (size_t i = 0; i < CODEC_TEST_READINGS; i++) {
+    encoder.add(codecReading(i));
+  }
+  length = encoder.finish();
+  SeriesDecoder truncated(buffer, length / 2);
+  count = 0;
+  while (truncated.next(got)) {
+    count++;
+  }
+  CHECK(!truncated.valid() && count < CODEC_TEST_READINGS);
+
+  // Y el lote saliente truncado se rechaza entero
+  uint8_t batch[MQTT_BUFFER_SIZE];
+  BatchEncoder batchEncoder;
+  batchEncoder.begin(CODEC_SERIES, batch, sizeof(batch));
+  for (size_t i = 0; i < CODEC_TEST_READINGS; i++) {
+    CHECK(batchEncoder.add(codecReading(i)));
+  }
+  length = batchEncoder.finish();
+  CHECK(decodeTelemetrySeries(batch, length, nullptr, 0, nullptr, nullptr));
+  CHECK(!decodeTelemetrySeries(batch, length / 2, nullptr, 0, nullptr, nullptr));
+}
+
+// ============================================
+// SUSCRIPCIONES
+// ============================================
+#define SUBSCRIBE_TEST_RELAYS 32
+#define SESSION_WAIT_MS 600000UL        // Reasociación y backoff de reconexión
+
+// Registro generado como en los benchmarks de despacho, más el de reglas
+static char relayTopics[SUBSCRIBE_TEST_RELAYS][48];
+static ActuatorInfo relayRegistry[SUBSCRIBE_TEST_RELAYS];
+static ActuatorDispatchTable<SUBSCRIBE_TEST_RELAYS> relayDispatch;
+static const char* relayFilters[SUBSCRIBE_TEST_RELAYS + 1];
+static unsigned relayDeliveries[SUBSCRIBE_TEST_RELAYS + 1];
+
+static void countRelayMessage(const char* topic, const uint8_t* payload, size_t length) {
+  size_t index = dispatchTopic(relayRegistry, relayDispatch, topic, strlen(topic));
+  if (index == SUBSCRIBE_TEST_RELAYS && strcmp(topic, TOPIC_REGLAS) != 0) {
+    return;
+  }
+  relayDeliveries[index]++;
+}
+
+/**
+ * Corta el enlace y espera a la nueva sesión con `filters` filtros
+ * suscritos. false si no llega en SESSION_WAIT_MS.
+ */
+static bool reopenSession(size_t filters) {
+  nativeSetLinkUp(false);
+  firmwareStep();
+  nativeSetLinkUp(true);
+
+  for (unsigned long waited = 0; waited < SESSION_WAIT_MS; waited += LOOP_IDLE_DELAY_MS) {
+    firmwareStep();
+    if (isMQTTConnected() && nativeBrokerSubscriptions(nullptr) == filters) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * 32 relays y reglas no caben en un SUBSCRIBE del buffer de control: se
+ * suscriben en varios y cada topic recibe sus comandos. Un filtro que no
+ * cabe en ningún paquete hace fallar la sesión en lugar de darla por
+ * suscrita.
+ */
+static void testSubscribeGeneratedRegistry() {
+  // Con la sesión del arranque ya abierta (el arranque fija su callback)
+  for (unsigned long waited = 0; !isMQTTConnected() && waited < 120000; waited++) {
+    firmwareStep();
+  }
+
+  for (size_t i = 0; i < SUBSCRIBE_TEST_RELAYS; i++) {
+    snprintf(relayTopics[i], sizeof(relayTopics[i]), TOPIC_ACTUADORES_PREFIX "rele%02u",
+             (unsigned)i);
+    const char* suffix = relayTopics[i] + ACTUATOR_PREFIX_LENGTH;
+    relayRegistry[i] = { relayTopics[i], suffix, (uint8_t)strlen(suffix), (uint8_t)i, suffix };
+    relayFilters[i] = relayTopics[i];
+  }
+  relayFilters[SUBSCRIBE_TEST_RELAYS] = TOPIC_REGLAS;
+  relayDispatch = buildDispatchTable(relayRegistry);
+  memset(relayDeliveries, 0, sizeof(relayDeliveries));
+
+  setSubscriptions(relayFilters, SUBSCRIBE_TEST_RELAYS + 1);
+  setMessageCallback(countRelayMessage);
+  bool subscribed = CHECK(reopenSession(SUBSCRIBE_TEST_RELAYS + 1));
+
+  size_t packets = 0;
+  nativeBrokerSubscriptions(&packets);
+  printf("  %u filtros en %u SUBSCRIBE\n", (unsigned)(SUBSCRIBE_TEST_RELAYS + 1),
+         (unsigned)packets);
+  CHECK(packets > 1);
+
+  for (size_t i = 0; subscribed && i <= SUBSCRIBE_TEST_RELAYS; i++) {
+    const char* payload = "{\"state\":true}";
+    nativeMqttInject(relayFilters[i], (const uint8_t*)payload, strlen(payload));
+    firmwareStep();
+  }
+  for (size_t i = 0; subscribed && i <= SUBSCRIBE_TEST_RELAYS; i++) {
+    CHECK(relayDeliveries[i] == 1);
+  }
+
+  // Filtro mayor que el buffer de control tras uno que sí cabe: la sesión
+  // cae al llegar a él y nunca queda suscrita a ambos
+  static char longTopic[300];
+  memset(longTopic, 'x', sizeof(longTopic) - 1);
+  longTopic[sizeof(longTopic) - 1] = '\0';
+  const char* longFilters[2] = { TOPIC_REGLAS, longTopic };
+  setSubscriptions(longFilters, 2);
+  CHECK(!reopenSession(2));
+  CHECK(nativeBrokerSubscriptions(nullptr) < 2);
+
+  setSubscriptions(nullptr, 0);
+  setMessageCallback(handleInboundMessage);
+  CHECK(reopenSession(ACTUATOR_COUNT + 1));
+}
+
+// ============================================
+// PUBLICACIÓN
+// ============================================
+// Publicador de prueba: acepta mientras quede hueco y cuenta por topic
+static size_t legacyRoom = 0;
+static unsigned legacyMessages[4];
+
+static int legacyTopicIndex(const char* topic) {
+  static const char* const topics[] = {
+    TOPIC_TEMPERATURA, TOPIC_HUMEDAD, TOPIC_HUMEDAD_SUELO, TOPIC_LUMINOSIDAD
+  };
+  for (int i = 0; i < 4; i++) {
+    if (strcmp(topic, topics[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static bool legacyPublish(const char* topic, const uint8_t* payload, size_t length) {
+  int index = legacyTopicIndex(topic);
+  if (legacyRoom == 0 || index < 0) {
+    return false;
+  }
+  legacyRoom--;
+  legacyMessages[index]++;
+  return true;
+}
+
+static size_t legacyRoomFn(const char* topic) {
+  return legacyRoom;
+}
+
+/**
+ * Modo compatible con la cola casi llena: una lectura se publica en los
+ * cuatro topics o en ninguno, así el reintento del llamador no duplica
+ * los topics que ya salieron.
+ */
+static void testLegacyTopicsAllOrNothing() {
+  static uint8_t buffer[MQTT_BUFFER_SIZE];
+  TelemetryBatcher batcher(buffer, sizeof(buffer));
+  BatchPolicy policy = { TELEMETRY_LEGACY_TOPICS, 1, 0, CODEC_JSON };
+  batcher.begin(policy, legacyPublish, legacyRoomFn);
+  memset(legacyMessages, 0, sizeof(legacyMessages));
+
+  SensorData data = logReading(1);
+  unsigned delivered = 0;
+
+  // El hueco crece de uno en uno; cada lectura se reintenta hasta salir
+  for (size_t room = 0; room <= 12; room++) {
+    legacyRoom = room;
+    while (batcher.add(data, 0)) {
+      delivered++;
+    }
+  }
+
+  for (int i = 0; i < 4; i++) {
+    CHECK(legacyMessages[i] == delivered);
+  }
+  CHECK(delivered > 0);
+  CHECK(batcher.stats().samples == delivered);
+  CHECK(batcher.stats().messages == 4 * delivered);
+}
+
+// ============================================
+// SUITE
+// ============================================
+struct TestCase {
+  const char* name;
+  void (*run)();
+};
+
+static const TestCase TESTS[] = {
+  { "acquisition/command-latency-dht-retries", testCommandLatencyDuringDhtRetries },
+  { "dht22/clean-frame", testDhtCleanFrame },
+  { "dht22/negative-temperature", testDhtNegativeTemperature },
+  { "dht22/bad-checksum", testDhtBadChecksum },
+  { "dht22/truncated-train", testDhtTruncatedTrain },
+  { "dht22/mistimed-high-pulses", testDhtMistimedHighPulses },
+  { "dht22/missing-start-pulse", testDhtMissingStartPulse },
+  { "adc/decimation-ratio", testAdcDecimationRatio },
+  { "adc/oversampled-mean", testAdcOversampledMean },
+  { "adc/outlier-rejection", testAdcOutlierRejection },
+  { "adc/double-buffer-swap", testAdcDoubleBufferSwap },
+  { "ring/threaded-fifo", testSpscRingThreadedFifo },
+  { "memory/steady-state-allocations", testSteadyStateAllocations },
+  { "storage/log-power-cut-sweep", testLogPowerCutSweep },
+  { "storage/log-implausible-headers", testLogImplausibleHeaders },
+  { "storage/log-sync-batching", testLogSyncBatching },
+  { "codec/cbor-batch-round-trip", testCborBatchRoundTrip },
+  { "codec/cbor-alerts-round-trip", testCborAlertsRoundTrip },
+  { "codec/series-round-trip-edge-cases", testSeriesRoundTripEdgeCases },
+  { "mqtt/subscribe-generated-registry", testSubscribeGeneratedRegistry },
+  { "telemetry/legacy-topics-all-or-nothing", testLegacyTopicsAllOrNothing },
+};
+
+bool runTests(const char* filter) {
+  unsigned run = 0, failed = 0;
+
+  for (size_t i = 0; i < sizeof(TESTS) / sizeof(TESTS[0]); i++) {
+    if (filter != nullptr && strstr(TESTS[i].name, filter) == nullptr) {
+      continue;
+    }
+
+    unsigned before = checkFailures;
+    printf("%s\n", TESTS[i].name);
+    TESTS[i].run();
+    run++;
+    if (checkFailures != before) {
+      failed++;
+    }
+    printf("  %s\n", checkFailures == before ? "ok" : "FALLO");
+  }
+
+  printf("\n%u pruebas, %u fallidas\n", run, failed);
+  return run > 0 && failed == 0;
+}
@@ -0,0 +1,8 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+// Ejecuta las pruebas del host (las que contienen filter en su nombre;
+// nullptr = todas). Llamar tras appSetup(). Retorna false si alguna falla.
+bool runTests(const char* filter);
+
+#endif // TESTS_H
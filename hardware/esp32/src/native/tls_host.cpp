@@ -0,0 +1,189 @@
+#include "tls_host.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cipher suites y curva del ESP32 (nombres de OpenSSL)
+#define TLS_HOST_CIPHERS "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256"
+#define TLS_HOST_GROUPS "P-256"
+#define TLS_HOST_HEADER 16   // Mantiene la alineación de malloc
+
+// ============================================
+// MEMORIA
+// ============================================
+// Por hilo: el broker local corre en otro hilo y no debe sumarse al
+// handshake del cliente
+thread_local int64_t tlsLive = 0;
+thread_local int64_t tlsPeak = 0;
+thread_local int64_t tlsMark = 0;
+
+static void* countedMalloc(size_t size, const char* file, int line) {
+  uint8_t* block = (uint8_t*)malloc(size + TLS_HOST_HEADER);
+  if (block == nullptr) {
+    return nullptr;
+  }
+
+  memcpy(block, &size, sizeof(size));
+  tlsLive += size;
+  if (tlsLive > tlsPeak) {
+    tlsPeak = tlsLive;
+  }
+  return block + TLS_HOST_HEADER;
+}
+
+static void countedFree(void* ptr, const char* file, int line) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  uint8_t* block = (uint8_t*)ptr - TLS_HOST_HEADER;
+  size_t size;
+  memcpy(&size, block, sizeof(size));
+  tlsLive -= size;
+  free(block);
+}
+
+static void* countedRealloc(void* ptr, size_t size, const char* file, int line) {
+  if (ptr == nullptr) {
+    return countedMalloc(size, file, line);
+  }
+  if (size == 0) {
+    countedFree(ptr, file, line);
+    return nullptr;
+  }
+
+  void* copy = countedMalloc(size, file, line);
+  if (copy != nullptr) {
+    size_t old;
+    memcpy(&old, (uint8_t*)ptr - TLS_HOST_HEADER, sizeof(old));
+    memcpy(copy, ptr, old < size ? old : size);
+    countedFree(ptr, file, line);
+  }
+  return copy;
+}
+
+bool tlsHostInit() {
+  return CRYPTO_set_mem_functions(countedMalloc, countedRealloc, countedFree) == 1;
+}
+
+void tlsHostHeapMark() {
+  tlsPeak = tlsLive;
+  tlsMark = tlsLive;
+}
+
+size_t tlsHostHeapPeak() {
+  return (size_t)(tlsPeak - tlsMark);
+}
+
+// ============================================
+// CREDENCIALES
+// ============================================
+static EVP_PKEY* generateKey(bool ecdsa) {
+  return ecdsa ? EVP_EC_gen(TLS_HOST_GROUPS) : EVP_RSA_gen(2048);
+}
+
+static void addExtension(X509* cert, X509* issuer, int nid, const char* value) {
+  X509V3_CTX context;
+  X509V3_set_ctx_nodb(&context);
+  X509V3_set_ctx(&context, issuer, cert, nullptr, nullptr, 0);
+  X509_EXTENSION* extension = X509V3_EXT_conf_nid(nullptr, &context, nid, value);
+  if (extension != nullptr) {
+    X509_add_ext(cert, extension, -1);
+    X509_EXTENSION_free(extension);
+  }
+}
+
+/**
+ * Certificado de un día firmado por issuer (nullptr = autofirmado de CA)
+ */
+static X509* issueCertificate(EVP_PKEY* key, const char* commonName,
+                              X509* issuer, EVP_PKEY* issuerKey) {
+  static long serial = 1;
+  X509* cert = X509_new();
+  X509_set_version(cert, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), serial++);
+  X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 86400);
+  X509_set_pubkey(cert, key);
+
+  X509_NAME* name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)commonName, -1, -1, 0);
+
+  if (issuer == nullptr) {
+    X509_set_issuer_name(cert, name);
+    addExtension(cert, cert, NID_basic_constraints, "critical,CA:TRUE");
+    addExtension(cert, cert, NID_key_usage, "critical,keyCertSign");
+    X509_sign(cert, key, EVP_sha256());
+  } else {
+    X509_set_issuer_name(cert, X509_get_subject_name(issuer));
+    addExtension(cert, issuer, NID_basic_constraints, "critical,CA:FALSE");
+    X509_sign(cert, issuerKey, EVP_sha256());
+  }
+  return cert;
+}
+
+static SSL_CTX* makeContext(bool server, X509* ca, X509* cert, EVP_PKEY* key) {
+  SSL_CTX* context = SSL_CTX_new(server ? TLS_server_method() : TLS_client_method());
+  if (context == nullptr) {
+    return nullptr;
+  }
+
+  X509_STORE_add_cert(SSL_CTX_get_cert_store(context), ca);
+  SSL_CTX_use_certificate(context, cert);
+  SSL_CTX_use_PrivateKey(context, key);
+  SSL_CTX_set_max_proto_version(context, TLS1_2_VERSION);
+  SSL_CTX_set1_groups_list(context, TLS_HOST_GROUPS);
+  SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+  if (server) {
+    // TLS mutuo, como AWS IoT Core; tickets de sesión activados por defecto
+    static const unsigned char sessionContext[] = "invernadero";
+    SSL_CTX_set_verify(context, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, nullptr);
+    SSL_CTX_set_session_id_context(context, sessionContext, sizeof(sessionContext) - 1);
+  } else {
+    SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+    SSL_CTX_set_cipher_list(context, TLS_HOST_CIPHERS);
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+  }
+
+  if (SSL_CTX_check_private_key(context) != 1) {
+    SSL_CTX_free(context);
+    return nullptr;
+  }
+  return context;
+}
+
+/**
+ * Genera una CA de prueba y con ella los certificados del broker y del
+ * dispositivo, del tipo de clave indicado
+ */
+bool tlsHostContexts(bool ecdsa, ssl_ctx_st*& server, ssl_ctx_st*& client) {
+  EVP_PKEY* caKey = generateKey(ecdsa);
+  EVP_PKEY* serverKey = generateKey(ecdsa);
+  EVP_PKEY* deviceKey = generateKey(ecdsa);
+  if (caKey == nullptr || serverKey == nullptr || deviceKey == nullptr) {
+    EVP_PKEY_free(caKey);
+    EVP_PKEY_free(serverKey);
+    EVP_PKEY_free(deviceKey);
+    return false;
+  }
+
+  X509* ca = issueCertificate(caKey, "Invernadero CA de prueba", nullptr, nullptr);
+  X509* serverCert = issueCertificate(serverKey, "127.0.0.1", ca, caKey);
+  X509* deviceCert = issueCertificate(deviceKey, "invernadero-01", ca, caKey);
+
+  server = makeContext(true, ca, serverCert, serverKey);
+  client = makeContext(false, ca, deviceCert, deviceKey);
+
+  X509_free(ca);
+  X509_free(serverCert);
+  X509_free(deviceCert);
+  EVP_PKEY_free(caKey);
+  EVP_PKEY_free(serverKey);
+  EVP_PKEY_free(deviceKey);
+  return server != nullptr && client != nullptr;
+}
@@ -0,0 +1,25 @@
+#ifndef TLS_HOST_H
+#define TLS_HOST_H
+
+#include <stddef.h>
+
+/**
+ * TLS en el host (OpenSSL) para medir el enlace contra el broker local:
+ * credenciales de prueba generadas al vuelo (CA, servidor y dispositivo,
+ * RSA-2048 o ECDSA P-256) y contexto de cliente con las mismas suites,
+ * curva y versión que ofrece el ESP32 (ver tls_link.cpp).
+ */
+
+struct ssl_ctx_st;
+
+// Cuenta la memoria de OpenSSL por hilo. Llamar antes de cualquier otro uso.
+bool tlsHostInit();
+
+// Contextos de servidor (TLS mutuo, tickets de sesión) y de cliente
+bool tlsHostContexts(bool ecdsa, ssl_ctx_st*& server, ssl_ctx_st*& client);
+
+// Pico de memoria de OpenSSL en este hilo desde la última marca
+void tlsHostHeapMark();
+size_t tlsHostHeapPeak();
+
+#endif // TLS_HOST_H
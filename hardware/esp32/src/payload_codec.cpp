@@ -0,0 +1,681 @@
+#include "payload_codec.h"
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tipos mayores CBOR
+#define CBOR_UINT 0x00
+#define CBOR_NEGINT 0x20
+#define CBOR_TEXT 0x60
+#define CBOR_ARRAY 0x80
+#define CBOR_MAP 0xA0
+#define CBOR_ARRAY_INDEFINITE 0x9F
+#define CBOR_BREAK 0xFF
+#define CBOR_INDEFINITE 0xFFFFFFFFu  // Longitud indefinida al decodificar
+
+// Bytes reservados para cerrar un lote ("]}" en JSON, break en CBOR)
+#define JSON_BATCH_TRAILER 2
+#define CBOR_BATCH_TRAILER 1
+
+// ============================================
+// ESCRITURA JSON
+// ============================================
+
+/**
+ * Escribe un valor con dos decimales sin ceros finales (23.5, 24, 23.45),
+ * igual que ArduinoJson con los valores redondeados a centésimas
+ */
+static void formatValue(char* out, size_t capacity, float value) {
+  int len = snprintf(out, capacity, "%.2f", round(value * 100) / 100.0);
+
+  while (len > 0 && out[len - 1] == '0') {
+    len--;
+  }
+  if (len > 0 && out[len - 1] == '.') {
+    len--;
+  }
+  if (len == 2 && out[0] == '-' && out[1] == '0') {
+    out[0] = '0';
+    len = 1;
+  }
+  out[len] = '\0';
+}
+
+/**
+ * Escribe una métrica: el valor, o con ventana de muestreo el objeto
+ * {"min","max","media","desv","n"}. Retorna lo que ocuparía (snprintf).
+ */
+static int writeMetricJson(char* out, size_t capacity, const char* key, float value,
+                           const MetricSummary& window) {
+  if (window.count == 0) {
+    char v[16];
+    formatValue(v, sizeof(v), value);
+    return snprintf(out, capacity, ",\"%s\":%s", key, v);
+  }
+
+  char lo[16], hi[16], mean[16], sd[16];
+  formatValue(lo, sizeof(lo), window.min);
+  formatValue(hi, sizeof(hi), window.max);
+  formatValue(mean, sizeof(mean), window.mean);
+  formatValue(sd, sizeof(sd), window.stddev);
+  return snprintf(out, capacity, ",\"%s\":{\"min\":%s,\"max\":%s,\"media\":%s,\"desv\":%s,\"n\":%lu}",
+                  key, lo, hi, mean, sd, (unsigned long)window.count);
+}
+
+/**
+ * Serializa una lectura como objeto JSON (con "thing" si no es nullptr).
+ * Retorna la longitud escrita, o 0 si no cabe en el buffer.
+ */
+static size_t writeSampleJson(char* out, size_t capacity, const SensorData& data, const char* thing) {
+  static const char* const keys[SENSOR_METRIC_COUNT] = {
+    "temperatura", "humedad", "humedadSuelo", "luminosidad"
+  };
+  const float values[SENSOR_METRIC_COUNT] = {
+    data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+  };
+
+  int len = snprintf(out, capacity, "{%s%s%s\"timestamp\":%lu",
+                     thing != nullptr ? "\"thing\":\"" : "",
+                     thing != nullptr ? thing : "",
+                     thing != nullptr ? "\"," : "",
+                     data.timestamp);
+
+  for (size_t i = 0; i < SENSOR_METRIC_COUNT && len > 0 && (size_t)len < capacity; i++) {
+    len += writeMetricJson(out + len, capacity - len, keys[i], values[i], data.window[i]);
+  }
+
+  if (len > 0 && (size_t)len < capacity) {
+    len += snprintf(out + len, capacity - len, "}");
+  }
+
+  if (len < 0 || (size_t)len >= capacity) {
+    return 0;
+  }
+  return len;
+}
+
+// ============================================
+// ESCRITURA CBOR
+// ============================================
+
+/**
+ * Escribe la cabecera de un elemento CBOR (tipo mayor + argumento)
+ */
+static size_t cborHead(uint8_t* out, size_t room, uint8_t major, uint32_t value) {
+  if (value < 24) {
+    if (room < 1) return 0;
+    out[0] = major | value;
+    return 1;
+  }
+  if (value <= 0xFF) {
+    if (room < 2) return 0;
+    out[0] = major | 24;
+    out[1] = value;
+    return 2;
+  }
+  if (value <= 0xFFFF) {
+    if (room < 3) return 0;
+    out[0] = major | 25;
+    out[1] = value >> 8;
+    out[2] = value;
+    return 3;
+  }
+  if (room < 5) return 0;
+  out[0] = major | 26;
+  out[1] = value >> 24;
+  out[2] = value >> 16;
+  out[3] = value >> 8;
+  out[4] = value;
+  return 5;
+}
+
+static size_t cborInt(uint8_t* out, size_t room, int32_t value) {
+  if (value >= 0) {
+    return cborHead(out, room, CBOR_UINT, value);
+  }
+  return cborHead(out, room, CBOR_NEGINT, (uint32_t)(-1 - value));
+}
+
+static size_t cborText(uint8_t* out, size_t room, const char* text) {
+  size_t len = strlen(text);
+  size_t head = cborHead(out, room, CBOR_TEXT, len);
+  if (head == 0 || head + len > room) {
+    return 0;
+  }
+  memcpy(out + head, text, len);
+  return head + len;
+}
+
+// Valor en punto fijo (centésimas)
+static int32_t toFixed(float value) {
+  return (int32_t)lroundf(value * 100.0f);
+}
+
+/**
+ * Escribe una secuencia de elementos CBOR; retorna 0 si alguno no cabe
+ */
+#define CBOR_PUT(expr) do { size_t n_ = (expr); if (n_ == 0) return 0; pos += n_; } while (0)
+
+/**
+ * Una métrica: el valor, o con ventana [mín, máx, media, desv, n]
+ */
+static size_t writeMetricCbor(uint8_t* out, size_t room, float value, const MetricSummary& window) {
+  if (window.count == 0) {
+    return cborInt(out, room, toFixed(value));
+  }
+
+  size_t pos = 0;
+  CBOR_PUT(cborHead(out + pos, room - pos, CBOR_ARRAY, 5));
+  CBOR_PUT(cborInt(out + pos, room - pos, toFixed(window.min)));
+  CBOR_PUT(cborInt(out + pos, room - pos, toFixed(window.max)));
+  CBOR_PUT(cborInt(out + pos, room - pos, toFixed(window.mean)));
+  CBOR_PUT(cborInt(out + pos, room - pos, toFixed(window.stddev)));
+  CBOR_PUT(cborHead(out + pos, room - pos, CBOR_UINT, window.count));
+  return pos;
+}
+
+static size_t writeSampleCbor(uint8_t* out, size_t room, const SensorData& data,
+                              unsigned long baseTimestamp) {
+  const float values[SENSOR_METRIC_COUNT] = {
+    data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+  };
+
+  size_t pos = 0;
+  CBOR_PUT(cborHead(out + pos, room - pos, CBOR_ARRAY, 5));
+  CBOR_PUT(cborHead(out + pos, room - pos, CBOR_UINT, data.timestamp - baseTimestamp));
+  for (size_t i = 0; i < SENSOR_METRIC_COUNT; i++) {
+    CBOR_PUT(writeMetricCbor(out + pos, room - pos, values[i], data.window[i]));
+  }
+  return pos;
+}
+
+// ============================================
+// CODIFICADOR DE LOTES
+// ============================================
+
+BatchEncoder::BatchEncoder()
+  : format(CODEC_JSON), buffer(nullptr), capacity(0), length(0),
+    count(0), baseTimestamp(0) {}
+
+void BatchEncoder::begin(PayloadCodec codec, uint8_t* out, size_t outCapacity) {
+  format = codec;
+  buffer = out;
+  capacity = outCapacity;
+  count = 0;
+  length = 0;
+
+  if (format == CODEC_JSON) {
+    length = snprintf((char*)buffer, capacity, "{\"thing\":\"%s\",\"samples\":[", THING_NAME);
+  } else if (format == CODEC_SERIES) {
+    size_t thingLength = strlen(THING_NAME);
+    if (capacity < thingLength + 1) {
+      return;
+    }
+    buffer[0] = thingLength;
+    memcpy(buffer + 1, THING_NAME, thingLength);
+    length = thingLength + 1;
+    series.begin(buffer + length, capacity - length);
+  }
+  // En CBOR la cabecera se escribe con la primera lectura (timestamp base)
+}
+
+/**
+ * Añade una lectura al lote. Retorna false si no cabe; el lote sigue válido.
+ */
+bool BatchEncoder::add(const SensorData& data) {
+  if (format == CODEC_JSON) {
+    size_t room = capacity - length - JSON_BATCH_TRAILER;
+    size_t sep = count > 0 ? 1 : 0;
+
+    if (room <= sep) {
+      return false;
+    }
+
+    size_t written = writeSampleJson((char*)buffer + length + sep, room - sep, data, nullptr);
+    if (written == 0) {
+      return false;
+    }
+
+    if (sep) {
+      buffer[length] = ',';
+    }
+    length += sep + written;
+    count++;
+    return true;
+  }
+
+  if (format == CODEC_SERIES) {
+    if (length == 0 || !series.add(data)) {
+      return false;
+    }
+    count++;
+    return true;
+  }
+
+  size_t room = capacity - length - CBOR_BATCH_TRAILER;
+  size_t pos = 0;
+  uint8_t* out = buffer + length;
+
+  if (count == 0) {
+    // {0: thing, 1: base, 2: [_ ...
+    baseTimestamp = data.timestamp;
+    size_t n;
+    if ((n = cborHead(out + pos, room - pos, CBOR_MAP, 3)) == 0) return false;
+    pos += n;
+    if ((n = cborHead(out + pos, room - pos, CBOR_UINT, CBOR_KEY_THING)) == 0) return false;
+    pos += n;
+    if ((n = cborText(out + pos, room - pos, THING_NAME)) == 0) return false;
+    pos += n;
+    if ((n = cborHead(out + pos, room - pos, CBOR_UINT, CBOR_KEY_TIMESTAMP)) == 0) return false;
+    pos += n;
+    if ((n = cborHead(out + pos, room - pos, CBOR_UINT, baseTimestamp)) == 0) return false;
+    pos += n;
+    if ((n = cborHead(out + pos, room - pos, CBOR_UINT, CBOR_KEY_SAMPLES)) == 0) return false;
+    pos += n;
+    if (room - pos < 1) return false;
+    out[pos++] = CBOR_ARRAY_INDEFINITE;
+  }
+
+  size_t written = writeSampleCbor(out + pos, room - pos, data, baseTimestamp);
+  if (written == 0) {
+    return false;
+  }
+
+  length += pos + written;
+  count++;
+  return true;
+}
+
+/**
+ * Cierra el lote. Retorna la longitud total del payload (0 si está vacío).
+ */
+size_t BatchEncoder::finish() {
+  if (count == 0) {
+    return 0;
+  }
+
+  if (format == CODEC_JSON) {
+    buffer[length] = ']';
+    buffer[length + 1] = '}';
+    return length + JSON_BATCH_TRAILER;
+  }
+
+  if (format == CODEC_SERIES) {
+    return length + series.finish();
+  }
+
+  buffer[length] = CBOR_BREAK;
+  return length + CBOR_BATCH_TRAILER;
+}
+
+// ============================================
+// MENSAJES INDIVIDUALES
+// ============================================
+
+/**
+ * Serializa una lectura individual (formato de sensorDataToJson en JSON)
+ */
+size_t encodeSensorData(PayloadCodec codec, const SensorData& data,
+                        uint8_t* out, size_t capacity) {
+  if (codec == CODEC_JSON) {
+    return writeSampleJson((char*)out, capacity, data, THING_NAME);
+  }
+
+  BatchEncoder encoder;
+  encoder.begin(CODEC_CBOR, out, capacity);
+  if (!encoder.add(data)) {
+    return 0;
+  }
+  return encoder.finish();
+}
+
+/**
+ * Lectura individual en JSON a nombre de otro thing (simulación de flota)
+ */
+size_t encodeSensorDataJson(const char* thing, const SensorData& data,
+                            char* out, size_t capacity) {
+  return writeSampleJson(out, capacity, data, thing);
+}
+
+const char* alertMetricName(AlertMetric metric) {
+  switch (metric) {
+    case ALERT_TEMPERATURA: return "temperatura";
+    case ALERT_HUMEDAD: return "humedad";
+    case ALERT_HUMEDAD_SUELO: return "humedad_suelo";
+    case ALERT_LUMINOSIDAD: return "luminosidad";
+  }
+  return "desconocido";
+}
+
+const char* alertSeverityName(AlertSeverity severity) {
+  switch (severity) {
+    case SEVERITY_INFO: return "info";
+    case SEVERITY_WARNING: return "warning";
+    case SEVERITY_CRITICAL: return "critical";
+  }
+  return "info";
+}
+
+/**
+ * Serializa un mensaje de alertas. Retorna 0 si no cabe en el buffer.
+ */
+size_t encodeAlerts(PayloadCodec codec, unsigned long timestamp,
+                    const Alert* alerts, size_t count,
+                    uint8_t* out, size_t capacity) {
+  // CODEC_SERIES solo aplica a lotes: las alertas van en CBOR
+  if (codec == CODEC_JSON) {
+    char* text = (char*)out;
+    int pos = snprintf(text, capacity, "{\"thing\":\"%s\",\"timestamp\":%lu,\"alerts\":[",
+                       THING_NAME, timestamp);
+
+    for (size_t i = 0; i < count && pos > 0 && (size_t)pos < capacity; i++) {
+      char value[16];
+      formatValue(value, sizeof(value), alerts[i].value);
+      pos += snprintf(text + pos, capacity - pos,
+                      "%s{\"type\":\"%s\",\"severity\":\"%s\",\"message\":\"%s\",\"value\":%s}",
+                      i > 0 ? "," : "",
+                      alertMetricName(alerts[i].metric),
+                      alertSeverityName(alerts[i].severity),
+                      alerts[i].message, value);
+    }
+
+    if (pos > 0 && (size_t)pos < capacity) {
+      pos += snprintf(text + pos, capacity - pos, "]}");
+    }
+
+    if (pos < 0 || (size_t)pos >= capacity) {
+      return 0;
+    }
+    return pos;
+  }
+
+  size_t pos = 0;
+  CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_MAP, 3));
+  CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_UINT, CBOR_KEY_THING));
+  CBOR_PUT(cborText(out + pos, capacity - pos, THING_NAME));
+  CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_UINT, CBOR_KEY_TIMESTAMP));
+  CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_UINT, timestamp));
+  CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_UINT, CBOR_KEY_ALERTS));
+  CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_ARRAY, count));
+
+  for (size_t i = 0; i < count; i++) {
+    CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_ARRAY, 3));
+    CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_UINT, alerts[i].metric));
+    CBOR_PUT(cborHead(out + pos, capacity - pos, CBOR_UINT, alerts[i].severity));
+    CBOR_PUT(cborInt(out + pos, capacity - pos, toFixed(alerts[i].value)));
+  }
+
+  return pos;
+}
+
+// ============================================
+// DECODIFICACIÓN CBOR
+// ============================================
+
+struct CborReader {
+  const uint8_t* data;
+  size_t length;
+  size_t pos;
+};
+
+/**
+ * Lee la cabecera de un elemento. Retorna false si el payload está
+ * truncado o usa un formato no soportado.
+ */
+static bool cborReadHead(CborReader& r, uint8_t& major, uint32_t& value) {
+  if (r.pos >= r.length) {
+    return false;
+  }
+
+  uint8_t initial = r.data[r.pos++];
+  major = initial & 0xE0;
+  uint8_t info = initial & 0x1F;
+
+  if (info < 24) {
+    value = info;
+    return true;
+  }
+
+  size_t bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : 0;
+  if (bytes == 0) {
+    value = CBOR_INDEFINITE;
+    return info == 31; // 27-30 (enteros de 64 bits, reservados) no se usan
+  }
+  if (r.pos + bytes > r.length) {
+    return false;
+  }
+
+  value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value = (value << 8) | r.data[r.pos++];
+  }
+  return true;
+}
+
+static bool cborReadInt(CborReader& r, int32_t& value) {
+  uint8_t major;
+  uint32_t raw;
+
+  if (!cborReadHead(r, major, raw)) {
+    return false;
+  }
+  if (major == CBOR_UINT) {
+    value = (int32_t)raw;
+    return true;
+  }
+  if (major == CBOR_NEGINT) {
+    value = -1 - (int32_t)raw;
+    return true;
+  }
+  return false;
+}
+
+static bool cborReadText(CborReader& r, char* out, size_t capacity) {
+  uint8_t major;
+  uint32_t len;
+
+  if (!cborReadHead(r, major, len) || major != CBOR_TEXT || r.pos + len > r.length) {
+    return false;
+  }
+
+  if (out != nullptr && capacity > 0) {
+    size_t n = len < capacity - 1 ? len : capacity - 1;
+    memcpy(out, r.data + r.pos, n);
+    out[n] = '\0';
+  }
+  r.pos += len;
+  return true;
+}
+
+static bool cborAtBreak(CborReader& r) {
+  if (r.pos < r.length && r.data[r.pos] == CBOR_BREAK) {
+    r.pos++;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Lee una métrica de una lectura: valor en centésimas o ventana
+ * [mín, máx, media, desv, n]; con ventana el valor es la media
+ */
+static bool cborReadMetric(CborReader& r, float& value, MetricSummary& window) {
+  if (r.pos < r.length && (r.data[r.pos] & 0xE0) != CBOR_ARRAY) {
+    int32_t fixed;
+    if (!cborReadInt(r, fixed)) {
+      return false;
+    }
+    value = fixed / 100.0f;
+    return true;
+  }
+
+  uint8_t major;
+  uint32_t fields;
+  int32_t v[5];
+  if (!cborReadHead(r, major, fields) || fields != 5) {
+    return false;
+  }
+  for (int f = 0; f < 5; f++) {
+    if (!cborReadInt(r, v[f])) return false;
+  }
+
+  window.min = v[0] / 100.0f;
+  window.max = v[1] / 100.0f;
+  window.mean = v[2] / 100.0f;
+  window.stddev = v[3] / 100.0f;
+  window.count = (uint32_t)v[4];
+  value = window.mean;
+  return true;
+}
+
+/**
+ * Decodifica un lote de telemetría CBOR y entrega cada lectura a sink
+ */
+bool decodeTelemetryCbor(const uint8_t* payload, size_t length,
+                         char* thing, size_t thingCapacity,
+                         SampleSink sink, void* context) {
+  CborReader r = { payload, length, 0 };
+  uint8_t major;
+  uint32_t entries;
+  uint32_t base = 0;
+
+  if (!cborReadHead(r, major, entries) || major != CBOR_MAP) {
+    return false;
+  }
+
+  for (uint32_t e = 0; e < entries; e++) {
+    int32_t key;
+    if (!cborReadInt(r, key)) {
+      return false;
+    }
+
+    if (key == CBOR_KEY_THING) {
+      if (!cborReadText(r, thing, thingCapacity)) return false;
+    } else if (key == CBOR_KEY_TIMESTAMP) {
+      int32_t ts;
+      if (!cborReadInt(r, ts)) return false;
+      base = (uint32_t)ts;
+    } else if (key == CBOR_KEY_SAMPLES) {
+      uint32_t declared;
+      if (!cborReadHead(r, major, declared) || major != CBOR_ARRAY) return false;
+      bool indefinite = declared == CBOR_INDEFINITE;
+
+      for (uint32_t i = 0; indefinite || i < declared; i++) {
+        if (indefinite && cborAtBreak(r)) {
+          break;
+        }
+
+        uint32_t fields;
+        int32_t dt;
+        if (!cborReadHead(r, major, fields) || major != CBOR_ARRAY || fields != 5 ||
+            !cborReadInt(r, dt)) {
+          return false;
+        }
+
+        SensorData data = SensorData();
+        float* values[SENSOR_METRIC_COUNT] = {
+          &data.temperatura, &data.humedad, &data.humedadSuelo, &data.luminosidad
+        };
+        for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+          if (!cborReadMetric(r, *values[m], data.window[m])) return false;
+        }
+        data.timestamp = base + (uint32_t)dt;
+        data.valid = true;
+
+        if (sink != nullptr) {
+          sink(data, context);
+        }
+      }
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Decodifica un lote comprimido (CODEC_SERIES) y entrega cada lectura a sink
+ */
+bool decodeTelemetrySeries(const uint8_t* payload, size_t length,
+                           char* thing, size_t thingCapacity,
+                           SampleSink sink, void* context) {
+  if (length < 1 || length < (size_t)payload[0] + 1) {
+    return false;
+  }
+
+  size_t thingLength = payload[0];
+  if (thing != nullptr && thingCapacity > 0) {
+    size_t n = thingLength < thingCapacity - 1 ? thingLength : thingCapacity - 1;
+    memcpy(thing, payload + 1, n);
+    thing[n] = '\0';
+  }
+
+  SeriesDecoder decoder(payload + 1 + thingLength, length - 1 - thingLength);
+  SensorData data = SensorData();
+
+  while (decoder.next(data)) {
+    if (sink != nullptr) {
+      sink(data, context);
+    }
+  }
+
+  return decoder.valid();
+}
+
+/**
+ * Decodifica un mensaje de alertas CBOR y entrega cada alerta a sink
+ */
+bool decodeAlertsCbor(const uint8_t* payload, size_t length,
+                      AlertSink sink, void* context) {
+  CborReader r = { payload, length, 0 };
+  uint8_t major;
+  uint32_t entries;
+  uint32_t timestamp = 0;
+
+  if (!cborReadHead(r, major, entries) || major != CBOR_MAP) {
+    return false;
+  }
+
+  for (uint32_t e = 0; e < entries; e++) {
+    int32_t key;
+    if (!cborReadInt(r, key)) {
+      return false;
+    }
+
+    if (key == CBOR_KEY_THING) {
+      if (!cborReadText(r, nullptr, 0)) return false;
+    } else if (key == CBOR_KEY_TIMESTAMP) {
+      int32_t ts;
+      if (!cborReadInt(r, ts)) return false;
+      timestamp = (uint32_t)ts;
+    } else if (key == CBOR_KEY_ALERTS) {
+      uint32_t count;
+      if (!cborReadHead(r, major, count) || major != CBOR_ARRAY) return false;
+
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t fields;
+        int32_t metric, severity, value;
+        if (!cborReadHead(r, major, fields) || major != CBOR_ARRAY || fields != 3 ||
+            !cborReadInt(r, metric) || !cborReadInt(r, severity) || !cborReadInt(r, value)) {
+          return false;
+        }
+
+        Alert alert;
+        alert.metric = (AlertMetric)metric;
+        alert.severity = (AlertSeverity)severity;
+        alert.message = nullptr;
+        alert.value = value / 100.0f;
+
+        if (sink != nullptr) {
+          sink(alert, timestamp, context);
+        }
+      }
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
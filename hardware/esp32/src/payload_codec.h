@@ -0,0 +1,111 @@
+#ifndef PAYLOAD_CODEC_H
+#define PAYLOAD_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+#include "series_codec.h"
+
+/**
+ * Codificación de payloads MQTT.
+ *
+ * CODEC_JSON: el formato de texto de siempre (claves legibles).
+ * CODEC_CBOR: CBOR (RFC 8949) compacto con claves enteras y valores en
+ * punto fijo (centésimas). Lote de telemetría:
+ *   { 0: thing, 1: timestamp base, 2: [ [dt, temp, hum, suelo, luz], ... ] }
+ * Una métrica con ventana de muestreo (SensorData::window) se escribe como
+ * [mín, máx, media, desv, n] en lugar del valor; en JSON como el objeto
+ * {"min","max","media","desv","n"}. CODEC_SERIES solo lleva los valores.
+ * Alertas:
+ *   { 0: thing, 1: timestamp, 3: [ [tipo, severidad, valor], ... ] }
+ * CODEC_SERIES: solo para lotes de telemetría; bloque comprimido de
+ * series_codec.h precedido del thing: [longitud u8][thing][bloque].
+ * Las alertas y los mensajes individuales usan CBOR con este códec.
+ * Este módulo no depende de Arduino: el mismo decodificador se usa en el host.
+ */
+enum PayloadCodec : uint8_t {
+  CODEC_JSON,
+  CODEC_CBOR,
+  CODEC_SERIES
+};
+
+// Claves enteras del formato CBOR
+enum CborKey : uint8_t {
+  CBOR_KEY_THING = 0,
+  CBOR_KEY_TIMESTAMP = 1,
+  CBOR_KEY_SAMPLES = 2,
+  CBOR_KEY_ALERTS = 3
+};
+
+// Tipos y severidades de alerta (índices estables para CBOR)
+enum AlertMetric : uint8_t {
+  ALERT_TEMPERATURA,
+  ALERT_HUMEDAD,
+  ALERT_HUMEDAD_SUELO,
+  ALERT_LUMINOSIDAD
+};
+
+enum AlertSeverity : uint8_t {
+  SEVERITY_INFO,
+  SEVERITY_WARNING,
+  SEVERITY_CRITICAL
+};
+
+struct Alert {
+  AlertMetric metric;
+  AlertSeverity severity;
+  const char* message;
+  float value;
+};
+
+/**
+ * Codificador incremental de lotes de lecturas sobre un buffer fijo
+ */
+class BatchEncoder {
+public:
+  BatchEncoder();
+
+  void begin(PayloadCodec codec, uint8_t* buffer, size_t capacity);
+  bool add(const SensorData& data);
+  size_t finish();
+
+  size_t samples() const { return count; }
+  PayloadCodec codec() const { return format; }
+
+private:
+  PayloadCodec format;
+  uint8_t* buffer;
+  size_t capacity;
+  size_t length;
+  size_t count;
+  unsigned long baseTimestamp;
+  SeriesEncoder series;
+};
+
+size_t encodeSensorData(PayloadCodec codec, const SensorData& data,
+                        uint8_t* out, size_t capacity);
+size_t encodeSensorDataJson(const char* thing, const SensorData& data,
+                            char* out, size_t capacity);
+size_t encodeAlerts(PayloadCodec codec, unsigned long timestamp,
+                    const Alert* alerts, size_t count,
+                    uint8_t* out, size_t capacity);
+
+const char* alertMetricName(AlertMetric metric);
+const char* alertSeverityName(AlertSeverity severity);
+
+// ============================================
+// DECODIFICACIÓN (host / backend)
+// ============================================
+typedef void (*SampleSink)(const SensorData& data, void* context);
+typedef void (*AlertSink)(const Alert& alert, unsigned long timestamp, void* context);
+
+bool decodeTelemetryCbor(const uint8_t* payload, size_t length,
+                         char* thing, size_t thingCapacity,
+                         SampleSink sink, void* context);
+bool decodeTelemetrySeries(const uint8_t* payload, size_t length,
+                           char* thing, size_t thingCapacity,
+                           SampleSink sink, void* context);
+bool decodeAlertsCbor(const uint8_t* payload, size_t length,
+                      AlertSink sink, void* context);
+
+#endif // PAYLOAD_CODEC_H
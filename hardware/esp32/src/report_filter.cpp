@@ -0,0 +1,82 @@
+#include "report_filter.h"
+#include <math.h>
+#include <string.h>
+
+ReportFilter::ReportFilter() : policy(), last(), lastSentAt(0), reported(false) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+void ReportFilter::begin(const ReportPolicy& reportPolicy) {
+  policy = reportPolicy;
+  reported = false;
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool ReportFilter::exceedsDeadband(const SensorData& data) const {
+  const float values[REPORT_METRIC_COUNT] = {
+    data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+  };
+  const float previous[REPORT_METRIC_COUNT] = {
+    last.temperatura, last.humedad, last.humedadSuelo, last.luminosidad
+  };
+
+  for (size_t i = 0; i < REPORT_METRIC_COUNT; i++) {
+    const Deadband& band = policy.deadbands[i];
+    float limit = band.relative * fabsf(previous[i]);
+    if (limit < band.absolute) {
+      limit = band.absolute;
+    }
+
+    if (fabsf(values[i] - previous[i]) > limit) {
+      return true;
+    }
+
+    // Un pico dentro de la ventana de muestreo también cuenta
+    const MetricSummary& window = data.window[i];
+    if (window.count > 0 && (window.max - previous[i] > limit || previous[i] - window.min > limit)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ReportReason ReportFilter::offer(const SensorData& data, bool crossing, unsigned long now) {
+  ReportReason reason;
+
+  if (!reported) {
+    reason = REPORT_FIRST;
+  } else if (crossing) {
+    reason = REPORT_CROSSING;
+    counters.crossings++;
+  } else if (exceedsDeadband(data)) {
+    reason = REPORT_CHANGE;
+    counters.changes++;
+  } else if (now - lastSentAt >= policy.heartbeatMs) {
+    reason = REPORT_HEARTBEAT;
+    counters.heartbeats++;
+  } else {
+    counters.suppressed++;
+    return REPORT_SUPPRESSED;
+  }
+
+  if (reported && now - lastSentAt > counters.maxSilenceMs) {
+    counters.maxSilenceMs = (uint32_t)(now - lastSentAt);
+  }
+
+  last = data;
+  lastSentAt = now;
+  reported = true;
+  counters.sent++;
+  return reason;
+}
+
+const char* reportReasonName(ReportReason reason) {
+  switch (reason) {
+    case REPORT_SUPPRESSED: return "descartada";
+    case REPORT_FIRST: return "primera";
+    case REPORT_CHANGE: return "cambio";
+    case REPORT_CROSSING: return "umbral";
+    case REPORT_HEARTBEAT: return "latido";
+    default: return "?";
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+
+/**
+ * Reporte por excepción: decide qué lecturas se publican.
+ *
+ * Una lectura se envía si alguna métrica (o el mínimo o el máximo de su
+ * ventana de muestreo) se aleja de la última enviada más que su banda
+ * muerta, si la pide el llamador (p. ej. porque cruza el umbral de una
+ * regla) o si se cumple el silencio máximo (latido); el resto se descarta
+ * sin publicar. El muestreo, las reglas y el control
+ * siguen viendo todas las lecturas. Portable (compila en el host).
+ */
+
+#define REPORT_METRIC_COUNT SENSOR_METRIC_COUNT   // En el orden de AlertMetric
+
+// Cambio mínimo para enviar: max(absolute, relative * |última enviada|)
+struct Deadband {
+  float absolute;
+  float relative;
+};
+
+struct ReportPolicy {
+  Deadband deadbands[REPORT_METRIC_COUNT];
+  uint32_t heartbeatMs;         // Silencio máximo entre dos envíos
+};
+
+// Motivo del envío de una lectura
+enum ReportReason : uint8_t {
+  REPORT_SUPPRESSED,
+  REPORT_FIRST,
+  REPORT_CHANGE,                // Fuera de la banda muerta
+  REPORT_CROSSING,              // Pedido por el llamador
+  REPORT_HEARTBEAT
+};
+
+struct ReportStats {
+  uint32_t sent;
+  uint32_t suppressed;
+  uint32_t changes;
+  uint32_t crossings;
+  uint32_t heartbeats;
+  uint32_t maxSilenceMs;        // Mayor intervalo entre dos envíos
+};
+
+class ReportFilter {
+public:
+  ReportFilter();
+
+  void begin(const ReportPolicy& policy);
+
+  // Una lectura válida; retorna el motivo del envío o REPORT_SUPPRESSED
+  ReportReason offer(const SensorData& data, bool crossing, unsigned long now);
+
+  bool hasReported() const { return reported; }
+  const SensorData& lastReported() const { return last; }
+  const ReportStats& stats() const { return counters; }
+
+private:
+  bool exceedsDeadband(const SensorData& data) const;
+
+  ReportPolicy policy;
+  SensorData last;
+  unsigned long lastSentAt;
+  bool reported;
+  ReportStats counters;
+};
+
+const char* reportReasonName(ReportReason reason);
+
+#endif // REPORT_FILTER_H
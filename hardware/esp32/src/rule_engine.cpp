@@ -0,0 +1,157 @@
+#include "rule_engine.h"
+#include <math.h>
+
+#define RULE_FLAG_ACTIVE 0x01
+#define RULE_FLAG_PENDING 0x02
+
+// Mensaje de alerta por métrica: [por encima, por debajo]
+static const char* const ALERT_MESSAGES[RULE_METRIC_COUNT][2] = {
+  { "Temperatura muy alta", "Temperatura muy baja" },
+  { "Humedad muy alta", "Humedad muy baja" },
+  { "Suelo muy húmedo", "Suelo muy seco" },
+  { "Exceso de luz", "Poca luz detectada" }
+};
+
+const char* ruleAlertMessage(AlertMetric metric, bool below) {
+  return metric < RULE_METRIC_COUNT ? ALERT_MESSAGES[metric][below ? 1 : 0] : "Regla activada";
+}
+
+RuleEngine::RuleEngine(RuleSlot* slots, size_t capacity)
+  : slots(slots), capacity(capacity), ruleCount(0), actuatorDemand(0) {}
+
+bool RuleEngine::validate(const Rule& rule) {
+  return rule.metric < RULE_METRIC_COUNT &&
+         (rule.comparator == RULE_ABOVE || rule.comparator == RULE_BELOW) &&
+         rule.actuator <= ACTUATOR_NONE &&
+         (rule.severity <= SEVERITY_CRITICAL || rule.severity == SEVERITY_NONE) &&
+         rule.threshold == rule.threshold &&   // NaN
+         rule.hysteresis >= 0;
+}
+
+bool RuleEngine::load(const Rule* rules, size_t count) {
+  if (count > capacity) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (!validate(rules[i])) {
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const Rule& rule = rules[i];
+    RuleSlot& slot = slots[i];
+    float release = rule.comparator == RULE_ABOVE ? rule.threshold - rule.hysteresis
+                                                  : rule.threshold + rule.hysteresis;
+    slot.sign = rule.comparator == RULE_ABOVE ? 1.0f : -1.0f;
+    slot.limits[0] = slot.sign * rule.threshold;
+    slot.limits[1] = slot.sign * release;
+    slot.dwellMs = rule.dwellMs;
+    slot.since = 0;
+    slot.metric = rule.metric;
+    slot.actuator = rule.actuator;
+    slot.severity = rule.severity;
+    slot.flags = 0;
+  }
+
+  ruleCount = count;
+  actuatorDemand = 0;
+  return true;
+}
+
+/**
+ * Una pasada sobre todas las reglas. Con la regla inactiva la condición es
+ * superar el umbral; con la regla activa, seguir más allá del umbral de
+ * salida. Si el resultado difiere del estado actual durante dwellMs, la
+ * regla cambia de estado.
+ */
+size_t RuleEngine::evaluate(const SensorData& data, unsigned long now, Alert* alerts,
+                            size_t maxAlerts) {
+  const float values[RULE_METRIC_COUNT] = {
+    data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+  };
+  uint32_t demand = 0;
+  size_t alertCount = 0;
+
+  for (size_t i = 0; i < ruleCount; i++) {
+    RuleSlot& slot = slots[i];
+    bool active = (slot.flags & RULE_FLAG_ACTIVE) != 0;
+    float value = values[slot.metric];
+    bool beyond = slot.sign * value > slot.limits[active ? 1 : 0];
+
+    if (beyond == active) {
+      slot.flags &= ~RULE_FLAG_PENDING;
+    } else {
+      if ((slot.flags & RULE_FLAG_PENDING) == 0) {
+        slot.flags |= RULE_FLAG_PENDING;
+        slot.since = (uint32_t)now;
+      }
+
+      if ((uint32_t)now - slot.since >= slot.dwellMs) {
+        active = beyond;
+        slot.flags = active ? RULE_FLAG_ACTIVE : 0;
+
+        if (active && slot.severity != SEVERITY_NONE && alertCount < maxAlerts) {
+          alerts[alertCount++] = { slot.metric, (AlertSeverity)slot.severity,
+                                   ruleAlertMessage(slot.metric, slot.sign < 0), value };
+        }
+      }
+    }
+
+    if (active && slot.actuator != ACTUATOR_NONE) {
+      demand |= 1u << slot.actuator;
+    }
+  }
+
+  actuatorDemand = demand;
+  return alertCount;
+}
+
+bool RuleEngine::crosses(const SensorData& from, const SensorData& to) const {
+  const float before[RULE_METRIC_COUNT] = {
+    from.temperatura, from.humedad, from.humedadSuelo, from.luminosidad
+  };
+  const float after[RULE_METRIC_COUNT] = {
+    to.temperatura, to.humedad, to.humedadSuelo, to.luminosidad
+  };
+
+  for (size_t i = 0; i < ruleCount; i++) {
+    const RuleSlot& slot = slots[i];
+    float a = slot.sign * before[slot.metric];
+    float b = slot.sign * after[slot.metric];
+
+    for (int edge = 0; edge < 2; edge++) {
+      if ((a > slot.limits[edge]) != (b > slot.limits[edge])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+float RuleEngine::limitDistance(AlertMetric metric, float value) const {
+  float nearest = INFINITY;
+
+  for (size_t i = 0; i < ruleCount; i++) {
+    const RuleSlot& slot = slots[i];
+    if (slot.metric != metric) {
+      continue;
+    }
+
+    for (int edge = 0; edge < 2; edge++) {
+      float distance = fabsf(slot.sign * value - slot.limits[edge]);
+      if (distance < nearest) {
+        nearest = distance;
+      }
+    }
+  }
+  return nearest;
+}
+
+size_t RuleEngine::active() const {
+  size_t count = 0;
+  for (size_t i = 0; i < ruleCount; i++) {
+    count += slots[i].flags & RULE_FLAG_ACTIVE;
+  }
+  return count;
+}
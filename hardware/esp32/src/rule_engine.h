@@ -0,0 +1,99 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+#include "payload_codec.h"
+#include "actuator_registry.h"
+
+/**
+ * Motor de reglas de control y alerta.
+ *
+ * Cada regla compara una métrica con un umbral. Se activa cuando la
+ * lectura lo supera (o queda por debajo) durante al menos dwellMs, y se
+ * desactiva cuando vuelve más allá del umbral desplazado por la
+ * histéresis durante el mismo tiempo. Al activarse genera una alerta con
+ * su severidad; mientras está activa pide encender su actuador (varias
+ * reglas pueden pedir el mismo). Las reglas viven en un arreglo plano que
+ * se recorre una vez por lectura, sin memoria dinámica. Portable (compila
+ * en el host).
+ */
+
+#define RULE_METRIC_COUNT 4   // Métricas de SensorData (índices de AlertMetric)
+
+enum RuleComparator : uint8_t {
+  RULE_ABOVE,   // Activa con la métrica por encima del umbral
+  RULE_BELOW    // Activa con la métrica por debajo del umbral
+};
+
+// Regla sin actuador o sin alerta
+constexpr uint8_t ACTUATOR_NONE = ACTUATOR_COUNT;
+constexpr uint8_t SEVERITY_NONE = 0xFF;
+
+static_assert(ACTUATOR_COUNT <= 32, "La demanda de actuadores es una máscara de 32 bits");
+
+struct Rule {
+  AlertMetric metric;
+  RuleComparator comparator;
+  uint8_t actuator;     // ActuatorId encendido mientras está activa, o ACTUATOR_NONE
+  uint8_t severity;     // AlertSeverity al activarse, o SEVERITY_NONE
+  float threshold;
+  float hysteresis;     // Se desactiva en threshold - hysteresis (RULE_BELOW: +)
+  uint32_t dwellMs;     // Permanencia mínima de la condición para cambiar de estado
+};
+
+// Regla compilada y su estado. Los límites se guardan con el signo del
+// comparador para evaluar ambos sentidos con la misma comparación.
+struct RuleSlot {
+  float sign;           // +1 (RULE_ABOVE) o -1 (RULE_BELOW)
+  float limits[2];      // [inactiva, activa] multiplicados por sign
+  uint32_t dwellMs;
+  uint32_t since;       // Inicio de la condición de cambio pendiente
+  AlertMetric metric;
+  uint8_t actuator;
+  uint8_t severity;
+  uint8_t flags;        // RULE_FLAG_*
+};
+
+/**
+ * Evalúa un conjunto de reglas sobre un arreglo de ranuras proporcionado
+ * por el llamador.
+ */
+class RuleEngine {
+public:
+  RuleEngine(RuleSlot* slots, size_t capacity);
+
+  // Sustituye las reglas y empieza con todas inactivas. Retorna false (sin
+  // cambiar nada) si no caben o alguna no es válida.
+  bool load(const Rule* rules, size_t count);
+
+  // Evalúa una lectura válida. Escribe hasta maxAlerts alertas de las
+  // reglas que se activan y retorna cuántas.
+  size_t evaluate(const SensorData& data, unsigned long now, Alert* alerts, size_t maxAlerts);
+
+  // Indica si entre dos lecturas alguna métrica cruza un umbral de
+  // activación o de desactivación de alguna regla (sin esperar dwellMs)
+  bool crosses(const SensorData& from, const SensorData& to) const;
+
+  // Distancia de un valor de la métrica al umbral (de activación o de
+  // desactivación) más cercano de sus reglas; INFINITY si no tiene reglas
+  float limitDistance(AlertMetric metric, float value) const;
+
+  // Actuadores pedidos por las reglas activas (bit = ActuatorId)
+  uint32_t demand() const { return actuatorDemand; }
+  size_t count() const { return ruleCount; }
+  size_t active() const;
+
+  static bool validate(const Rule& rule);
+
+private:
+  RuleSlot* slots;
+  size_t capacity;
+  size_t ruleCount;
+  uint32_t actuatorDemand;
+};
+
+const char* ruleAlertMessage(AlertMetric metric, bool below);
+
+#endif // RULE_ENGINE_H
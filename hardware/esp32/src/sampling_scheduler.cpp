@@ -0,0 +1,118 @@
+#include "sampling_scheduler.h"
+#include <math.h>
+#include <string.h>
+
+SamplingScheduler::SamplingScheduler() : policy() {
+  memset(lastValue, 0, sizeof(lastValue));
+  memset(rate, 0, sizeof(rate));
+  memset(lastReadAt, 0, sizeof(lastReadAt));
+  memset(nextAt, 0, sizeof(nextAt));
+  memset(intervalMs, 0, sizeof(intervalMs));
+  memset(primed, 0, sizeof(primed));
+  memset(&counters, 0, sizeof(counters));
+}
+
+void SamplingScheduler::begin(const SamplingPolicy& samplingPolicy, unsigned long now) {
+  policy = samplingPolicy;
+  memset(rate, 0, sizeof(rate));
+  memset(primed, 0, sizeof(primed));
+  memset(&counters, 0, sizeof(counters));
+
+  for (size_t s = 0; s < SENSOR_COUNT; s++) {
+    intervalMs[s] = policy.bounds[s].minMs;
+    nextAt[s] = now;
+  }
+}
+
+uint8_t SamplingScheduler::due(unsigned long now) const {
+  uint8_t mask = 0;
+  for (size_t s = 0; s < SENSOR_COUNT; s++) {
+    if ((long)(now - nextAt[s]) >= 0) {
+      mask |= 1u << s;
+    }
+  }
+  if (mask == 0) {
+    return 0;
+  }
+
+  // Los que vencen poco después aprovechan la misma lectura
+  for (size_t s = 0; s < SENSOR_COUNT; s++) {
+    if ((float)(long)(nextAt[s] - now) <= policy.coalesce * intervalMs[s]) {
+      mask |= 1u << s;
+    }
+  }
+  return mask;
+}
+
+/**
+ * Intervalo que pide una métrica con la velocidad estimada y su distancia
+ * al umbral más cercano, dentro de los límites de su sensor
+ */
+uint32_t SamplingScheduler::metricInterval(size_t metric, float distance) const {
+  const SamplingBounds& bounds = policy.bounds[sensorOfMetric(metric)];
+
+  float seconds = INFINITY;
+  if (rate[metric] > 0) {
+    seconds = policy.step[metric] / rate[metric];
+    float untilLimit = policy.lead * distance / rate[metric];
+    if (untilLimit < seconds) {
+      seconds = untilLimit;
+    }
+  }
+
+  float ms = seconds * 1000.0f;
+  if (!(ms < bounds.maxMs)) {
+    return bounds.maxMs;
+  }
+  return ms > bounds.minMs ? (uint32_t)ms : bounds.minMs;
+}
+
+void SamplingScheduler::update(uint8_t sensors, const SensorData& data, const float* distances,
+                               unsigned long now) {
+  const float values[SENSOR_METRIC_COUNT] = {
+    data.temperatura, data.humedad, data.humedadSuelo, data.luminosidad
+  };
+
+  if (sensors != 0) {
+    counters.readings++;
+  }
+
+  for (size_t s = 0; s < SENSOR_COUNT; s++) {
+    if ((sensors & (1u << s)) == 0) {
+      continue;
+    }
+    counters.reads[s]++;
+
+    if (data.valid) {
+      float dtS = (now - lastReadAt[s]) / 1000.0f;
+      for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+        if (sensorOfMetric(m) != s) {
+          continue;
+        }
+        if (primed[s] && dtS > 0) {
+          // Sube al momento, baja poco a poco
+          float instant = fabsf(values[m] - lastValue[m]) / dtS;
+          rate[m] = instant > rate[m] ? instant : rate[m] + (instant - rate[m]) * policy.release;
+        }
+        lastValue[m] = values[m];
+      }
+      lastReadAt[s] = now;
+      primed[s] = true;
+    }
+
+    // Sin una lectura válida todavía, reintentar pronto
+    uint32_t next = policy.bounds[s].minMs;
+    if (primed[s]) {
+      next = policy.bounds[s].maxMs;
+      for (size_t m = 0; m < SENSOR_METRIC_COUNT; m++) {
+        if (sensorOfMetric(m) == s) {
+          uint32_t wanted = metricInterval(m, distances[m]);
+          next = wanted < next ? wanted : next;
+        }
+      }
+    }
+
+    intervalMs[s] = next;
+    nextAt[s] = now + next;
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef SAMPLING_SCHEDULER_H
+#define SAMPLING_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+
+/**
+ * Muestreo adaptativo: decide cuándo leer cada sensor.
+ *
+ * Cada sensor tiene su propio intervalo entre un mínimo y un máximo. Tras
+ * cada lectura se estima la velocidad de cambio de sus métricas (sube al
+ * momento, baja poco a poco) y el siguiente intervalo es el menor de:
+ *   - el tiempo en cambiar un paso (step / velocidad)
+ *   - una fracción (lead) del tiempo en llegar al umbral más cercano de las
+ *     reglas (distancia / velocidad)
+ * Así el intervalo se acorta a medida que la métrica se acerca a un umbral
+ * y se alarga con la métrica quieta. Un sensor al que le falta poco para
+ * tocarle se lee junto con el que vence, para no multiplicar las lecturas.
+ * Portable (compila en el host).
+ */
+
+struct SamplingBounds {
+  uint32_t minMs;
+  uint32_t maxMs;
+};
+
+struct SamplingPolicy {
+  SamplingBounds bounds[SENSOR_COUNT];
+  float step[SENSOR_METRIC_COUNT];    // Cambio que justifica otra lectura
+  float lead;                         // Fracción del tiempo hasta el umbral (0-1)
+  float release;                      // Olvido de la velocidad por lectura (0-1)
+  float coalesce;                     // Adelanta un sensor al que le falta menos de esta fracción
+};
+
+struct SamplingStats {
+  uint32_t readings;                  // Lecturas entregadas (uno o más sensores)
+  uint32_t reads[SENSOR_COUNT];       // Lecturas de cada sensor
+};
+
+class SamplingScheduler {
+public:
+  SamplingScheduler();
+
+  // Todos los sensores vencen en now
+  void begin(const SamplingPolicy& policy, unsigned long now);
+
+  // Sensores que toca leer (máscara de SensorId), con los que vencen poco después
+  uint8_t due(unsigned long now) const;
+
+  // Tras una lectura de los sensores de la máscara: actualiza la velocidad
+  // y programa la siguiente. distances: distancia de cada métrica a su
+  // umbral más cercano (INFINITY sin reglas). Con data no válida solo se
+  // reprograma.
+  void update(uint8_t sensors, const SensorData& data, const float* distances, unsigned long now);
+
+  uint32_t interval(SensorId sensor) const { return intervalMs[sensor]; }
+  const SamplingStats& stats() const { return counters; }
+
+private:
+  uint32_t metricInterval(size_t metric, float distance) const;
+
+  SamplingPolicy policy;
+  float lastValue[SENSOR_METRIC_COUNT];
+  float rate[SENSOR_METRIC_COUNT];    // Unidades por segundo
+  unsigned long lastReadAt[SENSOR_COUNT];
+  unsigned long nextAt[SENSOR_COUNT];
+  uint32_t intervalMs[SENSOR_COUNT];
+  bool primed[SENSOR_COUNT];
+  SamplingStats counters;
+};
+
+#endif // SAMPLING_SCHEDULER_H
@@ -0,0 +1,46 @@
+#ifndef SENSOR_DATA_H
+#define SENSOR_DATA_H
+
+#include <stdint.h>
+
+#define SENSOR_METRIC_COUNT 4   // temperatura, humedad, humedadSuelo, luminosidad
+
+// Sensores físicos: cada uno se lee con su propio calendario
+enum SensorId : uint8_t {
+  SENSOR_DHT22,       // temperatura y humedad
+  SENSOR_SUELO,
+  SENSOR_LUZ,
+  SENSOR_COUNT
+};
+
+#define SENSOR_MASK_ALL ((uint8_t)((1u << SENSOR_COUNT) - 1))
+
+// Sensor que mide cada métrica (en el orden de SensorData)
+inline SensorId sensorOfMetric(unsigned int metric) {
+  return metric < 2 ? SENSOR_DHT22 : (metric == 2 ? SENSOR_SUELO : SENSOR_LUZ);
+}
+
+// Estadísticos de una métrica en la ventana de muestreo de una lectura
+struct MetricSummary {
+  float min;
+  float max;
+  float mean;
+  float stddev;
+  uint32_t count;     // 0 = sin ventana (solo el valor instantáneo)
+};
+
+// Estructura para datos de sensores (sin dependencias de Arduino para
+// poder compartirla con los módulos que también compilan en el host).
+// window solo lo rellena el muestreo interno de sensors.cpp; el registro
+// local y las trazas guardan los valores instantáneos.
+struct SensorData {
+  float temperatura;
+  float humedad;
+  float humedadSuelo;
+  float luminosidad;
+  bool valid;
+  unsigned long timestamp;
+  MetricSummary window[SENSOR_METRIC_COUNT];
+};
+
+#endif // SENSOR_DATA_H
@@ -1,10 +1,10 @@
 #include "sensors.h"
 #include "config.h"
-#include <DHT.h>
-#include <ArduinoJson.h>
-
-// Instancia del sensor DHT22
-DHT dht(PIN_DHT22, DHT_TYPE);
+#include "hal.h"
+#include "logger.h"
+#include "payload_codec.h"
+#include "window_stats.h"
+#include <math.h>
 
 // Variables para filtrado de datos
 float lastTemp = 0.0;
@@ -12,163 +12,368 @@ float lastHum = 0.0;
 float lastSoil = 0.0;
 float lastLux = 0.0;
 
+// Temperatura aceptada aún no entregada al control (ver takeTemperature)
+bool temperatureFresh = false;
+
+// Muestreo interno entre lecturas: cada lectura lleva los estadísticos de
+// todas las muestras tomadas desde la anterior (orden de SensorData)
+RunningStats windowStats[SENSOR_METRIC_COUNT];
+unsigned long nextDhtSampleAt = 0;
+unsigned long nextAnalogSampleAt = 0;
+
 /**
  * Inicializa todos los sensores
  */
 void initSensors() {
-  DEBUG_PRINTLN("Inicializando sensores...");
-  
-  // Inicializar DHT22
-  dht.begin();
-  
-  // Configurar pines analógicos
-  pinMode(PIN_HUMEDAD_SUELO, INPUT);
-  pinMode(PIN_LDR, INPUT);
+  LOG_I(LOG_SENSORS, "Inicializando sensores...");
   
-  // Configurar ADC
-  analogSetAttenuation(ADC_11db); // Rango completo 0-3.3V
+  // DHT22 y muestreo continuo de humedad de suelo y LDR en segundo plano
+  halSensorsBegin();
+  nextDhtSampleAt = halMillis() + DHT_WARMUP_MS;
   
-  DEBUG_PRINTLN("Sensores inicializados correctamente");
+  LOG_I(LOG_SENSORS, "Sensores inicializados correctamente");
 }
 
+// Máquina de estados de adquisición no bloqueante
+enum AcquisitionState {
+  ACQ_IDLE,
+  ACQ_DHT_START,
+  ACQ_DHT_WAIT,
+  ACQ_ANALOG,
+  ACQ_DONE
+};
+
+struct AcquisitionContext {
+  AcquisitionState state;
+  uint8_t sensors;             // Sensores de la lectura en curso (máscara de SensorId)
+  uint8_t attempt;             // Reintento actual de la lectura DHT
+  bool temperatureOnly;        // Solo el DHT22, sin lectura completa
+  bool dhtStarted;             // Hubo alguna trama (cuenta DHT_MIN_INTERVAL_MS)
+  unsigned long nextStepAt;    // No avanzar antes de este instante (millis)
+  unsigned long dhtStartedAt;
+  SensorData data;
+};
+
+AcquisitionContext acq = { ACQ_IDLE, 0, 0, false, false, 0, 0, {} };
+
 /**
- * Lee la temperatura del DHT22 con validación y reintentos
+ * Registra un fallo de lectura del DHT22 y programa el siguiente
+ * reintento sin bloquear. Retorna true si se agotaron los reintentos.
  */
-float readTemperature() {
-  float temp = NAN;
-  
-  for (int i = 0; i < SENSOR_RETRY_COUNT; i++) {
-    temp = dht.readTemperature();
-    
-    if (!isnan(temp) && temp >= -40 && temp <= 80) {
-      // Filtro simple para evitar cambios bruscos
-      if (lastTemp != 0.0 && abs(temp - lastTemp) > 10.0) {
-        DEBUG_PRINTLN("Advertencia: Cambio brusco de temperatura detectado");
-        delay(SENSOR_RETRY_DELAY_MS);
-        continue;
-      }
-      lastTemp = temp;
-      return temp;
-    }
-    
-    DEBUG_PRINTF("Reintento %d de lectura de temperatura\n", i + 1);
-    delay(SENSOR_RETRY_DELAY_MS);
+static bool scheduleDhtRetry(unsigned long now, const char* what) {
+  acq.attempt++;
+
+  if (acq.attempt >= SENSOR_RETRY_COUNT) {
+    LOG_E(LOG_SENSORS, "No se pudo leer %s", what);
+    acq.attempt = 0;
+    return true;
   }
-  
-  DEBUG_PRINTLN("Error: No se pudo leer temperatura");
-  return lastTemp; // Retornar última lectura válida
+
+  LOG_W(LOG_SENSORS, "Reintento %d de lectura de %s", acq.attempt, what);
+  acq.nextStepAt = now + SENSOR_RETRY_DELAY_MS;
+  return false;
 }
 
 /**
- * Lee la humedad del DHT22 con validación y reintentos
+ * Valida temperatura y humedad de una transacción del DHT22
  */
-float readHumidity() {
-  float hum = NAN;
-  
-  for (int i = 0; i < SENSOR_RETRY_COUNT; i++) {
-    hum = dht.readHumidity();
-    
-    if (!isnan(hum) && hum >= 0 && hum <= 100) {
-      // Filtro simple
-      if (lastHum != 0.0 && abs(hum - lastHum) > 20.0) {
-        DEBUG_PRINTLN("Advertencia: Cambio brusco de humedad detectado");
-        delay(SENSOR_RETRY_DELAY_MS);
-        continue;
-      }
-      lastHum = hum;
-      return hum;
-    }
-    
-    DEBUG_PRINTF("Reintento %d de lectura de humedad\n", i + 1);
-    delay(SENSOR_RETRY_DELAY_MS);
+static bool acceptTemperature(float temp) {
+  if (isnan(temp) || temp < -40 || temp > 80) {
+    return false;
   }
-  
-  DEBUG_PRINTLN("Error: No se pudo leer humedad");
-  return lastHum;
+
+  // Filtro simple para evitar cambios bruscos
+  if (lastTemp != 0.0 && fabsf(temp - lastTemp) > 10.0) {
+    LOG_W(LOG_SENSORS, "Cambio brusco de temperatura detectado");
+    return false;
+  }
+
+  return true;
+}
+
+static bool acceptHumidity(float hum) {
+  if (isnan(hum) || hum < 0 || hum > 100) {
+    return false;
+  }
+
+  // Filtro simple
+  if (lastHum != 0.0 && fabsf(hum - lastHum) > 20.0) {
+    LOG_W(LOG_SENSORS, "Cambio brusco de humedad detectado");
+    return false;
+  }
+
+  return true;
 }
 
 /**
- * Lee la humedad del suelo (sensor analógico)
- * Retorna porcentaje: 0% = seco, 100% = húmedo
+ * Procesa el resultado de una transacción del DHT22: temperatura y
+ * humedad llegan juntas, así que un fallo reintenta la trama completa.
  */
-float readSoilMoisture() {
-  const int numReadings = 10;
-  long sum = 0;
-  
-  // Promedio de múltiples lecturas para estabilidad
-  for (int i = 0; i < numReadings; i++) {
-    sum += analogRead(PIN_HUMEDAD_SUELO);
-    delay(10);
+static void stepDhtResult(unsigned long now, Dht22Status status, const Dht22Reading& reading) {
+  bool tempOk = status == DHT_OK && acceptTemperature(reading.temperatura);
+  bool humOk = status == DHT_OK && acceptHumidity(reading.humedad);
+
+  // Una muestra intermedia termina con el DHT22
+  AcquisitionState next = acq.temperatureOnly ? ACQ_IDLE : ACQ_ANALOG;
+
+  if (tempOk && humOk) {
+    lastTemp = reading.temperatura;
+    lastHum = reading.humedad;
+    temperatureFresh = true;
+    windowStats[0].add(reading.temperatura);
+    windowStats[1].add(reading.humedad);
+    acq.data.temperatura = reading.temperatura;
+    acq.data.humedad = reading.humedad;
+    acq.attempt = 0;
+    acq.state = next;
+    return;
   }
-  
-  int rawValue = sum / numReadings;
-  
-  // Calibración: ajustar estos valores según tu sensor
-  // Valor en aire (seco): ~3000-4095
-  // Valor en agua (húmedo): ~1000-1500
-  const int dryValue = 3500;
-  const int wetValue = 1200;
-  
+
+  if (status != DHT_OK) {
+    LOG_W(LOG_SENSORS, "DHT22: %s", dht22StatusName(status));
+  }
+
+  // Una muestra intermedia fallida no se reintenta: llegará la siguiente
+  if (acq.temperatureOnly) {
+    acq.state = ACQ_IDLE;
+    return;
+  }
+
+  if (scheduleDhtRetry(now, "DHT22")) {
+    // Retornar última lectura válida para lo que no pasó la validación
+    if (tempOk) lastTemp = reading.temperatura;
+    if (humOk) lastHum = reading.humedad;
+    acq.data.temperatura = lastTemp;
+    acq.data.humedad = lastHum;
+    acq.state = next;
+  } else {
+    acq.state = ACQ_DHT_START;
+  }
+}
+
+/**
+ * Limita un porcentaje al rango 0-100
+ */
+static float clampPercent(float value) {
+  return value < 0 ? 0 : (value > 100 ? 100 : value);
+}
+
+/**
+ * Humedad del suelo a partir del valor filtrado del ADC
+ * Retorna porcentaje: 0% = seco, 100% = húmedo
+ */
+static float soilMoistureFromRaw(float rawValue) {
   // Convertir a porcentaje (invertido porque menor valor = más húmedo)
-  float moisture = map(rawValue, dryValue, wetValue, 0, 100);
-  moisture = constrain(moisture, 0, 100);
+  float moisture = (rawValue - SOIL_ADC_DRY) * 100.0f / (SOIL_ADC_WET - SOIL_ADC_DRY);
+  moisture = clampPercent(moisture);
   
   lastSoil = moisture;
   return moisture;
 }
 
 /**
- * Lee la luminosidad (LDR)
+ * Luminosidad (LDR) a partir del valor filtrado del ADC
  * Retorna porcentaje: 0% = oscuro, 100% = muy luminoso
  */
-float readLuminosity() {
-  const int numReadings = 10;
-  long sum = 0;
-  
-  // Promedio de múltiples lecturas
-  for (int i = 0; i < numReadings; i++) {
-    sum += analogRead(PIN_LDR);
-    delay(10);
-  }
-  
-  int rawValue = sum / numReadings;
-  
-  // Calibración: ajustar según tu LDR
-  // Oscuridad total: ~10-100
-  // Luz brillante: ~3000-4095
-  const int darkValue = 50;
-  const int brightValue = 3500;
-  
+static float luminosityFromRaw(float rawValue) {
   // Convertir a porcentaje
-  float luminosity = map(rawValue, darkValue, brightValue, 0, 100);
-  luminosity = constrain(luminosity, 0, 100);
+  float luminosity = (rawValue - LDR_ADC_DARK) * 100.0f / (LDR_ADC_BRIGHT - LDR_ADC_DARK);
+  luminosity = clampPercent(luminosity);
   
   lastLux = luminosity;
   return luminosity;
 }
 
 /**
- * Lee todos los sensores y retorna estructura con datos
+ * Toma los valores ya filtrados por el muestreador del ADC de los sensores
+ * de la lectura. Si aún no hay suficientes muestras (recién arrancado),
+ * reintenta más tarde.
  */
-SensorData readAllSensors() {
-  SensorData data;
-  
-  DEBUG_PRINTLN("\n--- Leyendo sensores ---");
-  
-  data.temperatura = readTemperature();
-  data.humedad = readHumidity();
-  data.humedadSuelo = readSoilMoisture();
-  data.luminosidad = readLuminosity();
-  data.timestamp = millis();
-  data.valid = validateSensorData(data);
+static bool stepAnalog(unsigned long now) {
+  bool soil = (acq.sensors & (1u << SENSOR_SUELO)) != 0;
+  bool light = (acq.sensors & (1u << SENSOR_LUZ)) != 0;
+  float soilRaw = 0, lightRaw = 0;
+
+  if ((soil && !halAdcRead(ADC_SOIL, soilRaw)) || (light && !halAdcRead(ADC_LIGHT, lightRaw))) {
+    acq.nextStepAt = now + ANALOG_WAIT_MS;
+    return false;
+  }
+
+  if (soil) {
+    acq.data.humedadSuelo = soilMoistureFromRaw(soilRaw);
+  }
+  if (light) {
+    acq.data.luminosidad = luminosityFromRaw(lightRaw);
+  }
+  return true;
+}
+
+/**
+ * Inicia la lectura de los sensores de la máscara (SensorId); el resto
+ * conserva su último valor. El trabajo se reparte en pasos cortos
+ * ejecutados por pollSensors().
+ */
+void startSensorAcquisition(uint8_t sensors) {
+  if (acq.state != ACQ_IDLE || sensors == 0) {
+    return;
+  }
+
+  LOG_D(LOG_SENSORS, "Leyendo sensores (0x%02x)", sensors);
+
+  acq.sensors = sensors;
+  acq.state = (sensors & (1u << SENSOR_DHT22)) ? ACQ_DHT_START : ACQ_ANALOG;
+  acq.attempt = 0;
+  acq.temperatureOnly = false;
+  acq.nextStepAt = halMillis();
+}
+
+/**
+ * Muestra intermedia solo del DHT22 (cada DHT_SAMPLE_INTERVAL_MS). No
+ * produce SensorData: alimenta la ventana y takeTemperature().
+ */
+static void startDhtSample(unsigned long now) {
+  acq.state = ACQ_DHT_START;
+  acq.attempt = 0;
+  acq.temperatureOnly = true;
+  acq.nextStepAt = now;
+}
+
+/**
+ * Muestra intermedia de suelo y luz (cada ANALOG_SAMPLE_INTERVAL_MS),
+ * del valor ya filtrado por el muestreador del ADC
+ */
+static void sampleAnalog(unsigned long now) {
+  if ((long)(now - nextAnalogSampleAt) < 0) {
+    return;
+  }
+  nextAnalogSampleAt = now + ANALOG_SAMPLE_INTERVAL_MS;
+
+  float soilRaw, lightRaw;
+  if (halAdcRead(ADC_SOIL, soilRaw) && halAdcRead(ADC_LIGHT, lightRaw)) {
+    windowStats[2].add(soilMoistureFromRaw(soilRaw));
+    windowStats[3].add(luminosityFromRaw(lightRaw));
+  }
+}
+
+/**
+ * Entrega la última temperatura aceptada del DHT22 (de cualquier ciclo).
+ * Retorna false si no hay una nueva desde la llamada anterior.
+ */
+bool takeTemperature(float& temperatura) {
+  if (!temperatureFresh) {
+    return false;
+  }
+
+  temperatureFresh = false;
+  temperatura = lastTemp;
+  return true;
+}
+
+/**
+ * Humedad del suelo actual, del valor ya filtrado por el muestreador del
+ * ADC (no espera ninguna conversión)
+ */
+bool readSoilMoisture(float& percent) {
+  float soilRaw;
+
+  if (!halAdcRead(ADC_SOIL, soilRaw)) {
+    return false;
+  }
+
+  percent = soilMoistureFromRaw(soilRaw);
+  return true;
+}
+
+/**
+ * Avanza la adquisición como máximo un paso. Debe llamarse en cada
+ * iteración del loop; nunca espera con delay(). Cuando hay una lectura
+ * disponible en data retorna los sensores leídos (máscara de SensorId);
+ * si no, 0.
+ */
+uint8_t pollSensors(SensorData& data) {
+  // Procesar lo capturado por el ADC aunque no haya lectura en curso
+  halAdcPoll();
   
-  DEBUG_PRINTF("Temperatura: %.2f °C\n", data.temperatura);
-  DEBUG_PRINTF("Humedad: %.2f %%\n", data.humedad);
-  DEBUG_PRINTF("Humedad Suelo: %.2f %%\n", data.humedadSuelo);
-  DEBUG_PRINTF("Luminosidad: %.2f %%\n", data.luminosidad);
-  DEBUG_PRINTF("Válido: %s\n", data.valid ? "Sí" : "No");
+  unsigned long now = halMillis();
+  sampleAnalog(now);
   
-  return data;
+  if (acq.state == ACQ_IDLE) {
+    if ((long)(now - nextDhtSampleAt) < 0) {
+      return 0;
+    }
+    startDhtSample(now);
+  }
+
+  // Esperando el siguiente reintento o la siguiente muestra
+  if ((long)(now - acq.nextStepAt) < 0) {
+    return 0;
+  }
+
+  switch (acq.state) {
+    case ACQ_DHT_START:
+      // El DHT22 no admite tramas seguidas (lectura completa y refresco)
+      if (acq.dhtStarted && now - acq.dhtStartedAt < DHT_MIN_INTERVAL_MS) {
+        acq.nextStepAt = acq.dhtStartedAt + DHT_MIN_INTERVAL_MS;
+        break;
+      }
+      halDhtStart();
+      acq.dhtStarted = true;
+      acq.dhtStartedAt = now;
+      nextDhtSampleAt = now + DHT_SAMPLE_INTERVAL_MS;
+      acq.state = ACQ_DHT_WAIT;
+      break;
+
+    case ACQ_DHT_WAIT: {
+      Dht22Reading reading;
+      Dht22Status status = halDhtPoll(reading);
+      if (status != DHT_PENDING) {
+        stepDhtResult(now, status, reading);
+      }
+      break;
+    }
+
+    case ACQ_ANALOG:
+      if (stepAnalog(now)) {
+        acq.state = ACQ_DONE;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  if (acq.state != ACQ_DONE) {
+    return 0;
+  }
+
+  acq.data.timestamp = halMillis();
+  acq.data.valid = validateSensorData(acq.data);
+  acq.state = ACQ_IDLE;
+
+  // Las métricas leídas se llevan su ventana y empiezan otra; las demás
+  // siguen acumulando hasta la lectura de su sensor
+  for (size_t i = 0; i < SENSOR_METRIC_COUNT; i++) {
+    if (acq.sensors & (1u << sensorOfMetric(i))) {
+      acq.data.window[i] = windowStats[i].summary();
+      windowStats[i].reset();
+    } else {
+      acq.data.window[i].count = 0;
+    }
+  }
+
+  LOG_D(LOG_SENSORS, "Temperatura %.2f °C, humedad %.2f %%, suelo %.2f %%, luz %.2f %%, válido: %s",
+        acq.data.temperatura, acq.data.humedad, acq.data.humedadSuelo,
+        acq.data.luminosidad, acq.data.valid ? "sí" : "no");
+
+  data = acq.data;
+  return acq.sensors;
+}
+
+/**
+ * Indica si hay un ciclo de lectura en curso
+ */
+bool isSensorAcquisitionBusy() {
+  return acq.state != ACQ_IDLE;
 }
 
 /**
@@ -176,22 +381,22 @@ SensorData readAllSensors() {
  */
 bool validateSensorData(const SensorData& data) {
   if (isnan(data.temperatura) || data.temperatura < -40 || data.temperatura > 80) {
-    DEBUG_PRINTLN("Validación: Temperatura fuera de rango");
+    LOG_W(LOG_SENSORS, "Validación: temperatura fuera de rango");
     return false;
   }
   
   if (isnan(data.humedad) || data.humedad < 0 || data.humedad > 100) {
-    DEBUG_PRINTLN("Validación: Humedad fuera de rango");
+    LOG_W(LOG_SENSORS, "Validación: humedad fuera de rango");
     return false;
   }
   
   if (data.humedadSuelo < 0 || data.humedadSuelo > 100) {
-    DEBUG_PRINTLN("Validación: Humedad suelo fuera de rango");
+    LOG_W(LOG_SENSORS, "Validación: humedad del suelo fuera de rango");
     return false;
   }
   
   if (data.luminosidad < 0 || data.luminosidad > 100) {
-    DEBUG_PRINTLN("Validación: Luminosidad fuera de rango");
+    LOG_W(LOG_SENSORS, "Validación: luminosidad fuera de rango");
     return false;
   }
   
@@ -199,20 +404,9 @@ bool validateSensorData(const SensorData& data) {
 }
 
 /**
- * Convierte datos de sensores a JSON
+ * Convierte datos de sensores a JSON en el buffer del llamador.
+ * Retorna la longitud escrita, o 0 si no cabe.
  */
-String sensorDataToJson(const SensorData& data) {
-  StaticJsonDocument<256> doc;
-  
-  doc["thing"] = THING_NAME;
-  doc["timestamp"] = data.timestamp;
-  doc["temperatura"] = round(data.temperatura * 100) / 100.0;
-  doc["humedad"] = round(data.humedad * 100) / 100.0;
-  doc["humedadSuelo"] = round(data.humedadSuelo * 100) / 100.0;
-  doc["luminosidad"] = round(data.luminosidad * 100) / 100.0;
-  
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
-  return jsonString;
+size_t sensorDataToJson(const SensorData& data, char* buffer, size_t capacity) {
+  return encodeSensorData(CODEC_JSON, data, (uint8_t*)buffer, capacity);
 }
@@ -1,26 +1,20 @@
 #ifndef SENSORS_H
 #define SENSORS_H
 
-#include <Arduino.h>
-
-// Estructura para datos de sensores
-struct SensorData {
-  float temperatura;
-  float humedad;
-  float humedadSuelo;
-  float luminosidad;
-  bool valid;
-  unsigned long timestamp;
-};
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
 
 // Funciones públicas
 void initSensors();
-SensorData readAllSensors();
-float readTemperature();
-float readHumidity();
-float readSoilMoisture();
-float readLuminosity();
+void startSensorAcquisition(uint8_t sensors);
+uint8_t pollSensors(SensorData& data);
+bool isSensorAcquisitionBusy();
 bool validateSensorData(const SensorData& data);
-String sensorDataToJson(const SensorData& data);
+size_t sensorDataToJson(const SensorData& data, char* buffer, size_t capacity);
+
+// Medidas para el control en lazo cerrado, entre lecturas completas
+bool takeTemperature(float& temperatura);
+bool readSoilMoisture(float& percent);
 
 #endif // SENSORS_H
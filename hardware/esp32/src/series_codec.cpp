@@ -0,0 +1,241 @@
+#include "series_codec.h"
+#include <math.h>
+#include <string.h>
+
+// Anchos de cada tramo de prefijo ('10', '110', '1110', '1111')
+static const uint8_t TIMESTAMP_WIDTHS[4] = { 7, 9, 12, 32 };
+static const uint8_t VALUE_WIDTHS[4] = { 6, 10, 16, 32 };
+
+static int32_t toFixed(float value) {
+  return (int32_t)lroundf(value * 100.0f);
+}
+
+static void toFixedValues(const SensorData& data, int32_t* values) {
+  values[0] = toFixed(data.temperatura);
+  values[1] = toFixed(data.humedad);
+  values[2] = toFixed(data.humedadSuelo);
+  values[3] = toFixed(data.luminosidad);
+}
+
+static uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// ============================================
+// CODIFICADOR
+// ============================================
+
+SeriesEncoder::SeriesEncoder()
+  : buffer(nullptr), capacity(0), bitPos(0), count(0),
+    prevTimestamp(0), prevDelta(0) {
+  memset(prevValues, 0, sizeof(prevValues));
+}
+
+void SeriesEncoder::begin(uint8_t* out, size_t outCapacity) {
+  buffer = out;
+  capacity = outCapacity;
+  count = 0;
+  bitPos = SERIES_HEADER_SIZE * 8;
+
+  if (capacity >= SERIES_HEADER_SIZE) {
+    memset(buffer, 0, capacity);
+    buffer[0] = SERIES_VERSION;
+  }
+}
+
+void SeriesEncoder::writeBits(uint32_t value, uint8_t width) {
+  for (int b = width - 1; b >= 0; b--) {
+    if ((value >> b) & 1) {
+      buffer[bitPos >> 3] |= 0x80 >> (bitPos & 7);
+    }
+    bitPos++;
+  }
+}
+
+/**
+ * Escribe un delta con el prefijo del tramo más corto en que cabe
+ */
+void SeriesEncoder::writeDelta(int32_t delta, const uint8_t* widths) {
+  if (delta == 0) {
+    writeBits(0, 1);
+    return;
+  }
+
+  uint32_t encoded = zigzag(delta);
+
+  for (int i = 0; i < 3; i++) {
+    if (encoded < (1u << widths[i])) {
+      // Prefijo: i+1 unos y un cero
+      writeBits(((1u << (i + 1)) - 1) << 1, i + 2);
+      writeBits(encoded, widths[i]);
+      return;
+    }
+  }
+
+  writeBits(0xF, 4);
+  writeBits(encoded, widths[3]);
+}
+
+/**
+ * Añade una lectura al bloque. Retorna false si no hay espacio para el
+ * peor caso; el bloque ya escrito sigue siendo válido.
+ */
+bool SeriesEncoder::add(const SensorData& data) {
+  if (capacity < SERIES_HEADER_SIZE ||
+      (bitPos + 7) / 8 + SERIES_MAX_SAMPLE_BYTES > capacity ||
+      count >= 0xFFFF) {
+    return false;
+  }
+
+  uint32_t timestamp = (uint32_t)data.timestamp;
+  int32_t values[4];
+  toFixedValues(data, values);
+
+  if (count == 0) {
+    // Primera lectura en claro
+    writeBits(timestamp, 32);
+    for (int i = 0; i < 4; i++) {
+      writeBits((uint32_t)values[i], 32);
+    }
+    prevDelta = 0;
+  } else {
+    int32_t delta = (int32_t)(timestamp - prevTimestamp);
+    writeDelta(delta - prevDelta, TIMESTAMP_WIDTHS);
+    prevDelta = delta;
+
+    for (int i = 0; i < 4; i++) {
+      writeDelta(values[i] - prevValues[i], VALUE_WIDTHS);
+    }
+  }
+
+  prevTimestamp = timestamp;
+  memcpy(prevValues, values, sizeof(prevValues));
+  count++;
+  return true;
+}
+
+/**
+ * Cierra el bloque escribiendo el número de lecturas. Retorna su tamaño.
+ */
+size_t SeriesEncoder::finish() {
+  if (capacity < SERIES_HEADER_SIZE) {
+    return 0;
+  }
+
+  buffer[1] = count & 0xFF;
+  buffer[2] = count >> 8;
+  return (bitPos + 7) / 8;
+}
+
+// ============================================
+// DECODIFICADOR
+// ============================================
+
+SeriesDecoder::SeriesDecoder(const uint8_t* in, size_t inLength)
+  : buffer(in), length(inLength), bitPos(SERIES_HEADER_SIZE * 8), total(0),
+    index(0), ok(false), prevTimestamp(0), prevDelta(0) {
+  memset(prevValues, 0, sizeof(prevValues));
+
+  if (length >= SERIES_HEADER_SIZE && buffer[0] == SERIES_VERSION) {
+    total = buffer[1] | (buffer[2] << 8);
+    ok = true;
+  }
+}
+
+bool SeriesDecoder::readBits(uint8_t width, uint32_t& value) {
+  if (bitPos + width > length * 8) {
+    ok = false;
+    return false;
+  }
+
+  value = 0;
+  for (uint8_t b = 0; b < width; b++) {
+    value = (value << 1) | ((buffer[bitPos >> 3] >> (7 - (bitPos & 7))) & 1);
+    bitPos++;
+  }
+  return true;
+}
+
+bool SeriesDecoder::readDelta(const uint8_t* widths, int32_t& delta) {
+  uint32_t bit;
+  int ones = 0;
+
+  // Contar unos del prefijo (como máximo 4)
+  while (ones < 4) {
+    if (!readBits(1, bit)) {
+      return false;
+    }
+    if (bit == 0) {
+      break;
+    }
+    ones++;
+  }
+
+  if (ones == 0) {
+    delta = 0;
+    return true;
+  }
+
+  uint32_t encoded;
+  if (!readBits(widths[ones - 1], encoded)) {
+    return false;
+  }
+
+  delta = unzigzag(encoded);
+  return true;
+}
+
+/**
+ * Decodifica la siguiente lectura. Retorna false al terminar el bloque
+ * o si está corrupto (ver valid()).
+ */
+bool SeriesDecoder::next(SensorData& data) {
+  if (!ok || index >= total) {
+    return false;
+  }
+
+  int32_t values[4];
+
+  if (index == 0) {
+    uint32_t raw;
+    if (!readBits(32, prevTimestamp)) {
+      return false;
+    }
+    for (int i = 0; i < 4; i++) {
+      if (!readBits(32, raw)) {
+        return false;
+      }
+      values[i] = (int32_t)raw;
+    }
+  } else {
+    int32_t dod;
+    if (!readDelta(TIMESTAMP_WIDTHS, dod)) {
+      return false;
+    }
+    prevDelta += dod;
+    prevTimestamp += prevDelta;
+
+    for (int i = 0; i < 4; i++) {
+      int32_t delta;
+      if (!readDelta(VALUE_WIDTHS, delta)) {
+        return false;
+      }
+      values[i] = prevValues[i] + delta;
+    }
+  }
+
+  memcpy(prevValues, values, sizeof(prevValues));
+  index++;
+
+  data.timestamp = prevTimestamp;
+  data.temperatura = values[0] / 100.0f;
+  data.humedad = values[1] / 100.0f;
+  data.humedadSuelo = values[2] / 100.0f;
+  data.luminosidad = values[3] / 100.0f;
+  data.valid = true;
+  return true;
+}
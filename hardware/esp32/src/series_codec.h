@@ -0,0 +1,72 @@
+#ifndef SERIES_CODEC_H
+#define SERIES_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+
+/**
+ * Compresión por bloques de series de lecturas, al estilo Gorilla.
+ *
+ *   - Timestamps: delta-de-delta con prefijos de longitud variable
+ *     ('0' = misma cadencia, '10' + 7 bits, '110' + 9, '1110' + 12, '1111' + 32).
+ *   - Valores: punto fijo en centésimas y delta respecto a la lectura
+ *     anterior en zigzag ('0' = sin cambio, '10' + 6 bits, '110' + 10,
+ *     '1110' + 16, '1111' + 32).
+ * Con cadencia regular y valores que derivan lentamente cada lectura ocupa
+ * unos 3-4 bytes. Cabecera del bloque: [versión u8][lecturas u16][bits...].
+ * No depende de Arduino; sirve tanto para lotes salientes como para un
+ * histórico en el propio dispositivo.
+ */
+#define SERIES_VERSION 1
+#define SERIES_HEADER_SIZE 3
+#define SERIES_MAX_SAMPLE_BYTES 23     // Peor caso de una lectura (180 bits)
+
+class SeriesEncoder {
+public:
+  SeriesEncoder();
+
+  void begin(uint8_t* buffer, size_t capacity);
+  bool add(const SensorData& data);
+  size_t finish();
+
+  size_t samples() const { return count; }
+  size_t bits() const { return bitPos; }
+
+private:
+  void writeBits(uint32_t value, uint8_t width);
+  void writeDelta(int32_t delta, const uint8_t* widths);
+
+  uint8_t* buffer;
+  size_t capacity;
+  size_t bitPos;
+  size_t count;
+  uint32_t prevTimestamp;
+  int32_t prevDelta;
+  int32_t prevValues[4];
+};
+
+class SeriesDecoder {
+public:
+  SeriesDecoder(const uint8_t* buffer, size_t length);
+
+  bool valid() const { return ok; }
+  size_t samples() const { return total; }
+  bool next(SensorData& data);
+
+private:
+  bool readBits(uint8_t width, uint32_t& value);
+  bool readDelta(const uint8_t* widths, int32_t& delta);
+
+  const uint8_t* buffer;
+  size_t length;
+  size_t bitPos;
+  size_t total;
+  size_t index;
+  bool ok;
+  uint32_t prevTimestamp;
+  int32_t prevDelta;
+  int32_t prevValues[4];
+};
+
+#endif // SERIES_CODEC_H
@@ -0,0 +1,105 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * Cola circular lock-free de un productor y un consumidor (SPSC).
+ *
+ * Capacidad fija N (potencia de 2), sin memoria dinámica. Solo depende de
+ * std::atomic, por lo que compila igual en el ESP32 que en Linux.
+ * push() solo debe llamarse desde la tarea productora y pop() solo desde
+ * la consumidora.
+ */
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+public:
+  /**
+   * origin fija el valor inicial de los índices; como N divide a 2^n, la
+   * cola funciona igual al desbordarse (las pruebas empiezan cerca).
+   */
+  explicit SpscRing(size_t origin = 0) : head(origin), tail(origin) {}
+
+  /**
+   * Encola un elemento. Retorna false si la cola está llena.
+   */
+  bool push(const T& item) {
+    size_t h = head.load(std::memory_order_relaxed);
+
+    if (h - tail.load(std::memory_order_acquire) >= N) {
+      return false;
+    }
+
+    buffer[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Extrae el elemento más antiguo. Retorna false si la cola está vacía.
+   */
+  bool pop(T& item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    item = buffer[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Encola hasta count elementos de una vez. Retorna cuántos cupieron.
+   */
+  size_t write(const T* items, size_t count) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t space = N - (h - tail.load(std::memory_order_acquire));
+    size_t n = count < space ? count : space;
+
+    for (size_t i = 0; i < n; i++) {
+      buffer[(h + i) & (N - 1)] = items[i];
+    }
+    head.store(h + n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * Extrae hasta count elementos de una vez. Retorna cuántos había.
+   */
+  size_t read(T* items, size_t count) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t available = head.load(std::memory_order_acquire) - t;
+    size_t n = count < available ? count : available;
+
+    for (size_t i = 0; i < n; i++) {
+      items[i] = buffer[(t + i) & (N - 1)];
+    }
+    tail.store(t + n, std::memory_order_release);
+    return n;
+  }
+
+  size_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  static constexpr size_t capacity() {
+    return N;
+  }
+
+private:
+  // Índices en líneas de caché separadas para evitar falso compartido
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+  T buffer[N];
+};
+
+#endif // SPSC_RING_H
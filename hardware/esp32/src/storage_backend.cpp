@@ -0,0 +1,149 @@
+#include "storage_backend.h"
+#include <string.h>
+
+// ============================================
+// BACKEND EN RAM
+// ============================================
+
+RamStorageBackend::RamStorageBackend(size_t sectorSize, size_t sectorCount)
+  : sectorBytes(sectorSize), sectors(sectorCount), syncs(0), writeBudget(-1) {
+  memory = new uint8_t[sectorSize * sectorCount];
+  erases = new uint32_t[sectorCount];
+  memset(memory, 0xFF, sectorSize * sectorCount);
+  memset(erases, 0, sizeof(uint32_t) * sectorCount);
+}
+
+RamStorageBackend::~RamStorageBackend() {
+  delete[] memory;
+  delete[] erases;
+}
+
+bool RamStorageBackend::read(size_t offset, void* buffer, size_t length) {
+  if (offset + length > sectorBytes * sectors) {
+    return false;
+  }
+
+  memcpy(buffer, memory + offset, length);
+  return true;
+}
+
+bool RamStorageBackend::write(size_t offset, const void* data, size_t length) {
+  if (offset + length > sectorBytes * sectors) {
+    return false;
+  }
+
+  const uint8_t* src = (const uint8_t*)data;
+
+  for (size_t i = 0; i < length; i++) {
+    if (writeBudget == 0) {
+      return false; // Corte de energía simulado: escritura parcial
+    }
+    if (writeBudget > 0) {
+      writeBudget--;
+    }
+    memory[offset + i] &= src[i]; // NOR: solo bits 1 -> 0
+  }
+
+  return true;
+}
+
+bool RamStorageBackend::eraseSector(size_t sector) {
+  if (sector >= sectors || writeBudget == 0) {
+    return false;
+  }
+
+  memset(memory + sector * sectorBytes, 0xFF, sectorBytes);
+  erases[sector]++;
+  return true;
+}
+
+// ============================================
+// BACKEND LITTLEFS (ESP32)
+// ============================================
+#ifdef ARDUINO
+#include <LittleFS.h>
+#include "config.h"
+#include "logger.h"
+
+LittleFsStorageBackend::LittleFsStorageBackend(const char* path, size_t sectorSize,
+                                               size_t sectorCount)
+  : path(path), sectorBytes(sectorSize), sectors(sectorCount) {}
+
+/**
+ * Monta LittleFS y preasigna el archivo del registro (todo en 0xFF)
+ */
+bool LittleFsStorageBackend::begin() {
+  if (!LittleFS.begin(true)) {
+    LOG_E(LOG_STORAGE, "No se pudo montar LittleFS");
+    return false;
+  }
+
+  size_t total = sectorBytes * sectors;
+
+  if (LittleFS.exists(path)) {
+    file = LittleFS.open(path, "r+");
+    if (file && file.size() == total) {
+      return true;
+    }
+    file.close();
+  }
+
+  LOG_I(LOG_STORAGE, "Creando registro de telemetría en LittleFS...");
+  file = LittleFS.open(path, "w+");
+  if (!file) {
+    return false;
+  }
+
+  uint8_t blank[64];
+  memset(blank, 0xFF, sizeof(blank));
+  for (size_t written = 0; written < total; written += sizeof(blank)) {
+    if (file.write(blank, sizeof(blank)) != sizeof(blank)) {
+      file.close();
+      return false;
+    }
+  }
+  file.flush();
+  return true;
+}
+
+bool LittleFsStorageBackend::read(size_t offset, void* buffer, size_t length) {
+  if (!file || !file.seek(offset)) {
+    return false;
+  }
+  return file.read((uint8_t*)buffer, length) == length;
+}
+
+bool LittleFsStorageBackend::write(size_t offset, const void* data, size_t length) {
+  // Los registros consecutivos se anexan sin buscar (buscar vacía la caché)
+  if (!file || (file.position() != offset && !file.seek(offset))) {
+    return false;
+  }
+  return file.write((const uint8_t*)data, length) == length;
+}
+
+bool LittleFsStorageBackend::eraseSector(size_t sector) {
+  if (!file || sector >= sectors || !file.seek(sector * sectorBytes)) {
+    return false;
+  }
+
+  uint8_t blank[64];
+  memset(blank, 0xFF, sizeof(blank));
+  for (size_t written = 0; written < sectorBytes; written += sizeof(blank)) {
+    if (file.write(blank, sizeof(blank)) != sizeof(blank)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Persiste lo escrito desde el último volcado (datos y metadatos)
+ */
+bool LittleFsStorageBackend::sync() {
+  if (!file) {
+    return false;
+  }
+  file.flush();
+  return true;
+}
+#endif
@@ -0,0 +1,93 @@
+#ifndef STORAGE_BACKEND_H
+#define STORAGE_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Almacenamiento por sectores con semántica de flash NOR:
+ * eraseSector() deja todos los bytes en 0xFF y write() solo puede pasar
+ * bits de 1 a 0. Lo escrito puede quedar en caché hasta sync(). El
+ * registro de telemetría (telemetry_log.h) solo usa esta interfaz, de modo
+ * que el backend puede sustituirse en Linux.
+ */
+class StorageBackend {
+public:
+  virtual ~StorageBackend() {}
+
+  virtual size_t sectorSize() const = 0;
+  virtual size_t sectorCount() const = 0;
+
+  virtual bool read(size_t offset, void* buffer, size_t length) = 0;
+  virtual bool write(size_t offset, const void* data, size_t length) = 0;
+  virtual bool eraseSector(size_t sector) = 0;
+  virtual bool sync() { return true; }
+};
+
+/**
+ * Backend en RAM para pruebas y mediciones en el host.
+ * Emula la semántica NOR y permite simular un corte de energía:
+ * tras agotar el presupuesto de bytes, las escrituras se truncan y fallan.
+ */
+class RamStorageBackend : public StorageBackend {
+public:
+  RamStorageBackend(size_t sectorSize, size_t sectorCount);
+  ~RamStorageBackend();
+
+  size_t sectorSize() const { return sectorBytes; }
+  size_t sectorCount() const { return sectors; }
+
+  bool read(size_t offset, void* buffer, size_t length);
+  bool write(size_t offset, const void* data, size_t length);
+  bool eraseSector(size_t sector);
+  bool sync() { syncs++; return true; }
+
+  // Corta la "energía" tras escribir budget bytes más (-1 = sin límite)
+  void setWriteBudget(long budget) { writeBudget = budget; }
+
+  uint32_t eraseCount(size_t sector) const { return erases[sector]; }
+  uint32_t syncCount() const { return syncs; }
+  uint8_t* data() { return memory; }
+
+private:
+  size_t sectorBytes;
+  size_t sectors;
+  uint8_t* memory;
+  uint32_t* erases;
+  uint32_t syncs;
+  long writeBudget;
+};
+
+#ifdef ARDUINO
+#include <FS.h>
+
+/**
+ * Backend sobre un archivo preasignado en LittleFS.
+ * LittleFS es copy-on-write: cada volcado reescribe el bloque de cola y
+ * los metadatos del archivo. Por eso write() no vuelca (lo hace sync(),
+ * que el registro llama por lotes) y no reposiciona el archivo si ya está
+ * en el offset pedido, ya que buscar también vacía la caché.
+ */
+class LittleFsStorageBackend : public StorageBackend {
+public:
+  LittleFsStorageBackend(const char* path, size_t sectorSize, size_t sectorCount);
+
+  bool begin();
+
+  size_t sectorSize() const { return sectorBytes; }
+  size_t sectorCount() const { return sectors; }
+
+  bool read(size_t offset, void* buffer, size_t length);
+  bool write(size_t offset, const void* data, size_t length);
+  bool eraseSector(size_t sector);
+  bool sync();
+
+private:
+  const char* path;
+  size_t sectorBytes;
+  size_t sectors;
+  fs::File file;
+};
+#endif
+
+#endif // STORAGE_BACKEND_H
@@ -0,0 +1,171 @@
+#include "telemetry_batcher.h"
+#include "config.h"
+#include "diagnostics.h"
+#include <string.h>
+
+// El modo compatible necesita hueco para los cuatro topics a la vez
+static_assert(MQTT_OUTBOX_SLOTS - MQTT_OUTBOX_RESERVED >= 4,
+              "La telemetría no puede encolar los cuatro topics antiguos");
+
+TelemetryBatcher::TelemetryBatcher(uint8_t* buffer, size_t capacity)
+  : buffer(buffer), capacity(capacity), publish(nullptr), room(nullptr),
+    count(0), firstSampleAt(0) {
+  policy.mode = TELEMETRY_BATCHED;
+  policy.maxSamples = 1;
+  policy.maxAgeMs = 0;
+  policy.codec = CODEC_JSON;
+  memset(&counters, 0, sizeof(counters));
+}
+
+void TelemetryBatcher::begin(const BatchPolicy& batchPolicy, TelemetryPublishFn publishFn,
+                             TelemetryRoomFn roomFn) {
+  policy = batchPolicy;
+  publish = publishFn;
+  room = roomFn;
+
+  if (policy.maxSamples == 0) {
+    policy.maxSamples = 1;
+  }
+  if (policy.maxSamples > TELEMETRY_BATCH_CAPACITY) {
+    policy.maxSamples = TELEMETRY_BATCH_CAPACITY;
+  }
+
+  reset();
+}
+
+void TelemetryBatcher::reset() {
+  count = 0;
+  encoder.begin(policy.codec, buffer, capacity);
+}
+
+/**
+ * Añade la lectura al payload en construcción. Retorna false si no cabe.
+ */
+bool TelemetryBatcher::appendSample(const SensorData& data) {
+  DIAG_SCOPE(DIAG_SERIALIZE);
+  if (!encoder.add(data)) {
+    return false;
+  }
+
+  samples[count++] = data;
+  return true;
+}
+
+/**
+ * Publica la lectura en los topics por métrica (modo compatible). Solo
+ * empieza si caben los cuatro mensajes: si retorna false el llamador
+ * conserva la lectura y la reintentará entera, así que publicar una parte
+ * duplicaría esos topics.
+ */
+bool TelemetryBatcher::publishLegacy(const SensorData& data) {
+  static const char* const legacyTopics[] = {
+    TOPIC_TEMPERATURA, TOPIC_HUMEDAD, TOPIC_HUMEDAD_SUELO, TOPIC_LUMINOSIDAD
+  };
+  const size_t topicCount = sizeof(legacyTopics) / sizeof(legacyTopics[0]);
+
+  if (room != nullptr && room(legacyTopics[0]) < topicCount) {
+    return false;
+  }
+
+  size_t len;
+  {
+    DIAG_SCOPE(DIAG_SERIALIZE);
+    len = encodeSensorData(CODEC_JSON, data, buffer, capacity);
+  }
+  if (len == 0) {
+    return false;
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < topicCount; i++) {
+    if (!publish(legacyTopics[i], buffer, len)) {
+      ok = false;
+      continue;
+    }
+    counters.messages++;
+    counters.bytes += len;
+  }
+
+  if (ok) {
+    counters.samples++;
+  }
+  return ok;
+}
+
+/**
+ * Añade una lectura al lote y publica si se alcanzó la política.
+ * Retorna false si la lectura no pudo aceptarse (lote lleno y sin conexión);
+ * en ese caso el llamador conserva la lectura.
+ */
+bool TelemetryBatcher::add(const SensorData& data, unsigned long now) {
+  if (policy.mode == TELEMETRY_LEGACY_TOPICS) {
+    return publishLegacy(data);
+  }
+
+  if (count >= policy.maxSamples || !appendSample(data)) {
+    // Lote lleno o sin espacio en el buffer: publicar y reintentar
+    if (count == 0 || !flush(now) || !appendSample(data)) {
+      return false;
+    }
+  }
+
+  if (count == 1) {
+    firstSampleAt = now;
+  }
+
+  if (count >= policy.maxSamples) {
+    flush(now);
+  }
+  return true;
+}
+
+/**
+ * Publica el lote si la lectura más antigua superó maxAgeMs
+ */
+bool TelemetryBatcher::poll(unsigned long now) {
+  if (count == 0 || now - firstSampleAt < policy.maxAgeMs) {
+    return false;
+  }
+  return flush(now);
+}
+
+/**
+ * Cierra y publica el lote en curso. Si falla, el lote se conserva.
+ */
+bool TelemetryBatcher::flush(unsigned long now) {
+  if (count == 0) {
+    return true;
+  }
+
+  // El cierre se escribe tras los datos ya codificados, sin alterarlos:
+  // si la publicación falla el lote puede seguir creciendo
+  size_t total;
+  {
+    DIAG_SCOPE(DIAG_SERIALIZE);
+    total = encoder.finish();
+  }
+
+  if (!publish(TOPIC_TELEMETRIA, buffer, total)) {
+    return false;
+  }
+
+  counters.samples += count;
+  counters.messages++;
+  counters.bytes += total;
+  if (now - firstSampleAt > counters.maxWaitMs) {
+    counters.maxWaitMs = (uint32_t)(now - firstSampleAt);
+  }
+  reset();
+  return true;
+}
+
+/**
+ * Extrae las lecturas aún no publicadas (p. ej. para guardarlas en flash
+ * durante un corte) y vacía el lote
+ */
+size_t TelemetryBatcher::takePending(SensorData* out, size_t maxCount) {
+  size_t n = count < maxCount ? count : maxCount;
+  memcpy(out, samples, n * sizeof(SensorData));
+  reset();
+  return n;
+}
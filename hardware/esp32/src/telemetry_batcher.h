@@ -0,0 +1,79 @@
+#ifndef TELEMETRY_BATCHER_H
+#define TELEMETRY_BATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+#include "payload_codec.h"
+
+// Capacidad máxima de un lote (el límite efectivo lo fija BatchPolicy)
+#define TELEMETRY_BATCH_CAPACITY 32
+
+// Modo de publicación de telemetría
+enum TelemetryMode {
+  TELEMETRY_BATCHED,        // Un mensaje con N lecturas en TOPIC_TELEMETRIA
+  TELEMETRY_LEGACY_TOPICS   // Una lectura por mensaje, repetida en los 4 topics antiguos
+};
+
+// Política de vaciado del lote
+struct BatchPolicy {
+  TelemetryMode mode;
+  uint16_t maxSamples;   // Publicar al acumular este número de lecturas
+  uint32_t maxAgeMs;     // ...o cuando la lectura más antigua tenga esta edad
+  PayloadCodec codec;    // Codificación del lote (los topics antiguos siempre usan JSON)
+};
+
+// Contadores para medir el ahorro
+struct BatchStats {
+  uint32_t samples;      // Lecturas publicadas
+  uint32_t messages;     // Mensajes MQTT enviados
+  uint32_t bytes;        // Bytes de payload enviados
+  uint32_t maxWaitMs;    // Mayor espera de una lectura en el lote antes de publicarse
+};
+
+// Función de publicación (topic, payload, longitud)
+typedef bool (*TelemetryPublishFn)(const char* topic, const uint8_t* payload, size_t length);
+
+// Mensajes que aún se pueden publicar en el topic sin que se rechacen
+typedef size_t (*TelemetryRoomFn)(const char* topic);
+
+/**
+ * Acumula lecturas y las publica como un único mensaje por lote.
+ * El payload se construye de forma incremental sobre un buffer fijo
+ * proporcionado por el llamador; nunca usa memoria dinámica.
+ */
+class TelemetryBatcher {
+public:
+  TelemetryBatcher(uint8_t* buffer, size_t capacity);
+
+  // room (opcional) evita publicar una lectura del modo compatible solo
+  // en parte de sus topics
+  void begin(const BatchPolicy& policy, TelemetryPublishFn publish,
+             TelemetryRoomFn room = nullptr);
+
+  bool add(const SensorData& data, unsigned long now);
+  bool poll(unsigned long now);
+  bool flush(unsigned long now);
+
+  size_t pending() const { return count; }
+  size_t takePending(SensorData* out, size_t maxCount);
+  const BatchStats& stats() const { return counters; }
+
+private:
+  bool appendSample(const SensorData& data);
+  bool publishLegacy(const SensorData& data);
+  void reset();
+
+  uint8_t* buffer;
+  size_t capacity;
+  BatchEncoder encoder;
+  BatchPolicy policy;
+  TelemetryPublishFn publish;
+  TelemetryRoomFn room;
+  SensorData samples[TELEMETRY_BATCH_CAPACITY];
+  size_t count;
+  unsigned long firstSampleAt;
+  BatchStats counters;
+};
+
+#endif // TELEMETRY_BATCHER_H
@@ -0,0 +1,334 @@
+#include "telemetry_log.h"
+#include "config.h"
+#include <string.h>
+
+#define LOG_SECTOR_MAGIC 0x474F4C54u  // "TLOG"
+#define LOG_HEADER_SIZE 8
+#define LOG_RECORD_SIZE 28
+#define LOG_CONSUMED_OFFSET 24
+#define LOG_CRC_OFFSET 26
+#define LOG_BLANK_SLOT 0xFFFFFFFFu
+#define LOG_BLANK_GENERATION 0xFFFFFFFFu
+
+/**
+ * CRC16-CCITT sobre los campos inmutables del registro
+ */
+static uint16_t crc16(const uint8_t* data, size_t length) {
+  uint16_t crc = 0xFFFF;
+
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+
+  return crc;
+}
+
+/**
+ * Serializa un registro:
+ * [slot u32][timestamp u32][4 x float][consumido u8][reservado u8][crc u16]
+ */
+static void encodeRecord(uint32_t slot, const SensorData& data, uint8_t* rec) {
+  uint32_t ts = (uint32_t)data.timestamp;
+
+  memcpy(rec + 0, &slot, 4);
+  memcpy(rec + 4, &ts, 4);
+  memcpy(rec + 8, &data.temperatura, 4);
+  memcpy(rec + 12, &data.humedad, 4);
+  memcpy(rec + 16, &data.humedadSuelo, 4);
+  memcpy(rec + 20, &data.luminosidad, 4);
+  rec[LOG_CONSUMED_OFFSET] = 0xFF;
+  rec[LOG_CONSUMED_OFFSET + 1] = 0xFF;
+
+  uint16_t crc = crc16(rec, LOG_CONSUMED_OFFSET);
+  memcpy(rec + LOG_CRC_OFFSET, &crc, 2);
+}
+
+static bool decodeRecord(const uint8_t* rec, uint32_t slot, SensorData* out) {
+  uint32_t storedSlot;
+  uint16_t storedCrc;
+
+  memcpy(&storedSlot, rec, 4);
+  memcpy(&storedCrc, rec + LOG_CRC_OFFSET, 2);
+
+  if (storedSlot != slot || storedCrc != crc16(rec, LOG_CONSUMED_OFFSET)) {
+    return false;
+  }
+
+  if (out != nullptr) {
+    uint32_t ts;
+    *out = SensorData();   // El registro no guarda la ventana
+    memcpy(&ts, rec + 4, 4);
+    memcpy(&out->temperatura, rec + 8, 4);
+    memcpy(&out->humedad, rec + 12, 4);
+    memcpy(&out->humedadSuelo, rec + 16, 4);
+    memcpy(&out->luminosidad, rec + 20, 4);
+    out->timestamp = ts;
+    out->valid = true;
+  }
+
+  return true;
+}
+
+TelemetryLog::TelemetryLog()
+  : backend(nullptr), slotsPerSector(0), totalSlots(0),
+    head(0), tail(0), activeGeneration(0), lostRecords(0), unsyncedRecords(0),
+    mounted(false) {}
+
+size_t TelemetryLog::slotOffset(uint32_t slot) const {
+  uint32_t generation = slot / slotsPerSector;
+  size_t sector = generation % backend->sectorCount();
+  return sector * backend->sectorSize() + LOG_HEADER_SIZE +
+         (slot % slotsPerSector) * LOG_RECORD_SIZE;
+}
+
+/**
+ * Lee la cabecera de un sector. Retorna false si el sector no tiene una
+ * cabecera completa de una generación que pueda ocupar ese sector.
+ */
+bool TelemetryLog::readHeader(size_t sector, uint32_t& generation) {
+  uint32_t header[2];
+
+  if (!backend->read(sector * backend->sectorSize(), header, sizeof(header))) {
+    return false;
+  }
+
+  // Las ranuras absolutas (generación * slotsPerSector) caben en 32 bits
+  uint32_t maxGeneration = LOG_BLANK_GENERATION / slotsPerSector - 1;
+
+  generation = header[1];
+  return header[0] == LOG_SECTOR_MAGIC && generation <= maxGeneration &&
+         generation % backend->sectorCount() == sector;
+}
+
+/**
+ * Busca la generación más reciente. Las válidas ocupan como mucho
+ * sectorCount generaciones consecutivas: una que se aleja más de la
+ * siguiente más alta no proviene de la rotación y se descarta.
+ */
+bool TelemetryLog::newestGeneration(uint32_t& newest) {
+  uint32_t limit = LOG_BLANK_GENERATION;
+
+  for (;;) {
+    bool found = false;
+    bool hasNext = false;
+    uint32_t next = 0;
+
+    for (size_t s = 0; s < backend->sectorCount(); s++) {
+      uint32_t generation;
+      if (!readHeader(s, generation) || generation >= limit) {
+        continue;
+      }
+      if (!found || generation > newest) {
+        if (found) {
+          next = newest;
+          hasNext = true;
+        }
+        newest = generation;
+        found = true;
+      } else if (!hasNext || generation > next) {
+        next = generation;
+        hasNext = true;
+      }
+    }
+
+    if (!found || !hasNext || newest - next <= backend->sectorCount()) {
+      return found;
+    }
+    limit = newest;
+  }
+}
+
+/**
+ * Monta el registro reconstruyendo cabeza y cola desde el backend
+ */
+bool TelemetryLog::begin(StorageBackend* storage) {
+  backend = storage;
+  slotsPerSector = (backend->sectorSize() - LOG_HEADER_SIZE) / LOG_RECORD_SIZE;
+  totalSlots = slotsPerSector * backend->sectorCount();
+  unsyncedRecords = 0;
+  mounted = false;
+
+  // Localizar la generación más reciente
+  uint32_t newest = 0;
+
+  if (!newestGeneration(newest)) {
+    // Registro vacío: abrir la generación 0
+    head = tail = 0;
+    activeGeneration = 0;
+    if (!openSector(0)) {
+      return false;
+    }
+    mounted = true;
+    return true;
+  }
+
+  uint32_t oldest = newest >= backend->sectorCount() - 1 ?
+                    newest - (backend->sectorCount() - 1) : 0;
+  head = newest * slotsPerSector;
+  tail = oldest * slotsPerSector;
+  activeGeneration = newest;
+
+  // Recorrer de la generación más antigua a la más nueva
+  uint8_t rec[LOG_RECORD_SIZE];
+
+  for (uint32_t n = 0; n <= newest - oldest; n++) {
+    uint32_t gen = oldest + n;
+    uint32_t stored;
+    if (!readHeader(gen % backend->sectorCount(), stored) || stored != gen) {
+      // Generación sobrescrita o nunca abierta: lo anterior no es recuperable
+      tail = (gen + 1) * slotsPerSector;
+      continue;
+    }
+
+    for (uint32_t i = 0; i < slotsPerSector; i++) {
+      uint32_t slot = gen * slotsPerSector + i;
+      if (!backend->read(slotOffset(slot), rec, LOG_RECORD_SIZE)) {
+        return false;
+      }
+
+      uint32_t storedSlot;
+      memcpy(&storedSlot, rec, 4);
+
+      if (gen == newest && storedSlot == LOG_BLANK_SLOT) {
+        // Primera ranura libre del sector activo: siguiente escritura
+        head = slot;
+        break;
+      }
+
+      head = slot + 1;
+
+      if (rec[LOG_CONSUMED_OFFSET] == 0x00) {
+        tail = slot + 1;
+      }
+    }
+  }
+
+  if (tail > head) {
+    tail = head;
+  }
+
+  mounted = true;
+  return true;
+}
+
+/**
+ * Borra el sector que corresponde a una generación y escribe su cabecera:
+ * primero la generación y por último el magic, que da el sector por
+ * abierto. Si contenía registros pendientes, la cola avanza (se pierden
+ * los más antiguos).
+ */
+bool TelemetryLog::openSector(uint32_t generation) {
+  size_t sector = generation % backend->sectorCount();
+
+  if (generation >= backend->sectorCount()) {
+    uint32_t evictedEnd = (generation - backend->sectorCount() + 1) * slotsPerSector;
+    if (tail < evictedEnd) {
+      lostRecords += evictedEnd - tail;
+      tail = evictedEnd;
+    }
+  }
+
+  if (!backend->eraseSector(sector)) {
+    return false;
+  }
+
+  uint32_t magic = LOG_SECTOR_MAGIC;
+  size_t offset = sector * backend->sectorSize();
+  return backend->write(offset + 4, &generation, 4) && backend->write(offset, &magic, 4) &&
+         syncBackend();
+}
+
+/**
+ * Vuelca al backend lo escrito desde el último volcado
+ */
+bool TelemetryLog::syncBackend() {
+  unsyncedRecords = 0;
+  return backend->sync();
+}
+
+/**
+ * Añade una lectura al final del registro
+ */
+bool TelemetryLog::append(const SensorData& data) {
+  if (!mounted) {
+    return false;
+  }
+
+  if (head / slotsPerSector != activeGeneration) {
+    if (!openSector(head / slotsPerSector)) {
+      return false;
+    }
+    activeGeneration = head / slotsPerSector;
+  }
+
+  uint8_t rec[LOG_RECORD_SIZE];
+  encodeRecord(head, data, rec);
+
+  // La ranura se da por usada aunque la escritura falle a medias:
+  // el CRC la invalidará al leerla
+  uint32_t slot = head++;
+  if (!backend->write(slotOffset(slot), rec, LOG_RECORD_SIZE)) {
+    return false;
+  }
+  return ++unsyncedRecords < STORE_SYNC_RECORDS || syncBackend();
+}
+
+bool TelemetryLog::readSlot(uint32_t slot, SensorData* out) {
+  uint8_t rec[LOG_RECORD_SIZE];
+
+  if (!backend->read(slotOffset(slot), rec, LOG_RECORD_SIZE)) {
+    return false;
+  }
+
+  return decodeRecord(rec, slot, out);
+}
+
+/**
+ * Copia hasta maxCount lecturas pendientes (las más antiguas primero) sin
+ * consumirlas. Los registros corruptos se saltan. Retorna cuántas copió.
+ */
+size_t TelemetryLog::peek(SensorData* out, size_t maxCount) {
+  size_t count = 0;
+
+  for (uint32_t slot = tail; slot != head && count < maxCount; slot++) {
+    if (readSlot(slot, &out[count])) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/**
+ * Marca como enviadas las count lecturas válidas más antiguas.
+ * Solo se escribe la marca del último registro del lote.
+ */
+bool TelemetryLog::consume(size_t count) {
+  uint32_t last = tail;
+  bool any = false;
+
+  while (count > 0 && tail != head) {
+    if (readSlot(tail, nullptr)) {
+      count--;
+      last = tail;
+      any = true;
+    }
+    tail++;
+  }
+
+  // Saltar también los corruptos que sigan, para no releerlos
+  while (tail != head && !readSlot(tail, nullptr)) {
+    tail++;
+  }
+
+  if (!any) {
+    return true;
+  }
+
+  uint8_t consumed = 0x00;
+  return backend->write(slotOffset(last) + LOG_CONSUMED_OFFSET, &consumed, 1) &&
+         syncBackend();
+}
@@ -0,0 +1,65 @@
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+#include "storage_backend.h"
+
+/**
+ * Registro circular de solo-anexado para almacenar lecturas mientras
+ * MQTT no está disponible (store-and-forward).
+ *
+ * Formato en el backend:
+ *   - Cada sector empieza con una cabecera {magic, generación}. La
+ *     generación crece de uno en uno y determina qué sector lógico se usa
+ *     (generación % sectorCount), así cada uno se borra una vez por vuelta.
+ *     El magic se escribe después de la generación: una cabecera cortada
+ *     a medias no tiene magic y el sector no cuenta al montar. Tampoco
+ *     cuentan las generaciones imposibles (en blanco, o a más de
+ *     sectorCount de la siguiente más alta).
+ *   - Tras la cabecera van registros de tamaño fijo con CRC16. Un registro
+ *     a medio escribir (corte de energía) falla el CRC y se ignora.
+ *   - Los registros enviados no se borran: se marca el último de cada lote
+ *     como consumido (un byte 0xFF -> 0x00, válido en flash NOR).
+ *   - El backend se vuelca (sync) cada STORE_SYNC_RECORDS lecturas, al
+ *     abrir un sector y al consumir. En LittleFS cada volcado reescribe el
+ *     bloque de cola y los metadatos (copy-on-write), de modo que el
+ *     desgaste real lo marcan los volcados, no los registros; un corte
+ *     pierde como mucho las últimas STORE_SYNC_RECORDS - 1 lecturas.
+ * Al montar se reconstruyen cabeza y cola recorriendo el backend.
+ */
+class TelemetryLog {
+public:
+  TelemetryLog();
+
+  bool begin(StorageBackend* backend);
+
+  bool append(const SensorData& data);
+  size_t peek(SensorData* out, size_t maxCount);
+  bool consume(size_t count);
+
+  uint32_t pending() const { return head - tail; }
+  uint32_t capacity() const { return totalSlots; }
+  uint32_t overwritten() const { return lostRecords; }
+
+private:
+  bool openSector(uint32_t generation);
+  bool readHeader(size_t sector, uint32_t& generation);
+  bool newestGeneration(uint32_t& newest);
+  bool readSlot(uint32_t slot, SensorData* out);
+  size_t slotOffset(uint32_t slot) const;
+  bool syncBackend();
+
+  StorageBackend* backend;
+  uint32_t slotsPerSector;
+  uint32_t totalSlots;
+  uint32_t head;          // Próxima ranura absoluta a escribir
+  uint32_t tail;          // Próxima ranura absoluta a enviar
+  uint32_t activeGeneration;
+  uint32_t lostRecords;   // Registros pendientes sobrescritos por falta de espacio
+  uint32_t unsyncedRecords; // Anexados desde el último volcado del backend
+  bool mounted;
+};
+
+#endif // TELEMETRY_LOG_H
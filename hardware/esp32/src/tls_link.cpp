@@ -0,0 +1,330 @@
+#include "tls_link.h"
+#include "config.h"
+#include "logger.h"
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/version.h>
+#include <mbedtls/x509_crt.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Enlace TLS mutuo con AWS IoT Core directamente sobre mbedTLS.
+ *
+ * Sustituye a WiFiClientSecure, que no permite ofrecer una sesión previa:
+ * tras cada handshake la sesión (ticket o ID) se serializa en memoria RTC,
+ * que se conserva entre reconexiones y durante el sueño profundo, y el
+ * siguiente enlace la ofrece al servidor. Reanudar evita el intercambio de
+ * claves, la verificación de la cadena del servidor y la firma con la
+ * clave del dispositivo, que son la mayor parte del tiempo y del heap del
+ * handshake. Si el servidor la rechaza se hace uno completo y se guarda la
+ * sesión nueva.
+ *
+ * La clave del dispositivo puede ser RSA o ECDSA P-256 (el tipo se deduce
+ * del PEM). Solo se ofrecen suites ECDHE con AES-128-GCM y la curva P-256:
+ * el ClientHello más corto y el acuerdo de claves más barato que acepta
+ * AWS IoT Core. Sesiones en TLS 1.2, donde la reanudación es un handshake
+ * abreviado de un solo viaje de ida y vuelta.
+ */
+
+// Campos internos de mbedTLS 3 (estado del handshake)
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+// Suites ofrecidas, de preferida a aceptable
+static const int TLS_CIPHERSUITES[] = {
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+  0
+};
+
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+static const uint16_t TLS_GROUPS[] = {
+  MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1,
+  MBEDTLS_SSL_IANA_TLS_GROUP_NONE
+};
+#else
+static const mbedtls_ecp_group_id TLS_CURVES[] = {
+  MBEDTLS_ECP_DP_SECP256R1,
+  MBEDTLS_ECP_DP_NONE
+};
+#endif
+
+// Credenciales y configuración: se cargan una vez y duran todo el arranque
+mbedtls_entropy_context tlsEntropy;
+mbedtls_ctr_drbg_context tlsDrbg;
+mbedtls_x509_crt tlsCaCert;
+mbedtls_x509_crt tlsDeviceCert;
+mbedtls_pk_context tlsDeviceKey;
+mbedtls_ssl_config tlsConfig;
+bool tlsConfigured = false;
+
+// Conexión en curso
+mbedtls_net_context tlsNet;
+mbedtls_ssl_context tlsSsl;
+bool tlsOpen = false;
+
+// Última sesión: memoria RTC (sobrevive al sueño profundo, no a un corte
+// de alimentación, donde se inicializa a cero)
+RTC_DATA_ATTR uint8_t tlsSessionBlob[TLS_SESSION_CACHE_SIZE];
+RTC_DATA_ATTR uint32_t tlsSessionLength = 0;
+
+/**
+ * Carga certificados y clave y prepara la configuración común
+ */
+static bool configureTls() {
+  if (tlsConfigured) {
+    return true;
+  }
+
+  mbedtls_entropy_init(&tlsEntropy);
+  mbedtls_ctr_drbg_init(&tlsDrbg);
+  mbedtls_x509_crt_init(&tlsCaCert);
+  mbedtls_x509_crt_init(&tlsDeviceCert);
+  mbedtls_pk_init(&tlsDeviceKey);
+  mbedtls_ssl_config_init(&tlsConfig);
+
+  // Los PEM se pasan con su terminador nulo
+  int ret = mbedtls_ctr_drbg_seed(&tlsDrbg, mbedtls_entropy_func, &tlsEntropy, nullptr, 0);
+  if (ret == 0) {
+    ret = mbedtls_x509_crt_parse(&tlsCaCert, (const uint8_t*)AWS_CERT_CA, sizeof(AWS_CERT_CA));
+  }
+  if (ret == 0) {
+    ret = mbedtls_x509_crt_parse(&tlsDeviceCert, (const uint8_t*)AWS_CERT_CRT, sizeof(AWS_CERT_CRT));
+  }
+  if (ret == 0) {
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    ret = mbedtls_pk_parse_key(&tlsDeviceKey, (const uint8_t*)AWS_CERT_PRIVATE,
+                               sizeof(AWS_CERT_PRIVATE), nullptr, 0,
+                               mbedtls_ctr_drbg_random, &tlsDrbg);
+#else
+    ret = mbedtls_pk_parse_key(&tlsDeviceKey, (const uint8_t*)AWS_CERT_PRIVATE,
+                               sizeof(AWS_CERT_PRIVATE), nullptr, 0);
+#endif
+  }
+  if (ret == 0) {
+    ret = mbedtls_ssl_config_defaults(&tlsConfig, MBEDTLS_SSL_IS_CLIENT,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  }
+  if (ret == 0) {
+    ret = mbedtls_ssl_conf_own_cert(&tlsConfig, &tlsDeviceCert, &tlsDeviceKey);
+  }
+  if (ret != 0) {
+    LOG_E(LOG_TLS, "Credenciales TLS no válidas (-0x%04x)", (unsigned)-ret);
+    return false;
+  }
+
+  mbedtls_ssl_conf_authmode(&tlsConfig, MBEDTLS_SSL_VERIFY_REQUIRED);
+  mbedtls_ssl_conf_ca_chain(&tlsConfig, &tlsCaCert, nullptr);
+  mbedtls_ssl_conf_rng(&tlsConfig, mbedtls_ctr_drbg_random, &tlsDrbg);
+  mbedtls_ssl_conf_ciphersuites(&tlsConfig, TLS_CIPHERSUITES);
+  mbedtls_ssl_conf_read_timeout(&tlsConfig, MQTT_CONNECT_TIMEOUT_MS);
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+  mbedtls_ssl_conf_groups(&tlsConfig, TLS_GROUPS);
+  mbedtls_ssl_conf_max_tls_version(&tlsConfig, MBEDTLS_SSL_VERSION_TLS1_2);
+#else
+  mbedtls_ssl_conf_curves(&tlsConfig, TLS_CURVES);
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&tlsConfig, TLS_SESSION_RESUMPTION ?
+                                   MBEDTLS_SSL_SESSION_TICKETS_ENABLED :
+                                   MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+#endif
+
+  LOG_I(LOG_TLS, "Clave del dispositivo: %s",
+        mbedtls_pk_get_type(&tlsDeviceKey) == MBEDTLS_PK_ECKEY ? "ECDSA" : "RSA");
+  tlsConfigured = true;
+  return true;
+}
+
+/**
+ * Ofrece la sesión guardada al servidor (antes del ClientHello)
+ */
+static bool offerSavedSession() {
+  if (!TLS_SESSION_RESUMPTION || tlsSessionLength == 0) {
+    return false;
+  }
+
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  bool offered = mbedtls_ssl_session_load(&session, tlsSessionBlob, tlsSessionLength) == 0 &&
+                 mbedtls_ssl_set_session(&tlsSsl, &session) == 0;
+  mbedtls_ssl_session_free(&session);
+
+  if (!offered) {
+    tlsSessionLength = 0;
+  }
+  return offered;
+}
+
+/**
+ * Guarda la sesión recién negociada (o renovada) para la próxima conexión
+ */
+static void saveSession() {
+  if (!TLS_SESSION_RESUMPTION) {
+    return;
+  }
+
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  size_t length = 0;
+
+  if (mbedtls_ssl_get_session(&tlsSsl, &session) == 0 &&
+      mbedtls_ssl_session_save(&session, tlsSessionBlob, sizeof(tlsSessionBlob), &length) == 0) {
+    tlsSessionLength = length;
+  } else {
+    tlsSessionLength = 0;
+    LOG_W(LOG_TLS, "La sesión TLS no cabe en TLS_SESSION_CACHE_SIZE");
+  }
+  mbedtls_ssl_session_free(&session);
+}
+
+static bool handshakeOver() {
+#if MBEDTLS_VERSION_NUMBER >= 0x03020000
+  return mbedtls_ssl_is_handshake_over(&tlsSsl);
+#else
+  return tlsSsl.MBEDTLS_PRIVATE(state) == MBEDTLS_SSL_HANDSHAKE_OVER;
+#endif
+}
+
+/**
+ * Abre TCP y hace el handshake (bloquea la tarea de E/S, no la de red).
+ * El pico de heap es aproximado: se muestrea el heap libre tras cada paso
+ * del handshake, que es cuando los buffers de cada mensaje están vivos.
+ */
+bool tlsLinkConnect(const char* host, uint16_t port, HalHandshake& handshake) {
+  tlsLinkClose();
+  if (!configureTls()) {
+    return false;
+  }
+
+  unsigned long start = millis();
+  size_t freeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  size_t freeMin = freeBefore;
+
+  char portText[6];
+  snprintf(portText, sizeof(portText), "%u", (unsigned)port);
+  mbedtls_net_init(&tlsNet);
+  mbedtls_ssl_init(&tlsSsl);
+  tlsOpen = true;
+
+  int ret = mbedtls_net_connect(&tlsNet, host, portText, MBEDTLS_NET_PROTO_TCP);
+  if (ret == 0) {
+    ret = mbedtls_ssl_setup(&tlsSsl, &tlsConfig);
+  }
+  if (ret == 0) {
+    ret = mbedtls_ssl_set_hostname(&tlsSsl, host);
+  }
+  if (ret != 0) {
+    tlsLinkClose();
+    return false;
+  }
+
+  mbedtls_ssl_set_bio(&tlsSsl, &tlsNet, mbedtls_net_send, nullptr, mbedtls_net_recv_timeout);
+  bool offered = offerSavedSession();
+
+  // Un handshake reanudado (TLS 1.2) no pasa por el intercambio de claves
+  bool keyExchange = false;
+  while (ret == 0 && !handshakeOver()) {
+    if (tlsSsl.MBEDTLS_PRIVATE(state) == MBEDTLS_SSL_CLIENT_KEY_EXCHANGE) {
+      keyExchange = true;
+    }
+    ret = mbedtls_ssl_handshake_step(&tlsSsl);
+
+    size_t freeNow = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    if (freeNow < freeMin) {
+      freeMin = freeNow;
+    }
+  }
+
+  if (ret != 0) {
+    LOG_E(LOG_TLS, "Handshake TLS (-0x%04x)", (unsigned)-ret);
+    // Una sesión rechazada de forma explícita no se vuelve a ofrecer
+    if (offered) {
+      tlsSessionLength = 0;
+    }
+    tlsLinkClose();
+    return false;
+  }
+
+  handshake.durationMs = millis() - start;
+  handshake.peakHeapBytes = freeBefore - freeMin;
+  handshake.resumed = offered && !keyExchange;
+  saveSession();
+
+  // A partir de aquí lectura sin espera; la escritura reintenta en tlsLinkWrite()
+  // hasta MQTT_WRITE_TIMEOUT_MS sin avanzar
+  mbedtls_net_set_nonblock(&tlsNet);
+  mbedtls_ssl_set_bio(&tlsSsl, &tlsNet, mbedtls_net_send, mbedtls_net_recv, nullptr);
+
+  LOG_I(LOG_TLS, "TLS %s en %lu ms, pico de heap %u B",
+        handshake.resumed ? "reanudado" : "completo",
+        (unsigned long)handshake.durationMs, (unsigned)handshake.peakHeapBytes);
+  return true;
+}
+
+/**
+ * Escribe todo el buffer; retorna los bytes escritos o -1 si el enlace cayó.
+ * Un broker que deja de leer no bloquea la tarea: se abandona tras
+ * MQTT_WRITE_TIMEOUT_MS sin avanzar o en cuanto abort() pide cerrar o
+ * reabrir el enlace.
+ */
+int tlsLinkWrite(const uint8_t* data, size_t length, bool (*abort)()) {
+  size_t sent = 0;
+  unsigned long progressAt = millis();
+
+  while (tlsOpen && sent < length) {
+    int ret = mbedtls_ssl_write(&tlsSsl, data + sent, length - sent);
+    if (ret > 0) {
+      sent += ret;
+      progressAt = millis();
+    } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) {
+      if (abort()) {
+        return -1;
+      }
+      if (millis() - progressAt >= MQTT_WRITE_TIMEOUT_MS) {
+        LOG_W(LOG_TLS, "Escritura TLS detenida %u ms, se cierra el enlace",
+              (unsigned)MQTT_WRITE_TIMEOUT_MS);
+        return -1;
+      }
+      vTaskDelay(pdMS_TO_TICKS(LOOP_IDLE_DELAY_MS));
+    } else {
+      return -1;
+    }
+  }
+  return tlsOpen ? (int)sent : -1;
+}
+
+/**
+ * Lee lo ya recibido; 0 si no hay nada, -1 si el enlace se cerró
+ */
+int tlsLinkRead(uint8_t* out, size_t capacity) {
+  if (!tlsOpen) {
+    return -1;
+  }
+
+  int ret = mbedtls_ssl_read(&tlsSsl, out, capacity);
+  if (ret > 0) {
+    return ret;
+  }
+  if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+    return 0;
+  }
+  return -1;
+}
+
+void tlsLinkClose() {
+  if (!tlsOpen) {
+    return;
+  }
+
+  mbedtls_ssl_close_notify(&tlsSsl);
+  mbedtls_ssl_free(&tlsSsl);
+  mbedtls_net_free(&tlsNet);
+  tlsOpen = false;
+}
@@ -0,0 +1,13 @@
+#ifndef TLS_LINK_H
+#define TLS_LINK_H
+
+#include <Arduino.h>
+#include "hal.h"
+
+// Funciones públicas (solo desde la tarea de E/S del enlace)
+bool tlsLinkConnect(const char* host, uint16_t port, HalHandshake& handshake);
+int tlsLinkWrite(const uint8_t* data, size_t length, bool (*abort)());
+int tlsLinkRead(uint8_t* out, size_t capacity);
+void tlsLinkClose();
+
+#endif // TLS_LINK_H
@@ -0,0 +1,249 @@
+#include "trace.h"
+#include "config.h"
+#include "hal.h"
+#include "spsc_ring.h"
+#include <string.h>
+
+/**
+ * Las lecturas llegan desde la tarea de adquisición por una cola SPSC;
+ * el resto de eventos los genera la tarea de red, dueña del buffer de
+ * salida. traceFlush() vuelca el buffer a la HAL (archivo en LittleFS en
+ * el ESP32, archivo del host en env:native).
+ */
+
+struct TraceReadingEntry {
+  uint32_t timestamp;
+  SensorData data;
+};
+
+bool traceActive = false;
+SpscRing<TraceReadingEntry, 8> traceReadings;   // adquisición -> red
+uint8_t traceBuffer[TRACE_BUFFER_SIZE];         // Propiedad de la tarea de red
+size_t traceLength = 0;
+size_t traceRecords = 0;
+uint32_t traceLost = 0;
+unsigned long lastTraceFlush = 0;
+
+/**
+ * Añade un registro al buffer de salida (solo tarea de red)
+ */
+static bool appendRecord(TraceRecordType type, uint32_t timestamp,
+                         const uint8_t* head, size_t headLength,
+                         const uint8_t* body, size_t bodyLength) {
+  size_t total = headLength + bodyLength;
+
+  if (total > TRACE_MAX_BODY || traceLength + TRACE_HEADER_SIZE + total > sizeof(traceBuffer)) {
+    traceLost++;
+    return false;
+  }
+
+  uint8_t* rec = traceBuffer + traceLength;
+  uint16_t length16 = (uint16_t)total;
+  rec[0] = type;
+  memcpy(rec + 1, &length16, 2);
+  memcpy(rec + 3, &timestamp, 4);
+  memcpy(rec + TRACE_HEADER_SIZE, head, headLength);
+  if (bodyLength > 0) {
+    memcpy(rec + TRACE_HEADER_SIZE + headLength, body, bodyLength);
+  }
+
+  traceLength += TRACE_HEADER_SIZE + total;
+  traceRecords++;
+  return true;
+}
+
+static void appendMessage(TraceRecordType type, const char* topic,
+                          const uint8_t* payload, size_t length) {
+  uint8_t head[1 + 255];
+  size_t topicLength = strlen(topic);
+
+  if (topicLength > 255) {
+    traceLost++;
+    return;
+  }
+
+  head[0] = (uint8_t)topicLength;
+  memcpy(head + 1, topic, topicLength);
+  appendRecord(type, (uint32_t)halMillis(), head, 1 + topicLength, payload, length);
+}
+
+static void appendReading(const TraceReadingEntry& entry) {
+  uint8_t body[21];
+  uint32_t ts = (uint32_t)entry.data.timestamp;
+
+  memcpy(body + 0, &entry.data.temperatura, 4);
+  memcpy(body + 4, &entry.data.humedad, 4);
+  memcpy(body + 8, &entry.data.humedadSuelo, 4);
+  memcpy(body + 12, &entry.data.luminosidad, 4);
+  body[16] = entry.data.valid ? 1 : 0;
+  memcpy(body + 17, &ts, 4);
+
+  appendRecord(TRACE_READING, entry.timestamp, body, sizeof(body), nullptr, 0);
+}
+
+/**
+ * Activa el registro y marca el inicio de una sesión (un arranque)
+ */
+void traceBegin() {
+  uint8_t head[2 + 255];
+  size_t thingLength = strlen(THING_NAME);
+
+  head[0] = TRACE_VERSION;
+  head[1] = (uint8_t)thingLength;
+  memcpy(head + 2, THING_NAME, thingLength);
+
+  traceActive = true;
+  appendRecord(TRACE_START, (uint32_t)halMillis(), head, 2 + thingLength, nullptr, 0);
+}
+
+bool traceEnabled() {
+  return traceActive;
+}
+
+/**
+ * Lectura producida por la adquisición (tarea de adquisición)
+ */
+void traceReading(const SensorData& data) {
+  if (!traceActive) {
+    return;
+  }
+
+  TraceReadingEntry entry = { (uint32_t)halMillis(), data };
+  if (!traceReadings.push(entry)) {
+    traceLost++;
+  }
+}
+
+void traceInbound(const char* topic, const uint8_t* payload, size_t length) {
+  if (traceActive) {
+    appendMessage(TRACE_INBOUND, topic, payload, length);
+  }
+}
+
+void tracePublish(const char* topic, const uint8_t* payload, size_t length) {
+  if (traceActive) {
+    appendMessage(TRACE_PUBLISH, topic, payload, length);
+  }
+}
+
+void traceLink(bool connected) {
+  if (traceActive) {
+    uint8_t body = connected ? 1 : 0;
+    appendRecord(TRACE_LINK, (uint32_t)halMillis(), &body, 1, nullptr, 0);
+  }
+}
+
+/**
+ * Vuelca lo acumulado cada TRACE_FLUSH_INTERVAL_MS, cuando el buffer
+ * pasa de la mitad o si se fuerza (fin de una ejecución en el host)
+ */
+void traceFlush(bool force) {
+  if (!traceActive) {
+    return;
+  }
+
+  TraceReadingEntry entry;
+  while (traceReadings.pop(entry)) {
+    appendReading(entry);
+  }
+
+  unsigned long now = halMillis();
+  if (traceLength == 0 ||
+      (!force && traceLength < sizeof(traceBuffer) / 2 &&
+       now - lastTraceFlush < TRACE_FLUSH_INTERVAL_MS)) {
+    return;
+  }
+
+  if (!halTraceWrite(traceBuffer, traceLength)) {
+    traceLost += traceRecords;
+  }
+
+  traceLength = 0;
+  traceRecords = 0;
+  lastTraceFlush = now;
+}
+
+/**
+ * Registros perdidos por buffer lleno o fallo de escritura
+ */
+uint32_t traceDropped() {
+  return traceLost;
+}
+
+// ============================================
+// LECTURA
+// ============================================
+TraceReader::TraceReader(const uint8_t* data, size_t length)
+  : data(data), length(length), position(0) {}
+
+/**
+ * Siguiente registro válido. Retorna false al final de la traza o si
+ * el último registro está incompleto (ver truncated()).
+ */
+bool TraceReader::next(TraceRecord& record) {
+  if (position + TRACE_HEADER_SIZE > length) {
+    return false;
+  }
+
+  const uint8_t* rec = data + position;
+  uint16_t bodyLength;
+  memcpy(&bodyLength, rec + 1, 2);
+
+  if (position + TRACE_HEADER_SIZE + bodyLength > length) {
+    return false;
+  }
+
+  const uint8_t* body = rec + TRACE_HEADER_SIZE;
+  memset(&record, 0, sizeof(record));
+  record.type = (TraceRecordType)rec[0];
+  memcpy(&record.timestamp, rec + 3, 4);
+
+  switch (record.type) {
+    case TRACE_START:
+      if (bodyLength < 2 || body[0] != TRACE_VERSION || 2u + body[1] > bodyLength) {
+        return false;
+      }
+      record.topic = (const char*)body + 2;
+      record.topicLength = body[1];
+      break;
+
+    case TRACE_READING: {
+      if (bodyLength != 21) {
+        return false;
+      }
+      uint32_t ts;
+      memcpy(&record.reading.temperatura, body + 0, 4);
+      memcpy(&record.reading.humedad, body + 4, 4);
+      memcpy(&record.reading.humedadSuelo, body + 8, 4);
+      memcpy(&record.reading.luminosidad, body + 12, 4);
+      record.reading.valid = body[16] != 0;
+      memcpy(&ts, body + 17, 4);
+      record.reading.timestamp = ts;
+      break;
+    }
+
+    case TRACE_INBOUND:
+    case TRACE_PUBLISH:
+      if (bodyLength < 1 || 1u + body[0] > bodyLength) {
+        return false;
+      }
+      record.topic = (const char*)body + 1;
+      record.topicLength = body[0];
+      record.payload = body + 1 + body[0];
+      record.payloadLength = bodyLength - 1 - body[0];
+      break;
+
+    case TRACE_LINK:
+      if (bodyLength != 1) {
+        return false;
+      }
+      record.connected = body[0] != 0;
+      break;
+
+    default:
+      return false;
+  }
+
+  position += TRACE_HEADER_SIZE + bodyLength;
+  return true;
+}
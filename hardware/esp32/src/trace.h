@@ -0,0 +1,82 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+
+/**
+ * Trazas de registro y reproducción.
+ *
+ * Captura cada lectura producida por la adquisición, cada mensaje MQTT
+ * recibido y publicado y los cambios de conexión con el broker, para
+ * reproducir incidentes de campo en el host (native/replay.cpp).
+ *
+ * Formato: secuencia de registros
+ *   [tipo u8][longitud del cuerpo u16][timestamp ms u32][cuerpo]
+ * Cuerpos:
+ *   TRACE_START    [versión u8][longitud u8][thing]  (uno por arranque)
+ *   TRACE_READING  [4 x float][válido u8][timestamp de la lectura u32]
+ *   TRACE_INBOUND  [longitud u8][topic][payload]
+ *   TRACE_PUBLISH  [longitud u8][topic][payload]
+ *   TRACE_LINK     [conectado u8]
+ * Enteros y floats en little-endian (como en el ESP32).
+ */
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 7
+#define TRACE_MAX_BODY 1024
+
+enum TraceRecordType : uint8_t {
+  TRACE_START = 1,
+  TRACE_READING = 2,
+  TRACE_INBOUND = 3,
+  TRACE_PUBLISH = 4,
+  TRACE_LINK = 5
+};
+
+// ============================================
+// REGISTRO (firmware)
+// ============================================
+// Las funciones trace* no hacen nada hasta llamar a traceBegin().
+// traceReading() se llama desde la tarea de adquisición; el resto, desde la de red.
+void traceBegin();
+bool traceEnabled();
+void traceReading(const SensorData& data);
+void traceInbound(const char* topic, const uint8_t* payload, size_t length);
+void tracePublish(const char* topic, const uint8_t* payload, size_t length);
+void traceLink(bool connected);
+void traceFlush(bool force);
+uint32_t traceDropped();
+
+// ============================================
+// LECTURA (host)
+// ============================================
+struct TraceRecord {
+  TraceRecordType type;
+  uint32_t timestamp;
+  SensorData reading;         // TRACE_READING
+  const char* topic;          // TRACE_INBOUND / TRACE_PUBLISH / TRACE_START (thing)
+  size_t topicLength;
+  const uint8_t* payload;     // TRACE_INBOUND / TRACE_PUBLISH
+  size_t payloadLength;
+  bool connected;             // TRACE_LINK
+};
+
+/**
+ * Recorre una traza en memoria sin copiarla. Los punteros de cada
+ * registro apuntan al buffer original.
+ */
+class TraceReader {
+public:
+  TraceReader(const uint8_t* data, size_t length);
+
+  bool next(TraceRecord& record);
+  bool truncated() const { return position < length; }
+
+private:
+  const uint8_t* data;
+  size_t length;
+  size_t position;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,42 @@
+#include "window_stats.h"
+#include <math.h>
+
+RunningStats::RunningStats() {
+  reset();
+}
+
+void RunningStats::reset() {
+  samples = 0;
+  average = 0;
+  m2 = 0;
+  minimum = 0;
+  maximum = 0;
+}
+
+void RunningStats::add(float sample) {
+  samples++;
+  if (samples == 1) {
+    minimum = sample;
+    maximum = sample;
+  } else if (sample < minimum) {
+    minimum = sample;
+  } else if (sample > maximum) {
+    maximum = sample;
+  }
+
+  float delta = sample - average;
+  average += delta / samples;
+  m2 += delta * (sample - average);
+}
+
+/**
+ * Desviación típica muestral (n - 1); 0 con menos de dos muestras
+ */
+float RunningStats::stddev() const {
+  return samples > 1 ? sqrtf(m2 / (samples - 1)) : 0.0f;
+}
+
+MetricSummary RunningStats::summary() const {
+  MetricSummary result = { minimum, maximum, average, stddev(), samples };
+  return result;
+}
@@ -0,0 +1,36 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_data.h"
+
+/**
+ * Estadísticos de una ventana de muestras en O(1) de memoria: mínimo,
+ * máximo, media y desviación típica por el método de Welford (estable en
+ * float, sin restar sumas grandes). Cada muestra cuesta unas pocas
+ * operaciones y ninguna memoria dinámica. Portable (compila en el host).
+ */
+class RunningStats {
+public:
+  RunningStats();
+
+  void reset();
+  void add(float sample);
+
+  uint32_t count() const { return samples; }
+  float mean() const { return average; }
+  float stddev() const;
+
+  // Resumen de la ventana (count 0 si no hubo muestras)
+  MetricSummary summary() const;
+
+private:
+  uint32_t samples;
+  float average;
+  float m2;           // Suma de cuadrados de las desviaciones
+  float minimum;
+  float maximum;
+};
+
+#endif // WINDOW_STATS_H